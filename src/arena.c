@@ -0,0 +1,256 @@
+/*
+ *  arena.c: An arena of locked i/o buffers that is mapped once at startup.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <sys/mman.h>
+
+#include "nwipe.h"
+#include "context.h"
+#include "method.h"
+#include "prng.h"
+#include "options.h"
+#include "logging.h"
+#include "arena.h"
+
+/* The mapping, or NULL when buffers come from the heap. */
+static char* nwipe_arena = NULL;
+
+/* The length of the mapping. */
+static size_t nwipe_arena_mapped = 0;
+
+/* Set when the mapping is in huge pages. */
+static int nwipe_arena_hugepage = 0;
+
+/* Set for each slot that belongs to a buffer, and for the first slot of a buffer, the slots it spans. */
+static char* nwipe_arena_state = NULL;
+static int* nwipe_arena_span = NULL;
+static int nwipe_arena_slots = 0;
+
+/* Set for each slot that has been locked into memory, only read and written by the owner of the slot. */
+static char* nwipe_arena_locked = NULL;
+
+/* The slots in use, the most that were ever in use, and the buffers that were refused. */
+static int nwipe_arena_used = 0;
+static int nwipe_arena_peak = 0;
+static int nwipe_arena_misses = 0;
+
+/* Serializes the slot states. */
+static pthread_mutex_t nwipe_arena_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+int nwipe_arena_init( size_t size )
+{
+    /**
+     * Reserves the address space and, for huge pages, the pages of the arena. Nothing is
+     * touched here, so that each slot is faulted in by the thread that first uses it.
+     */
+
+    size = ( size + NWIPE_KNOB_HUGEPAGE_SIZE - 1 ) / NWIPE_KNOB_HUGEPAGE_SIZE * NWIPE_KNOB_HUGEPAGE_SIZE;
+
+    if( size == 0 )
+    {
+        return -1;
+    }
+
+    nwipe_arena = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0 );
+    nwipe_arena_hugepage = ( nwipe_arena != MAP_FAILED );
+
+    if( nwipe_arena == MAP_FAILED )
+    {
+        /* Not enough huge pages are reserved, so ask for transparent ones instead. */
+        nwipe_arena = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+
+        if( nwipe_arena != MAP_FAILED )
+        {
+            madvise( nwipe_arena, size, MADV_HUGEPAGE );
+        }
+    }
+
+    if( nwipe_arena == MAP_FAILED )
+    {
+        nwipe_perror( errno, __FUNCTION__, "mmap" );
+        nwipe_log( NWIPE_LOG_WARNING, "Unable to map %zu bytes of i/o buffers, using the heap.", size );
+        nwipe_arena = NULL;
+        return -1;
+    }
+
+    nwipe_arena_mapped = size;
+    nwipe_arena_slots = size / NWIPE_KNOB_ARENA_SLOT;
+    nwipe_arena_state = calloc( nwipe_arena_slots, sizeof( char ) );
+    nwipe_arena_span = calloc( nwipe_arena_slots, sizeof( int ) );
+    nwipe_arena_locked = calloc( nwipe_arena_slots, sizeof( char ) );
+
+    if( nwipe_arena_state == NULL || nwipe_arena_span == NULL || nwipe_arena_locked == NULL )
+    {
+        nwipe_perror( errno, __FUNCTION__, "calloc" );
+        munmap( nwipe_arena, size );
+        free( nwipe_arena_state );
+        free( nwipe_arena_span );
+        free( nwipe_arena_locked );
+        nwipe_arena = NULL;
+        return -1;
+    }
+
+    nwipe_log( NWIPE_LOG_NOTICE,
+               "Mapped %zu bytes of i/o buffers in %s pages.",
+               size,
+               nwipe_arena_hugepage ? "huge" : "normal" );
+
+    return 0;
+
+} /* nwipe_arena_init */
+
+void* nwipe_arena_get( size_t size )
+{
+    /* The buffer. */
+    void* buffer = NULL;
+
+    /* The number of slots of the buffer. */
+    int n;
+
+    /* The first slot of a run of free slots, and the slot being looked at. */
+    int first;
+    int i;
+
+    int r;
+
+    n = ( size + NWIPE_KNOB_ARENA_SLOT - 1 ) / NWIPE_KNOB_ARENA_SLOT;
+
+    if( nwipe_arena != NULL && n > 0 )
+    {
+        pthread_mutex_lock( &nwipe_arena_mutex );
+
+        for( first = 0, i = 0; i < nwipe_arena_slots && i - first < n; i++ )
+        {
+            if( nwipe_arena_state[i] )
+            {
+                /* Skip the buffer that owns the slot. */
+                i += nwipe_arena_span[i] - 1;
+                first = i + 1;
+            }
+        }
+
+        if( i - first == n )
+        {
+            for( i = first; i < first + n; i++ )
+            {
+                nwipe_arena_state[i] = 1;
+            }
+
+            nwipe_arena_span[first] = n;
+            nwipe_arena_used += n;
+
+            if( nwipe_arena_used > nwipe_arena_peak )
+            {
+                nwipe_arena_peak = nwipe_arena_used;
+            }
+
+            buffer = &nwipe_arena[(size_t) first * NWIPE_KNOB_ARENA_SLOT];
+        }
+        else
+        {
+            nwipe_arena_misses += 1;
+        }
+
+        pthread_mutex_unlock( &nwipe_arena_mutex );
+
+        if( buffer == NULL )
+        {
+            /* The arena is the cap on buffer memory, so a buffer that does not fit is refused. */
+            nwipe_log( NWIPE_LOG_ERROR,
+                       "No room for a buffer of %zu bytes in the %zu bytes of --buffers.",
+                       size,
+                       nwipe_arena_mapped );
+            errno = ENOMEM;
+            return NULL;
+        }
+
+        /* Only the owner touches the locked flags of its slots, so they are set outside of the mutex. */
+        for( i = first; i < first + n; i++ )
+        {
+            if( !nwipe_arena_locked[i] )
+            {
+                /* Locking faults the pages in, on the NUMA node of this thread. */
+                if( mlock( &nwipe_arena[(size_t) i * NWIPE_KNOB_ARENA_SLOT], NWIPE_KNOB_ARENA_SLOT ) == 0 )
+                {
+                    nwipe_arena_locked[i] = 1;
+                }
+            }
+        }
+
+        return buffer;
+    }
+
+    r = posix_memalign( &buffer, NWIPE_KNOB_IO_ALIGN, size );
+
+    if( r != 0 )
+    {
+        errno = r;
+        return NULL;
+    }
+
+    return buffer;
+
+} /* nwipe_arena_get */
+
+void nwipe_arena_put( void* buffer )
+{
+    /* The first slot of the buffer. */
+    int first;
+
+    int i;
+
+    if( buffer == NULL )
+    {
+        return;
+    }
+
+    if( nwipe_arena == NULL || (char*) buffer < nwipe_arena || (char*) buffer >= nwipe_arena + nwipe_arena_mapped )
+    {
+        free( buffer );
+        return;
+    }
+
+    first = ( (char*) buffer - nwipe_arena ) / NWIPE_KNOB_ARENA_SLOT;
+
+    pthread_mutex_lock( &nwipe_arena_mutex );
+
+    for( i = first; i < first + nwipe_arena_span[first]; i++ )
+    {
+        nwipe_arena_state[i] = 0;
+    }
+
+    nwipe_arena_used -= nwipe_arena_span[first];
+    nwipe_arena_span[first] = 0;
+
+    pthread_mutex_unlock( &nwipe_arena_mutex );
+
+} /* nwipe_arena_put */
+
+void nwipe_arena_log( void )
+{
+    if( nwipe_arena == NULL )
+    {
+        return;
+    }
+
+    nwipe_log( NWIPE_LOG_NOTIMESTAMP,
+               "I/O buffers: %zu of %zu bytes used at most, %i buffers did not fit and were refused",
+               (size_t) nwipe_arena_peak * NWIPE_KNOB_ARENA_SLOT,
+               nwipe_arena_mapped,
+               nwipe_arena_misses );
+
+} /* nwipe_arena_log */
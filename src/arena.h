@@ -0,0 +1,43 @@
+/*
+ *  arena.h: An arena of locked i/o buffers that is mapped once at startup.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+/*
+ * With --buffers=SIZE the i/o buffers of the passes come from one mapping of SIZE bytes, in huge
+ * pages when the system has them reserved. The mapping is cut into slots of NWIPE_KNOB_ARENA_SLOT
+ * bytes and a buffer takes the first run of free slots that it fits. Slots are locked into
+ * memory by the first thread that uses them, which also places them on the NUMA node of that
+ * thread. The arena caps the buffer memory, so a buffer that does not fit is refused. Without
+ * --buffers, buffers come from the heap as before.
+ */
+
+/* Maps an arena of 'size' bytes. Returns zero on success, the heap is used otherwise. */
+int nwipe_arena_init( size_t size );
+
+/* Returns a NWIPE_KNOB_IO_ALIGN aligned buffer of 'size' bytes, or NULL with errno set. */
+void* nwipe_arena_get( size_t size );
+
+/* Returns a buffer of nwipe_arena_get(), NULL is ignored. */
+void nwipe_arena_put( void* buffer );
+
+/* Logs the size and the high water mark of the arena. */
+void nwipe_arena_log( void );
+
+#endif /* ARENA_H_ */
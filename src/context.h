@@ -56,6 +56,20 @@ typedef enum nwipe_select_t_ {
 
 #define NWIPE_KNOB_SPEEDRING_SIZE 30
 #define NWIPE_KNOB_SPEEDRING_GRANULARITY 10
+#define NWIPE_KNOB_SLOWEST 5  // The number of slowest devices that the statistics keep.
+#define NWIPE_KNOB_FAILING 8  // The number of failing devices that the statistics keep.
+
+/* The state of a device, as counted by the statistics. */
+typedef enum nwipe_state_t_ {
+    NWIPE_STATE_WAITING = 0,  // The wipe has not started.
+    NWIPE_STATE_WRITING,  // Writing a pass.
+    NWIPE_STATE_VERIFYING,  // Verifying a pass.
+    NWIPE_STATE_BLANKING,  // Writing the final blank.
+    NWIPE_STATE_SYNCING,  // Flushing writes to the device.
+    NWIPE_STATE_DONE,  // The wipe succeeded.
+    NWIPE_STATE_FAILED,  // The wipe failed.
+    NWIPE_STATE_COUNT  // The number of states.
+} nwipe_state_t;
 
 typedef struct nwipe_speedring_t_
 {
@@ -68,7 +82,83 @@ typedef struct nwipe_speedring_t_
     u32 position;
 } nwipe_speedring_t;
 
+/* The stages of a wipe that CPU time is attributed to. */
+typedef enum nwipe_stage_t_ {
+    NWIPE_STAGE_PRNG = 0,  // Generating random data.
+    NWIPE_STAGE_PATTERN,  // Building static pattern buffers.
+    NWIPE_STAGE_COMPARE,  // Comparing data that was read back.
+    NWIPE_STAGE_SUBMIT,  // Submitting reads, writes and discards.
+    NWIPE_STAGE_SYNC,  // Flushing writes to the device.
+    NWIPE_STAGE_DIGEST,  // Computing the digests of written and read data.
+    NWIPE_STAGE_COUNT  // The number of stages.
+} nwipe_stage_t;
+
+/* Attributes the CPU time of one thread to the stages of a wipe, see cpu.h. */
+typedef struct nwipe_cpu_meter_t_
+{
+    struct nwipe_context_t_* c;  // The device that the thread works on.
+    u64 start;  // The CPU time of the thread when metering started, in nanoseconds.
+    u64 last;  // The CPU time of the thread at the last mark.
+    double sampled[NWIPE_STAGE_COUNT];  // The weighted CPU time that sampled marks saw in each stage.
+    u64 skipped;  // The number of bytes since the last sampled iteration.
+    double weight;  // The number of iterations the current marks stand for, zero while they are not sampled.
+} nwipe_cpu_meter_t;
+
+/* Samples of the block layer statistics of a device, from /sys/class/block/<dev>/stat and inflight. */
+typedef struct nwipe_iostat_t_
+{
+    int stat_fd;  // The open stat file, or -1.
+    int inflight_fd;  // The open inflight file, or -1.
+    double sampled;  // The monotonic time of the last sample in seconds, zero before the first sample.
+    u64 ios;  // The completed reads and writes at the last sample.
+    u64 merges;  // The merged reads and writes at the last sample.
+    u64 io_ticks;  // The milliseconds that the device had been busy at the last sample.
+    double utilization;  // The percentage of the last interval that the device was busy, negative when unknown.
+    int inflight;  // The requests that were in flight at the last sample.
+    double service_time;  // The average milliseconds that the device was busy for each request in the last interval.
+    double merge_rate;  // The requests per second that were merged in the last interval.
+} nwipe_iostat_t;
+
+/* A byte range of a device. */
+typedef struct nwipe_extent_t_
+{
+    u64 start;  // The device offset of the range.
+    u64 length;  // The length of the range.
+} nwipe_extent_t;
+
+/* The threads of one device that do i/o at once and follow changes of its i/o priority. */
+#define NWIPE_IO_THREADS 8
+
+/* The number of written back windows of a pass that are not dropped from the page cache yet. */
+#define NWIPE_WRITEBACK_WINDOWS 4
+
+/* The buffered writes of a pass that are written back and dropped from the page cache as it goes. */
+typedef struct nwipe_writeback_t_
+{
+    u64 start;  // The device offset of the writes that have not been written back yet.
+    u64 end;  // The device offset that follows the last write.
+    int count;  // The number of windows in window[].
+    int failed;  // Set when the kernel refused, the rest of the pass is left to the page cache.
+    nwipe_extent_t window[NWIPE_WRITEBACK_WINDOWS];  // The windows that are being written back, the oldest first.
+} nwipe_writeback_t;
+
+/* The duration and size of one pass or verification of a wipe, for the summary. */
+typedef struct nwipe_pass_timing_t_
+{
+    int op;  // The nwipe_step_op_t of the step.
+    nwipe_pass_t pass_type;  // What the step was shown as.
+    int round;  // The round of the step, zero for the steps that follow the last round.
+    int pass;  // The pass of the step within its round.
+    u64 bytes;  // The bytes that the step read or wrote.
+    double seconds;  // The monotonic wall time of the step.
+    double sync_seconds;  // The part of the wall time that was spent in fdatasync().
+    u64 errors;  // The pass errors or verification errors of the step.
+    int result;  // The result of the step, negative when it failed.
+    char root[65];  // The Merkle root of the data of the step in hexadecimal, empty without --digest.
+} nwipe_pass_timing_t;
+
 #define NWIPE_DEVICE_LABEL_LENGTH 200
+#define NWIPE_DEVICE_CONTROLLER_LENGTH 32
 #define NWIPE_DEVICE_SIZE_TXT_LENGTH 7
 
 typedef struct nwipe_context_t_
@@ -97,8 +187,27 @@ typedef struct nwipe_context_t_
     char device_type_str[14];  // Indicates an IDE, SCSI, USB etc as per nwipe_device_t but in ascii
     char device_serial_no[21];  // Serial number(processed, 20 characters plus null termination) of the device.
     int device_target;  // The device target.
+    int device_zone_count;  // The number of zones of a zoned device, zero when the device is not zoned.
+    int device_zone_open;  // The number of zones that the device can write at once, zero when unlimited.
+    struct nwipe_zone_t_* device_zones;  // The zone layout of a zoned device.
+    char device_controller[NWIPE_DEVICE_CONTROLLER_LENGTH];  // The PCI address of the controller, or the bus type.
+    int device_group;  // The controller group of the device in the status screen.
+    nwipe_iostat_t device_iostat;  // The block layer statistics of the device.
+    int io_priority;  // The ioprio_set() priority of the threads of the device, zero to inherit it.
+    pid_t io_tid[NWIPE_IO_THREADS];  // The threads that do the i/o of the device, zero for a free slot.
+    uint32_t digest_crc;  // The CRC32C of the chunk of the random pass that is being written.
+    u64 digest_count;  // The number of chunks in digests[].
+    size_t digest_fill;  // The bytes of the chunk that is being written.
+    u64 digest_index;  // The index of the chunk that is being written.
+    size_t digest_mapped;  // The size of the temporary file mapping of digests[], zero when it is on the heap.
+    int digest_valid;  // Set while digests[] holds every chunk of the last random pass.
+    uint32_t* digests;  // The CRC32C of each chunk of the last random pass.
+    u64 cpu_time[NWIPE_STAGE_COUNT];  // The CPU nanoseconds that all threads of the wipe spent in each stage.
+    nwipe_cpu_meter_t cpu_meter;  // The CPU meter of the wipe thread.
 
     u64 eta;  // The estimated number of seconds until method completion.
+    int extent_count;  // The number of byte ranges that each pass covers.
+    nwipe_extent_t* extents;  // The byte ranges that each pass covers, sorted and disjoint.
     int entropy_fd;  // The entropy source. Usually /dev/urandom.
     int pass_count;  // The number of passes performed by the working wipe method.
     u64 pass_done;  // The number of bytes that have already been i/o'd in this pass.
@@ -106,9 +215,11 @@ typedef struct nwipe_context_t_
     u64 pass_size;  // The total number of i/o bytes across all passes.
     nwipe_pass_t pass_type;  // The type of the current working pass.
     int pass_working;  // The current working pass.
+    double preflight_rate;  // The read rate that the pre-flight measured in bytes per second, zero when unknown.
     nwipe_prng_t* prng;  // The PRNG implementation.
     nwipe_entropy_t prng_seed;  // The random data that is used to seed the PRNG.
     void* prng_state;  // The private internal state of the PRNG.
+    struct nwipe_merkle_t_* merkle;  // The digest of the current step, NULL without --digest.
     int result;  // The process return value.
     int round_count;  // The number of rounds performed by the working wipe method.
     u64 round_done;  // The number of bytes that have already been i/o'd.
@@ -120,9 +231,17 @@ typedef struct nwipe_context_t_
     int signal;  // Set when the child is killed by a signal.
     nwipe_speedring_t speedring;  // Ring buffer for computing the rolling throughput average.
     short sync_status;  // A flag to indicate when the method is syncing.
+    double sync_time;  // The number of seconds spent in fdatasync() across all passes.
     pthread_t thread;  // The ID of the thread.
+    int timing_count;  // The number of finished steps in timings[].
+    nwipe_pass_timing_t* timings;  // The duration and size of each finished step of the wipe.
     u64 throughput;  // Average throughput in bytes per second.
     u64 verify_errors;  // The number of verification errors across all passes.
+    u64 verify_done;  // The number of bytes read by verification across all passes.
+    double verify_time;  // The number of seconds spent in verification across all passes.
+    u64 verify_throughput;  // Average verification read rate in bytes per second.
+    u64 wipe_size;  // The number of bytes that each pass covers.
+    nwipe_writeback_t writeback;  // The writes of the current pass that are still in the page cache.
     int wipe_status;  // Wipe finished = 0, wipe in progress = 1, wipe yet to start = -1.
     int spinner_idx;  // Index into the spinner character array
     char spinner_character[1];  // The current spinner character
@@ -138,6 +257,17 @@ typedef struct nwipe_context_t_
     struct hd_driveid identity;
 } nwipe_context_t;
 
+/* The combined progress of the devices on one controller. */
+typedef struct nwipe_group_t_
+{
+    const char* controller;  // The controller, as in the device contexts.
+    int count;  // The number of devices.
+    int active;  // The number of devices that are being wiped.
+    int failed;  // The number of devices that have failed or have errors.
+    u64 throughput;  // The combined throughput.
+    double percent;  // The lowest percentage complete.
+} nwipe_group_t;
+
 /*
  * We use 2 data structs to pass data between threads.
  * The first contains any required values.
@@ -150,6 +280,13 @@ typedef struct
     time_t maxeta;  // The estimated runtime of the slowest device.
     u64 throughput;  // Total throughput.
     u64 errors;  // The combined number of errors of all processes.
+    int states[NWIPE_STATE_COUNT];  // The number of devices in each state.
+    int slowest[NWIPE_KNOB_SLOWEST];  // The active devices with the lowest throughput, slowest first.
+    int slowest_count;  // The number of devices in slowest[].
+    int failing[NWIPE_KNOB_FAILING];  // The first devices that have failed or have errors.
+    int failing_count;  // The number of devices that have failed or have errors, which may exceed failing[].
+    nwipe_group_t* groups;  // The devices grouped by controller, or NULL when not grouped.
+    int group_count;  // The number of groups.
     pthread_t* gui_thread;  // The ID of GUI thread.
 } nwipe_misc_thread_data_t;
 
@@ -0,0 +1,217 @@
+/*
+ *  cpu.c: CPU time accounting of the stages of a wipe.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "nwipe.h"
+#include "context.h"
+#include "method.h"
+#include "prng.h"
+#include "options.h"
+#include "cpu.h"
+
+/* The names of the stages, in the order of nwipe_stage_t. */
+static const char* nwipe_cpu_stage_names[NWIPE_STAGE_COUNT] = { "prng", "pattern", "compare", "submit", "sync", "digest" };
+
+static u64 nwipe_cpu_now( void )
+{
+    /**
+     * Returns the CPU time of the calling thread in nanoseconds.
+     */
+
+    struct timespec t;
+
+    if( clock_gettime( CLOCK_THREAD_CPUTIME_ID, &t ) != 0 )
+    {
+        return 0;
+    }
+
+    return (u64) t.tv_sec * 1000000000ULL + (u64) t.tv_nsec;
+
+} /* nwipe_cpu_now */
+
+void nwipe_cpu_start( nwipe_cpu_meter_t* m, nwipe_context_t* c )
+{
+    memset( m, 0, sizeof( nwipe_cpu_meter_t ) );
+    m->c = c;
+    m->start = nwipe_cpu_now();
+
+} /* nwipe_cpu_start */
+
+void nwipe_cpu_next( nwipe_cpu_meter_t* m, size_t length )
+{
+    /**
+     * Reading the thread CPU clock costs a few hundred nanoseconds, which is more than some stages
+     * of a single block take, so only one iteration in every NWIPE_KNOB_CPU_SAMPLE bytes is timed
+     * and stands for all of the iterations since the previous sample.
+     */
+
+    m->skipped += length;
+
+    if( m->skipped >= NWIPE_KNOB_CPU_SAMPLE && length > 0 )
+    {
+        m->weight = (double) m->skipped / length;
+        m->skipped = 0;
+        m->last = nwipe_cpu_now();
+    }
+    else
+    {
+        m->weight = 0;
+    }
+
+} /* nwipe_cpu_next */
+
+void nwipe_cpu_span( nwipe_cpu_meter_t* m )
+{
+    m->weight = 1;
+    m->last = nwipe_cpu_now();
+
+} /* nwipe_cpu_span */
+
+void nwipe_cpu_mark( nwipe_cpu_meter_t* m, nwipe_stage_t stage )
+{
+    u64 now;
+
+    if( m->weight == 0 )
+    {
+        return;
+    }
+
+    now = nwipe_cpu_now();
+    m->sampled[stage] += (double) ( now - m->last ) * m->weight;
+    m->last = now;
+
+} /* nwipe_cpu_mark */
+
+void nwipe_cpu_stop( nwipe_cpu_meter_t* m )
+{
+    /**
+     * The samples only estimate the share of each stage, so the exact CPU time of the thread is
+     * split in their proportion. The time of a thread without samples counts as submission.
+     */
+
+    /* The CPU time of the thread since nwipe_cpu_start(). */
+    u64 total;
+
+    /* The sum of the samples. */
+    double sampled = 0;
+
+    /* The CPU time given to the stages so far. */
+    u64 given = 0;
+
+    /* The share of one stage. */
+    u64 share;
+
+    int i;
+
+    if( m->c == NULL )
+    {
+        return;
+    }
+
+    total = nwipe_cpu_now() - m->start;
+
+    for( i = 0; i < NWIPE_STAGE_COUNT; i++ )
+    {
+        sampled += m->sampled[i];
+    }
+
+    if( sampled <= 0 )
+    {
+        __sync_fetch_and_add( &m->c->cpu_time[NWIPE_STAGE_SUBMIT], total );
+        m->c = NULL;
+        return;
+    }
+
+    for( i = 0; i < NWIPE_STAGE_COUNT; i++ )
+    {
+        share = ( i == NWIPE_STAGE_COUNT - 1 ) ? total - given : (u64) ( total * ( m->sampled[i] / sampled ) );
+        if( share > total - given )
+        {
+            share = total - given;
+        }
+        given += share;
+        __sync_fetch_and_add( &m->c->cpu_time[i], share );
+    }
+
+    m->c = NULL;
+
+} /* nwipe_cpu_stop */
+
+void nwipe_cpu_cleanup( void* ptr )
+{
+    nwipe_cpu_stop( (nwipe_cpu_meter_t*) ptr );
+
+} /* nwipe_cpu_cleanup */
+
+double nwipe_cpu_hz( void )
+{
+    /**
+     * The nominal maximum from cpufreq, or the current rate from /proc/cpuinfo without cpufreq,
+     * which is close enough for turning nanoseconds into cycles.
+     */
+
+    /* The cached result, negative until it is known. */
+    static double hz = -1;
+
+    FILE* fp;
+    char line[256];
+    double value;
+
+    if( hz >= 0 )
+    {
+        return hz;
+    }
+    hz = 0;
+
+    fp = fopen( "/sys/devices/system/cpu/cpu0/cpufreq/cpuinfo_max_freq", "r" );
+    if( fp != NULL )
+    {
+        /* The file is in kHz. */
+        if( fscanf( fp, "%lf", &value ) == 1 && value > 0 )
+        {
+            hz = value * 1000;
+        }
+        fclose( fp );
+        if( hz > 0 )
+        {
+            return hz;
+        }
+    }
+
+    fp = fopen( "/proc/cpuinfo", "r" );
+    if( fp != NULL )
+    {
+        while( fgets( line, sizeof( line ), fp ) != NULL )
+        {
+            if( sscanf( line, "cpu MHz : %lf", &value ) == 1 && value > 0 )
+            {
+                hz = value * 1000000;
+                break;
+            }
+        }
+        fclose( fp );
+    }
+
+    return hz;
+
+} /* nwipe_cpu_hz */
+
+const char* nwipe_cpu_stage_name( nwipe_stage_t stage )
+{
+    return nwipe_cpu_stage_names[stage];
+
+} /* nwipe_cpu_stage_name */
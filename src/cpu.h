@@ -0,0 +1,54 @@
+/*
+ *  cpu.h: CPU time accounting of the stages of a wipe.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef CPU_H_
+#define CPU_H_
+
+/*
+ * A meter belongs to one thread. The loop of the thread calls nwipe_cpu_next() at the top of each
+ * iteration and nwipe_cpu_mark() after each stage, which only read the thread CPU clock once in
+ * every NWIPE_KNOB_CPU_SAMPLE bytes. Work outside a loop is bracketed with nwipe_cpu_span().
+ * nwipe_cpu_stop() adds the exact CPU time of the thread to c->cpu_time, split between the stages
+ * in proportion to the samples.
+ */
+
+/* Starts metering the calling thread for the device. */
+void nwipe_cpu_start( nwipe_cpu_meter_t* m, nwipe_context_t* c );
+
+/* Starts an iteration of a loop over 'length' bytes. */
+void nwipe_cpu_next( nwipe_cpu_meter_t* m, size_t length );
+
+/* Starts work outside a loop, which is always sampled. */
+void nwipe_cpu_span( nwipe_cpu_meter_t* m );
+
+/* Attributes the CPU time since the last mark to the stage, if the iteration is sampled. */
+void nwipe_cpu_mark( nwipe_cpu_meter_t* m, nwipe_stage_t stage );
+
+/* Stops metering and adds the CPU time of the thread to the device. */
+void nwipe_cpu_stop( nwipe_cpu_meter_t* m );
+
+/* Calls nwipe_cpu_stop() from a cancellation cleanup handler. */
+void nwipe_cpu_cleanup( void* ptr );
+
+/* Returns the clock rate of the processor in hertz, or 0 if it is unknown. */
+double nwipe_cpu_hz( void );
+
+/* Returns the name of a stage. */
+const char* nwipe_cpu_stage_name( nwipe_stage_t stage );
+
+#endif /* CPU_H_ */
@@ -40,6 +40,7 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <ctype.h>
+#include <limits.h>
 
 #include <parted/parted.h>
 #include <parted/debug.h>
@@ -291,6 +292,8 @@ int check_device( nwipe_context_t*** c, PedDevice* dev, int dcount )
             break;
     }
 
+    nwipe_device_controller( next_device );
+
     if( strlen( (const char*) next_device->device_serial_no ) )
     {
         snprintf( next_device->device_label,
@@ -670,6 +673,62 @@ int nwipe_get_device_bus_type_and_serialno( char* device, nwipe_device_t* bus, c
     return set_return_value;
 }
 
+void nwipe_device_controller( nwipe_context_t* c )
+{
+    /**
+     * Finds the controller of a device from its sysfs path, which is the last PCI function on the path. Devices that
+     * have no PCI controller use their bus type instead.
+     *
+     * @parameter c  The device context.
+     * @modifies  c->device_controller
+     *
+     */
+
+    /* The sysfs link of the device and its target. */
+    char link[PATH_MAX];
+    char target[PATH_MAX];
+
+    /* The kernel name of the device. */
+    const char* name;
+
+    /* The length of the target. */
+    ssize_t length;
+
+    /* The current path component. */
+    char* component;
+
+    /* The fields of a PCI address. */
+    unsigned int domain, bus, slot, function;
+
+    /* The number of characters in a PCI address. */
+    int n;
+
+    snprintf( c->device_controller, sizeof( c->device_controller ), "%s", c->device_type_str );
+    trim( c->device_controller );
+
+    name = strrchr( c->device_name, '/' );
+    name = name ? name + 1 : c->device_name;
+
+    snprintf( link, sizeof( link ), "/sys/block/%s", name );
+    length = readlink( link, target, sizeof( target ) - 1 );
+    if( length < 0 )
+    {
+        return;
+    }
+    target[length] = 0;
+
+    for( component = strtok( target, "/" ); component != NULL; component = strtok( NULL, "/" ) )
+    {
+        n = 0;
+        if( sscanf( component, "%4x:%2x:%2x.%1x%n", &domain, &bus, &slot, &function, &n ) == 4
+            && component[n] == 0 )
+        {
+            snprintf( c->device_controller, sizeof( c->device_controller ), "%s", component );
+        }
+    }
+
+} /* nwipe_device_controller */
+
 void strip_CR_LF( char* str )
 {
     /* In the specified string, replace any CR or LF with a space */
@@ -27,6 +27,7 @@ void nwipe_device_identify( nwipe_context_t* c );  // Get hardware information a
 int nwipe_device_scan( nwipe_context_t*** c );  // Find devices that we can wipe.
 int nwipe_device_get( nwipe_context_t*** c, char** devnamelist, int ndevnames );  // Get info about devices to wipe.
 int nwipe_get_device_bus_type_and_serialno( char*, nwipe_device_t*, char* );
+void nwipe_device_controller( nwipe_context_t* c );  // Find the controller that the device is attached to.
 void strip_CR_LF( char* );
 void determine_disk_capacity_nomenclature( u64, char* );
 void remove_ATA_prefix( char* );
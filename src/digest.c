@@ -0,0 +1,559 @@
+/*
+ *  digest.c: CRC32C digests of the chunks of a random pass, for its verification.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <limits.h>
+#include <stdint.h>
+#include <sys/mman.h>
+
+#include "nwipe.h"
+#include "context.h"
+#include "method.h"
+#include "prng.h"
+#include "options.h"
+#include "logging.h"
+#include "digest.h"
+
+#if defined( __x86_64__ )
+#include <nmmintrin.h>
+#define NWIPE_CRC32C_SSE42 1
+#elif defined( __aarch64__ ) && defined( __ARM_FEATURE_CRC32 )
+#include <arm_acle.h>
+#define NWIPE_CRC32C_ARMV8 1
+#endif
+
+/* The reflected Castagnoli polynomial. */
+#define NWIPE_CRC32C_POLY 0x82F63B78
+
+/* The slicing-by-8 tables of the portable implementation. */
+static uint32_t nwipe_crc32c_table[8][256];
+
+/*
+ * The instructions take three cycles but issue one per cycle, so the hardware implementations
+ * run three independent streams over the lanes of a block and shift the first two over the
+ * lanes that follow them. Long lanes cover most of a chunk and short ones most of the rest.
+ */
+#define NWIPE_CRC32C_LONG 8192
+#define NWIPE_CRC32C_SHORT 256
+
+/* The tables that shift a CRC over a long and a short lane of zeros. */
+static uint32_t nwipe_crc32c_long[4][256];
+static uint32_t nwipe_crc32c_short[4][256];
+
+/* The implementation that nwipe_crc32c() calls, and its name. */
+static uint32_t ( *nwipe_crc32c_impl )( uint32_t crc, const u8* p, size_t length );
+static const char* nwipe_crc32c_impl_name;
+
+static pthread_once_t nwipe_crc32c_once = PTHREAD_ONCE_INIT;
+
+static uint32_t nwipe_crc32c_sw( uint32_t crc, const u8* p, size_t length )
+{
+    u64 w;
+
+    while( length > 0 && ( (uintptr_t) p & 7 ) != 0 )
+    {
+        crc = nwipe_crc32c_table[0][( crc ^ *p++ ) & 0xFF] ^ ( crc >> 8 );
+        length--;
+    }
+
+    while( length >= 8 )
+    {
+        /* The tables assume the little-endian byte order of the word. */
+        w = (u64) p[0] | (u64) p[1] << 8 | (u64) p[2] << 16 | (u64) p[3] << 24 | (u64) p[4] << 32
+            | (u64) p[5] << 40 | (u64) p[6] << 48 | (u64) p[7] << 56;
+        w ^= crc;
+
+        crc = nwipe_crc32c_table[7][w & 0xFF] ^ nwipe_crc32c_table[6][( w >> 8 ) & 0xFF]
+            ^ nwipe_crc32c_table[5][( w >> 16 ) & 0xFF] ^ nwipe_crc32c_table[4][( w >> 24 ) & 0xFF]
+            ^ nwipe_crc32c_table[3][( w >> 32 ) & 0xFF] ^ nwipe_crc32c_table[2][( w >> 40 ) & 0xFF]
+            ^ nwipe_crc32c_table[1][( w >> 48 ) & 0xFF] ^ nwipe_crc32c_table[0][w >> 56];
+
+        p += 8;
+        length -= 8;
+    }
+
+    while( length > 0 )
+    {
+        crc = nwipe_crc32c_table[0][( crc ^ *p++ ) & 0xFF] ^ ( crc >> 8 );
+        length--;
+    }
+
+    return crc;
+
+} /* nwipe_crc32c_sw */
+
+static uint32_t nwipe_crc32c_multiply( uint32_t a, uint32_t b )
+{
+    /**
+     * Multiplies two polynomials modulo the Castagnoli polynomial, in the reflected bit order.
+     */
+
+    uint32_t m = (uint32_t) 1 << 31;
+    uint32_t p = 0;
+
+    for( ; m != 0; m >>= 1 )
+    {
+        if( a & m )
+        {
+            p ^= b;
+        }
+
+        b = ( b & 1 ) ? ( b >> 1 ) ^ NWIPE_CRC32C_POLY : b >> 1;
+    }
+
+    return p;
+
+} /* nwipe_crc32c_multiply */
+
+static void nwipe_crc32c_shift_init( uint32_t table[4][256], size_t length )
+{
+    /**
+     * Builds the table that shifts a CRC over 'length' zero bytes, which multiplies it by
+     * x^(8 * length) modulo the polynomial, one table per byte of the CRC.
+     */
+
+    /* The polynomial x^(8 * length), and x^(2^k) while it is built. */
+    uint32_t x = (uint32_t) 1 << 31;
+    uint32_t x2k = (uint32_t) 1 << 30;
+
+    size_t n;
+    int i;
+    int k;
+
+    for( n = 8 * length; n != 0; n >>= 1 )
+    {
+        if( n & 1 )
+        {
+            x = nwipe_crc32c_multiply( x2k, x );
+        }
+
+        x2k = nwipe_crc32c_multiply( x2k, x2k );
+    }
+
+    for( k = 0; k < 4; k++ )
+    {
+        for( i = 0; i < 256; i++ )
+        {
+            table[k][i] = nwipe_crc32c_multiply( x, (uint32_t) i << ( 8 * k ) );
+        }
+    }
+
+} /* nwipe_crc32c_shift_init */
+
+static inline uint32_t nwipe_crc32c_shift( uint32_t table[4][256], uint32_t crc )
+{
+    return table[0][crc & 0xFF] ^ table[1][( crc >> 8 ) & 0xFF] ^ table[2][( crc >> 16 ) & 0xFF]
+        ^ table[3][crc >> 24];
+
+} /* nwipe_crc32c_shift */
+
+#ifdef NWIPE_CRC32C_SSE42
+__attribute__( ( target( "sse4.2" ) ) ) static inline uint32_t
+    nwipe_crc32c_sse42_lanes( uint32_t crc, const u8* p, size_t lane, uint32_t table[4][256] )
+{
+    /**
+     * Runs a stream over each of three lanes of 'lane' bytes at 'p' and merges them.
+     */
+
+    u64 c0 = crc;
+    u64 c1 = 0;
+    u64 c2 = 0;
+    u64 w0;
+    u64 w1;
+    u64 w2;
+
+    size_t i;
+
+    for( i = 0; i < lane; i += 8 )
+    {
+        memcpy( &w0, p + i, sizeof( w0 ) );
+        memcpy( &w1, p + lane + i, sizeof( w1 ) );
+        memcpy( &w2, p + 2 * lane + i, sizeof( w2 ) );
+        c0 = _mm_crc32_u64( c0, w0 );
+        c1 = _mm_crc32_u64( c1, w1 );
+        c2 = _mm_crc32_u64( c2, w2 );
+    }
+
+    return nwipe_crc32c_shift( table, nwipe_crc32c_shift( table, (uint32_t) c0 ) ^ (uint32_t) c1 ) ^ (uint32_t) c2;
+
+} /* nwipe_crc32c_sse42_lanes */
+
+__attribute__( ( target( "sse4.2" ) ) ) static uint32_t nwipe_crc32c_sse42( uint32_t crc, const u8* p, size_t length )
+{
+    u64 c;
+    u64 w;
+
+    while( length >= 3 * NWIPE_CRC32C_LONG )
+    {
+        crc = nwipe_crc32c_sse42_lanes( crc, p, NWIPE_CRC32C_LONG, nwipe_crc32c_long );
+        p += 3 * NWIPE_CRC32C_LONG;
+        length -= 3 * NWIPE_CRC32C_LONG;
+    }
+
+    while( length >= 3 * NWIPE_CRC32C_SHORT )
+    {
+        crc = nwipe_crc32c_sse42_lanes( crc, p, NWIPE_CRC32C_SHORT, nwipe_crc32c_short );
+        p += 3 * NWIPE_CRC32C_SHORT;
+        length -= 3 * NWIPE_CRC32C_SHORT;
+    }
+
+    c = crc;
+
+    while( length >= 8 )
+    {
+        memcpy( &w, p, sizeof( w ) );
+        c = _mm_crc32_u64( c, w );
+        p += 8;
+        length -= 8;
+    }
+
+    crc = (uint32_t) c;
+
+    while( length > 0 )
+    {
+        crc = _mm_crc32_u8( crc, *p++ );
+        length--;
+    }
+
+    return crc;
+
+} /* nwipe_crc32c_sse42 */
+#endif
+
+#ifdef NWIPE_CRC32C_ARMV8
+static inline uint32_t nwipe_crc32c_armv8_lanes( uint32_t crc, const u8* p, size_t lane, uint32_t table[4][256] )
+{
+    /**
+     * Runs a stream over each of three lanes of 'lane' bytes at 'p' and merges them.
+     */
+
+    uint32_t c0 = crc;
+    uint32_t c1 = 0;
+    uint32_t c2 = 0;
+    u64 w0;
+    u64 w1;
+    u64 w2;
+
+    size_t i;
+
+    for( i = 0; i < lane; i += 8 )
+    {
+        memcpy( &w0, p + i, sizeof( w0 ) );
+        memcpy( &w1, p + lane + i, sizeof( w1 ) );
+        memcpy( &w2, p + 2 * lane + i, sizeof( w2 ) );
+        c0 = __crc32cd( c0, w0 );
+        c1 = __crc32cd( c1, w1 );
+        c2 = __crc32cd( c2, w2 );
+    }
+
+    return nwipe_crc32c_shift( table, nwipe_crc32c_shift( table, c0 ) ^ c1 ) ^ c2;
+
+} /* nwipe_crc32c_armv8_lanes */
+
+static uint32_t nwipe_crc32c_armv8( uint32_t crc, const u8* p, size_t length )
+{
+    u64 w;
+
+    while( length >= 3 * NWIPE_CRC32C_LONG )
+    {
+        crc = nwipe_crc32c_armv8_lanes( crc, p, NWIPE_CRC32C_LONG, nwipe_crc32c_long );
+        p += 3 * NWIPE_CRC32C_LONG;
+        length -= 3 * NWIPE_CRC32C_LONG;
+    }
+
+    while( length >= 3 * NWIPE_CRC32C_SHORT )
+    {
+        crc = nwipe_crc32c_armv8_lanes( crc, p, NWIPE_CRC32C_SHORT, nwipe_crc32c_short );
+        p += 3 * NWIPE_CRC32C_SHORT;
+        length -= 3 * NWIPE_CRC32C_SHORT;
+    }
+
+    while( length >= 8 )
+    {
+        memcpy( &w, p, sizeof( w ) );
+        crc = __crc32cd( crc, w );
+        p += 8;
+        length -= 8;
+    }
+
+    while( length > 0 )
+    {
+        crc = __crc32cb( crc, *p++ );
+        length--;
+    }
+
+    return crc;
+
+} /* nwipe_crc32c_armv8 */
+#endif
+
+static void nwipe_crc32c_init( void )
+{
+    /**
+     * Builds the tables and picks the fastest implementation that the processor has.
+     */
+
+    uint32_t crc;
+    int i;
+    int j;
+
+    for( i = 0; i < 256; i++ )
+    {
+        crc = i;
+
+        for( j = 0; j < 8; j++ )
+        {
+            crc = ( crc & 1 ) ? ( crc >> 1 ) ^ NWIPE_CRC32C_POLY : crc >> 1;
+        }
+
+        nwipe_crc32c_table[0][i] = crc;
+    }
+
+    for( i = 0; i < 256; i++ )
+    {
+        for( j = 1; j < 8; j++ )
+        {
+            nwipe_crc32c_table[j][i] =
+                nwipe_crc32c_table[0][nwipe_crc32c_table[j - 1][i] & 0xFF] ^ ( nwipe_crc32c_table[j - 1][i] >> 8 );
+        }
+    }
+
+    nwipe_crc32c_shift_init( nwipe_crc32c_long, NWIPE_CRC32C_LONG );
+    nwipe_crc32c_shift_init( nwipe_crc32c_short, NWIPE_CRC32C_SHORT );
+
+    nwipe_crc32c_impl = nwipe_crc32c_sw;
+    nwipe_crc32c_impl_name = "table";
+
+#ifdef NWIPE_CRC32C_SSE42
+    if( __builtin_cpu_supports( "sse4.2" ) )
+    {
+        nwipe_crc32c_impl = nwipe_crc32c_sse42;
+        nwipe_crc32c_impl_name = "sse4.2";
+    }
+#endif
+
+#ifdef NWIPE_CRC32C_ARMV8
+    nwipe_crc32c_impl = nwipe_crc32c_armv8;
+    nwipe_crc32c_impl_name = "armv8";
+#endif
+
+} /* nwipe_crc32c_init */
+
+uint32_t nwipe_crc32c( uint32_t crc, const void* buffer, size_t length )
+{
+    pthread_once( &nwipe_crc32c_once, nwipe_crc32c_init );
+
+    return ~nwipe_crc32c_impl( ~crc, (const u8*) buffer, length );
+
+} /* nwipe_crc32c */
+
+const char* nwipe_crc32c_name( void )
+{
+    pthread_once( &nwipe_crc32c_once, nwipe_crc32c_init );
+
+    return nwipe_crc32c_impl_name;
+
+} /* nwipe_crc32c_name */
+
+static uint32_t* nwipe_digest_map( size_t size )
+{
+    /**
+     * Maps 'size' bytes of an unlinked temporary file, or returns MAP_FAILED.
+     */
+
+    /* The template of the file name. */
+    char path[PATH_MAX];
+
+    const char* dir = getenv( "TMPDIR" );
+
+    void* m;
+    int fd;
+
+    snprintf( path, sizeof( path ), "%s/nwipe-digest-XXXXXX", ( dir != NULL && dir[0] != 0 ) ? dir : "/tmp" );
+
+    fd = mkstemp( path );
+
+    if( fd < 0 )
+    {
+        nwipe_perror( errno, __FUNCTION__, "mkstemp" );
+        return MAP_FAILED;
+    }
+
+    unlink( path );
+
+    if( ftruncate( fd, size ) != 0 )
+    {
+        nwipe_perror( errno, __FUNCTION__, "ftruncate" );
+        close( fd );
+        return MAP_FAILED;
+    }
+
+    m = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+
+    if( m == MAP_FAILED )
+    {
+        nwipe_perror( errno, __FUNCTION__, "mmap" );
+    }
+
+    /* The mapping keeps the file. */
+    close( fd );
+
+    return m;
+
+} /* nwipe_digest_map */
+
+void nwipe_digest_start( nwipe_context_t* c )
+{
+    /* The number of chunks of the pass. */
+    u64 count = 0;
+
+    /* The size of the digests. */
+    size_t size;
+
+    int e;
+
+    for( e = 0; e < c->extent_count; e++ )
+    {
+        count += ( c->extents[e].length + NWIPE_KNOB_VERIFY_CHUNK - 1 ) / NWIPE_KNOB_VERIFY_CHUNK;
+    }
+
+    c->digest_crc = 0;
+    c->digest_fill = 0;
+    c->digest_index = 0;
+    c->digest_valid = 0;
+
+    if( c->digests != NULL && c->digest_count == count )
+    {
+        /* The extents are the same for every pass, so the digests of the last pass are reused. */
+        c->digest_valid = 1;
+        return;
+    }
+
+    nwipe_digest_free( c );
+
+    if( count == 0 )
+    {
+        return;
+    }
+
+    size = count * sizeof( uint32_t );
+
+    if( size > NWIPE_KNOB_DIGEST_MEMORY )
+    {
+        c->digests = nwipe_digest_map( size );
+
+        if( c->digests == MAP_FAILED )
+        {
+            c->digests = NULL;
+        }
+        else
+        {
+            c->digest_mapped = size;
+        }
+    }
+    else
+    {
+        c->digests = malloc( size );
+    }
+
+    if( c->digests == NULL )
+    {
+        nwipe_log( NWIPE_LOG_WARNING,
+                   "No room for the %zu bytes of digests of '%s', verification regenerates the stream.",
+                   size,
+                   c->device_name );
+        return;
+    }
+
+    c->digest_count = count;
+    c->digest_valid = 1;
+
+} /* nwipe_digest_start */
+
+void nwipe_digest_update( nwipe_context_t* c, const void* buffer, size_t length )
+{
+    const u8* p = buffer;
+
+    /* The bytes that go into the current chunk. */
+    size_t n;
+
+    if( !c->digest_valid )
+    {
+        return;
+    }
+
+    while( length > 0 )
+    {
+        n = ( NWIPE_KNOB_VERIFY_CHUNK - c->digest_fill <= length ) ? NWIPE_KNOB_VERIFY_CHUNK - c->digest_fill : length;
+
+        c->digest_crc = nwipe_crc32c( c->digest_crc, p, n );
+        c->digest_fill += n;
+
+        if( c->digest_fill == NWIPE_KNOB_VERIFY_CHUNK )
+        {
+            nwipe_digest_extent_end( c );
+        }
+
+        p += n;
+        length -= n;
+    }
+
+} /* nwipe_digest_update */
+
+void nwipe_digest_extent_end( nwipe_context_t* c )
+{
+    if( !c->digest_valid || c->digest_fill == 0 )
+    {
+        return;
+    }
+
+    if( c->digest_index >= c->digest_count )
+    {
+        /* More was written than the extents hold. */
+        nwipe_digest_invalidate( c );
+        return;
+    }
+
+    c->digests[c->digest_index++] = c->digest_crc;
+    c->digest_crc = 0;
+    c->digest_fill = 0;
+
+} /* nwipe_digest_extent_end */
+
+void nwipe_digest_invalidate( nwipe_context_t* c )
+{
+    c->digest_valid = 0;
+
+} /* nwipe_digest_invalidate */
+
+void nwipe_digest_free( nwipe_context_t* c )
+{
+    if( c->digest_mapped > 0 )
+    {
+        munmap( c->digests, c->digest_mapped );
+    }
+    else
+    {
+        free( c->digests );
+    }
+
+    c->digests = NULL;
+    c->digest_count = 0;
+    c->digest_mapped = 0;
+    c->digest_valid = 0;
+
+} /* nwipe_digest_free */
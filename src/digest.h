@@ -0,0 +1,53 @@
+/*
+ *  digest.h: CRC32C digests of the chunks of a random pass, for its verification.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef DIGEST_H_
+#define DIGEST_H_
+
+/*
+ * A random pass keeps the CRC32C of every NWIPE_KNOB_VERIFY_CHUNK bytes that it writes, counted
+ * from the start of each extent, which are the chunks that the verification reads. The
+ * verification then compares the digest of each chunk that it reads instead of regenerating the
+ * PRNG stream, so it costs a CRC per byte rather than a PRNG and a compare, and the chunks can be
+ * checked in any order. Digests that take more than NWIPE_KNOB_DIGEST_MEMORY bytes are kept in an
+ * unlinked temporary file. When the digests are not complete, after a partial write or when
+ * there is no room for them, the verification regenerates the stream as before.
+ */
+
+/* Returns the CRC32C of 'length' bytes, continuing from 'crc', which is zero for the first bytes. */
+uint32_t nwipe_crc32c( uint32_t crc, const void* buffer, size_t length );
+
+/* Returns the name of the CRC32C implementation, "sse4.2", "armv8" or "table". */
+const char* nwipe_crc32c_name( void );
+
+/* Sizes the digests for a pass over the extents of the device and starts the first chunk. */
+void nwipe_digest_start( nwipe_context_t* c );
+
+/* Adds 'length' written bytes to the current chunk. */
+void nwipe_digest_update( nwipe_context_t* c, const void* buffer, size_t length );
+
+/* Closes the last chunk of an extent. */
+void nwipe_digest_extent_end( nwipe_context_t* c );
+
+/* Marks the digests of the pass as incomplete, so the verification regenerates the stream. */
+void nwipe_digest_invalidate( nwipe_context_t* c );
+
+/* Releases the digests. */
+void nwipe_digest_free( nwipe_context_t* c );
+
+#endif /* DIGEST_H_ */
@@ -32,6 +32,7 @@
 #include <panel.h>
 #include <stdint.h>
 #include <time.h>
+#include <linux/serial.h>
 
 #include "nwipe.h"
 #include "context.h"
@@ -42,6 +43,10 @@
 #include "pass.h"
 #include "logging.h"
 #include "version.h"
+#include "iostat.h"
+#include "trace.h"
+#include "preflight.h"
+#include "ioprio.h"
 
 #define NWIPE_GUI_PANE 8
 
@@ -103,6 +108,48 @@
 
 #define SKIP_DEV_PREFIX 5
 
+/* The size of the text that the status screen remembers for each cell. */
+#define NWIPE_GUI_CELL_SIZE 256
+
+/* The most lines that the dashboard view prints. */
+#define NWIPE_GUI_DASHBOARD_LINES ( NWIPE_STATE_COUNT + NWIPE_KNOB_SLOWEST + NWIPE_KNOB_FAILING + 8 )
+
+/* The estimated terminal bytes for each character cell that changes, allowing for cursor movement. */
+#define NWIPE_GUI_CELL_COST 8
+
+/* The text that the status screen last drew for one slot of the main window. */
+typedef struct nwipe_gui_slot_t_
+{
+    char label[NWIPE_GUI_CELL_SIZE];  // The device label.
+    char status[NWIPE_GUI_CELL_SIZE];  // The progress line, including the spinner.
+} nwipe_gui_slot_t;
+
+/* The fields of the statistics window that the status screen updates. */
+typedef enum nwipe_gui_stat_t_ {
+    NWIPE_GUI_STAT_RUNTIME = 0,
+    NWIPE_GUI_STAT_ETA,
+    NWIPE_GUI_STAT_LOAD,
+    NWIPE_GUI_STAT_THROUGHPUT,
+    NWIPE_GUI_STAT_ERRORS,
+    NWIPE_GUI_STAT_COUNT  // The number of fields.
+} nwipe_gui_stat_t;
+
+/* The ways that the status screen can show the devices. */
+typedef enum nwipe_gui_view_t_ {
+    NWIPE_GUI_VIEW_DETAIL = 0,  // Three lines for each device.
+    NWIPE_GUI_VIEW_COMPACT,  // One line for each device.
+    NWIPE_GUI_VIEW_GROUPED,  // One line for each device, under a line for each controller.
+    NWIPE_GUI_VIEW_DASHBOARD,  // Totals, device states, and the failing and slowest devices.
+    NWIPE_GUI_VIEW_COUNT  // The number of views.
+} nwipe_gui_view_t;
+
+/* The titles of the views. */
+const char* nwipe_gui_view_titles[NWIPE_GUI_VIEW_COUNT] = { " Detail ", " Compact ", " By controller ", " Dashboard " };
+
+/* The names of the device states. */
+const char* nwipe_gui_state_names[NWIPE_STATE_COUNT] = {
+    "waiting", "writing", "verifying", "blanking", "syncing", "done", "failed" };
+
 /* Window pointers. */
 WINDOW* footer_window;
 WINDOW* header_window;
@@ -128,8 +175,10 @@ const char* main_window_footer_warning_lower_case_s =
     "  WARNING: To start the wipe press capital S, you pressed lower case s  ";
 const char* main_window_footer_warning_no_drive_selected =
     "  No drives selected, use spacebar to select a drive, then press S to start  ";
+const char* main_window_footer_preflight = "  Measuring the selected drives, nothing is written  ";
+const char* main_window_footer_preflight_confirm = "  S=Start the wipe with this forecast, any other key=Back  ";
 const char* selection_footer = "J=Down K=Up Space=Select Backspace=Cancel Ctrl-C=Quit";
-const char* end_wipe_footer = "B=Blank screen Ctrl-C=Quit";
+const char* end_wipe_footer = "V=View I=I/O priority J=Down K=Up B=Blank screen Ctrl-C=Quit";
 const char* rounds_footer = "Left=Erase Esc=Cancel Ctrl-C=Quit";
 const char* wipes_finished_footer = "Wipe finished - press enter to exit. Logged to STDOUT";
 
@@ -1012,6 +1061,35 @@ void nwipe_gui_select( int count, nwipe_context_t** c )
                         /* Remove the S from keystroke, which allows us to stay within the selection menu loop */
                         keystroke = 0;
                     }
+                    else if( nwipe_options.preflight )
+                    {
+                        /* Measure the selected drives and show the forecast, a second S starts the wipe. */
+                        nwipe_gui_amend_footer_window( main_window_footer_preflight );
+                        doupdate();
+
+                        nwipe_preflight( c, count );
+
+                        nwipe_gui_options();
+                        nwipe_gui_amend_footer_window( main_window_footer_preflight_confirm );
+                        doupdate();
+
+                        /* Ignore the keys that were pressed while measuring. */
+                        flushinp();
+
+                        do
+                        {
+                            timeout( 250 );  // block getch() for 250ms.
+                            keystroke = getch();  // Get user input.
+                            timeout( -1 );  // Switch back to blocking mode.
+                        } while( keystroke == ERR && terminate_signal != 1 );
+
+                        if( keystroke != 'S' )
+                        {
+                            /* Back to the selection, where the forecast would go stale. */
+                            nwipe_preflight_slowest = NULL;
+                            keystroke = 0;
+                        }
+                    }
 
                     break;
 
@@ -1100,11 +1178,36 @@ void nwipe_gui_options( void )
      *
      */
 
+    /* The forecast of the batch. */
+    int hours;
+    int minutes;
+    int seconds;
+
     /* Erase the window. */
     werase( options_window );
 
-    mvwprintw(
-        options_window, NWIPE_GUI_OPTIONS_ENTROPY_Y, NWIPE_GUI_OPTIONS_ENTROPY_X, "Entropy: Linux Kernel (urandom)" );
+    if( nwipe_preflight_slowest != NULL )
+    {
+        /* The forecast takes the place of the entropy source, which is always the same. */
+        convert_seconds_to_hours_minutes_seconds( (u64) nwipe_preflight_batch, &hours, &minutes, &seconds );
+        mvwprintw( options_window,
+                   NWIPE_GUI_OPTIONS_ENTROPY_Y,
+                   NWIPE_GUI_OPTIONS_ENTROPY_X,
+                   "Forecast: %02i:%02i:%02i (%.12s)",
+                   hours,
+                   minutes,
+                   seconds,
+                   strrchr( nwipe_preflight_slowest->device_name, '/' )
+                       ? strrchr( nwipe_preflight_slowest->device_name, '/' ) + 1
+                       : nwipe_preflight_slowest->device_name );
+    }
+    else
+    {
+        mvwprintw( options_window,
+                   NWIPE_GUI_OPTIONS_ENTROPY_Y,
+                   NWIPE_GUI_OPTIONS_ENTROPY_X,
+                   "Entropy: Linux Kernel (urandom)" );
+    }
 
     mvwprintw(
         options_window, NWIPE_GUI_OPTIONS_PRNG_Y, NWIPE_GUI_OPTIONS_PRNG_X, "PRNG:    %s", nwipe_options.prng->label );
@@ -1303,10 +1406,12 @@ void nwipe_gui_prng( void )
 
     extern nwipe_prng_t nwipe_twister;
     extern nwipe_prng_t nwipe_isaac;
+    extern nwipe_prng_t nwipe_broadcast;
+    extern nwipe_prng_t nwipe_getrandom;
     extern int terminate_signal;
 
     /* The number of implemented PRNGs. */
-    const int count = 2;
+    const int count = 4;
 
     /* The first tabstop. */
     const int tab1 = 2;
@@ -1336,6 +1441,14 @@ void nwipe_gui_prng( void )
     {
         focus = 1;
     }
+    if( nwipe_options.prng == &nwipe_broadcast )
+    {
+        focus = 2;
+    }
+    if( nwipe_options.prng == &nwipe_getrandom )
+    {
+        focus = 3;
+    }
 
     do
     {
@@ -1352,6 +1465,8 @@ void nwipe_gui_prng( void )
         mvwprintw( main_window, yy++, tab1, "" );
         mvwprintw( main_window, yy++, tab1, "  %s", nwipe_twister.label );
         mvwprintw( main_window, yy++, tab1, "  %s", nwipe_isaac.label );
+        mvwprintw( main_window, yy++, tab1, "  %s", nwipe_broadcast.label );
+        mvwprintw( main_window, yy++, tab1, "  %s", nwipe_getrandom.label );
         mvwprintw( main_window, yy++, tab1, "" );
 
         /* Print the cursor. */
@@ -1411,6 +1526,62 @@ void nwipe_gui_prng( void )
                            "                                                                            " );
                 break;
 
+            case 2:
+
+                mvwprintw( main_window, 2, tab2, "syslinux.cfg:  nuke=\"nwipe --prng broadcast\"" );
+
+                mvwprintw( main_window,
+                           yy++,
+                           tab1,
+                           "The Mersenne Twister fills one 16MiB pool that all drives share, and each   " );
+                mvwprintw( main_window,
+                           yy++,
+                           tab1,
+                           "drive XORs it from its own offset with a splitmix64 stream keyed by its     " );
+                mvwprintw( main_window,
+                           yy++,
+                           tab1,
+                           "seed, so a drive costs a fraction of the CPU of its own twister. XORing two " );
+                mvwprintw( main_window,
+                           yy++,
+                           tab1,
+                           "drives that were wiped together leaves two splitmix64 streams, which are not" );
+                mvwprintw( main_window,
+                           yy++,
+                           tab1,
+                           "cryptographically strong. Use it when the CPU cannot keep up with the drives" );
+                mvwprintw( main_window,
+                           yy++,
+                           tab1,
+                           "                                                                            " );
+                break;
+
+            case 3:
+
+                mvwprintw( main_window, 2, tab2, "syslinux.cfg:  nuke=\"nwipe --prng getrandom\"" );
+
+                mvwprintw( main_window,
+                           yy++,
+                           tab1,
+                           "The ChaCha20 generator of the kernel, read with getrandom() in batches of   " );
+                mvwprintw( main_window,
+                           yy++,
+                           tab1,
+                           "1MiB. The kernel reseeds it from its entropy pool, so the stream cannot be  " );
+                mvwprintw( main_window,
+                           yy++,
+                           tab1,
+                           "replayed: the verification compares the CRC32C digests that the pass kept of" );
+                mvwprintw( main_window,
+                           yy++,
+                           tab1,
+                           "every chunk it wrote, and fails when they could not be kept.                " );
+                mvwprintw( main_window,
+                           yy++,
+                           tab1,
+                           "                                                                            " );
+                break;
+
         } /* switch */
 
         /* Add a border. */
@@ -1467,6 +1638,14 @@ void nwipe_gui_prng( void )
                 {
                     nwipe_options.prng = &nwipe_isaac;
                 }
+                if( focus == 2 )
+                {
+                    nwipe_options.prng = &nwipe_broadcast;
+                }
+                if( focus == 3 )
+                {
+                    nwipe_options.prng = &nwipe_getrandom;
+                }
                 return;
 
             case KEY_BACKSPACE:
@@ -1840,8 +2019,11 @@ void nwipe_gui_method( void )
 
     extern int terminate_signal;
 
-    /* The number of implemented methods. */
-    const int count = 8;
+    /* The number of implemented methods, plus one for a method loaded from a file. */
+    int count = nwipe_method_count;
+
+    /* The method loaded from a file, if any. */
+    const nwipe_method_t* loaded = NULL;
 
     /* The first tabstop. */
     const int tab1 = 2;
@@ -1852,6 +2034,9 @@ void nwipe_gui_method( void )
     /* The currently selected method. */
     int focus = 0;
 
+    /* An index variable. */
+    int i;
+
     /* The current working row. */
     int yy;
 
@@ -1863,37 +2048,15 @@ void nwipe_gui_method( void )
     nwipe_gui_title( footer_window, selection_footer );
     wrefresh( footer_window );
 
-    if( nwipe_options.method == &nwipe_zero )
-    {
-        focus = 0;
-    }
-    if( nwipe_options.method == &nwipe_ops2 )
-    {
-        focus = 1;
-    }
-    if( nwipe_options.method == &nwipe_dodshort )
-    {
-        focus = 2;
-    }
-    if( nwipe_options.method == &nwipe_dod522022m )
+    if( nwipe_options.method >= &nwipe_methods[0] && nwipe_options.method < &nwipe_methods[nwipe_method_count] )
     {
-        focus = 3;
-    }
-    if( nwipe_options.method == &nwipe_gutmann )
-    {
-        focus = 4;
-    }
-    if( nwipe_options.method == &nwipe_random )
-    {
-        focus = 5;
-    }
-    if( nwipe_options.method == &nwipe_verify )
-    {
-        focus = 6;
+        focus = nwipe_options.method - &nwipe_methods[0];
     }
-    if( nwipe_options.method == &nwipe_is5enh )
+    else
     {
-        focus = 7;
+        loaded = nwipe_options.method;
+        focus = count;
+        count += 1;
     }
 
     do
@@ -1907,14 +2070,14 @@ void nwipe_gui_method( void )
         yy = 2;
 
         /* Print the options. */
-        mvwprintw( main_window, yy++, tab1, "  %s", nwipe_method_label( &nwipe_zero ) );
-        mvwprintw( main_window, yy++, tab1, "  %s", nwipe_method_label( &nwipe_ops2 ) );
-        mvwprintw( main_window, yy++, tab1, "  %s", nwipe_method_label( &nwipe_dodshort ) );
-        mvwprintw( main_window, yy++, tab1, "  %s", nwipe_method_label( &nwipe_dod522022m ) );
-        mvwprintw( main_window, yy++, tab1, "  %s", nwipe_method_label( &nwipe_gutmann ) );
-        mvwprintw( main_window, yy++, tab1, "  %s", nwipe_method_label( &nwipe_random ) );
-        mvwprintw( main_window, yy++, tab1, "  %s", nwipe_method_label( &nwipe_verify ) );
-        mvwprintw( main_window, yy++, tab1, "  %s", nwipe_method_label( &nwipe_is5enh ) );
+        for( i = 0; i < count; i++ )
+        {
+            mvwprintw( main_window,
+                       yy++,
+                       tab1,
+                       "  %s",
+                       nwipe_method_label( i < nwipe_method_count ? &nwipe_methods[i] : loaded ) );
+        }
         mvwprintw( main_window, yy++, tab1, "                                             " );
 
         /* Print the cursor. */
@@ -2089,6 +2252,17 @@ void nwipe_gui_method( void )
                            "then reads the device to verify the PRNG stream was successfully written.    " );
                 break;
 
+            default:
+
+                mvwprintw( main_window, 2, tab2, "syslinux.cfg: nuke=\"nwipe --method FILE\"" );
+                mvwprintw( main_window, 3, tab2, "Passes: %i", loaded->pass_count );
+
+                mvwprintw( main_window,
+                           yy++,
+                           tab1,
+                           "This method was loaded from a method description file.                       " );
+                break;
+
         } /* switch */
 
         /* Add a border. */
@@ -2142,54 +2316,36 @@ void nwipe_gui_method( void )
 
     } while( keystroke != KEY_ENTER && keystroke != ' ' && keystroke != 10 && terminate_signal != 1 );
 
-    switch( focus )
+    if( focus < nwipe_method_count )
     {
-        case 0:
-            nwipe_options.method = &nwipe_zero;
-            break;
-
-        case 1:
-            nwipe_options.method = &nwipe_ops2;
-            break;
-
-        case 2:
-            nwipe_options.method = &nwipe_dodshort;
-            break;
-
-        case 3:
-            nwipe_options.method = &nwipe_dod522022m;
-            break;
-
-        case 4:
-            nwipe_options.method = &nwipe_gutmann;
-            break;
-
-        case 5:
-            nwipe_options.method = &nwipe_random;
-            break;
-
-        case 6:
-            nwipe_options.method = &nwipe_verify;
-            break;
-
-        case 7:
-            nwipe_options.method = &nwipe_is5enh;
-            break;
+        nwipe_options.method = &nwipe_methods[focus];
+    }
+    else
+    {
+        nwipe_options.method = loaded;
     }
 
 } /* nwipe_gui_method */
 
-void nwipe_gui_load( void )
+void nwipe_gui_load( char* load, size_t size )
 {
     /**
-     * Prints the system load average to the statistics window.
+     * Formats the system load average for the statistics window. The loadavg file stays open and is re-read with
+     * pread().
      *
-     * @modifies stat_window      Prints the system load average to the statistics window.
+     * @parameter load  A buffer that receives the load averages, or an error.
+     * @parameter size  The size of the buffer.
      *
      */
 
-    /* A file handle for the stat file. */
-    FILE* nwipe_fp;
+    /* The loadavg file, which is opened on the first call. */
+    static int nwipe_fd = -1;
+
+    /* The start of the loadavg file. */
+    char buffer[64];
+
+    /* The length of the data read. */
+    ssize_t length;
 
     /* The one, five, and fifteen minute load averages. */
     float load_01;
@@ -2197,206 +2353,783 @@ void nwipe_gui_load( void )
     float load_15;
 
     /* Open the loadavg file. */
-    nwipe_fp = fopen( NWIPE_KNOB_LOADAVG, "r" );
-
-    /* Print the label. */
-    mvwprintw( stats_window, NWIPE_GUI_STATS_LOAD_Y, NWIPE_GUI_STATS_LOAD_X, "Load Averages:" );
-
-    if( nwipe_fp )
+    if( nwipe_fd < 0 )
     {
-        /* The load averages are the first three numbers in the file. */
-        if( 3 == fscanf( nwipe_fp, "%f %f %f", &load_01, &load_05, &load_15 ) )
-        {
-            /* Print the load average. */
-            mvwprintw( stats_window,
-                       NWIPE_GUI_STATS_LOAD_Y,
-                       NWIPE_GUI_STATS_TAB,
-                       "%04.2f %04.2f %04.2f",
-                       load_01,
-                       load_05,
-                       load_15 );
-        }
-        else
+        nwipe_fd = open( NWIPE_KNOB_LOADAVG, O_RDONLY | O_CLOEXEC );
+        if( nwipe_fd < 0 )
         {
-            /* Print an error. */
-            mvwprintw( stats_window, NWIPE_GUI_STATS_LOAD_Y, NWIPE_GUI_STATS_TAB, "(fscanf error %i)", errno );
+            snprintf( load, size, "(open error %i)", errno );
+            return;
         }
+    }
+
+    length = pread( nwipe_fd, buffer, sizeof( buffer ) - 1, 0 );
+    if( length < 0 )
+    {
+        snprintf( load, size, "(pread error %i)", errno );
+        return;
+    }
+    buffer[length] = 0;
 
-        /* Close the loadavg file. */
-        fclose( nwipe_fp );
+    /* The load averages are the first three numbers in the file. */
+    if( 3 == sscanf( buffer, "%f %f %f", &load_01, &load_05, &load_15 ) )
+    {
+        /* Format the load average. */
+        snprintf( load, size, "%04.2f %04.2f %04.2f", load_01, load_05, load_15 );
     }
     else
     {
-        mvwprintw( stats_window, NWIPE_GUI_STATS_LOAD_Y, NWIPE_GUI_STATS_TAB, "(fopen error %i)", errno );
+        /* Report an error. */
+        snprintf( load, size, "(sscanf error)" );
     }
 
 } /* nwipe_gui_load */
 
-void* nwipe_gui_status( void* ptr )
+static int nwipe_gui_cell( WINDOW* w, int y, int x, char* drawn, const char* text, int highlight )
 {
     /**
-     * Shows runtime statistics and overall progress.
-     *
-     * @parameter count           The number of contexts in the array.
-     * @parameter c               An array of device contexts.
+     * Draws 'text' at y,x unless the window already shows it there, blanking what is left of the previous text.
+     * The text is clipped to the window border.
      *
-     * @modifies  main_window     Prints information into the main window.
-     * @modifies  c[].throughput  Updates the i/o throughput value.
+     * @parameter drawn      The text that was last drawn in the cell, updated to 'text'.
+     * @parameter highlight  The number of leading characters to draw in the failure colour.
+     * @returns              The number of character cells that changed.
      *
      */
 
-    extern int terminate_signal;
-
-    nwipe_thread_data_ptr_t* nwipe_thread_data_ptr;
-    nwipe_thread_data_ptr = (nwipe_thread_data_ptr_t*) ptr;
+    /* The number of columns that the cell may use. */
+    int width;
 
-    nwipe_context_t** c;
-    nwipe_misc_thread_data_t* nwipe_misc_thread_data;
-    int count;
+    /* The lengths of the old and new text. */
+    int previous;
+    int length;
 
-    c = nwipe_thread_data_ptr->c;
-    nwipe_misc_thread_data = nwipe_thread_data_ptr->nwipe_misc_thread_data;
-    count = nwipe_misc_thread_data->nwipe_selected;
+    /* The number of characters that differ. */
+    int changed = 0;
 
-    char nomenclature_result_str[NOMENCLATURE_RESULT_STR_SIZE]; /* temporary usage */
+    /* Generic loop variable. */
+    int i;
 
-    /* Spinner character */
-    char spinner_string[2];
+    if( strcmp( drawn, text ) == 0 )
+    {
+        return 0;
+    }
 
-    /* We count time from when this function is first called. */
-    static time_t nwipe_time_start = 0;
+    width = getmaxx( w ) - x - 1;
+    if( width <= 0 )
+    {
+        return 0;
+    }
 
-    /* Whether the screen has been blanked by the user. */
-    static int nwipe_gui_blank = 0;
+    previous = strlen( drawn );
+    length = strlen( text );
+    if( length > width )
+    {
+        length = width;
+    }
+    if( previous > width )
+    {
+        previous = width;
+    }
+    if( highlight > length )
+    {
+        highlight = length;
+    }
 
-    /* The current time. */
-    time_t nwipe_time_now;
+    for( i = 0; i < length || i < previous; i++ )
+    {
+        if( i >= length || i >= previous || drawn[i] != text[i] )
+        {
+            changed++;
+        }
+    }
 
-    /* The time when all wipes ended */
-    time_t nwipe_time_stopped;
+    /* Draw the text, with the failure message in its colour. */
+    wattron( w, COLOR_PAIR( 9 ) );
+    mvwaddnstr( w, y, x, text, highlight );
+    wattroff( w, COLOR_PAIR( 9 ) );
+    waddnstr( w, text + highlight, length - highlight );
 
-    /* The index of the element that is visible in the first slot. */
-    static int offset;
+    /* Blank the tail of a longer previous text. */
+    for( i = length; i < previous; i++ )
+    {
+        waddch( w, ' ' );
+    }
 
-    /* The number of elements that we can show in the window. */
-    int slots;
+    snprintf( drawn, NWIPE_GUI_CELL_SIZE, "%s", text );
 
-    /* Window dimensions. */
-    int wlines;
-    int wcols;
+    return changed;
 
-    /* Generic loop variable. */
-    int i;
+} /* nwipe_gui_cell */
 
-    /* The current working line in the main window. */
-    int yy;
+static nwipe_state_t nwipe_gui_state( nwipe_context_t* c )
+{
+    /**
+     * Returns the state of a device for the statistics.
+     */
 
-    /* User input buffer. */
-    int keystroke;
+    if( c->wipe_status == 1 )
+    {
+        if( c->sync_status )
+        {
+            return NWIPE_STATE_SYNCING;
+        }
 
-    /* controls main while loop */
-    int loop_control;
+        switch( c->pass_type )
+        {
+            case NWIPE_PASS_VERIFY:
+                return NWIPE_STATE_VERIFYING;
 
-    /* The combined througput of all processes. */
-    nwipe_misc_thread_data->throughput = 0;
+            case NWIPE_PASS_FINAL_BLANK:
+            case NWIPE_PASS_FINAL_OPS2:
+                return NWIPE_STATE_BLANKING;
 
-    /* The estimated runtime of the slowest device. */
-    nwipe_misc_thread_data->maxeta = 0;
+            default:
+                return NWIPE_STATE_WRITING;
+        }
+    }
 
-    /* The combined number of errors of all processes. */
-    nwipe_misc_thread_data->errors = 0;
+    if( c->wipe_status == -1 || c->result == -2 )
+    {
+        return NWIPE_STATE_WAITING;
+    }
 
-    /* Time values. */
-    int nwipe_hh;
-    int nwipe_mm;
-    int nwipe_ss;
+    return c->result == 0 ? NWIPE_STATE_DONE : NWIPE_STATE_FAILED;
 
-    struct timespec tim, tim2;
-    tim.tv_sec = 0;
-    tim.tv_nsec = 100000000L; /* sleep for 0.1 seconds */
+} /* nwipe_gui_state */
 
-    /* Throughput variables */
-    u64 nwipe_throughput;
+static void nwipe_gui_groups( nwipe_context_t** c, int count, nwipe_misc_thread_data_t* nwipe_misc_thread_data )
+{
+    /**
+     * Groups the devices by controller, in the order that the controllers are first seen.
+     *
+     * @modifies  c[].device_group
+     * @modifies  nwipe_misc_thread_data->groups  An array of groups, or NULL when it cannot be allocated.
+     *
+     */
 
-    /* The number of active wipe processes. */
-    /* Set to 1 initially to start loop.    */
-    int nwipe_active = 1;
+    nwipe_group_t* groups;
+    int group_count = 0;
+    int i;
+    int g;
 
-    if( nwipe_time_start == 0 )
+    groups = calloc( count > 0 ? count : 1, sizeof( nwipe_group_t ) );
+    if( groups == NULL )
     {
-        /* This is the first time that we have been called. */
-        nwipe_time_start = time( NULL ) - 1;
+        nwipe_perror( errno, __FUNCTION__, "calloc" );
+        return;
     }
 
-    nwipe_gui_title( footer_window, end_wipe_footer );
+    for( i = 0; i < count; i++ )
+    {
+        for( g = 0; g < group_count && strcmp( groups[g].controller, c[i]->device_controller ); g++ )
+            ;
 
-    loop_control = 1;
+        if( g == group_count )
+        {
+            groups[group_count++].controller = c[i]->device_controller;
+        }
 
-    while( loop_control )
-    {
-        /* IMPORTANT ! Halfdelay(1) causes getch() to pause for 0.1 secs. This is important for two reasons.
-         * 1. Pauses the getch for 0.1 secs so that the screen is only updated max 10 times/sec. Without
-         *    this delay the loop would run hundreds of times per sec maxing out the core.
-         * 2. By keeping the delay below 0.2 seconds, i.e 0.1, it makes the keypress and resizing
-         *    nice and responsive.
-         */
-        halfdelay( 1 );  // Important, don't change this unless you know what you are doing ! Related to getch().
+        groups[g].count++;
+        c[i]->device_group = g;
+    }
 
-        keystroke = getch();  // Get user input.
+    nwipe_misc_thread_data->group_count = group_count;
+    nwipe_misc_thread_data->groups = groups;
 
-        /* Get the current time. */
-        if( nwipe_active && terminate_signal != 1 )
+} /* nwipe_gui_groups */
+
+static int nwipe_gui_progress( nwipe_context_t* c, char* text, size_t size, int* highlight )
+{
+    /**
+     * Formats the progress line of the detail view, returning its length.
+     *
+     * @parameter highlight  Receives the number of leading characters that report a failure.
+     *
+     */
+
+    char nomenclature_result_str[NOMENCLATURE_RESULT_STR_SIZE];
+    int length;
+
+    *highlight = 0;
+
+    /* Check whether the child process is still running the wipe. */
+    if( c->wipe_status == 1 )
+    {
+        /* Print percentage and pass information. */
+        length = snprintf( text,
+                           size,
+                           "[%5.2f%%, round %i of %i, pass %i of %i] ",
+                           c->round_percent,
+                           c->round_working,
+                           c->round_count,
+                           c->pass_working,
+                           c->pass_count );
+
+    } /* child running */
+    else
+    {
+        if( c->result == 0 )
         {
-            nwipe_time_now = time( NULL );
-            nwipe_time_stopped = nwipe_time_now;
+            length = snprintf( text, size, "[%05.2f%% complete, SUCCESS! ", c->round_percent );
+        }
+        else if( c->signal )
+        {
+            length = snprintf( text, size, "(>>> FAILURE! <<<, signal %i) ", c->signal );
+            *highlight = length;
         }
         else
         {
-            nwipe_time_now = nwipe_time_stopped;
+            length = snprintf( text, size, "(>>>FAILURE!<<<, code %i) ", c->result );
+            *highlight = length;
         }
 
-        /* Erase the main window. */
-        werase( main_window );
+    } /* child returned */
 
-        /* Erase the stats window. */
-        werase( stats_window );
+    if( c->verify_errors )
+    {
+        length += snprintf( text + length, size - length, "[verify errors: %llu] ", c->verify_errors );
+    }
+    if( c->pass_errors )
+    {
+        length += snprintf( text + length, size - length, "[pass errors: %llu] ", c->pass_errors );
+    }
+    if( c->wipe_status == 1 )
+    {
+        switch( c->pass_type )
+        {
+            /* Each text field in square brackets should be the same number of characters
+             * to retain output in columns */
+            case NWIPE_PASS_FINAL_BLANK:
+                if( !c->sync_status )
+                {
+                    length += snprintf( text + length, size - length, "[ blanking] " );
+                }
+                break;
+
+            case NWIPE_PASS_FINAL_OPS2:
+                if( !c->sync_status )
+                {
+                    length += snprintf( text + length, size - length, "[OPS2final] " );
+                }
+                break;
+
+            case NWIPE_PASS_WRITE:
+                if( !c->sync_status )
+                {
+                    length += snprintf( text + length, size - length, "[ writing ] " );
+                }
+                break;
 
-        /* Erase the footer window */
-        werase( footer_window );
+            case NWIPE_PASS_VERIFY:
+                if( !c->sync_status )
+                {
+                    length += snprintf( text + length, size - length, "[verifying] " );
+                }
+                break;
 
-        /* Only repaint the windows on terminal resize if the user hasn't blanked the screen */
-        if( nwipe_gui_blank == 0 )
+            case NWIPE_PASS_NONE:
+                break;
+        }
+
+        if( c->sync_status )
         {
-            if( nwipe_active != 0 )
+            length += snprintf( text + length, size - length, "[ syncing ] " );
+        }
+    }
+
+    /* Determine throughput nomenclature for this drive and output drives throughput to GUI */
+    Determine_C_B_nomenclature( c->throughput, nomenclature_result_str, NOMENCLATURE_RESULT_STR_SIZE );
+
+    length += snprintf( text + length, size - length, "[%s/s] ", nomenclature_result_str );
+
+    return length;
+
+} /* nwipe_gui_progress */
+
+static int nwipe_gui_iostat( nwipe_context_t* c, char* text, size_t size, int brief )
+{
+    /**
+     * Formats the block layer statistics of a device, returning the length, which is zero while they are unknown.
+     *
+     * @parameter brief  Set to only show the utilization and the requests in flight.
+     *
+     */
+
+    nwipe_iostat_t* s = &c->device_iostat;
+
+    text[0] = 0;
+
+    if( s->stat_fd <= 0 || s->utilization < 0 || c->wipe_status != 1 )
+    {
+        return 0;
+    }
+
+    if( brief )
+    {
+        return snprintf( text, size, "util %3.0f%% queue %3i", s->utilization, s->inflight );
+    }
+
+    return snprintf( text,
+                     size,
+                     "[util %3.0f%%] [queue %3i] [service %6.2f ms] [merged %6.0f/s]",
+                     s->utilization,
+                     s->inflight,
+                     s->service_time,
+                     s->merge_rate );
+
+} /* nwipe_gui_iostat */
+
+static int nwipe_gui_compact( nwipe_context_t* c, char* text, size_t size, int* highlight )
+{
+    /**
+     * Formats the one line that the compact views show for a device, returning its length.
+     *
+     * @parameter highlight  Receives the number of leading characters that report a failure.
+     *
+     */
+
+    char nomenclature_result_str[NOMENCLATURE_RESULT_STR_SIZE];
+    nwipe_state_t state;
+    int length;
+
+    *highlight = 0;
+    state = nwipe_gui_state( c );
+
+    switch( state )
+    {
+        case NWIPE_STATE_WAITING:
+            length = snprintf( text, size, "%-14s waiting", c->device_name );
+            break;
+
+        case NWIPE_STATE_DONE:
+            length = snprintf( text, size, "%-14s %6.2f%% SUCCESS!", c->device_name, c->round_percent );
+            break;
+
+        case NWIPE_STATE_FAILED:
+            length = snprintf( text,
+                               size,
+                               "%-14s FAILURE! %s %i",
+                               c->device_name,
+                               c->signal ? "signal" : "code",
+                               c->signal ? c->signal : c->result );
+            *highlight = length;
+            break;
+
+        default:
+            Determine_C_B_nomenclature( c->throughput, nomenclature_result_str, NOMENCLATURE_RESULT_STR_SIZE );
+            length = snprintf( text,
+                               size,
+                               "%-14s %6.2f%% %-9s round %i/%i pass %i/%i %7s/s",
+                               c->device_name,
+                               c->round_percent,
+                               nwipe_gui_state_names[state],
+                               c->round_working,
+                               c->round_count,
+                               c->pass_working,
+                               c->pass_count,
+                               nomenclature_result_str );
+            if( nwipe_gui_iostat( c, text + length + 1, size - length - 1, 1 ) > 0 )
             {
-                /* if resizing the terminal during a wipe a specific footer is required */
-                nwipe_gui_create_all_windows_on_terminal_resize( end_wipe_footer );
+                text[length] = ' ';
+                length += strlen( text + length );
             }
-            else
+            break;
+    }
+
+    if( c->pass_errors + c->verify_errors )
+    {
+        length += snprintf( text + length, size - length, " [errors: %llu]", c->pass_errors + c->verify_errors );
+    }
+
+    return length;
+
+} /* nwipe_gui_compact */
+
+static int nwipe_gui_dashboard( nwipe_context_t** c,
+                                nwipe_misc_thread_data_t* nwipe_misc_thread_data,
+                                nwipe_gui_slot_t* slot )
+{
+    /**
+     * Prints the totals, a histogram of the device states, and the failing and slowest devices into the main window.
+     * The work does not depend on the number of devices.
+     *
+     * @parameter slot  The text that each line of the main window shows.
+     * @returns         The number of character cells that changed.
+     *
+     */
+
+    char nomenclature_result_str[NOMENCLATURE_RESULT_STR_SIZE];
+
+    /* The lines of the dashboard. */
+    char text[NWIPE_GUI_DASHBOARD_LINES][NWIPE_GUI_CELL_SIZE];
+
+    /* The number of leading characters of each line that report a failure. */
+    int highlight[NWIPE_GUI_DASHBOARD_LINES];
+
+    /* The number of lines. */
+    int lines = 0;
+
+    /* Window dimensions. */
+    int wlines;
+    int wcols;
+
+    /* The width of the histogram bars. */
+    int width;
+
+    /* The length of a bar. */
+    int bar;
+
+    /* The length of a line before its i/o statistics. */
+    int length;
+
+    /* The number of devices that are being wiped. */
+    int active;
+
+    /* The number of devices. */
+    int count = nwipe_misc_thread_data->nwipe_selected;
+
+    int cells = 0;
+    int i;
+    int k;
+
+    getmaxyx( main_window, wlines, wcols );
+
+    memset( highlight, 0, sizeof( highlight ) );
+
+    active = nwipe_misc_thread_data->states[NWIPE_STATE_WRITING] + nwipe_misc_thread_data->states[NWIPE_STATE_VERIFYING]
+        + nwipe_misc_thread_data->states[NWIPE_STATE_BLANKING] + nwipe_misc_thread_data->states[NWIPE_STATE_SYNCING];
+
+    Determine_C_B_nomenclature(
+        nwipe_misc_thread_data->throughput, nomenclature_result_str, NOMENCLATURE_RESULT_STR_SIZE );
+
+    snprintf( text[lines++],
+              NWIPE_GUI_CELL_SIZE,
+              "Drives: %i   Active: %i   Throughput: %s/s   Errors: %llu",
+              count,
+              active,
+              nomenclature_result_str,
+              nwipe_misc_thread_data->errors );
+    text[lines++][0] = 0;
+
+    /* The histogram of device states. */
+    width = wcols - 24;
+    if( width > NWIPE_GUI_CELL_SIZE - 20 )
+    {
+        width = NWIPE_GUI_CELL_SIZE - 20;
+    }
+    for( i = 0; i < NWIPE_STATE_COUNT; i++ )
+    {
+        bar = ( count > 0 && width > 0 ) ? nwipe_misc_thread_data->states[i] * width / count : 0;
+        if( bar == 0 && nwipe_misc_thread_data->states[i] > 0 && width > 0 )
+        {
+            bar = 1;
+        }
+        k = snprintf( text[lines],
+                      NWIPE_GUI_CELL_SIZE,
+                      "%-10s %5i ",
+                      nwipe_gui_state_names[i],
+                      nwipe_misc_thread_data->states[i] );
+        memset( text[lines] + k, '#', bar );
+        text[lines][k + bar] = 0;
+        if( i == NWIPE_STATE_FAILED && nwipe_misc_thread_data->states[i] > 0 )
+        {
+            highlight[lines] = k + bar;
+        }
+        lines++;
+    }
+    text[lines++][0] = 0;
+
+    /* The devices that have failed or have errors. */
+    snprintf( text[lines++], NWIPE_GUI_CELL_SIZE, "Failing drives: %i", nwipe_misc_thread_data->failing_count );
+    for( k = 0; k < nwipe_misc_thread_data->failing_count && k < NWIPE_KNOB_FAILING; k++ )
+    {
+        strcpy( text[lines], "  " );
+        nwipe_gui_compact(
+            c[nwipe_misc_thread_data->failing[k]], text[lines] + 2, NWIPE_GUI_CELL_SIZE - 2, &highlight[lines] );
+        if( highlight[lines] )
+        {
+            highlight[lines] += 2;
+        }
+        lines++;
+    }
+    if( nwipe_misc_thread_data->failing_count > NWIPE_KNOB_FAILING )
+    {
+        snprintf( text[lines++],
+                  NWIPE_GUI_CELL_SIZE,
+                  "  ... and %i more",
+                  nwipe_misc_thread_data->failing_count - NWIPE_KNOB_FAILING );
+    }
+    text[lines++][0] = 0;
+
+    /* The slowest devices that are being wiped. */
+    snprintf( text[lines++], NWIPE_GUI_CELL_SIZE, "Slowest drives:" );
+    for( k = 0; k < nwipe_misc_thread_data->slowest_count; k++ )
+    {
+        i = nwipe_misc_thread_data->slowest[k];
+        Determine_C_B_nomenclature( c[i]->throughput, nomenclature_result_str, NOMENCLATURE_RESULT_STR_SIZE );
+        snprintf( text[lines],
+                  NWIPE_GUI_CELL_SIZE,
+                  "  %-14s %6.2f%% %7s/s   remaining %02i:%02i:%02i   ",
+                  c[i]->device_name,
+                  c[i]->round_percent,
+                  nomenclature_result_str,
+                  (int) ( c[i]->eta / 3600 ),
+                  (int) ( c[i]->eta / 60 % 60 ),
+                  (int) ( c[i]->eta % 60 ) );
+        length = strlen( text[lines] );
+        nwipe_gui_iostat( c[i], text[lines] + length, NWIPE_GUI_CELL_SIZE - length, 1 );
+        lines++;
+    }
+
+    /* Print the lines that fit, and blank the rest of the window. */
+    for( i = 2; i < wlines - 2; i++ )
+    {
+        k = i - 2;
+        cells += nwipe_gui_cell(
+            main_window, i, 2, slot[i].status, k < lines ? text[k] : "", k < lines ? highlight[k] : 0 );
+    }
+
+    return cells;
+
+} /* nwipe_gui_dashboard */
+
+void* nwipe_gui_status( void* ptr )
+{
+    /**
+     * Shows runtime statistics and overall progress.
+     *
+     * Each frame only formats the devices that are visible and only redraws the text that changed. The windows are
+     * recreated when the terminal is resized, and the frame rate drops when the changes would use more than a share
+     * of the terminal line rate, which keeps slow serial consoles responsive.
+     *
+     * @parameter count           The number of contexts in the array.
+     * @parameter c               An array of device contexts.
+     *
+     * @modifies  main_window     Prints information into the main window.
+     * @modifies  c[].throughput  Updates the i/o throughput value.
+     *
+     */
+
+    extern int terminate_signal;
+
+    nwipe_thread_data_ptr_t* nwipe_thread_data_ptr;
+    nwipe_thread_data_ptr = (nwipe_thread_data_ptr_t*) ptr;
+
+    nwipe_context_t** c;
+    nwipe_misc_thread_data_t* nwipe_misc_thread_data;
+    int count;
+
+    c = nwipe_thread_data_ptr->c;
+    nwipe_misc_thread_data = nwipe_thread_data_ptr->nwipe_misc_thread_data;
+    count = nwipe_misc_thread_data->nwipe_selected;
+
+    char nomenclature_result_str[NOMENCLATURE_RESULT_STR_SIZE]; /* temporary usage */
+
+    /* Spinner character */
+    char spinner_character;
+
+    /* We count time from when this function is first called. */
+    static time_t nwipe_time_start = 0;
+
+    /* Whether the screen has been blanked by the user. */
+    static int nwipe_gui_blank = 0;
+
+    /* The current time. */
+    time_t nwipe_time_now;
+
+    /* The time when all wipes ended */
+    time_t nwipe_time_stopped;
+
+    /* The runtime that the statistics window shows. */
+    time_t nwipe_time_drawn = -1;
+
+    /* The index of the element that is visible in the first slot. */
+    static int offset;
+
+    /* The number of elements that we can show in the window. */
+    int slots = 0;
+
+    /* The view that is shown. */
+    static nwipe_gui_view_t view = NWIPE_GUI_VIEW_DETAIL;
+
+    /* The number of elements in the view, and the number of lines that each element prints. */
+    int items = 0;
+    int item_lines;
+
+    /* The element of each line of the grouped view, a device index or minus one less the group index. */
+    int* rows = NULL;
+
+    /* The index of the device or group of an element. */
+    int d;
+
+    /* Window dimensions. */
+    int wlines;
+    int wcols;
+
+    /* Generic loop variable. */
+    int i;
+
+    /* The current working line in the main window. */
+    int yy;
+
+    /* User input buffer. */
+    int keystroke;
+
+    /* The i/o priority that the I key steps the wipes to, and its text. */
+    int prio;
+    char prio_name[8];
+
+    /* controls main while loop */
+    int loop_control;
+
+    /* The text that each slot or line of the main window shows. */
+    nwipe_gui_slot_t* slot = NULL;
+
+    /* The number of elements in slot[]. */
+    int slot_count = 0;
+
+    /* The text that each field of the statistics window shows. */
+    char stats[NWIPE_GUI_STAT_COUNT][NWIPE_GUI_CELL_SIZE];
+
+    /* A line of text for the screen. */
+    char text[NWIPE_GUI_CELL_SIZE];
+
+    /* The length of the text. */
+    int length;
+
+    /* The number of leading characters of the text that report a failure. */
+    int highlight;
+
+    /* Set when the windows must be drawn from scratch. */
+    int redraw = 1;
+
+    /* The footer that is shown. */
+    const char* footer = NULL;
+
+    /* The footer that should be shown. */
+    const char* footer_wanted;
+
+    /* The number of 0.1 second ticks between frames, and the ticks since the last frame. */
+    int frame_ticks = 1;
+    int ticks = 0;
+
+    /* The number of character cells that the last frame changed. */
+    int cells;
+
+    /* The terminal bytes per second that the status screen may use, or zero for no limit. */
+    long budget = 0;
+
+    /* The line settings of a serial console. */
+    struct serial_struct serial;
+
+    /* The combined througput of all processes. */
+    nwipe_misc_thread_data->throughput = 0;
+
+    /* The estimated runtime of the slowest device. */
+    nwipe_misc_thread_data->maxeta = 0;
+
+    /* The combined number of errors of all processes. */
+    nwipe_misc_thread_data->errors = 0;
+
+    /* Time values. */
+    int nwipe_hh;
+    int nwipe_mm;
+    int nwipe_ss;
+
+    /* Throughput variables */
+    u64 nwipe_throughput;
+
+    /* The number of active wipe processes. */
+    /* Set to 1 initially to start loop.    */
+    int nwipe_active = 1;
+
+    if( nwipe_time_start == 0 )
+    {
+        /* This is the first time that we have been called. */
+        nwipe_time_start = time( NULL ) - 1;
+    }
+
+    /* Group the devices by controller, and list the lines of the grouped view. */
+    nwipe_gui_groups( c, count, nwipe_misc_thread_data );
+    if( nwipe_misc_thread_data->groups != NULL )
+    {
+        rows = malloc( ( count + nwipe_misc_thread_data->group_count ) * sizeof( int ) );
+    }
+    if( rows != NULL )
+    {
+        i = 0;
+        for( d = 0; d < nwipe_misc_thread_data->group_count; d++ )
+        {
+            rows[i++] = -1 - d;
+            for( yy = 0; yy < count; yy++ )
             {
-                /* and if the wipes have finished a different footer is required */
-                nwipe_gui_create_all_windows_on_terminal_resize( wipes_finished_footer );
+                if( c[yy]->device_group == d )
+                {
+                    rows[i++] = yy;
+                }
             }
         }
+    }
 
-        /* Initialize our working offset to the third line. */
-        yy = 2;
+    /*
+     * A serial console reports its line rate, of which a share is kept for the status screen.
+     * Ptys and virtual consoles report a rate too, but nothing limits them, so only a terminal
+     * that answers TIOCGSERIAL is budgeted.
+     */
+    if( baudrate() > 0 && ioctl( STDOUT_FILENO, TIOCGSERIAL, &serial ) == 0 )
+    {
+        budget = (long) baudrate() / 10 * NWIPE_KNOB_GUI_LINE_SHARE / 100;
+    }
 
-        /* Get the window dimensions. */
-        getmaxyx( main_window, wlines, wcols );
+    nwipe_trace_name( "gui" );
 
-        /* Less four lines for the box and padding. */
-        slots = wlines - 4;
+    loop_control = 1;
+
+    while( loop_control )
+    {
+        /* IMPORTANT ! Halfdelay(1) causes getch() to pause for 0.1 secs. This is important for two reasons.
+         * 1. Pauses the getch for 0.1 secs so that the screen is only updated max 10 times/sec. Without
+         *    this delay the loop would run hundreds of times per sec maxing out the core.
+         * 2. By keeping the delay below 0.2 seconds, i.e 0.1, it makes the keypress and resizing
+         *    nice and responsive.
+         */
+        halfdelay( 1 );  // Important, don't change this unless you know what you are doing ! Related to getch().
+
+        keystroke = getch();  // Get user input.
 
-        /* Each element prints three lines. */
-        slots /= 3;
+        /* Get the current time. */
+        if( nwipe_active && terminate_signal != 1 )
+        {
+            nwipe_time_now = time( NULL );
+            nwipe_time_stopped = nwipe_time_now;
+        }
+        else
+        {
+            nwipe_time_now = nwipe_time_stopped;
+        }
 
         if( nwipe_active == 0 || terminate_signal == 1 )
         {
-            nwipe_gui_title( footer_window, wipes_finished_footer );
+            footer_wanted = wipes_finished_footer;
+        }
+        else
+        {
+            footer_wanted = end_wipe_footer;
+        }
+
+        /* Only recreate the windows on terminal resize if the user hasn't blanked the screen */
+        if( keystroke == KEY_RESIZE && nwipe_gui_blank == 0 )
+        {
+            nwipe_gui_create_all_windows_on_terminal_resize( footer_wanted );
+            footer = footer_wanted;
+            redraw = 1;
+        }
 
-            // Refresh the footer_window ;
-            wnoutrefresh( footer_window );
+        if( footer != footer_wanted && nwipe_gui_blank == 0 )
+        {
+            nwipe_gui_amend_footer_window( footer_wanted );
+            footer = footer_wanted;
         }
 
         if( terminate_signal == 1 )
@@ -2420,11 +3153,13 @@ void* nwipe_gui_status( void* ptr )
             show_panel( options_panel );
             show_panel( main_panel );
 
-            /* reprint the footer */
-            nwipe_gui_title( footer_window, end_wipe_footer );
+            /* The terminal may have been resized while the screen was blank. */
+            nwipe_gui_create_all_windows_on_terminal_resize( footer_wanted );
 
-            // Refresh the footer_window ;
-            wnoutrefresh( footer_window );
+            /* reprint the footer */
+            nwipe_gui_amend_footer_window( footer_wanted );
+            footer = footer_wanted;
+            redraw = 1;
 
             /* Update panels */
             update_panels();
@@ -2453,6 +3188,35 @@ void* nwipe_gui_status( void* ptr )
 
                     break;
 
+                case 'v':
+                case 'V':
+
+                    /* Show the next view, skipping the grouped view when the devices could not be grouped. */
+                    view = ( view + 1 ) % NWIPE_GUI_VIEW_COUNT;
+                    if( view == NWIPE_GUI_VIEW_GROUPED && rows == NULL )
+                    {
+                        view++;
+                    }
+                    offset = 0;
+                    redraw = 1;
+
+                    break;
+
+                case 'i':
+                case 'I':
+
+                    /* Step every wipe to the next i/o priority, from the one of the first device. */
+                    prio = nwipe_ioprio_next( count > 0 ? c[0]->io_priority : 0 );
+                    for( i = 0; i < count; i++ )
+                    {
+                        nwipe_ioprio_set( c[i], prio );
+                    }
+                    nwipe_log( NWIPE_LOG_NOTICE,
+                               "The i/o priority of the wipes is now %s.",
+                               nwipe_ioprio_name( prio, prio_name ) );
+
+                    break;
+
                 case KEY_DOWN:
                 case 'j':
                 case 'J':
@@ -2460,16 +3224,18 @@ void* nwipe_gui_status( void* ptr )
                     /* Scroll down. */
                     offset += 1;
 
-                    if( count < slots )
+                    if( items < slots )
                     {
                         offset = 0;
                     }
 
-                    else if( offset + slots > count )
+                    else if( offset + slots > items )
                     {
-                        offset = count - slots;
+                        offset = items - slots;
                     }
 
+                    redraw = 1;
+
                     break;
 
                 case KEY_UP:
@@ -2484,6 +3250,8 @@ void* nwipe_gui_status( void* ptr )
                         offset = 0;
                     }
 
+                    redraw = 1;
+
                     break;
 
                 case ' ':
@@ -2516,154 +3284,238 @@ void* nwipe_gui_status( void* ptr )
             }
         }
 
-        /* Update screen if not blanked. */
-        if( nwipe_gui_blank == 0 )
+        /* Update screen if not blanked, once a frame or straight away after a change of layout. */
+        if( nwipe_gui_blank == 0 && ( ++ticks >= frame_ticks || redraw || !loop_control ) )
         {
+            ticks = 0;
+            cells = 0;
+
+            NWIPE_TRACE_BEGIN( "frame" );
 
             if( terminate_signal != 1 )
             {
                 nwipe_active = compute_stats( ptr );  // Returns number of active wipe threads
             }
 
-            /* Print information for the user. */
-            for( i = offset; i < offset + slots && i < count; i++ )
+            /* Get the window dimensions. */
+            getmaxyx( main_window, wlines, wcols );
+
+            switch( view )
             {
-                /* Print the device label. */
-                mvwprintw( main_window, yy++, 2, "%s", c[i]->device_label );
+                case NWIPE_GUI_VIEW_DETAIL:
+                    items = count;
+                    item_lines = 3;
+                    break;
 
-                /* Check whether the child process is still running the wipe. */
-                if( c[i]->wipe_status == 1 )
-                {
-                    /* Print percentage and pass information. */
-                    mvwprintw( main_window,
-                               yy++,
-                               4,
-                               "[%5.2f%%, round %i of %i, pass %i of %i] ",
-                               c[i]->round_percent,
-                               c[i]->round_working,
-                               c[i]->round_count,
-                               c[i]->pass_working,
-                               c[i]->pass_count );
-
-                } /* child running */
-                else
+                case NWIPE_GUI_VIEW_GROUPED:
+                    items = count + nwipe_misc_thread_data->group_count;
+                    item_lines = 1;
+                    break;
+
+                case NWIPE_GUI_VIEW_DASHBOARD:
+                    items = 0;
+                    item_lines = 1;
+                    break;
+
+                default:
+                    items = count;
+                    item_lines = 1;
+                    break;
+            }
+
+            /* Less four lines for the box and padding. */
+            slots = ( wlines - 4 ) / item_lines;
+
+            if( redraw || slot_count < wlines )
+            {
+                redraw = 0;
+
+                /* There is a slot for each line of the window. */
+                if( slot_count < wlines )
                 {
-                    if( c[i]->result == 0 )
-                    {
-                        mvwprintw( main_window, yy++, 4, "[%05.2f%% complete, SUCCESS! ", c[i]->round_percent );
-                    }
-                    else if( c[i]->signal )
-                    {
-                        wattron( main_window, COLOR_PAIR( 9 ) );
-                        mvwprintw( main_window, yy++, 4, "(>>> FAILURE! <<<, signal %i) ", c[i]->signal );
-                        wattroff( main_window, COLOR_PAIR( 9 ) );
-                    }
-                    else
+                    free( slot );
+                    slot_count = wlines;
+                    slot = malloc( slot_count * sizeof( nwipe_gui_slot_t ) );
+                    if( slot == NULL )
                     {
-                        wattron( main_window, COLOR_PAIR( 9 ) );
-                        mvwprintw( main_window, yy++, 4, "(>>>FAILURE!<<<, code %i) ", c[i]->result );
-                        wattroff( main_window, COLOR_PAIR( 9 ) );
+                        nwipe_perror( errno, __FUNCTION__, "malloc" );
+                        nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the status screen." );
+                        terminate_signal = 1;
+                        break;
                     }
+                }
+
+                /* Forget what the windows showed. */
+                memset( slot, 0, slot_count * sizeof( nwipe_gui_slot_t ) );
+                memset( stats, 0, sizeof( stats ) );
+                nwipe_time_drawn = -1;
 
-                } /* child returned */
+                werase( main_window );
 
-                if( c[i]->verify_errors )
+                if( offset > 0 )
                 {
-                    wprintw( main_window, "[verify errors: %llu] ", c[i]->verify_errors );
+                    mvwprintw( main_window, 1, wcols - 8, " More " );
+                    waddch( main_window, ACS_UARROW );
                 }
-                if( c[i]->pass_errors )
+
+                if( items - offset > slots )
                 {
-                    wprintw( main_window, "[pass errors: %llu] ", c[i]->pass_errors );
+                    mvwprintw( main_window, wlines - 2, wcols - 8, " More " );
+                    waddch( main_window, ACS_DARROW );
                 }
-                if( c[i]->wipe_status == 1 )
-                {
-                    switch( c[i]->pass_type )
-                    {
-                        /* Each text field in square brackets should be the same number of characters
-                         * to retain output in columns */
-                        case NWIPE_PASS_FINAL_BLANK:
-                            if( !c[i]->sync_status )
-                            {
-                                wprintw( main_window, "[ blanking] " );
-                            }
-                            break;
 
-                        case NWIPE_PASS_FINAL_OPS2:
-                            if( !c[i]->sync_status )
-                            {
-                                wprintw( main_window, "[OPS2final] " );
-                            }
-                            break;
+                /* Box the main window. */
+                box( main_window, 0, 0 );
 
-                        case NWIPE_PASS_WRITE:
-                            if( !c[i]->sync_status )
-                            {
-                                wprintw( main_window, "[ writing ] " );
-                            }
-                            break;
+                /* Add the title of the view. */
+                mvwprintw( main_window, 0, 2, "%s", nwipe_gui_view_titles[view] );
 
-                        case NWIPE_PASS_VERIFY:
-                            if( !c[i]->sync_status )
-                            {
-                                wprintw( main_window, "[verifying] " );
-                            }
-                            break;
+                werase( stats_window );
 
-                        case NWIPE_PASS_NONE:
-                            break;
-                    }
+                /* Add a border. */
+                box( stats_window, 0, 0 );
 
-                    if( c[i]->sync_status )
-                    {
-                        wprintw( main_window, "[ syncing ] " );
-                    }
-                }
+                /* Add a title. */
+                mvwprintw( stats_window, 0, ( NWIPE_GUI_STATS_W - strlen( stats_title ) ) / 2, "%s", stats_title );
 
-                /* Determine throughput nomenclature for this drive and output drives throughput to GUI */
-                Determine_C_B_nomenclature( c[i]->throughput, nomenclature_result_str, NOMENCLATURE_RESULT_STR_SIZE );
+                /* Print field labels. */
+                mvwprintw( stats_window, NWIPE_GUI_STATS_RUNTIME_Y, NWIPE_GUI_STATS_RUNTIME_X, "Runtime:" );
+                mvwprintw( stats_window, NWIPE_GUI_STATS_ETA_Y, NWIPE_GUI_STATS_ETA_X, "Remaining:" );
+                mvwprintw( stats_window, NWIPE_GUI_STATS_LOAD_Y, NWIPE_GUI_STATS_LOAD_X, "Load Averages:" );
+                mvwprintw( stats_window, NWIPE_GUI_STATS_THROUGHPUT_Y, NWIPE_GUI_STATS_THROUGHPUT_X, "Throughput:" );
+                mvwprintw( stats_window, NWIPE_GUI_STATS_ERRORS_Y, NWIPE_GUI_STATS_ERRORS_X, "Errors:" );
+            }
 
-                wprintw( main_window, "[%s/s] ", nomenclature_result_str );
+            /* Initialize our working offset to the third line. */
+            yy = 2;
 
-                /* Insert whitespace. */
-                yy += 1;
+            /* Print information for the user. */
+            if( view == NWIPE_GUI_VIEW_DASHBOARD )
+            {
+                cells += nwipe_gui_dashboard( c, nwipe_misc_thread_data, slot );
+            }
+            for( i = offset; i < offset + slots && i < items; i++ )
+            {
+                d = view == NWIPE_GUI_VIEW_GROUPED ? rows[i] : i;
+
+                if( d < 0 )
+                {
+                    /* Print the totals of a controller. */
+                    nwipe_group_t* group = &nwipe_misc_thread_data->groups[-1 - d];
+
+                    Determine_C_B_nomenclature(
+                        group->throughput, nomenclature_result_str, NOMENCLATURE_RESULT_STR_SIZE );
+                    snprintf( text,
+                              sizeof( text ),
+                              "%s: %i drives, %i active, %i failing, %s/s, lowest %.2f%%",
+                              group->controller,
+                              group->count,
+                              group->active,
+                              group->failed,
+                              nomenclature_result_str,
+                              group->percent );
+                    cells += nwipe_gui_cell( main_window, yy, 2, slot[yy].status, text, 0 );
+                    yy++;
+                    continue;
+                }
+
+                if( view == NWIPE_GUI_VIEW_DETAIL )
+                {
+                    /* Print the device label. */
+                    cells += nwipe_gui_cell( main_window, yy, 2, slot[yy].label, c[d]->device_label, 0 );
+                    yy++;
+
+                    length = nwipe_gui_progress( c[d], text, sizeof( text ), &highlight );
+                }
+                else
+                {
+                    length = nwipe_gui_compact( c[d], text, sizeof( text ), &highlight );
+                }
 
                 /* Increment the next spinner character for this context if the thread is active */
-                if( c[i]->wipe_status == 1 )
+                if( c[d]->wipe_status == 1 )
                 {
-                    spinner( c, i );
-                    spinner_string[0] = c[i]->spinner_character[0];
+                    spinner( c, d );
+                    spinner_character = c[d]->spinner_character[0];
                 }
                 else
                 {
                     /* if the wipe thread is no longer active, replace the spinner with a space */
-                    spinner_string[0] = ' ';
+                    spinner_character = ' ';
                 }
-                spinner_string[1] = 0;
-                wprintw( main_window, " %s ", spinner_string );
-            }
 
-            if( offset > 0 )
-            {
-                mvwprintw( main_window, 1, wcols - 8, " More " );
-                waddch( main_window, ACS_UARROW );
-            }
+                snprintf( text + length, sizeof( text ) - length, " %c ", spinner_character );
 
-            if( count - offset > slots )
-            {
-                mvwprintw( main_window, wlines - 2, wcols - 8, " More " );
-                waddch( main_window, ACS_DARROW );
-            }
+                /* The compact view lines up with the labels, the others indent the progress under a heading. */
+                cells += nwipe_gui_cell(
+                    main_window, yy, view == NWIPE_GUI_VIEW_COMPACT ? 2 : 4, slot[yy].status, text, highlight );
+                yy++;
 
-            /* Box the main window. */
-            box( main_window, 0, 0 );
+                if( view == NWIPE_GUI_VIEW_DETAIL )
+                {
+                    /* Print the block layer statistics under the progress. */
+                    nwipe_gui_iostat( c[d], text, sizeof( text ), 0 );
+                    cells += nwipe_gui_cell( main_window, yy, 4, slot[yy].status, text, 0 );
+                    yy++;
+                }
+            }
 
             /* Refresh the main window. */
             wnoutrefresh( main_window );
 
-            /* Update the load average field, but only if we are still wiping */
-            if( nwipe_active && terminate_signal != 1 )
+            /* The runtime, estimate and load averages change at most once a second. */
+            if( nwipe_time_now != nwipe_time_drawn )
             {
-                nwipe_gui_load();
+                nwipe_time_drawn = nwipe_time_now;
+
+                /* Update the load average field, but only if we are still wiping */
+                if( nwipe_active && terminate_signal != 1 )
+                {
+                    nwipe_gui_load( text, sizeof( text ) );
+                    cells += nwipe_gui_cell( stats_window,
+                                             NWIPE_GUI_STATS_LOAD_Y,
+                                             NWIPE_GUI_STATS_TAB,
+                                             stats[NWIPE_GUI_STAT_LOAD],
+                                             text,
+                                             0 );
+                }
+
+                /* Change the current time into a delta. */
+                nwipe_time_now -= nwipe_time_start;
+
+                /* Put the delta into HH:mm:ss form. */
+                nwipe_hh = nwipe_time_now / 3600;
+                nwipe_time_now %= 3600;
+                nwipe_mm = nwipe_time_now / 60;
+                nwipe_time_now %= 60;
+                nwipe_ss = nwipe_time_now;
+
+                /* Print the runtime. */
+                snprintf( text, sizeof( text ), "%02i:%02i:%02i", nwipe_hh, nwipe_mm, nwipe_ss );
+                cells += nwipe_gui_cell( stats_window,
+                                         NWIPE_GUI_STATS_RUNTIME_Y,
+                                         NWIPE_GUI_STATS_TAB,
+                                         stats[NWIPE_GUI_STAT_RUNTIME],
+                                         text,
+                                         0 );
+
+                time_t nwipe_maxeta = nwipe_misc_thread_data->maxeta;
+                text[0] = 0;
+                if( nwipe_maxeta > 0 )
+                {
+                    /* Do it again for the estimated runtime remaining. */
+                    nwipe_hh = nwipe_maxeta / 3600;
+                    nwipe_maxeta %= 3600;
+                    nwipe_mm = nwipe_maxeta / 60;
+                    nwipe_maxeta %= 60;
+                    nwipe_ss = nwipe_maxeta;
+
+                    snprintf( text, sizeof( text ), "%02i:%02i:%02i", nwipe_hh, nwipe_mm, nwipe_ss );
+                }
+
+                /* Print the estimated runtime remaining. */
+                cells += nwipe_gui_cell(
+                    stats_window, NWIPE_GUI_STATS_ETA_Y, NWIPE_GUI_STATS_TAB, stats[NWIPE_GUI_STAT_ETA], text, 0 );
             }
 
             nwipe_throughput = nwipe_misc_thread_data->throughput;
@@ -2672,63 +3524,18 @@ void* nwipe_gui_status( void* ptr )
             Determine_C_B_nomenclature( nwipe_throughput, nomenclature_result_str, NOMENCLATURE_RESULT_STR_SIZE );
 
             /* Print the combined throughput. */
-            mvwprintw( stats_window, NWIPE_GUI_STATS_THROUGHPUT_Y, NWIPE_GUI_STATS_THROUGHPUT_X, "Throughput:" );
-
-            mvwprintw(
-                stats_window, NWIPE_GUI_STATS_THROUGHPUT_Y, NWIPE_GUI_STATS_TAB, "%s/s", nomenclature_result_str );
-
-            /* Change the current time into a delta. */
-            nwipe_time_now -= nwipe_time_start;
-
-            /* Put the delta into HH:mm:ss form. */
-            nwipe_hh = nwipe_time_now / 3600;
-            nwipe_time_now %= 3600;
-            nwipe_mm = nwipe_time_now / 60;
-            nwipe_time_now %= 60;
-            nwipe_ss = nwipe_time_now;
-
-            /* Print the runtime. */
-            mvwprintw( stats_window, NWIPE_GUI_STATS_RUNTIME_Y, 1, "Runtime:" );
-            mvwprintw( stats_window,
-                       NWIPE_GUI_STATS_RUNTIME_Y,
-                       NWIPE_GUI_STATS_TAB,
-                       "%02i:%02i:%02i",
-                       nwipe_hh,
-                       nwipe_mm,
-                       nwipe_ss );
-
-            mvwprintw( stats_window, NWIPE_GUI_STATS_ETA_Y, 1, "Remaining:" );
-
-            time_t nwipe_maxeta = nwipe_misc_thread_data->maxeta;
-            if( nwipe_maxeta > 0 )
-            {
-                /* Do it again for the estimated runtime remaining. */
-                nwipe_hh = nwipe_maxeta / 3600;
-                nwipe_maxeta %= 3600;
-                nwipe_mm = nwipe_maxeta / 60;
-                nwipe_maxeta %= 60;
-                nwipe_ss = nwipe_maxeta;
-
-                /* Print the estimated runtime remaining. */
-                mvwprintw( stats_window,
-                           NWIPE_GUI_STATS_ETA_Y,
-                           NWIPE_GUI_STATS_TAB,
-                           "%02i:%02i:%02i",
-                           nwipe_hh,
-                           nwipe_mm,
-                           nwipe_ss );
-            }
+            snprintf( text, sizeof( text ), "%s/s", nomenclature_result_str );
+            cells += nwipe_gui_cell( stats_window,
+                                     NWIPE_GUI_STATS_THROUGHPUT_Y,
+                                     NWIPE_GUI_STATS_TAB,
+                                     stats[NWIPE_GUI_STAT_THROUGHPUT],
+                                     text,
+                                     0 );
 
             /* Print the error count. */
-            mvwprintw( stats_window, NWIPE_GUI_STATS_ERRORS_Y, NWIPE_GUI_STATS_ERRORS_X, "Errors:" );
-            mvwprintw(
-                stats_window, NWIPE_GUI_STATS_ERRORS_Y, NWIPE_GUI_STATS_TAB, "  %llu", nwipe_misc_thread_data->errors );
-
-            /* Add a border. */
-            box( stats_window, 0, 0 );
-
-            /* Add a title. */
-            mvwprintw( stats_window, 0, ( NWIPE_GUI_STATS_W - strlen( stats_title ) ) / 2, "%s", stats_title );
+            snprintf( text, sizeof( text ), "  %llu", nwipe_misc_thread_data->errors );
+            cells += nwipe_gui_cell(
+                stats_window, NWIPE_GUI_STATS_ERRORS_Y, NWIPE_GUI_STATS_TAB, stats[NWIPE_GUI_STAT_ERRORS], text, 0 );
 
             /* Refresh internal representation of stats window */
             wnoutrefresh( stats_window );
@@ -2736,10 +3543,32 @@ void* nwipe_gui_status( void* ptr )
             /* Output all windows to screen */
             doupdate();
 
+            NWIPE_TRACE_END( "frame" );
+
+            /* Slow the frame rate while the changes would use more than their share of the line rate, and speed
+             * it up again once they fit. */
+            if( budget > 0 )
+            {
+                if( (long) cells * NWIPE_GUI_CELL_COST * 10 > budget * frame_ticks
+                    && frame_ticks < NWIPE_KNOB_GUI_FRAME_TICKS )
+                {
+                    frame_ticks++;
+                }
+                else if( frame_ticks > 1 && (long) cells * NWIPE_GUI_CELL_COST * 10 < budget * ( frame_ticks - 1 ) )
+                {
+                    frame_ticks--;
+                }
+            }
+
         }  // end blank screen if
 
     } /* End of while loop */
 
+    free( slot );
+    free( rows );
+    free( nwipe_misc_thread_data->groups );
+    nwipe_misc_thread_data->groups = NULL;
+
     if( nwipe_options.logfile[0] == '\0' )
     {
         nwipe_gui_title( footer_window, wipes_finished_footer );
@@ -2772,12 +3601,34 @@ int compute_stats( void* ptr )
 
     int nwipe_active = 0;
     int i;
+    int j;
+
+    /* The state of a device. */
+    nwipe_state_t state;
+
+    /* The slowest devices, slowest first. */
+    int* slowest = nwipe_misc_thread_data->slowest;
+
+    /* The controller group of a device. */
+    nwipe_group_t* group;
 
     time_t nwipe_time_now = time( NULL );
 
     nwipe_misc_thread_data->throughput = 0;
     nwipe_misc_thread_data->maxeta = 0;
     nwipe_misc_thread_data->errors = 0;
+    nwipe_misc_thread_data->slowest_count = 0;
+    nwipe_misc_thread_data->failing_count = 0;
+    memset( nwipe_misc_thread_data->states, 0, sizeof( nwipe_misc_thread_data->states ) );
+
+    for( i = 0; i < nwipe_misc_thread_data->group_count && nwipe_misc_thread_data->groups != NULL; i++ )
+    {
+        group = &nwipe_misc_thread_data->groups[i];
+        group->active = 0;
+        group->failed = 0;
+        group->throughput = 0;
+        group->percent = 100;
+    }
 
     /* Enumerate all contexts to compute statistics. */
     for( i = 0; i < count; i++ )
@@ -2829,6 +3680,66 @@ int compute_stats( void* ptr )
         nwipe_misc_thread_data->errors += c[i]->pass_errors;
         nwipe_misc_thread_data->errors += c[i]->verify_errors;
 
+        if( c[i]->wipe_status == 1 )
+        {
+            /* Sample the block layer statistics, which the function limits to a low fixed rate. */
+            nwipe_iostat_sample( c[i] );
+        }
+
+        /* Count the device states. */
+        state = nwipe_gui_state( c[i] );
+        nwipe_misc_thread_data->states[state]++;
+
+        if( c[i]->wipe_status == 1 )
+        {
+            /* Keep the slowest devices in order, dropping the fastest when the list is full. */
+            for( j = nwipe_misc_thread_data->slowest_count; j > 0 && c[slowest[j - 1]]->throughput > c[i]->throughput;
+                 j-- )
+            {
+                if( j < NWIPE_KNOB_SLOWEST )
+                {
+                    slowest[j] = slowest[j - 1];
+                }
+            }
+            if( j < NWIPE_KNOB_SLOWEST )
+            {
+                slowest[j] = i;
+                if( nwipe_misc_thread_data->slowest_count < NWIPE_KNOB_SLOWEST )
+                {
+                    nwipe_misc_thread_data->slowest_count++;
+                }
+            }
+        }
+
+        if( state == NWIPE_STATE_FAILED || c[i]->pass_errors || c[i]->verify_errors )
+        {
+            /* Keep the first devices that are failing, and count them all. */
+            if( nwipe_misc_thread_data->failing_count < NWIPE_KNOB_FAILING )
+            {
+                nwipe_misc_thread_data->failing[nwipe_misc_thread_data->failing_count] = i;
+            }
+            nwipe_misc_thread_data->failing_count++;
+        }
+
+        if( nwipe_misc_thread_data->groups != NULL )
+        {
+            /* Accumulate the totals of the controller. */
+            group = &nwipe_misc_thread_data->groups[c[i]->device_group];
+            if( c[i]->wipe_status == 1 )
+            {
+                group->active++;
+                group->throughput += c[i]->throughput;
+            }
+            if( state == NWIPE_STATE_FAILED || c[i]->pass_errors || c[i]->verify_errors )
+            {
+                group->failed++;
+            }
+            if( c[i]->round_percent < group->percent )
+            {
+                group->percent = c[i]->round_percent;
+            }
+        }
+
     } /* for statistics */
 
     return nwipe_active;
@@ -0,0 +1,459 @@
+/*
+ *  ioprio.c: The i/o priority of the threads of a wipe and the cgroup of the wipe.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#include <limits.h>
+#include <mntent.h>
+
+#include "nwipe.h"
+#include "context.h"
+#include "method.h"
+#include "prng.h"
+#include "options.h"
+#include "logging.h"
+#include "ioprio.h"
+
+/* The 'which' of ioprio_set() for a single thread. */
+#define NWIPE_IOPRIO_WHO_PROCESS 1
+
+/* The levels of the best effort class. */
+#define NWIPE_IOPRIO_LEVELS 8
+
+/* Serializes the threads of the devices with the changes of their priority. */
+static pthread_mutex_t nwipe_ioprio_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Set once a failed ioprio_set() has been logged. */
+static int nwipe_ioprio_failed = 0;
+
+/* The cgroup of the job, and the cgroup the process started in, empty when there is none. */
+static char nwipe_cgroup_job[PATH_MAX] = "";
+static char nwipe_cgroup_origin[PATH_MAX] = "";
+
+static void nwipe_ioprio_apply( pid_t tid, int prio )
+{
+    /* Called with the mutex held. */
+
+    if( syscall( SYS_ioprio_set, NWIPE_IOPRIO_WHO_PROCESS, tid, prio ) != 0 && !nwipe_ioprio_failed )
+    {
+        nwipe_perror( errno, __FUNCTION__, "ioprio_set" );
+        nwipe_log( NWIPE_LOG_WARNING, "Unable to set the i/o priority of thread %i.", (int) tid );
+        nwipe_ioprio_failed = 1;
+    }
+
+} /* nwipe_ioprio_apply */
+
+int nwipe_ioprio_parse( const char* text, int* prio )
+{
+    char* end;
+    long level;
+
+    if( strcmp( text, "none" ) == 0 )
+    {
+        *prio = NWIPE_IOPRIO( NWIPE_IOPRIO_CLASS_NONE, 0 );
+        return 0;
+    }
+
+    if( strcmp( text, "idle" ) == 0 )
+    {
+        *prio = NWIPE_IOPRIO( NWIPE_IOPRIO_CLASS_IDLE, 0 );
+        return 0;
+    }
+
+    if( strcmp( text, "be" ) == 0 )
+    {
+        /* The level that a nice value of zero maps to. */
+        *prio = NWIPE_IOPRIO( NWIPE_IOPRIO_CLASS_BE, 4 );
+        return 0;
+    }
+
+    if( strncmp( text, "be:", 3 ) == 0 )
+    {
+        errno = 0;
+        level = strtol( text + 3, &end, 10 );
+
+        if( errno == 0 && end != text + 3 && *end == 0 && level >= 0 && level < NWIPE_IOPRIO_LEVELS )
+        {
+            *prio = NWIPE_IOPRIO( NWIPE_IOPRIO_CLASS_BE, (int) level );
+            return 0;
+        }
+    }
+
+    return -1;
+
+} /* nwipe_ioprio_parse */
+
+char* nwipe_ioprio_name( int prio, char* buffer )
+{
+    switch( NWIPE_IOPRIO_CLASS( prio ) )
+    {
+        case NWIPE_IOPRIO_CLASS_IDLE:
+            strcpy( buffer, "idle" );
+            break;
+
+        case NWIPE_IOPRIO_CLASS_BE:
+            sprintf( buffer, "be:%i", NWIPE_IOPRIO_LEVEL( prio ) % NWIPE_IOPRIO_LEVELS );
+            break;
+
+        default:
+            strcpy( buffer, "none" );
+            break;
+    }
+
+    return buffer;
+
+} /* nwipe_ioprio_name */
+
+int nwipe_ioprio_next( int prio )
+{
+    /**
+     * From the highest to the lowest, and back to none: be:0, be:4, be:7, idle, none.
+     */
+
+    switch( NWIPE_IOPRIO_CLASS( prio ) )
+    {
+        case NWIPE_IOPRIO_CLASS_NONE:
+            return NWIPE_IOPRIO( NWIPE_IOPRIO_CLASS_BE, 0 );
+
+        case NWIPE_IOPRIO_CLASS_BE:
+            if( NWIPE_IOPRIO_LEVEL( prio ) < 4 )
+            {
+                return NWIPE_IOPRIO( NWIPE_IOPRIO_CLASS_BE, 4 );
+            }
+            if( NWIPE_IOPRIO_LEVEL( prio ) < NWIPE_IOPRIO_LEVELS - 1 )
+            {
+                return NWIPE_IOPRIO( NWIPE_IOPRIO_CLASS_BE, NWIPE_IOPRIO_LEVELS - 1 );
+            }
+            return NWIPE_IOPRIO( NWIPE_IOPRIO_CLASS_IDLE, 0 );
+
+        default:
+            return NWIPE_IOPRIO( NWIPE_IOPRIO_CLASS_NONE, 0 );
+    }
+
+} /* nwipe_ioprio_next */
+
+void nwipe_ioprio_join( nwipe_context_t* c )
+{
+    pid_t tid = (pid_t) syscall( SYS_gettid );
+    int i;
+
+    pthread_mutex_lock( &nwipe_ioprio_mutex );
+
+    for( i = 0; i < NWIPE_IO_THREADS; i++ )
+    {
+        if( c->io_tid[i] == 0 )
+        {
+            c->io_tid[i] = tid;
+            break;
+        }
+    }
+
+    /* A thread that finds no free slot still starts at the priority, it only misses the changes. */
+    if( c->io_priority != 0 )
+    {
+        nwipe_ioprio_apply( tid, c->io_priority );
+    }
+
+    pthread_mutex_unlock( &nwipe_ioprio_mutex );
+
+} /* nwipe_ioprio_join */
+
+void nwipe_ioprio_leave( void* ptr )
+{
+    nwipe_context_t* c = (nwipe_context_t*) ptr;
+    pid_t tid = (pid_t) syscall( SYS_gettid );
+    int i;
+
+    pthread_mutex_lock( &nwipe_ioprio_mutex );
+
+    for( i = 0; i < NWIPE_IO_THREADS; i++ )
+    {
+        if( c->io_tid[i] == tid )
+        {
+            c->io_tid[i] = 0;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock( &nwipe_ioprio_mutex );
+
+} /* nwipe_ioprio_leave */
+
+void nwipe_ioprio_set( nwipe_context_t* c, int prio )
+{
+    int i;
+
+    pthread_mutex_lock( &nwipe_ioprio_mutex );
+
+    c->io_priority = prio;
+
+    for( i = 0; i < NWIPE_IO_THREADS; i++ )
+    {
+        if( c->io_tid[i] != 0 )
+        {
+            nwipe_ioprio_apply( c->io_tid[i], prio );
+        }
+    }
+
+    pthread_mutex_unlock( &nwipe_ioprio_mutex );
+
+} /* nwipe_ioprio_set */
+
+static int nwipe_cgroup_write( const char* dir, const char* file, const char* text )
+{
+    /**
+     * Writes a line to a control file of a cgroup, which takes each write as one command.
+     *
+     * @return  Zero on success, else the errno of the failure.
+     */
+
+    char path[PATH_MAX];
+    int fd;
+    int e = 0;
+
+    snprintf( path, sizeof( path ), "%s/%s", dir, file );
+
+    fd = open( path, O_WRONLY );
+
+    if( fd < 0 )
+    {
+        return errno;
+    }
+
+    if( write( fd, text, strlen( text ) ) != (ssize_t) strlen( text ) )
+    {
+        e = errno;
+    }
+
+    close( fd );
+
+    return e;
+
+} /* nwipe_cgroup_write */
+
+static int nwipe_cgroup_find_origin( void )
+{
+    /**
+     * Finds the directory of the cgroup the process is in, from the cgroup2 mount and the
+     * unified hierarchy entry of /proc/self/cgroup.
+     */
+
+    FILE* fp;
+    struct mntent* m;
+    char mount[PATH_MAX] = "";
+    char line[PATH_MAX];
+
+    fp = setmntent( "/proc/self/mounts", "r" );
+
+    if( fp == NULL )
+    {
+        return -1;
+    }
+
+    while( ( m = getmntent( fp ) ) != NULL )
+    {
+        if( strcmp( m->mnt_type, "cgroup2" ) == 0 )
+        {
+            snprintf( mount, sizeof( mount ), "%s", m->mnt_dir );
+            break;
+        }
+    }
+
+    endmntent( fp );
+
+    if( mount[0] == 0 )
+    {
+        return -1;
+    }
+
+    fp = fopen( "/proc/self/cgroup", "r" );
+
+    if( fp == NULL )
+    {
+        return -1;
+    }
+
+    while( fgets( line, sizeof( line ), fp ) != NULL )
+    {
+        if( strncmp( line, "0::", 3 ) == 0 )
+        {
+            line[strcspn( line, "\n" )] = 0;
+            snprintf( nwipe_cgroup_origin, sizeof( nwipe_cgroup_origin ), "%s%s", mount, line + 3 );
+            break;
+        }
+    }
+
+    fclose( fp );
+
+    return nwipe_cgroup_origin[0] != 0 ? 0 : -1;
+
+} /* nwipe_cgroup_find_origin */
+
+int nwipe_cgroup_create( nwipe_context_t** c, int count )
+{
+    /**
+     * Runs before the wipe threads start, so the devices are identified by their nodes. The limits
+     * go in before the move, and a limit that cannot be set fails the whole setup, so that no write
+     * of the job runs unlimited.
+     *
+     * @return  Zero when the process is in the cgroup or there is no --cgroup, else -1.
+     */
+
+    struct stat st;
+    char line[128];
+    int i;
+    int e;
+
+    if( nwipe_options.cgroup[0] == 0 )
+    {
+        return 0;
+    }
+
+    if( nwipe_cgroup_find_origin() != 0 )
+    {
+        nwipe_log( NWIPE_LOG_ERROR, "Unable to find the cgroup2 hierarchy of this process." );
+        return -1;
+    }
+
+    if( snprintf( nwipe_cgroup_job, sizeof( nwipe_cgroup_job ), "%s/nwipe-%i", nwipe_options.cgroup, (int) getpid() )
+        >= (int) sizeof( nwipe_cgroup_job ) )
+    {
+        nwipe_log( NWIPE_LOG_ERROR, "The cgroup directory '%s' is too long.", nwipe_options.cgroup );
+        nwipe_cgroup_job[0] = 0;
+        return -1;
+    }
+
+    if( mkdir( nwipe_cgroup_job, 0755 ) != 0 )
+    {
+        nwipe_perror( errno, __FUNCTION__, "mkdir" );
+        nwipe_log( NWIPE_LOG_ERROR, "Unable to create the cgroup '%s'.", nwipe_cgroup_job );
+        nwipe_cgroup_job[0] = 0;
+        return -1;
+    }
+
+    /* The io files of the child only exist once the parent hands the controller down. */
+    e = nwipe_cgroup_write( nwipe_options.cgroup, "cgroup.subtree_control", "+io" );
+
+    if( e != 0 )
+    {
+        nwipe_perror( e, __FUNCTION__, "cgroup.subtree_control" );
+        nwipe_log( NWIPE_LOG_WARNING, "Unable to enable the io controller below '%s'.", nwipe_options.cgroup );
+    }
+
+    for( i = 0; i < count; i++ )
+    {
+        if( stat( c[i]->device_name, &st ) != 0 || !S_ISBLK( st.st_mode ) )
+        {
+            /* The device is skipped when it is opened, so it needs no limit. */
+            continue;
+        }
+
+        if( nwipe_options.iomax > 0 )
+        {
+            snprintf( line,
+                      sizeof( line ),
+                      "%u:%u rbps=%lld wbps=%lld",
+                      major( st.st_rdev ),
+                      minor( st.st_rdev ),
+                      nwipe_options.iomax,
+                      nwipe_options.iomax );
+
+            e = nwipe_cgroup_write( nwipe_cgroup_job, "io.max", line );
+
+            if( e != 0 )
+            {
+                nwipe_perror( e, __FUNCTION__, "io.max" );
+                nwipe_log( NWIPE_LOG_ERROR, "Unable to limit the rate of '%s'.", c[i]->device_name );
+                break;
+            }
+        }
+
+        if( nwipe_options.ioweight > 0 )
+        {
+            snprintf(
+                line, sizeof( line ), "%u:%u %i", major( st.st_rdev ), minor( st.st_rdev ), nwipe_options.ioweight );
+
+            e = nwipe_cgroup_write( nwipe_cgroup_job, "io.weight", line );
+
+            if( e != 0 )
+            {
+                nwipe_perror( e, __FUNCTION__, "io.weight" );
+                nwipe_log( NWIPE_LOG_ERROR, "Unable to weight the i/o of '%s'.", c[i]->device_name );
+                break;
+            }
+        }
+    }
+
+    if( i < count )
+    {
+        rmdir( nwipe_cgroup_job );
+        nwipe_cgroup_job[0] = 0;
+        return -1;
+    }
+
+    snprintf( line, sizeof( line ), "%i", (int) getpid() );
+
+    e = nwipe_cgroup_write( nwipe_cgroup_job, "cgroup.procs", line );
+
+    if( e != 0 )
+    {
+        nwipe_perror( e, __FUNCTION__, "cgroup.procs" );
+        nwipe_log( NWIPE_LOG_ERROR, "Unable to move the wipe into the cgroup '%s'.", nwipe_cgroup_job );
+        rmdir( nwipe_cgroup_job );
+        nwipe_cgroup_job[0] = 0;
+        return -1;
+    }
+
+    nwipe_log( NWIPE_LOG_NOTICE,
+               "The wipe runs in the cgroup '%s', write to its io.max to change the limits.",
+               nwipe_cgroup_job );
+
+    return 0;
+
+} /* nwipe_cgroup_create */
+
+void nwipe_cgroup_remove( void )
+{
+    char line[32];
+    int e;
+
+    if( nwipe_cgroup_job[0] == 0 )
+    {
+        return;
+    }
+
+    snprintf( line, sizeof( line ), "%i", (int) getpid() );
+
+    e = nwipe_cgroup_write( nwipe_cgroup_origin, "cgroup.procs", line );
+
+    if( e != 0 )
+    {
+        nwipe_perror( e, __FUNCTION__, "cgroup.procs" );
+        nwipe_log( NWIPE_LOG_WARNING, "Unable to move back to the cgroup '%s'.", nwipe_cgroup_origin );
+    }
+
+    /* A cgroup can only be removed once it is empty, which it is not when the move failed. */
+    if( rmdir( nwipe_cgroup_job ) != 0 )
+    {
+        nwipe_perror( errno, __FUNCTION__, "rmdir" );
+        nwipe_log( NWIPE_LOG_WARNING, "Unable to remove the cgroup '%s'.", nwipe_cgroup_job );
+    }
+
+    nwipe_cgroup_job[0] = 0;
+
+} /* nwipe_cgroup_remove */
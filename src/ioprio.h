@@ -0,0 +1,69 @@
+/*
+ *  ioprio.h: The i/o priority of the threads of a wipe and the cgroup of the wipe.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef IOPRIO_H_
+#define IOPRIO_H_
+
+/*
+ * Each thread that reads or writes a device joins the device, which sets the thread to the
+ * priority of the device with ioprio_set() and lets a later change reach it, so the status screen
+ * can turn a wipe down to the idle class while it runs. The priority is kept by the block layer
+ * for reads, direct writes and syncs, and only the bfq and mq-deadline schedulers act on it.
+ *
+ * Buffered writes are written back by the kernel on behalf of the cgroup of the writer, so the
+ * limits of a job are placed on a cgroup instead: with --cgroup=DIR the process moves into a
+ * child DIR/nwipe-<pid> that has an io.max and an io.weight line for each device, and moves back
+ * on exit. The io controller is not threaded, so the cgroup is for the whole job, not per thread.
+ */
+
+/* The kernel encoding of an i/o priority, the class in the top bits and the level below. */
+#define NWIPE_IOPRIO_CLASS_SHIFT 13
+#define NWIPE_IOPRIO( class, level ) ( ( ( class ) << NWIPE_IOPRIO_CLASS_SHIFT ) | ( level ) )
+#define NWIPE_IOPRIO_CLASS( prio ) ( ( prio ) >> NWIPE_IOPRIO_CLASS_SHIFT )
+#define NWIPE_IOPRIO_LEVEL( prio ) ( ( prio ) & ( ( 1 << NWIPE_IOPRIO_CLASS_SHIFT ) - 1 ) )
+
+/* The classes, none leaves the priority to follow the nice value of the process. */
+#define NWIPE_IOPRIO_CLASS_NONE 0
+#define NWIPE_IOPRIO_CLASS_BE 2
+#define NWIPE_IOPRIO_CLASS_IDLE 3
+
+/* Parses none, idle, be or be:LEVEL into a priority, returns -1 when the text is not one. */
+int nwipe_ioprio_parse( const char* text, int* prio );
+
+/* Formats a priority as nwipe_ioprio_parse() reads it, into a buffer of at least 8 bytes. */
+char* nwipe_ioprio_name( int prio, char* buffer );
+
+/* The priority that follows 'prio' when the status screen cycles through them. */
+int nwipe_ioprio_next( int prio );
+
+/* Sets the calling thread to the priority of the device and lets later changes reach it. */
+void nwipe_ioprio_join( nwipe_context_t* c );
+
+/* Forgets the calling thread, also usable as a pthread cleanup handler with the context. */
+void nwipe_ioprio_leave( void* ptr );
+
+/* Changes the priority of a device and of the threads that have joined it. */
+void nwipe_ioprio_set( nwipe_context_t* c, int prio );
+
+/* Creates the cgroup of --cgroup with the limits of the devices and moves the process into it. */
+int nwipe_cgroup_create( nwipe_context_t** c, int count );
+
+/* Moves the process back to the cgroup it started in and removes the cgroup of --cgroup. */
+void nwipe_cgroup_remove( void );
+
+#endif /* IOPRIO_H_ */
@@ -0,0 +1,181 @@
+/*
+ *  iostat.c: Block layer statistics of the devices being wiped.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <limits.h>
+
+#include "nwipe.h"
+#include "context.h"
+#include "method.h"
+#include "prng.h"
+#include "options.h"
+#include "logging.h"
+#include "iostat.h"
+
+/* The fields of /sys/class/block/<dev>/stat, see Documentation/block/stat.rst. */
+#define NWIPE_IOSTAT_READ_IOS 0
+#define NWIPE_IOSTAT_READ_MERGES 1
+#define NWIPE_IOSTAT_WRITE_IOS 4
+#define NWIPE_IOSTAT_WRITE_MERGES 5
+#define NWIPE_IOSTAT_IO_TICKS 9
+#define NWIPE_IOSTAT_FIELDS 11
+
+static int nwipe_iostat_read( int fd, unsigned long long* values, int count )
+{
+    /**
+     * Reads up to 'count' numbers from the start of a sysfs file, returning the number read or -1.
+     */
+
+    char buffer[256];
+    char* p;
+    char* end;
+    ssize_t length;
+    int n;
+
+    length = pread( fd, buffer, sizeof( buffer ) - 1, 0 );
+    if( length <= 0 )
+    {
+        return -1;
+    }
+    buffer[length] = 0;
+
+    p = buffer;
+    for( n = 0; n < count; n++ )
+    {
+        values[n] = strtoull( p, &end, 10 );
+        if( end == p )
+        {
+            break;
+        }
+        p = end;
+    }
+
+    return n;
+
+} /* nwipe_iostat_read */
+
+void nwipe_iostat_open( nwipe_context_t* c )
+{
+    /**
+     * Opens the stat and inflight files of the device. Either may be missing, as for device mapper targets on old
+     * kernels, in which case the status screen shows no statistics for the device.
+     */
+
+    char path[PATH_MAX];
+    const char* name;
+
+    name = strrchr( c->device_name, '/' );
+    name = name ? name + 1 : c->device_name;
+
+    snprintf( path, sizeof( path ), "/sys/class/block/%s/stat", name );
+    c->device_iostat.stat_fd = open( path, O_RDONLY | O_CLOEXEC );
+
+    snprintf( path, sizeof( path ), "/sys/class/block/%s/inflight", name );
+    c->device_iostat.inflight_fd = open( path, O_RDONLY | O_CLOEXEC );
+
+    if( c->device_iostat.stat_fd < 0 )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "%s has no block layer statistics.", c->device_name );
+    }
+
+    c->device_iostat.sampled = 0;
+    c->device_iostat.utilization = -1;
+
+} /* nwipe_iostat_open */
+
+void nwipe_iostat_sample( nwipe_context_t* c )
+{
+    /**
+     * Derives the utilization, service time and merge rate of the last interval from the change in the counters.
+     * The first sample only records the counters.
+     *
+     * @modifies  c->device_iostat
+     *
+     */
+
+    nwipe_iostat_t* s = &c->device_iostat;
+
+    /* The counters of the stat file, and the read and write requests of the inflight file. */
+    unsigned long long values[NWIPE_IOSTAT_FIELDS];
+    unsigned long long inflight[2];
+
+    struct timespec now;
+    double seconds;
+    double elapsed;
+    u64 ios;
+    u64 merges;
+    u64 io_ticks;
+
+    if( s->stat_fd <= 0 )
+    {
+        return;
+    }
+
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    seconds = now.tv_sec + now.tv_nsec / 1e9;
+    elapsed = seconds - s->sampled;
+    if( s->sampled > 0 && elapsed < NWIPE_KNOB_IOSTAT_INTERVAL )
+    {
+        return;
+    }
+
+    if( nwipe_iostat_read( s->stat_fd, values, NWIPE_IOSTAT_FIELDS ) < NWIPE_IOSTAT_FIELDS )
+    {
+        return;
+    }
+
+    ios = values[NWIPE_IOSTAT_READ_IOS] + values[NWIPE_IOSTAT_WRITE_IOS];
+    merges = values[NWIPE_IOSTAT_READ_MERGES] + values[NWIPE_IOSTAT_WRITE_MERGES];
+    io_ticks = values[NWIPE_IOSTAT_IO_TICKS];
+
+    if( s->sampled > 0 )
+    {
+        s->utilization = ( io_ticks - s->io_ticks ) / ( elapsed * 10 );
+        if( s->utilization > 100 )
+        {
+            s->utilization = 100;
+        }
+        s->service_time = ios > s->ios ? (double) ( io_ticks - s->io_ticks ) / ( ios - s->ios ) : 0;
+        s->merge_rate = ( merges - s->merges ) / elapsed;
+    }
+
+    if( s->inflight_fd > 0 && nwipe_iostat_read( s->inflight_fd, inflight, 2 ) == 2 )
+    {
+        s->inflight = inflight[0] + inflight[1];
+    }
+
+    s->ios = ios;
+    s->merges = merges;
+    s->io_ticks = io_ticks;
+    s->sampled = seconds;
+
+} /* nwipe_iostat_sample */
+
+void nwipe_iostat_close( nwipe_context_t* c )
+{
+    if( c->device_iostat.stat_fd > 0 )
+    {
+        close( c->device_iostat.stat_fd );
+    }
+    if( c->device_iostat.inflight_fd > 0 )
+    {
+        close( c->device_iostat.inflight_fd );
+    }
+    c->device_iostat.stat_fd = -1;
+    c->device_iostat.inflight_fd = -1;
+
+} /* nwipe_iostat_close */
@@ -0,0 +1,31 @@
+/*
+ *  iostat.h: Block layer statistics of the devices being wiped.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef IOSTAT_H_
+#define IOSTAT_H_
+
+/* Opens the sysfs statistics of the device, which stay open until nwipe_iostat_close(). */
+void nwipe_iostat_open( nwipe_context_t* c );
+
+/* Samples the statistics when the last sample is older than NWIPE_KNOB_IOSTAT_INTERVAL. */
+void nwipe_iostat_sample( nwipe_context_t* c );
+
+/* Closes the sysfs statistics of the device. */
+void nwipe_iostat_close( nwipe_context_t* c );
+
+#endif /* IOSTAT_H_ */
@@ -36,6 +36,9 @@
 #include "prng.h"
 #include "options.h"
 #include "logging.h"
+#include "cpu.h"
+#include "trace.h"
+#include "arena.h"
 
 /* Global array to hold log values to print when logging to STDOUT */
 char** log_lines;
@@ -64,7 +67,11 @@ void nwipe_log( nwipe_log_t level, const char* format, ... )
 
     /* A pointer to the system time struct. */
     struct tm* p;
+
+    /* Threads that log at once wait here. */
+    NWIPE_TRACE_BEGIN( "log wait" );
     r = pthread_mutex_lock( &mutex1 );
+    NWIPE_TRACE_END( "log wait" );
     if( r != 0 )
     {
         fprintf( stderr, "nwipe_log: pthread_mutex_lock failed. Code %i \n", r );
@@ -512,6 +519,281 @@ int nwipe_log_sysinfo()
     return 0;
 }
 
+static void nwipe_log_cpu( nwipe_context_t* c )
+{
+    /**
+     * Logs the CPU cost of each stage of the wipe of a device in cycles per byte, or in
+     * nanoseconds per byte when the clock rate is unknown, and the rate that one core
+     * would sustain, which shows whether the wipe was bound by the CPU or by the device.
+     */
+
+    /* The line of stage costs. */
+    char stages[81];
+
+    /* The rate of one core in a readable format. */
+    char rate[13];
+
+    /* The CPU time of all stages in nanoseconds. */
+    u64 total = 0;
+
+    /* The clock rate of the processor, in cycles per nanosecond. */
+    double scale = nwipe_cpu_hz() / 1e9;
+
+    /* The unit of the costs. */
+    const char* unit = "cycles/B";
+
+    size_t length = 0;
+    int i;
+
+    if( c->round_done == 0 )
+    {
+        return;
+    }
+
+    if( scale <= 0 )
+    {
+        scale = 1;
+        unit = "ns/B";
+    }
+
+    stages[0] = 0;
+
+    for( i = 0; i < NWIPE_STAGE_COUNT; i++ )
+    {
+        total += c->cpu_time[i];
+
+        if( c->cpu_time[i] > 0 && length < sizeof( stages ) )
+        {
+            length += snprintf( &stages[length],
+                                sizeof( stages ) - length,
+                                "%s%s %.3f",
+                                length > 0 ? ", " : "",
+                                nwipe_cpu_stage_name( i ),
+                                c->cpu_time[i] * scale / c->round_done );
+        }
+    }
+
+    if( total == 0 )
+    {
+        return;
+    }
+
+    Determine_C_B_nomenclature( (u64) ( c->round_done * 1e9 / total ), rate, 13 );
+
+    nwipe_log( NWIPE_LOG_NOTIMESTAMP,
+               "CPU cost of %s: %.3f %s, one core sustains %s/s",
+               strrchr( c->device_name, '/' ) ? strrchr( c->device_name, '/' ) + 1 : c->device_name,
+               total * scale / c->round_done,
+               unit,
+               rate );
+    nwipe_log( NWIPE_LOG_NOTIMESTAMP, "  %s", stages );
+
+} /* nwipe_log_cpu */
+
+static const char* nwipe_log_step_names[] = {"write", "verify", "discard"};
+
+static void nwipe_log_timings( nwipe_context_t* c )
+{
+    /**
+     * Logs the duration, size, rate and sync time of each pass and verification of a device,
+     * which shows where the time of a wipe went, for instance a verification that read at half
+     * the write rate.
+     */
+
+    /* The sizes and rates in a readable format. */
+    char bytes[13];
+    char rate[13];
+
+    /* The step and the totals of the device. */
+    nwipe_pass_timing_t* t;
+    double seconds = 0;
+    double sync_seconds = 0;
+
+    int hours;
+    int minutes;
+    int secs;
+    int i;
+
+    if( c->timing_count == 0 )
+    {
+        return;
+    }
+
+    nwipe_log( NWIPE_LOG_NOTIMESTAMP,
+               "Passes of %s:",
+               strrchr( c->device_name, '/' ) ? strrchr( c->device_name, '/' ) + 1 : c->device_name );
+    nwipe_log( NWIPE_LOG_NOTIMESTAMP, "  Round Pass Step       Bytes  HH:MM:SS    Thru-put   Sync  Errors" );
+
+    for( i = 0; i < c->timing_count; i++ )
+    {
+        t = &c->timings[i];
+        seconds += t->seconds;
+        sync_seconds += t->sync_seconds;
+
+        Determine_C_B_nomenclature( t->bytes, bytes, 13 );
+        Determine_C_B_nomenclature( ( t->seconds > 0 ) ? (u64) ( t->bytes / t->seconds ) : 0, rate, 13 );
+        convert_seconds_to_hours_minutes_seconds( (u64) t->seconds, &hours, &minutes, &secs );
+
+        if( t->round > 0 )
+        {
+            nwipe_log( NWIPE_LOG_NOTIMESTAMP,
+                       "  %5i %4i %-7s %7s  %02i:%02i:%02i  %8s/s  %4.1f%%  %6llu%s",
+                       t->round,
+                       t->pass,
+                       nwipe_log_step_names[t->op],
+                       bytes,
+                       hours,
+                       minutes,
+                       secs,
+                       rate,
+                       ( t->seconds > 0 ) ? 100 * t->sync_seconds / t->seconds : 0.0,
+                       t->errors,
+                       ( t->result < 0 ) ? " failed" : "" );
+        }
+        else
+        {
+            nwipe_log( NWIPE_LOG_NOTIMESTAMP,
+                       "  final      %-7s %7s  %02i:%02i:%02i  %8s/s  %4.1f%%  %6llu%s",
+                       nwipe_log_step_names[t->op],
+                       bytes,
+                       hours,
+                       minutes,
+                       secs,
+                       rate,
+                       ( t->seconds > 0 ) ? 100 * t->sync_seconds / t->seconds : 0.0,
+                       t->errors,
+                       ( t->result < 0 ) ? " failed" : "" );
+        }
+    }
+
+    /* The Merkle roots of --digest, the last one is what --check compares the device with. */
+    for( i = 0; i < c->timing_count; i++ )
+    {
+        t = &c->timings[i];
+
+        if( t->root[0] == 0 )
+        {
+            continue;
+        }
+
+        if( t->round > 0 )
+        {
+            nwipe_log( NWIPE_LOG_NOTIMESTAMP,
+                       "  %5i %4i %-7s %s",
+                       t->round,
+                       t->pass,
+                       nwipe_log_step_names[t->op],
+                       t->root );
+        }
+        else
+        {
+            nwipe_log( NWIPE_LOG_NOTIMESTAMP, "  final      %-7s %s", nwipe_log_step_names[t->op], t->root );
+        }
+    }
+
+    convert_seconds_to_hours_minutes_seconds( (u64) seconds, &hours, &minutes, &secs );
+
+    nwipe_log( NWIPE_LOG_NOTIMESTAMP,
+               "  %02i:%02i:%02i in passes, %.1f%% of it syncing",
+               hours,
+               minutes,
+               secs,
+               ( seconds > 0 ) ? 100 * sync_seconds / seconds : 0.0 );
+
+} /* nwipe_log_timings */
+
+static void nwipe_log_csv_field( FILE* fp, const char* text )
+{
+    /**
+     * Writes a quoted CSV field, doubling the quotes in the text and replacing control and
+     * non-ASCII bytes, which some drives report in their serial number, with a '?'.
+     */
+
+    const unsigned char* p;
+
+    fputc( '"', fp );
+
+    for( p = (const unsigned char*) text; text != NULL && *p != 0; p++ )
+    {
+        if( *p == '"' )
+        {
+            fputs( "\"\"", fp );
+        }
+        else if( *p < 0x20 || *p >= 0x7f )
+        {
+            fputc( '?', fp );
+        }
+        else
+        {
+            fputc( *p, fp );
+        }
+    }
+
+    fputc( '"', fp );
+
+} /* nwipe_log_csv_field */
+
+static void nwipe_log_timings_csv( nwipe_context_t** c, int nwipe_selected )
+{
+    /**
+     * Writes the steps of every device to the --timings file as CSV, one row per step, so
+     * that drive models and methods can be compared across wipes.
+     */
+
+    nwipe_pass_timing_t* t;
+    FILE* fp;
+    int i;
+    int j;
+
+    fp = fopen( nwipe_options.timings, "w" );
+
+    if( fp == NULL )
+    {
+        nwipe_perror( errno, __FUNCTION__, "fopen" );
+        nwipe_log( NWIPE_LOG_ERROR, "Unable to write the timings to '%s'.", nwipe_options.timings );
+        return;
+    }
+
+    fprintf( fp, "device,model,serial,method,round,pass,step,bytes,seconds,sync_seconds,bytes_per_second,errors,result,digest\n" );
+
+    for( i = 0; i < nwipe_selected; i++ )
+    {
+        for( j = 0; j < c[i]->timing_count; j++ )
+        {
+            t = &c[i]->timings[j];
+
+            /* The model and serial number come from the drive and may hold anything. */
+            fprintf( fp, "%s,", c[i]->device_name );
+            nwipe_log_csv_field( fp, c[i]->device_model );
+            fputc( ',', fp );
+            nwipe_log_csv_field( fp, c[i]->device_serial_no );
+            fprintf( fp,
+                     ",\"%s\",%i,%i,%s,%llu,%.3f,%.3f,%.0f,%llu,%i,%s\n",
+                     nwipe_method_label( nwipe_options.method ),
+                     t->round,
+                     t->pass,
+                     nwipe_log_step_names[t->op],
+                     t->bytes,
+                     t->seconds,
+                     t->sync_seconds,
+                     ( t->seconds > 0 ) ? t->bytes / t->seconds : 0.0,
+                     t->errors,
+                     t->result,
+                     t->root );
+        }
+    }
+
+    if( fclose( fp ) != 0 )
+    {
+        nwipe_perror( errno, __FUNCTION__, "fclose" );
+        nwipe_log( NWIPE_LOG_ERROR, "Unable to write the timings to '%s'.", nwipe_options.timings );
+        return;
+    }
+
+    nwipe_log( NWIPE_LOG_NOTICE, "Wrote the pass timings to '%s'.", nwipe_options.timings );
+
+} /* nwipe_log_timings_csv */
+
 void nwipe_log_summary( nwipe_context_t** ptr, int nwipe_selected )
 {
     int i;
@@ -642,6 +924,24 @@ void nwipe_log_summary( nwipe_context_t** ptr, int nwipe_selected )
                     strncpy( status, "UABORTED", 8 );
                     status[8] = 0;
                 }
+                else if( nwipe_options.check[0] != 0 )
+                {
+                    /* --check only read the device and matched the digest, nothing was erased. */
+                    strncpy( exclamation_flag, " ", 1 );
+                    exclamation_flag[1] = 0;
+
+                    strncpy( status, "Checked ", 8 );
+                    status[8] = 0;
+                }
+                else if( nwipe_options.range_count > 0 )
+                {
+                    /* Only the given ranges were wiped, so do not claim that the whole device was. */
+                    strncpy( exclamation_flag, " ", 1 );
+                    exclamation_flag[1] = 0;
+
+                    strncpy( status, "Partial ", 8 );
+                    status[8] = 0;
+                }
                 else
                 {
                     strncpy( exclamation_flag, " ", 1 );
@@ -745,9 +1045,51 @@ void nwipe_log_summary( nwipe_context_t** ptr, int nwipe_selected )
                nwipe_options.rounds,
                blank,
                verify );
+
+    /* Verification reads bypass the page cache, so their rate is the read rate of the media. */
+    for( i = 0; i < nwipe_selected; i++ )
+    {
+        if( c[i]->verify_done > 0 )
+        {
+            Determine_C_B_nomenclature( c[i]->verify_throughput, throughput, 13 );
+            nwipe_log( NWIPE_LOG_NOTIMESTAMP,
+                       "Verify read rate of %s: %s/s",
+                       strrchr( c[i]->device_name, '/' ) ? strrchr( c[i]->device_name, '/' ) + 1 : c[i]->device_name,
+                       throughput );
+        }
+    }
+
+    /* Where the wall time of each device went. */
+    for( i = 0; i < nwipe_selected; i++ )
+    {
+        nwipe_log_timings( c[i] );
+    }
+
+    /* Where the CPU time of each device went. */
+    for( i = 0; i < nwipe_selected; i++ )
+    {
+        nwipe_log_cpu( c[i] );
+    }
+
+    nwipe_arena_log();
+
+    for( i = 0; i < nwipe_options.range_count; i++ )
+    {
+        nwipe_log( NWIPE_LOG_NOTIMESTAMP,
+                   "Range %i: %lld bytes from offset %lld",
+                   i + 1,
+                   nwipe_options.range[i].length,
+                   nwipe_options.range[i].start );
+    }
+
     nwipe_log( NWIPE_LOG_NOTIMESTAMP,
                "********************************************************************************" );
     nwipe_log( NWIPE_LOG_NOTIMESTAMP, "" );
+
+    if( nwipe_options.timings[0] != 0 )
+    {
+        nwipe_log_timings_csv( c, nwipe_selected );
+    }
 }
 
 void Determine_C_B_nomenclature( u64 speed, char* result, int result_array_size )
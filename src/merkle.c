@@ -0,0 +1,835 @@
+/*
+ *  merkle.c: A SHA-256 Merkle tree digest of the data of each pass.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <stdint.h>
+#include <sys/uio.h>
+
+#include "nwipe.h"
+#include "context.h"
+#include "method.h"
+#include "prng.h"
+#include "options.h"
+#include "pass.h"
+#include "zone.h"
+#include "logging.h"
+#include "cpu.h"
+#include "trace.h"
+#include "arena.h"
+#include "merkle.h"
+#include "ioprio.h"
+
+/* The length of a SHA-256 hash in bytes. */
+#define NWIPE_SHA256_LENGTH 32
+
+/* The most levels of a tree, enough for 2^64 chunks. */
+#define NWIPE_MERKLE_LEVELS 64
+
+typedef struct
+{
+    uint32_t h[8];  // The intermediate hash.
+    uint8_t block[64];  // The bytes of the block that is not full yet.
+    size_t fill;  // The number of bytes in block[].
+    uint64_t length;  // The number of bytes hashed.
+} nwipe_sha256_t;
+
+/* The nodes of a tree that are not the left child of a finished node yet, the leftmost first. */
+typedef struct
+{
+    int depth;  // The number of nodes.
+    int level[NWIPE_MERKLE_LEVELS];  // The height of each node, zero for a leaf.
+    uint8_t hash[NWIPE_MERKLE_LEVELS][NWIPE_SHA256_LENGTH];  // The hash of each node.
+} nwipe_merkle_stack_t;
+
+/* The hashing of one step of a device. */
+typedef struct nwipe_merkle_t_
+{
+    nwipe_context_t* c;  // The device.
+    char* ring;  // NWIPE_KNOB_VERIFY_AHEAD chunk buffers.
+    size_t length[NWIPE_KNOB_VERIFY_AHEAD];  // The bytes of each chunk in the ring.
+    size_t fill;  // The bytes of the chunk that the pass is filling.
+    u64 produced;  // The number of chunks filled by the pass.
+    u64 consumed;  // The number of chunks hashed by the thread.
+    int stop;  // Set when the pass has filled its last chunk.
+    pthread_t thread;  // The hashing thread.
+    pthread_mutex_t mutex;  // Guards the counters.
+    pthread_cond_t cond;  // Signalled when a counter changes.
+    nwipe_merkle_stack_t stack;  // The tree so far.
+} nwipe_merkle_t;
+
+/* A region of --check. */
+typedef struct
+{
+    nwipe_context_t* c;  // The device.
+    u64 first;  // The first chunk of the region.
+    u64 count;  // The number of chunks of the region.
+    pthread_t thread;  // The thread that hashes the region.
+    int result;  // Negative when the region could not be read.
+    int running;  // Set from the start of the thread until it is joined.
+    nwipe_merkle_stack_t stack;  // The subtrees of the region.
+} nwipe_merkle_region_t;
+
+static const uint32_t nwipe_sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+#define NWIPE_ROTR( x, n ) ( ( ( x ) >> ( n ) ) | ( ( x ) << ( 32 - ( n ) ) ) )
+
+static void nwipe_sha256_block( nwipe_sha256_t* s, const uint8_t* p )
+{
+    uint32_t w[64];
+    uint32_t a, b, c, d, e, f, g, h;
+    uint32_t t1, t2;
+    int i;
+
+    for( i = 0; i < 16; i++ )
+    {
+        w[i] = (uint32_t) p[4 * i] << 24 | (uint32_t) p[4 * i + 1] << 16 | (uint32_t) p[4 * i + 2] << 8
+            | (uint32_t) p[4 * i + 3];
+    }
+
+    for( i = 16; i < 64; i++ )
+    {
+        w[i] = ( NWIPE_ROTR( w[i - 2], 17 ) ^ NWIPE_ROTR( w[i - 2], 19 ) ^ ( w[i - 2] >> 10 ) ) + w[i - 7]
+            + ( NWIPE_ROTR( w[i - 15], 7 ) ^ NWIPE_ROTR( w[i - 15], 18 ) ^ ( w[i - 15] >> 3 ) ) + w[i - 16];
+    }
+
+    a = s->h[0];
+    b = s->h[1];
+    c = s->h[2];
+    d = s->h[3];
+    e = s->h[4];
+    f = s->h[5];
+    g = s->h[6];
+    h = s->h[7];
+
+    for( i = 0; i < 64; i++ )
+    {
+        t1 = h + ( NWIPE_ROTR( e, 6 ) ^ NWIPE_ROTR( e, 11 ) ^ NWIPE_ROTR( e, 25 ) ) + ( ( e & f ) ^ ( ~e & g ) )
+            + nwipe_sha256_k[i] + w[i];
+        t2 = ( NWIPE_ROTR( a, 2 ) ^ NWIPE_ROTR( a, 13 ) ^ NWIPE_ROTR( a, 22 ) ) + ( ( a & b ) ^ ( a & c ) ^ ( b & c ) );
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    s->h[0] += a;
+    s->h[1] += b;
+    s->h[2] += c;
+    s->h[3] += d;
+    s->h[4] += e;
+    s->h[5] += f;
+    s->h[6] += g;
+    s->h[7] += h;
+
+} /* nwipe_sha256_block */
+
+static void nwipe_sha256_init( nwipe_sha256_t* s )
+{
+    static const uint32_t h0[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+    memcpy( s->h, h0, sizeof( h0 ) );
+    s->fill = 0;
+    s->length = 0;
+
+} /* nwipe_sha256_init */
+
+static void nwipe_sha256_update( nwipe_sha256_t* s, const void* buffer, size_t length )
+{
+    const uint8_t* p = buffer;
+    size_t n;
+
+    s->length += length;
+
+    if( s->fill > 0 )
+    {
+        n = ( 64 - s->fill <= length ) ? 64 - s->fill : length;
+        memcpy( &s->block[s->fill], p, n );
+        s->fill += n;
+        p += n;
+        length -= n;
+
+        if( s->fill < 64 )
+        {
+            return;
+        }
+
+        nwipe_sha256_block( s, s->block );
+        s->fill = 0;
+    }
+
+    while( length >= 64 )
+    {
+        nwipe_sha256_block( s, p );
+        p += 64;
+        length -= 64;
+    }
+
+    memcpy( s->block, p, length );
+    s->fill = length;
+
+} /* nwipe_sha256_update */
+
+static void nwipe_sha256_final( nwipe_sha256_t* s, uint8_t* hash )
+{
+    /* The length in bits, which follows the padding. */
+    uint64_t bits = s->length * 8;
+
+    int i;
+
+    s->block[s->fill++] = 0x80;
+
+    if( s->fill > 56 )
+    {
+        memset( &s->block[s->fill], 0, 64 - s->fill );
+        nwipe_sha256_block( s, s->block );
+        s->fill = 0;
+    }
+
+    memset( &s->block[s->fill], 0, 56 - s->fill );
+
+    for( i = 0; i < 8; i++ )
+    {
+        s->block[56 + i] = (uint8_t) ( bits >> ( 56 - 8 * i ) );
+    }
+
+    nwipe_sha256_block( s, s->block );
+
+    for( i = 0; i < 8; i++ )
+    {
+        hash[4 * i] = (uint8_t) ( s->h[i] >> 24 );
+        hash[4 * i + 1] = (uint8_t) ( s->h[i] >> 16 );
+        hash[4 * i + 2] = (uint8_t) ( s->h[i] >> 8 );
+        hash[4 * i + 3] = (uint8_t) s->h[i];
+    }
+
+} /* nwipe_sha256_final */
+
+static void nwipe_merkle_leaf( const void* buffer, size_t length, uint8_t* hash )
+{
+    static const uint8_t prefix = 0x00;
+    nwipe_sha256_t s;
+
+    nwipe_sha256_init( &s );
+    nwipe_sha256_update( &s, &prefix, 1 );
+    nwipe_sha256_update( &s, buffer, length );
+    nwipe_sha256_final( &s, hash );
+
+} /* nwipe_merkle_leaf */
+
+static void nwipe_merkle_node( const uint8_t* left, const uint8_t* right, uint8_t* hash )
+{
+    static const uint8_t prefix = 0x01;
+    nwipe_sha256_t s;
+
+    nwipe_sha256_init( &s );
+    nwipe_sha256_update( &s, &prefix, 1 );
+    nwipe_sha256_update( &s, left, NWIPE_SHA256_LENGTH );
+    nwipe_sha256_update( &s, right, NWIPE_SHA256_LENGTH );
+    nwipe_sha256_final( &s, hash );
+
+} /* nwipe_merkle_node */
+
+static void nwipe_merkle_push( nwipe_merkle_stack_t* t, int level, const uint8_t* hash )
+{
+    /**
+     * Adds a node to the right of the tree, joining it with the nodes to its left that are as
+     * high, like the carries of a binary counter. A node of height h must start at a multiple
+     * of 2^h chunks.
+     */
+
+    uint8_t h[NWIPE_SHA256_LENGTH];
+
+    memcpy( h, hash, sizeof( h ) );
+
+    while( t->depth > 0 && t->level[t->depth - 1] == level )
+    {
+        t->depth -= 1;
+        nwipe_merkle_node( t->hash[t->depth], h, h );
+        level += 1;
+    }
+
+    t->level[t->depth] = level;
+    memcpy( t->hash[t->depth], h, sizeof( h ) );
+    t->depth += 1;
+
+} /* nwipe_merkle_push */
+
+static void nwipe_merkle_root( nwipe_merkle_stack_t* t, char* root )
+{
+    /**
+     * Joins the remaining nodes from the right, which gives the tree of RFC 6962, and writes
+     * the root in hexadecimal. The root of no chunks is the hash of nothing.
+     */
+
+    uint8_t h[NWIPE_SHA256_LENGTH];
+    nwipe_sha256_t s;
+    int i;
+
+    if( t->depth == 0 )
+    {
+        nwipe_sha256_init( &s );
+        nwipe_sha256_final( &s, h );
+    }
+    else
+    {
+        memcpy( h, t->hash[t->depth - 1], sizeof( h ) );
+
+        for( i = t->depth - 2; i >= 0; i-- )
+        {
+            nwipe_merkle_node( t->hash[i], h, h );
+        }
+    }
+
+    for( i = 0; i < NWIPE_SHA256_LENGTH; i++ )
+    {
+        sprintf( &root[2 * i], "%02x", h[i] );
+    }
+
+} /* nwipe_merkle_root */
+
+static void* nwipe_merkle_hash( void* ptr )
+{
+    /**
+     * Hashes the chunks of the ring as the pass fills them.
+     */
+
+    nwipe_merkle_t* m = (nwipe_merkle_t*) ptr;
+
+    /* The CPU time of this thread is all hashing. */
+    nwipe_cpu_meter_t meter;
+
+    uint8_t h[NWIPE_SHA256_LENGTH];
+
+    /* The slot of the chunk. */
+    int k;
+
+    nwipe_cpu_start( &meter, m->c );
+    nwipe_trace_name( "digest %s", m->c->device_name );
+
+    for( ;; )
+    {
+        pthread_mutex_lock( &m->mutex );
+
+        while( !m->stop && m->produced == m->consumed )
+        {
+            pthread_cond_wait( &m->cond, &m->mutex );
+        }
+
+        if( m->produced == m->consumed )
+        {
+            /* Stopped and every chunk is hashed. */
+            pthread_mutex_unlock( &m->mutex );
+            break;
+        }
+
+        pthread_mutex_unlock( &m->mutex );
+
+        /* The slot is not touched by the pass until it is consumed. */
+        k = m->consumed % NWIPE_KNOB_VERIFY_AHEAD;
+
+        nwipe_cpu_next( &meter, m->length[k] );
+        NWIPE_TRACE_BATCH( "hash", m->length[k] );
+        nwipe_merkle_leaf( &m->ring[(size_t) k * NWIPE_KNOB_VERIFY_CHUNK], m->length[k], h );
+        nwipe_merkle_push( &m->stack, 0, h );
+        nwipe_cpu_mark( &meter, NWIPE_STAGE_DIGEST );
+
+        pthread_mutex_lock( &m->mutex );
+        m->consumed += 1;
+        pthread_cond_broadcast( &m->cond );
+        pthread_mutex_unlock( &m->mutex );
+    }
+
+    NWIPE_TRACE_BATCH_END();
+    nwipe_cpu_stop( &meter );
+
+    return NULL;
+
+} /* nwipe_merkle_hash */
+
+static void nwipe_merkle_unlock( void* ptr )
+{
+    pthread_mutex_unlock( (pthread_mutex_t*) ptr );
+
+} /* nwipe_merkle_unlock */
+
+void nwipe_merkle_begin( nwipe_context_t* c )
+{
+    nwipe_merkle_t* m;
+
+    int r;
+
+    c->merkle = NULL;
+
+    /* The zones of a zoned device are written by zone.c, which does not hash them. */
+    if( !nwipe_options.digest || c->device_zone_count > 0 )
+    {
+        return;
+    }
+
+    m = calloc( 1, sizeof( nwipe_merkle_t ) );
+
+    if( m == NULL )
+    {
+        nwipe_perror( errno, __FUNCTION__, "calloc" );
+        nwipe_log( NWIPE_LOG_ERROR, "Unable to allocate the digest of '%s'.", c->device_name );
+        return;
+    }
+
+    m->c = c;
+    m->ring = nwipe_arena_get( NWIPE_KNOB_VERIFY_AHEAD * NWIPE_KNOB_VERIFY_CHUNK );
+
+    if( m->ring == NULL )
+    {
+        nwipe_perror( errno, __FUNCTION__, "nwipe_arena_get" );
+        nwipe_log( NWIPE_LOG_ERROR, "Unable to allocate the digest ring of '%s'.", c->device_name );
+        free( m );
+        return;
+    }
+
+    pthread_mutex_init( &m->mutex, NULL );
+    pthread_cond_init( &m->cond, NULL );
+
+    r = pthread_create( &m->thread, NULL, nwipe_merkle_hash, m );
+
+    if( r != 0 )
+    {
+        nwipe_perror( r, __FUNCTION__, "pthread_create" );
+        nwipe_log( NWIPE_LOG_ERROR, "Unable to start the digest thread of '%s'.", c->device_name );
+        pthread_cond_destroy( &m->cond );
+        pthread_mutex_destroy( &m->mutex );
+        nwipe_arena_put( m->ring );
+        free( m );
+        return;
+    }
+
+    c->merkle = m;
+
+} /* nwipe_merkle_begin */
+
+static void nwipe_merkle_publish( nwipe_merkle_t* m )
+{
+    pthread_mutex_lock( &m->mutex );
+    m->length[m->produced % NWIPE_KNOB_VERIFY_AHEAD] = m->fill;
+    m->produced += 1;
+    pthread_cond_broadcast( &m->cond );
+    pthread_mutex_unlock( &m->mutex );
+
+    m->fill = 0;
+
+} /* nwipe_merkle_publish */
+
+static void nwipe_merkle_wait( nwipe_merkle_t* m )
+{
+    /**
+     * Waits for a free slot in the ring, which shows in the trace when the hashing falls behind.
+     */
+
+    NWIPE_TRACE_BEGIN( "wait digest" );
+    pthread_mutex_lock( &m->mutex );
+    pthread_cleanup_push( nwipe_merkle_unlock, &m->mutex );
+
+    while( m->produced - m->consumed >= NWIPE_KNOB_VERIFY_AHEAD )
+    {
+        pthread_cond_wait( &m->cond, &m->mutex );
+    }
+
+    pthread_cleanup_pop( 1 );
+    NWIPE_TRACE_END( "wait digest" );
+
+} /* nwipe_merkle_wait */
+
+void nwipe_merkle_update( nwipe_context_t* c, const void* buffer, size_t length )
+{
+    nwipe_merkle_t* m = c->merkle;
+
+    const char* p = buffer;
+
+    /* The bytes that go into the current chunk. */
+    size_t n;
+
+    if( m == NULL )
+    {
+        return;
+    }
+
+    while( length > 0 )
+    {
+        if( m->fill == 0 )
+        {
+            nwipe_merkle_wait( m );
+        }
+
+        n = ( NWIPE_KNOB_VERIFY_CHUNK - m->fill <= length ) ? NWIPE_KNOB_VERIFY_CHUNK - m->fill : length;
+
+        memcpy( &m->ring[( m->produced % NWIPE_KNOB_VERIFY_AHEAD ) * NWIPE_KNOB_VERIFY_CHUNK + m->fill], p, n );
+        m->fill += n;
+
+        if( m->fill == NWIPE_KNOB_VERIFY_CHUNK )
+        {
+            nwipe_merkle_publish( m );
+        }
+
+        p += n;
+        length -= n;
+    }
+
+} /* nwipe_merkle_update */
+
+void nwipe_merkle_updatev( nwipe_context_t* c, const struct iovec* iov, int count, size_t length )
+{
+    int i;
+
+    for( i = 0; i < count && length > 0; i++ )
+    {
+        nwipe_merkle_update( c, iov[i].iov_base, ( iov[i].iov_len <= length ) ? iov[i].iov_len : length );
+        length -= ( iov[i].iov_len <= length ) ? iov[i].iov_len : length;
+    }
+
+} /* nwipe_merkle_updatev */
+
+void nwipe_merkle_extent_end( nwipe_context_t* c )
+{
+    if( c->merkle != NULL && c->merkle->fill > 0 )
+    {
+        nwipe_merkle_publish( c->merkle );
+    }
+
+} /* nwipe_merkle_extent_end */
+
+void nwipe_merkle_end( nwipe_context_t* c, char* root )
+{
+    nwipe_merkle_t* m = c->merkle;
+
+    root[0] = 0;
+
+    if( m == NULL )
+    {
+        return;
+    }
+
+    nwipe_merkle_extent_end( c );
+
+    pthread_mutex_lock( &m->mutex );
+    m->stop = 1;
+    pthread_cond_broadcast( &m->cond );
+    pthread_mutex_unlock( &m->mutex );
+
+    pthread_join( m->thread, NULL );
+
+    nwipe_merkle_root( &m->stack, root );
+
+    pthread_cond_destroy( &m->cond );
+    pthread_mutex_destroy( &m->mutex );
+    nwipe_arena_put( m->ring );
+    free( m );
+
+    c->merkle = NULL;
+
+} /* nwipe_merkle_end */
+
+void nwipe_merkle_abort( void* ptr )
+{
+    /**
+     * Stops the hashing thread of a step that was cancelled, the digest is dropped.
+     */
+
+    char root[NWIPE_MERKLE_HEX];
+
+    nwipe_merkle_end( (nwipe_context_t*) ptr, root );
+
+} /* nwipe_merkle_abort */
+
+static void nwipe_merkle_check_chunks( nwipe_merkle_region_t* g, char* b )
+{
+    /**
+     * Hashes the chunks of a region into its subtrees, reading them into 'b'. It is kept out of
+     * nwipe_merkle_check_region() so that the cleanup handlers do not clobber its locals.
+     */
+
+    nwipe_context_t* c = g->c;
+
+    uint8_t h[NWIPE_SHA256_LENGTH];
+
+    /* The chunk before the current extent, and the chunks of the extent. */
+    u64 base = 0;
+    u64 chunks;
+
+    /* The device offset and length of the current chunk. */
+    u64 offset;
+    size_t length;
+
+    u64 i;
+    ssize_t r;
+    int e = 0;
+
+    for( i = g->first; i < g->first + g->count; i++ )
+    {
+        /* Find the extent of the chunk. */
+        for( ;; )
+        {
+            chunks = ( c->extents[e].length + NWIPE_KNOB_VERIFY_CHUNK - 1 ) / NWIPE_KNOB_VERIFY_CHUNK;
+
+            if( i < base + chunks )
+            {
+                break;
+            }
+
+            base += chunks;
+            e += 1;
+        }
+
+        offset = c->extents[e].start + ( i - base ) * NWIPE_KNOB_VERIFY_CHUNK;
+        length = ( c->extents[e].start + c->extents[e].length - offset < NWIPE_KNOB_VERIFY_CHUNK )
+            ? c->extents[e].start + c->extents[e].length - offset
+            : NWIPE_KNOB_VERIFY_CHUNK;
+
+        r = pread( c->device_fd, b, length, offset );
+
+        if( r != (ssize_t) length )
+        {
+            nwipe_perror( errno, __FUNCTION__, "pread" );
+            nwipe_log( NWIPE_LOG_ERROR, "Unable to read %zu bytes at %llu from '%s'.", length, offset, c->device_name );
+            g->result = -1;
+            return;
+        }
+
+        nwipe_merkle_leaf( b, length, h );
+        nwipe_merkle_push( &g->stack, 0, h );
+
+        __sync_fetch_and_add( &c->pass_done, length );
+        __sync_fetch_and_add( &c->round_done, length );
+
+        pthread_testcancel();
+    }
+
+} /* nwipe_merkle_check_chunks */
+
+static void* nwipe_merkle_check_region( void* ptr )
+{
+    /**
+     * Hashes a region on its own thread, which nwipe_merkle_check_stop() may cancel.
+     */
+
+    nwipe_merkle_region_t* g = (nwipe_merkle_region_t*) ptr;
+    nwipe_context_t* c = g->c;
+
+    /* The input buffer. */
+    char* b;
+
+    b = nwipe_arena_get( NWIPE_KNOB_VERIFY_CHUNK );
+
+    if( b == NULL )
+    {
+        nwipe_perror( errno, __FUNCTION__, "nwipe_arena_get" );
+        g->result = -1;
+        return NULL;
+    }
+
+    pthread_cleanup_push( nwipe_arena_put, b );
+    nwipe_ioprio_join( c );
+    pthread_cleanup_push( nwipe_ioprio_leave, c );
+
+    nwipe_merkle_check_chunks( g, b );
+
+    pthread_cleanup_pop( 1 );
+    pthread_cleanup_pop( 1 );
+
+    return NULL;
+
+} /* nwipe_merkle_check_region */
+
+static void nwipe_merkle_check_stop( void* ptr )
+{
+    /**
+     * Cancels and joins the region threads, which hash into the stack of the cancelled thread.
+     */
+
+    nwipe_merkle_region_t* region = (nwipe_merkle_region_t*) ptr;
+
+    int i;
+
+    for( i = 0; i < NWIPE_KNOB_MERKLE_REGIONS; i++ )
+    {
+        if( region[i].running )
+        {
+            pthread_cancel( region[i].thread );
+        }
+    }
+
+    for( i = 0; i < NWIPE_KNOB_MERKLE_REGIONS; i++ )
+    {
+        if( region[i].running )
+        {
+            pthread_join( region[i].thread, NULL );
+            region[i].running = 0;
+        }
+    }
+
+} /* nwipe_merkle_check_stop */
+
+void* nwipe_merkle_check( void* ptr )
+{
+    /**
+     * Hashes a device in regions at once and compares the root with --check.
+     */
+
+    nwipe_context_t* c = (nwipe_context_t*) ptr;
+
+    nwipe_merkle_region_t region[NWIPE_KNOB_MERKLE_REGIONS];
+    nwipe_merkle_stack_t stack;
+
+    char root[NWIPE_MERKLE_HEX];
+
+    /* The number of chunks, and of chunks in a region, a power of two. */
+    u64 chunks = 0;
+    u64 span = 1;
+
+    int count;
+    int e;
+    int i;
+    int j;
+    int r;
+
+    time( &c->start_time );
+    c->wipe_status = 1;
+    c->result = -1;
+
+    nwipe_trace_name( "check %s", c->device_name );
+
+    if( nwipe_zone_probe( c ) < 0 || nwipe_extents_create( c ) != 0 )
+    {
+        c->wipe_status = 0;
+        time( &c->end_time );
+        return NULL;
+    }
+
+    for( e = 0; e < c->extent_count; e++ )
+    {
+        chunks += ( c->extents[e].length + NWIPE_KNOB_VERIFY_CHUNK - 1 ) / NWIPE_KNOB_VERIFY_CHUNK;
+    }
+
+    /* Each region is a whole subtree, so the regions join like the chunks of one pass. */
+    while( span * NWIPE_KNOB_MERKLE_REGIONS < chunks )
+    {
+        span *= 2;
+    }
+
+    c->pass_type = NWIPE_PASS_VERIFY;
+    c->pass_count = 1;
+    c->pass_size = c->wipe_size;
+    c->round_count = 1;
+    c->round_size = c->wipe_size;
+    c->pass_done = 0;
+    c->round_done = 0;
+
+    nwipe_log( NWIPE_LOG_NOTICE, "Checking the digest of %s.", c->device_name );
+
+    memset( region, 0, sizeof( region ) );
+
+    for( count = 0; count < NWIPE_KNOB_MERKLE_REGIONS && count * span < chunks; count++ )
+    {
+        region[count].c = c;
+        region[count].first = count * span;
+        region[count].count = ( chunks - count * span < span ) ? chunks - count * span : span;
+    }
+
+    memset( &stack, 0, sizeof( stack ) );
+
+    /* Stop the region threads if this thread is cancelled. */
+    pthread_cleanup_push( nwipe_merkle_check_stop, region );
+
+    for( i = 0; i < count; i++ )
+    {
+        r = pthread_create( &region[i].thread, NULL, nwipe_merkle_check_region, &region[i] );
+
+        if( r != 0 )
+        {
+            nwipe_perror( r, __FUNCTION__, "pthread_create" );
+            region[i].result = -1;
+            break;
+        }
+
+        region[i].running = 1;
+    }
+
+    /* The regions start in order, so the first one that is not running ends them. */
+    for( i = 0; i < count && region[i].running; i++ )
+    {
+        pthread_join( region[i].thread, NULL );
+        region[i].running = 0;
+
+        for( j = 0; j < region[i].stack.depth; j++ )
+        {
+            nwipe_merkle_push( &stack, region[i].stack.level[j], region[i].stack.hash[j] );
+        }
+    }
+
+    pthread_cleanup_pop( 0 );
+
+    for( i = 0; i < NWIPE_KNOB_MERKLE_REGIONS; i++ )
+    {
+        if( region[i].result < 0 )
+        {
+            break;
+        }
+    }
+
+    c->pass_type = NWIPE_PASS_NONE;
+
+    if( i < NWIPE_KNOB_MERKLE_REGIONS )
+    {
+        nwipe_log( NWIPE_LOG_ERROR, "[FAILURE] Unable to read all of %s.", c->device_name );
+        c->verify_errors += 1;
+    }
+    else
+    {
+        nwipe_merkle_root( &stack, root );
+
+        if( strcasecmp( root, nwipe_options.check ) == 0 )
+        {
+            nwipe_log( NWIPE_LOG_NOTICE, "[SUCCESS] The digest of %s is %s.", c->device_name, root );
+            c->result = 0;
+        }
+        else
+        {
+            nwipe_log( NWIPE_LOG_ERROR, "[FAILURE] The digest of %s is %s, not %s.", c->device_name, root, nwipe_options.check );
+            c->verify_errors += 1;
+        }
+    }
+
+    nwipe_extents_free( c );
+    nwipe_zone_free( c );
+
+    c->wipe_status = 0;
+    time( &c->end_time );
+
+    return NULL;
+
+} /* nwipe_merkle_check */
@@ -0,0 +1,62 @@
+/*
+ *  merkle.h: A SHA-256 Merkle tree digest of the data of each pass.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef MERKLE_H_
+#define MERKLE_H_
+
+/*
+ * With --digest every write and verification step hashes the data that it wrote or read back, in
+ * the NWIPE_KNOB_VERIFY_CHUNK chunks of each extent that the verification reads, into the root of
+ * a Merkle tree as in RFC 6962: a leaf is SHA-256( 0x00 | chunk ), a node SHA-256( 0x01 | left |
+ * right ) and the left subtree of a node holds the largest power of two of the chunks. The pass
+ * copies each chunk into a ring and a hashing thread of the step hashes it, so the i/o loop only
+ * waits when the hashing falls NWIPE_KNOB_VERIFY_AHEAD chunks behind. The tree needs one hash per
+ * level, not one per chunk.
+ *
+ * The root of a write and of its verification are equal when the device holds what was written.
+ * With --check=ROOT nwipe does not wipe but hashes the selected devices in NWIPE_KNOB_MERKLE_REGIONS
+ * regions at once, which are subtrees of the same tree, and compares the root with ROOT.
+ */
+
+struct iovec;
+
+/* The length of a root in hexadecimal with its terminating null. */
+#define NWIPE_MERKLE_HEX 65
+
+/* Starts the hashing thread of a step when --digest is set. */
+void nwipe_merkle_begin( nwipe_context_t* c );
+
+/* Adds 'length' bytes that the step wrote or read to the current chunk. */
+void nwipe_merkle_update( nwipe_context_t* c, const void* buffer, size_t length );
+
+/* Adds the first 'length' bytes of a transfer vector that the step wrote. */
+void nwipe_merkle_updatev( nwipe_context_t* c, const struct iovec* iov, int count, size_t length );
+
+/* Closes the last chunk of an extent. */
+void nwipe_merkle_extent_end( nwipe_context_t* c );
+
+/* Stops the hashing thread and writes the root in hexadecimal to 'root', empty without --digest. */
+void nwipe_merkle_end( nwipe_context_t* c, char* root );
+
+/* Stops the hashing thread and drops the digest, as a pthread cleanup handler with the context. */
+void nwipe_merkle_abort( void* ptr );
+
+/* The thread of --check, which hashes a device and compares the root with nwipe_options.check. */
+void* nwipe_merkle_check( void* ptr );
+
+#endif /* MERKLE_H_ */
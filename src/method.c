@@ -21,20 +21,15 @@
 
 /* HOWTO:  Add another wipe method.
  *
- *  1.  Create a new function here and add the prototype to the 'method.h' file.
- *  2.  Update nwipe_method_label() appropriately.
- *  3.  Put the passes that you wish to run into a nwipe_pattern_t array.
- *  4.  Call nwipe_runmethod() with your array of patterns.
- *  5.  Copy-and-paste within the 'options.c' file so that the new method can be invoked.
- *  6.  Optionally try to plug your function into 'gui.c'.
- *  7.  Update the function 'calculate_round_size()' with the new method.
+ *  1.  Put the passes of one round into a nwipe_method_pass_t array.
+ *  2.  Add the method to the nwipe_methods[] table, with the names that --method accepts.
+ *  3.  Optionally describe the method in nwipe_gui_method() in 'gui.c'.
  *
- *
- * WARNING: Remember to pad all pattern arrays with { 0, NULL }.
+ *  Methods can also be loaded from a description file, see nwipe_method_load().
  *
  * WARNING: Never change nwipe_options after calling a method.
  *
- * NOTE: The nwipe_runmethod function appends a final pass to all methods.
+ * NOTE: The final pass, if any, is chosen by the 'final' member of the method.
  *
  */
 
@@ -46,7 +41,14 @@
 #include "prng.h"
 #include "options.h"
 #include "pass.h"
+#include "zone.h"
 #include "logging.h"
+#include "cpu.h"
+#include "trace.h"
+#include "probe.h"
+#include "digest.h"
+#include "merkle.h"
+#include "ioprio.h"
 
 /*
  * Comment Legend
@@ -55,623 +57,928 @@
  *   "pattern" The magic bits that will be written to a device.
  *   "pass"    Reading or writing one pattern to an entire device.
  *   "rounds"  The number of times that a method will be applied to a device.
+ *   "plan"    A method compiled for one device, every pass and verification in the order that they run.
  *
  */
 
-const char* nwipe_dod522022m_label = "DoD 5220.22-M";
-const char* nwipe_dodshort_label = "DoD Short";
-const char* nwipe_gutmann_label = "Gutmann Wipe";
-const char* nwipe_ops2_label = "RCMP TSSIT OPS-II";
-const char* nwipe_random_label = "PRNG Stream";
-const char* nwipe_zero_label = "Zero Fill";
-const char* nwipe_verify_label = "Verify Blank";
-const char* nwipe_is5enh_label = "HMG IS5 Enhanced";
+/* The largest number of random characters that a method can use in one round. */
+#define NWIPE_METHOD_BYTES 16
+
+/* The longest static pattern that a method description file can contain. */
+#define NWIPE_METHOD_PATTERN_MAX 64
 
 const char* nwipe_unknown_label = "Unknown Method (FIXME)";
 
-const char* nwipe_method_label( void* method )
+/* The pattern of the final blanking pass. */
+static char nwipe_zero_pattern[1] = {'\x00'};
+
+/* The trace span names of the step operations, in the order of nwipe_step_op_t. */
+static const char* nwipe_step_names[] = {"write pass", "verify pass", "discard"};
+
+static const nwipe_method_pass_t nwipe_zero_passes[] = {
+    {NWIPE_METHOD_PASS_STATIC, 1, "\x00", 0, 0}  // Pass 1: 0s
+};
+
+static const nwipe_method_pass_t nwipe_ops2_passes[] = {
+    {NWIPE_METHOD_PASS_BYTE, 0, NULL, 0, 0},  // Pass 1: A random character.
+    {NWIPE_METHOD_PASS_COMPLEMENT, 0, NULL, 0, 0},  // Pass 2: The bitwise complement of pass 1.
+    {NWIPE_METHOD_PASS_BYTE, 0, NULL, 0, 0},  // Pass 3: The character of pass 1.
+    {NWIPE_METHOD_PASS_COMPLEMENT, 0, NULL, 0, 0},  // Pass 4: The bitwise complement of pass 1.
+    {NWIPE_METHOD_PASS_BYTE, 0, NULL, 0, 0},  // Pass 5: The character of pass 1.
+    {NWIPE_METHOD_PASS_COMPLEMENT, 0, NULL, 0, 0},  // Pass 6: The bitwise complement of pass 1.
+    {NWIPE_METHOD_PASS_BYTE, 0, NULL, 0, 0},  // Pass 7: The character of pass 1.
+    {NWIPE_METHOD_PASS_COMPLEMENT, 0, NULL, 0, 0}  // Pass 8: The bitwise complement of pass 1.
+};
+
+static const nwipe_method_pass_t nwipe_dodshort_passes[] = {
+    {NWIPE_METHOD_PASS_BYTE, 0, NULL, 0, 0},  // Pass 1: A random character.
+    {NWIPE_METHOD_PASS_COMPLEMENT, 0, NULL, 0, 0},  // Pass 2: The bitwise complement of pass 1.
+    {NWIPE_METHOD_PASS_RANDOM, 0, NULL, 0, 0}  // Pass 3: A random stream.
+};
+
+static const nwipe_method_pass_t nwipe_dod522022m_passes[] = {
+    {NWIPE_METHOD_PASS_BYTE, 0, NULL, 0, 0},  // Pass 1: A random character.
+    {NWIPE_METHOD_PASS_COMPLEMENT, 0, NULL, 0, 0},  // Pass 2: The bitwise complement of pass 1.
+    {NWIPE_METHOD_PASS_RANDOM, 0, NULL, 0, 0},  // Pass 3: A random stream.
+    {NWIPE_METHOD_PASS_BYTE, 0, NULL, 1, 0},  // Pass 4: A random character.
+    {NWIPE_METHOD_PASS_BYTE, 0, NULL, 2, 0},  // Pass 5: A random character.
+    {NWIPE_METHOD_PASS_COMPLEMENT, 0, NULL, 2, 0},  // Pass 6: The bitwise complement of pass 5.
+    {NWIPE_METHOD_PASS_RANDOM, 0, NULL, 0, 0}  // Pass 7: A random stream.
+};
+
+static const nwipe_method_pass_t nwipe_gutmann_passes[] = {
+    {NWIPE_METHOD_PASS_RANDOM, 0, NULL, 0, 0},  // Random pass.
+    {NWIPE_METHOD_PASS_RANDOM, 0, NULL, 0, 0},  // Random pass.
+    {NWIPE_METHOD_PASS_RANDOM, 0, NULL, 0, 0},  // Random pass.
+    {NWIPE_METHOD_PASS_RANDOM, 0, NULL, 0, 0},  // Random pass.
+    {NWIPE_METHOD_PASS_STATIC, 3, "\x55\x55\x55", 0, 0},  // Static pass: 0x555555  01010101 01010101 01010101
+    {NWIPE_METHOD_PASS_STATIC, 3, "\xAA\xAA\xAA", 0, 0},  // Static pass: 0XAAAAAA  10101010 10101010 10101010
+    {NWIPE_METHOD_PASS_STATIC, 3, "\x92\x49\x24", 0, 0},  // Static pass: 0x924924  10010010 01001001 00100100
+    {NWIPE_METHOD_PASS_STATIC, 3, "\x49\x24\x92", 0, 0},  // Static pass: 0x492492  01001001 00100100 10010010
+    {NWIPE_METHOD_PASS_STATIC, 3, "\x24\x92\x49", 0, 0},  // Static pass: 0x249249  00100100 10010010 01001001
+    {NWIPE_METHOD_PASS_STATIC, 3, "\x00\x00\x00", 0, 0},  // Static pass: 0x000000  00000000 00000000 00000000
+    {NWIPE_METHOD_PASS_STATIC, 3, "\x11\x11\x11", 0, 0},  // Static pass: 0x111111  00010001 00010001 00010001
+    {NWIPE_METHOD_PASS_STATIC, 3, "\x22\x22\x22", 0, 0},  // Static pass: 0x222222  00100010 00100010 00100010
+    {NWIPE_METHOD_PASS_STATIC, 3, "\x33\x33\x33", 0, 0},  // Static pass: 0x333333  00110011 00110011 00110011
+    {NWIPE_METHOD_PASS_STATIC, 3, "\x44\x44\x44", 0, 0},  // Static pass: 0x444444  01000100 01000100 01000100
+    {NWIPE_METHOD_PASS_STATIC, 3, "\x55\x55\x55", 0, 0},  // Static pass: 0x555555  01010101 01010101 01010101
+    {NWIPE_METHOD_PASS_STATIC, 3, "\x66\x66\x66", 0, 0},  // Static pass: 0x666666  01100110 01100110 01100110
+    {NWIPE_METHOD_PASS_STATIC, 3, "\x77\x77\x77", 0, 0},  // Static pass: 0x777777  01110111 01110111 01110111
+    {NWIPE_METHOD_PASS_STATIC, 3, "\x88\x88\x88", 0, 0},  // Static pass: 0x888888  10001000 10001000 10001000
+    {NWIPE_METHOD_PASS_STATIC, 3, "\x99\x99\x99", 0, 0},  // Static pass: 0x999999  10011001 10011001 10011001
+    {NWIPE_METHOD_PASS_STATIC, 3, "\xAA\xAA\xAA", 0, 0},  // Static pass: 0xAAAAAA  10101010 10101010 10101010
+    {NWIPE_METHOD_PASS_STATIC, 3, "\xBB\xBB\xBB", 0, 0},  // Static pass: 0xBBBBBB  10111011 10111011 10111011
+    {NWIPE_METHOD_PASS_STATIC, 3, "\xCC\xCC\xCC", 0, 0},  // Static pass: 0xCCCCCC  11001100 11001100 11001100
+    {NWIPE_METHOD_PASS_STATIC, 3, "\xDD\xDD\xDD", 0, 0},  // Static pass: 0xDDDDDD  11011101 11011101 11011101
+    {NWIPE_METHOD_PASS_STATIC, 3, "\xEE\xEE\xEE", 0, 0},  // Static pass: 0xEEEEEE  11101110 11101110 11101110
+    {NWIPE_METHOD_PASS_STATIC, 3, "\xFF\xFF\xFF", 0, 0},  // Static pass: 0xFFFFFF  11111111 11111111 11111111
+    {NWIPE_METHOD_PASS_STATIC, 3, "\x92\x49\x24", 0, 0},  // Static pass: 0x924924  10010010 01001001 00100100
+    {NWIPE_METHOD_PASS_STATIC, 3, "\x49\x24\x92", 0, 0},  // Static pass: 0x492492  01001001 00100100 10010010
+    {NWIPE_METHOD_PASS_STATIC, 3, "\x24\x92\x49", 0, 0},  // Static pass: 0x249249  00100100 10010010 01001001
+    {NWIPE_METHOD_PASS_STATIC, 3, "\x6D\xB6\xDB", 0, 0},  // Static pass: 0x6DB6DB  01101101 10110110 11011011
+    {NWIPE_METHOD_PASS_STATIC, 3, "\xB6\xDB\x6D", 0, 0},  // Static pass: 0xB6DB6D  10110110 11011011 01101101
+    {NWIPE_METHOD_PASS_STATIC, 3, "\xDB\x6D\xB6", 0, 0},  // Static pass: 0XDB6DB6  11011011 01101101 10110110
+    {NWIPE_METHOD_PASS_RANDOM, 0, NULL, 0, 0},  // Random pass.
+    {NWIPE_METHOD_PASS_RANDOM, 0, NULL, 0, 0},  // Random pass.
+    {NWIPE_METHOD_PASS_RANDOM, 0, NULL, 0, 0},  // Random pass.
+    {NWIPE_METHOD_PASS_RANDOM, 0, NULL, 0, 0}  // Random pass.
+};
+
+static const nwipe_method_pass_t nwipe_random_passes[] = {
+    {NWIPE_METHOD_PASS_RANDOM, 0, NULL, 0, 0}  // Pass 1: A random stream.
+};
+
+static const nwipe_method_pass_t nwipe_is5enh_passes[] = {
+    {NWIPE_METHOD_PASS_STATIC, 1, "\x00", 0, 0},  // Pass 1: 0s
+    {NWIPE_METHOD_PASS_STATIC, 1, "\xFF", 0, 0},  // Pass 2: 1s
+    {NWIPE_METHOD_PASS_RANDOM, 0, NULL, 0, 1}  // Pass 3: random bytes, always verified.
+};
+
+#define NWIPE_METHOD_PASSES( p ) p, sizeof( p ) / sizeof( p[0] )
+
+const nwipe_method_t nwipe_methods[] = {
+    {{"zero", "quick"}, "Zero Fill", NWIPE_METHOD_PASSES( nwipe_zero_passes ), 0, NWIPE_METHOD_FINAL_BLANK},
+    {{"ops2"}, "RCMP TSSIT OPS-II", NWIPE_METHOD_PASSES( nwipe_ops2_passes ), 0, NWIPE_METHOD_FINAL_RANDOM},
+    {{"dodshort", "dod3pass"},
+     "DoD Short",
+     NWIPE_METHOD_PASSES( nwipe_dodshort_passes ),
+     0,
+     NWIPE_METHOD_FINAL_BLANK},
+    {{"dod522022m", "dod"},
+     "DoD 5220.22-M",
+     NWIPE_METHOD_PASSES( nwipe_dod522022m_passes ),
+     0,
+     NWIPE_METHOD_FINAL_BLANK},
+    {{"gutmann"}, "Gutmann Wipe", NWIPE_METHOD_PASSES( nwipe_gutmann_passes ), 1, NWIPE_METHOD_FINAL_BLANK},
+    {{"random", "prng", "stream"}, "PRNG Stream", NWIPE_METHOD_PASSES( nwipe_random_passes ), 0, NWIPE_METHOD_FINAL_BLANK},
+    {{"verify"}, "Verify Blank", NULL, 0, 0, NWIPE_METHOD_FINAL_VERIFY},
+    {{"is5enh"}, "HMG IS5 Enhanced", NWIPE_METHOD_PASSES( nwipe_is5enh_passes ), 0, NWIPE_METHOD_FINAL_BLANK}};
+
+const int nwipe_method_count = sizeof( nwipe_methods ) / sizeof( nwipe_methods[0] );
+
+const char* nwipe_method_label( const nwipe_method_t* method )
 {
     /**
-     *  Returns a pointer to the name of the method function.
+     *  Returns a pointer to the name of the method.
      *
      */
 
-    if( method == &nwipe_dod522022m )
-    {
-        return nwipe_dod522022m_label;
-    }
-    if( method == &nwipe_dodshort )
-    {
-        return nwipe_dodshort_label;
-    }
-    if( method == &nwipe_gutmann )
-    {
-        return nwipe_gutmann_label;
-    }
-    if( method == &nwipe_ops2 )
-    {
-        return nwipe_ops2_label;
-    }
-    if( method == &nwipe_random )
-    {
-        return nwipe_random_label;
-    }
-    if( method == &nwipe_zero )
-    {
-        return nwipe_zero_label;
-    }
-    if( method == &nwipe_verify )
-    {
-        return nwipe_verify_label;
-    }
-    if( method == &nwipe_is5enh )
+    if( method == NULL || method->label == NULL )
     {
-        return nwipe_is5enh_label;
+        return nwipe_unknown_label;
     }
 
-    /* else */
-    return nwipe_unknown_label;
+    return method->label;
 
 } /* nwipe_method_label */
 
-void* nwipe_zero( void* ptr )
+const nwipe_method_t* nwipe_method_lookup( const char* name )
 {
     /**
-     * Fill the device with zeroes.
+     * Finds a built in method by any of its names.
+     *
+     * @parameter name  The name given to --method.
+     * @returns         The method, or NULL if there is no method by that name.
      */
 
-    nwipe_context_t* c;
-    c = (nwipe_context_t*) ptr;
+    int i;
+    int j;
 
-    /* get current time at the start of the wipe  */
-    time( &c->start_time );
+    for( i = 0; i < nwipe_method_count; i++ )
+    {
+        for( j = 0; j < NWIPE_METHOD_NAMES && nwipe_methods[i].names[j] != NULL; j++ )
+        {
+            if( strcmp( name, nwipe_methods[i].names[j] ) == 0 )
+            {
+                return &nwipe_methods[i];
+            }
+        }
+    }
 
-    /* set wipe in progress flag for GUI */
-    c->wipe_status = 1;
+    return NULL;
 
-    /* setup for a zero-fill. */
+} /* nwipe_method_lookup */
 
-    char zerofill[1] = {'\x00'};
-    nwipe_pattern_t patterns[] = {{1, &zerofill[0]},  // pass 1: 0s
-                                  {0, NULL}};
+static void nwipe_method_free( nwipe_method_t* method )
+{
+    /**
+     * Releases a method that was loaded by nwipe_method_load().
+     */
 
-    /* Run the method. */
-    c->result = nwipe_runmethod( c, patterns );
+    int i;
 
-    /* Finished. Set the wipe_status flag so that the GUI knows */
-    c->wipe_status = 0;
+    for( i = 0; i < method->pass_count; i++ )
+    {
+        free( (char*) method->passes[i].s );
+    }
 
-    /* get current time at the end of the wipe  */
-    time( &c->end_time );
+    free( (nwipe_method_pass_t*) method->passes );
+    free( (char*) method->names[0] );
+    free( (char*) method->label );
+    free( method );
 
-    return NULL;
-} /* nwipe_zero */
+} /* nwipe_method_free */
 
-void* nwipe_verify( void* ptr )
+nwipe_method_t* nwipe_method_load( const char* path )
 {
     /**
-     * Fill the device with zeroes.
+     * Loads a method description file.
+     *
+     * Each line holds one keyword and its arguments, and '#' starts a comment:
+     *
+     *   label  A name for the method.
+     *   pass   static XX [XX ...] [verify]   A fixed pattern of hexadecimal bytes.
+     *   pass   random [verify]               A stream from the PRNG.
+     *   pass   byte N [verify]               Random character N, chosen afresh for each round.
+     *   pass   complement N [verify]         The bitwise complement of random character N.
+     *   shuffle                              Run the passes of each device in a random order.
+     *   final  blank | random | verify | none
+     *
+     * Errors are printed to stderr because the file is read while parsing the command line.
+     *
+     * @parameter path  The name of the description file.
+     * @returns         The method, or NULL if the file could not be read.
      */
 
-    nwipe_context_t* c;
-    c = (nwipe_context_t*) ptr;
+    /* The description file. */
+    FILE* fp;
 
-    /* get current time at the start of the wipe  */
-    time( &c->start_time );
+    /* The method being built. */
+    nwipe_method_t* method;
 
-    /* set wipe in progress flag for GUI */
-    c->wipe_status = 1;
+    /* The passes being built. */
+    nwipe_method_pass_t* passes = NULL;
 
-    /* Do nothing because nwipe_runmethod appends a zero-fill. */
-    nwipe_pattern_t patterns[] = {{0, NULL}};
+    /* The pass being parsed. */
+    nwipe_method_pass_t* p;
 
-    /* Run the method. */
-    c->result = nwipe_runmethod( c, patterns );
+    /* The pattern of a static pass. */
+    char* s;
 
-    /* Finished. Set the wipe_status flag so that the GUI knows */
-    c->wipe_status = 0;
+    /* The current line and its number. */
+    char line[1024];
+    int n = 0;
 
-    /* get current time at the end of the wipe  */
-    time( &c->end_time );
+    /* Tokenizer state. */
+    char* save;
+    char* word;
+    char* arg;
+    char* end;
+    unsigned long value;
 
-    return NULL;
-} /* nwipe_verify */
+    /* Set when the file is not a valid description. */
+    int error = 0;
 
-void* nwipe_dod522022m( void* ptr )
-{
-    /**
-     * United States Department of Defense 5220.22-M standard wipe.
-     *
-     */
+    fp = fopen( path, "r" );
 
-    nwipe_context_t* c;
-    c = (nwipe_context_t*) ptr;
+    if( fp == NULL )
+    {
+        fprintf( stderr, "Error: Unable to open the method file '%s': %s\n", path, strerror( errno ) );
+        return NULL;
+    }
 
-    /* get current time at the start of the wipe  */
-    time( &c->start_time );
+    method = calloc( 1, sizeof( nwipe_method_t ) );
 
-    /* set wipe in progress flag for GUI */
-    c->wipe_status = 1;
+    if( method == NULL )
+    {
+        fprintf( stderr, "Error: Unable to allocate memory for the method '%s'.\n", path );
+        fclose( fp );
+        return NULL;
+    }
 
-    /* A result holder. */
-    int r;
+    method->names[0] = strdup( path );
+    method->final = NWIPE_METHOD_FINAL_BLANK;
 
-    /* Random characters. (Elements 2 and 6 are unused.) */
-    char dod[7];
+    while( fgets( line, sizeof( line ), fp ) != NULL )
+    {
+        n += 1;
 
-    nwipe_pattern_t patterns[] = {{1, &dod[0]},  // Pass 1: A random character.
-                                  {1, &dod[1]},  // Pass 2: The bitwise complement of pass 1.
-                                  {-1, ""},  // Pass 3: A random stream.
-                                  {1, &dod[3]},  // Pass 4: A random character.
-                                  {1, &dod[4]},  // Pass 5: A random character.
-                                  {1, &dod[5]},  // Pass 6: The bitwise complement of pass 5.
-                                  {-1, ""},  // Pass 7: A random stream.
-                                  {0, NULL}};
+        /* Strip comments. */
+        end = strchr( line, '#' );
 
-    /* Load the array with random characters. */
-    r = read( c->entropy_fd, &dod, sizeof( dod ) );
+        if( end != NULL )
+        {
+            *end = '\0';
+        }
 
-    /* NOTE: Only the random data in dod[0], dod[3], and dod[4] is actually used. */
+        word = strtok_r( line, " \t\r\n", &save );
 
-    /* Check the result. */
-    if( r != sizeof( dod ) )
-    {
-        r = errno;
-        nwipe_perror( r, __FUNCTION__, "read" );
-        nwipe_log( NWIPE_LOG_FATAL, "Unable to seed the %s method.", nwipe_dod522022m_label );
+        if( word == NULL )
+        {
+            /* A blank line. */
+            continue;
+        }
 
-        /* Ensure a negative return. */
-        if( r < 0 )
+        if( strcmp( word, "label" ) == 0 )
         {
-            c->result = r;
-            return NULL;
+            arg = strtok_r( NULL, "\r\n", &save );
+
+            while( arg != NULL && ( *arg == ' ' || *arg == '\t' ) )
+            {
+                arg += 1;
+            }
+
+            if( arg == NULL || *arg == '\0' )
+            {
+                fprintf( stderr, "Error: %s:%i: The label is empty.\n", path, n );
+                error = 1;
+                break;
+            }
+
+            free( (char*) method->label );
+            method->label = strdup( arg );
+            continue;
         }
-        else
+
+        if( strcmp( word, "shuffle" ) == 0 )
         {
-            c->result = -1;
-            return NULL;
+            method->shuffle = 1;
+            continue;
         }
-    }
 
-    /* Pass 2 is the bitwise complement of Pass 1. */
-    dod[1] = ~dod[0];
+        if( strcmp( word, "final" ) == 0 )
+        {
+            arg = strtok_r( NULL, " \t\r\n", &save );
 
-    /* Pass 4 is the bitwise complement of Pass 3. */
-    dod[5] = ~dod[4];
+            if( arg != NULL && strcmp( arg, "blank" ) == 0 )
+            {
+                method->final = NWIPE_METHOD_FINAL_BLANK;
+                continue;
+            }
 
-    /* Run the DoD 5220.22-M method. */
-    c->result = nwipe_runmethod( c, patterns );
+            if( arg != NULL && strcmp( arg, "random" ) == 0 )
+            {
+                method->final = NWIPE_METHOD_FINAL_RANDOM;
+                continue;
+            }
 
-    /* Finished. Set the wipe_status flag so that the GUI knows */
-    c->wipe_status = 0;
+            if( arg != NULL && strcmp( arg, "verify" ) == 0 )
+            {
+                method->final = NWIPE_METHOD_FINAL_VERIFY;
+                continue;
+            }
 
-    /* get current time at the end of the wipe  */
-    time( &c->end_time );
+            if( arg != NULL && strcmp( arg, "none" ) == 0 )
+            {
+                method->final = NWIPE_METHOD_FINAL_NONE;
+                continue;
+            }
 
-    return NULL;
-} /* nwipe_dod522022m */
+            fprintf( stderr, "Error: %s:%i: The final step must be blank, random, verify or none.\n", path, n );
+            error = 1;
+            break;
+        }
 
-void* nwipe_dodshort( void* ptr )
-{
-    /**
-     * United States Department of Defense 5220.22-M short wipe.
-     * This method is comprised of passes 1,2,7 from the standard wipe.
-     *
-     */
+        if( strcmp( word, "pass" ) != 0 )
+        {
+            fprintf( stderr, "Error: %s:%i: Unknown keyword '%s'.\n", path, n, word );
+            error = 1;
+            break;
+        }
 
-    nwipe_context_t* c;
-    c = (nwipe_context_t*) ptr;
+        p = realloc( passes, ( method->pass_count + 1 ) * sizeof( nwipe_method_pass_t ) );
 
-    /* get current time at the start of the wipe  */
-    time( &c->start_time );
+        if( p == NULL )
+        {
+            fprintf( stderr, "Error: Unable to allocate memory for the method '%s'.\n", path );
+            error = 1;
+            break;
+        }
 
-    /* set wipe in progress flag for GUI */
-    c->wipe_status = 1;
+        passes = p;
+        p = &passes[method->pass_count];
+        memset( p, 0, sizeof( nwipe_method_pass_t ) );
 
-    /* A result holder. */
-    int r;
+        arg = strtok_r( NULL, " \t\r\n", &save );
 
-    /* Random characters. (Element 3 is unused.) */
-    char dod[3];
+        if( arg != NULL && strcmp( arg, "random" ) == 0 )
+        {
+            p->kind = NWIPE_METHOD_PASS_RANDOM;
+            arg = strtok_r( NULL, " \t\r\n", &save );
+        }
+        else if( arg != NULL && ( strcmp( arg, "byte" ) == 0 || strcmp( arg, "complement" ) == 0 ) )
+        {
+            p->kind = ( arg[0] == 'b' ) ? NWIPE_METHOD_PASS_BYTE : NWIPE_METHOD_PASS_COMPLEMENT;
+            arg = strtok_r( NULL, " \t\r\n", &save );
+            value = ( arg != NULL ) ? strtoul( arg, &end, 10 ) : NWIPE_METHOD_BYTES;
+
+            if( arg == NULL || *end != '\0' || value >= NWIPE_METHOD_BYTES )
+            {
+                fprintf( stderr,
+                         "Error: %s:%i: The random character number must be less than %i.\n",
+                         path,
+                         n,
+                         NWIPE_METHOD_BYTES );
+                error = 1;
+                break;
+            }
 
-    nwipe_pattern_t patterns[] = {{1, &dod[0]},  // Pass 1: A random character.
-                                  {1, &dod[1]},  // Pass 2: The bitwise complement of pass 1.
-                                  {-1, ""},  // Pass 3: A random stream.
-                                  {0, NULL}};
+            p->byte = (int) value;
+            arg = strtok_r( NULL, " \t\r\n", &save );
+        }
+        else if( arg != NULL && strcmp( arg, "static" ) == 0 )
+        {
+            p->kind = NWIPE_METHOD_PASS_STATIC;
+            s = malloc( NWIPE_METHOD_PATTERN_MAX );
 
-    /* Load the array with random characters. */
-    r = read( c->entropy_fd, &dod, sizeof( dod ) );
+            if( s == NULL )
+            {
+                fprintf( stderr, "Error: Unable to allocate memory for the method '%s'.\n", path );
+                error = 1;
+                break;
+            }
 
-    /* NOTE: Only the random data in dod[0] is actually used. */
+            p->s = s;
 
-    /* Check the result. */
-    if( r != sizeof( dod ) )
-    {
-        r = errno;
-        nwipe_perror( r, __FUNCTION__, "read" );
-        nwipe_log( NWIPE_LOG_FATAL, "Unable to seed the %s method.", nwipe_dodshort_label );
+            while( ( arg = strtok_r( NULL, " \t\r\n", &save ) ) != NULL && strcmp( arg, "verify" ) != 0 )
+            {
+                value = strtoul( arg, &end, 16 );
 
-        /* Ensure a negative return. */
-        if( r < 0 )
-        {
-            c->result = r;
-            return NULL;
+                if( *end != '\0' || value > 0xFF || p->length >= NWIPE_METHOD_PATTERN_MAX )
+                {
+                    break;
+                }
+
+                s[p->length++] = (char) value;
+            }
+
+            if( ( arg != NULL && strcmp( arg, "verify" ) != 0 ) || p->length == 0 )
+            {
+                fprintf( stderr,
+                         "Error: %s:%i: A static pattern is 1 to %i hexadecimal bytes.\n",
+                         path,
+                         n,
+                         NWIPE_METHOD_PATTERN_MAX );
+                method->pass_count += 1;
+                error = 1;
+                break;
+            }
         }
         else
         {
-            c->result = -1;
-            return NULL;
+            fprintf( stderr, "Error: %s:%i: A pass must be static, random, byte or complement.\n", path, n );
+            error = 1;
+            break;
+        }
+
+        /* The pass is complete, so count it before checking its options. */
+        method->pass_count += 1;
+
+        if( arg != NULL && strcmp( arg, "verify" ) == 0 )
+        {
+            p->verify = 1;
+            arg = strtok_r( NULL, " \t\r\n", &save );
+        }
+
+        if( arg != NULL )
+        {
+            fprintf( stderr, "Error: %s:%i: Unexpected '%s'.\n", path, n, arg );
+            error = 1;
+            break;
         }
     }
 
-    /* Pass 2 is the bitwise complement of Pass 1. */
-    dod[1] = ~dod[0];
+    method->passes = passes;
 
-    /* Run the DoD 5220.022-M short method. */
-    c->result = nwipe_runmethod( c, patterns );
+    fclose( fp );
 
-    /* Finished. Set the wipe_status flag so that the GUI knows */
-    c->wipe_status = 0;
+    if( error )
+    {
+        nwipe_method_free( method );
+        return NULL;
+    }
 
-    /* get current time at the end of the wipe  */
-    time( &c->end_time );
+    if( method->pass_count == 0 && method->final != NWIPE_METHOD_FINAL_VERIFY )
+    {
+        fprintf( stderr, "Error: The method '%s' has no passes.\n", path );
+        nwipe_method_free( method );
+        return NULL;
+    }
 
-    return NULL;
-} /* nwipe_dodshort */
+    if( method->label == NULL )
+    {
+        method->label = strdup( path );
+    }
+
+    return method;
 
-void* nwipe_gutmann( void* ptr )
+} /* nwipe_method_load */
+
+static int nwipe_plan_seed( nwipe_context_t* c, const nwipe_method_t* method, void* buffer, size_t length )
 {
     /**
-     * Peter Gutmann's wipe.
-     *
+     * Reads the random data that the method needs from the entropy source.
      */
 
-    nwipe_context_t* c;
-    c = (nwipe_context_t*) ptr;
+    ssize_t r;
 
-    /* get current time at the start of the wipe  */
-    time( &c->start_time );
+    r = read( c->entropy_fd, buffer, length );
 
-    /* set wipe in progress flag for GUI */
-    c->wipe_status = 1;
+    if( r != (ssize_t) length )
+    {
+        nwipe_perror( errno, __FUNCTION__, "read" );
+        nwipe_log( NWIPE_LOG_FATAL, "Unable to seed the %s method.", nwipe_method_label( method ) );
+        return -1;
+    }
 
-    /* A result buffer. */
-    int r;
+    return 0;
 
-    /* The number of patterns in the Guttman Wipe, also used to index the 'patterns' array. */
-    int i = 35;
+} /* nwipe_plan_seed */
 
-    /* An index into the 'book' array. */
-    int j;
+static void nwipe_plan_add( nwipe_plan_t* plan,
+                            nwipe_step_op_t op,
+                            nwipe_pattern_t pattern,
+                            nwipe_pass_t pass_type,
+                            int round,
+                            int pass )
+{
+    nwipe_plan_step_t* step = &plan->steps[plan->step_count++];
 
-    /* The N-th element that has not been used. */
-    int n;
+    step->op = op;
+    step->pattern = pattern;
+    step->pass_type = pass_type;
+    step->round = round;
+    step->pass = pass;
 
-    /* Define the Gutmann method. */
-    nwipe_pattern_t book[] = {{-1, ""},  // Random pass.
-                              {-1, ""},  // Random pass.
-                              {-1, ""},  // Random pass.
-                              {-1, ""},  // Random pass.
-                              {3, "\x55\x55\x55"},  // Static pass: 0x555555  01010101 01010101 01010101
-                              {3, "\xAA\xAA\xAA"},  // Static pass: 0XAAAAAA  10101010 10101010 10101010
-                              {3, "\x92\x49\x24"},  // Static pass: 0x924924  10010010 01001001 00100100
-                              {3, "\x49\x24\x92"},  // Static pass: 0x492492  01001001 00100100 10010010
-                              {3, "\x24\x92\x49"},  // Static pass: 0x249249  00100100 10010010 01001001
-                              {3, "\x00\x00\x00"},  // Static pass: 0x000000  00000000 00000000 00000000
-                              {3, "\x11\x11\x11"},  // Static pass: 0x111111  00010001 00010001 00010001
-                              {3, "\x22\x22\x22"},  // Static pass: 0x222222  00100010 00100010 00100010
-                              {3, "\x33\x33\x33"},  // Static pass: 0x333333  00110011 00110011 00110011
-                              {3, "\x44\x44\x44"},  // Static pass: 0x444444  01000100 01000100 01000100
-                              {3, "\x55\x55\x55"},  // Static pass: 0x555555  01010101 01010101 01010101
-                              {3, "\x66\x66\x66"},  // Static pass: 0x666666  01100110 01100110 01100110
-                              {3, "\x77\x77\x77"},  // Static pass: 0x777777  01110111 01110111 01110111
-                              {3, "\x88\x88\x88"},  // Static pass: 0x888888  10001000 10001000 10001000
-                              {3, "\x99\x99\x99"},  // Static pass: 0x999999  10011001 10011001 10011001
-                              {3, "\xAA\xAA\xAA"},  // Static pass: 0xAAAAAA  10101010 10101010 10101010
-                              {3, "\xBB\xBB\xBB"},  // Static pass: 0xBBBBBB  10111011 10111011 10111011
-                              {3, "\xCC\xCC\xCC"},  // Static pass: 0xCCCCCC  11001100 11001100 11001100
-                              {3, "\xDD\xDD\xDD"},  // Static pass: 0xDDDDDD  11011101 11011101 11011101
-                              {3, "\xEE\xEE\xEE"},  // Static pass: 0xEEEEEE  11101110 11101110 11101110
-                              {3, "\xFF\xFF\xFF"},  // Static pass: 0xFFFFFF  11111111 11111111 11111111
-                              {3, "\x92\x49\x24"},  // Static pass: 0x924924  10010010 01001001 00100100
-                              {3, "\x49\x24\x92"},  // Static pass: 0x492492  01001001 00100100 10010010
-                              {3, "\x24\x92\x49"},  // Static pass: 0x249249  00100100 10010010 01001001
-                              {3, "\x6D\xB6\xDB"},  // Static pass: 0x6DB6DB  01101101 10110110 11011011
-                              {3, "\xB6\xDB\x6D"},  // Static pass: 0xB6DB6D  10110110 11011011 01101101
-                              {3, "\xDB\x6D\xB6"},  // Static pass: 0XDB6DB6  11011011 01101101 10110110
-                              {-1, ""},  // Random pass.
-                              {-1, ""},  // Random pass.
-                              {-1, ""},  // Random pass.
-                              {-1, ""},  // Random pass.
-                              {0, NULL}};
-
-    /* Put the book array into this array in random order. */
-    nwipe_pattern_t patterns[36];
-
-    /* An entropy buffer. */
-    u16 s[i];
-
-    /* Load the array with random characters. */
-    r = read( c->entropy_fd, &s, sizeof( s ) );
-
-    if( r != sizeof( s ) )
+    if( op == NWIPE_STEP_VERIFY )
     {
-        r = errno;
-        nwipe_perror( r, __FUNCTION__, "read" );
-        nwipe_log( NWIPE_LOG_FATAL, "Unable to seed the %s method.", nwipe_gutmann_label );
+        plan->verify_count += 1;
+    }
 
-        /* Ensure a negative return. */
-        if( r < 0 )
-        {
-            c->result = r;
-            return NULL;
-        }
-        else
+} /* nwipe_plan_add */
+
+static void nwipe_plan_discard( nwipe_plan_t* plan,
+                                nwipe_pattern_t pattern,
+                                nwipe_pass_t discard_type,
+                                nwipe_pass_t verify_type,
+                                int round,
+                                int pass )
+{
+    /**
+     * Adds a discard of the device and the verification that writes the chunks which do not
+     * read back as zero, so that a blank costs one read of the device.
+     */
+
+    nwipe_plan_add( plan, NWIPE_STEP_DISCARD, pattern, discard_type, round, pass );
+    nwipe_plan_add( plan, NWIPE_STEP_VERIFY, pattern, verify_type, round, pass );
+    plan->steps[plan->step_count - 1].skip = 1;
+
+} /* nwipe_plan_discard */
+
+static int nwipe_plan_is_zero( nwipe_pattern_t* pattern )
+{
+    int i;
+
+    for( i = 0; i < pattern->length; i++ )
+    {
+        if( pattern->s[i] != 0 )
         {
-            c->result = -1;
-            return NULL;
+            return 0;
         }
     }
 
-    while( --i >= 0 )
-    {
+    return pattern->length > 0;
+
+} /* nwipe_plan_is_zero */
 
-        /* Get a random integer that is less than the first index 'i'. */
-        n = (int) ( (double) ( s[i] ) / (double) ( 0x0000FFFF + 1 ) * (double) ( i + 1 ) );
+static int nwipe_method_is_zero( const nwipe_method_t* method )
+{
+    /**
+     * Returns non-zero for a zero fill, a method whose passes only write zeros.
+     */
 
-        /* Initialize the secondary index. */
-        j = -1;
+    int i;
+    int j;
 
-        while( n-- >= 0 )
+    for( i = 0; i < method->pass_count; i++ )
+    {
+        if( method->passes[i].kind != NWIPE_METHOD_PASS_STATIC )
         {
-            /* Advance 'j' by 'n' positions... */
-            j += 1;
+            return 0;
+        }
 
-            /* ... but don't count 'book' elements that have already been copied. */
-            while( book[j].length == 0 )
+        for( j = 0; j < method->passes[i].length; j++ )
+        {
+            if( method->passes[i].s[j] != 0 )
             {
-                j += 1;
+                return 0;
             }
         }
-
-        /* Copy the element. */
-        patterns[i] = book[j];
-
-        /* Mark this element as having been used. */
-        book[j].length = 0;
-
-        nwipe_log( NWIPE_LOG_DEBUG, "nwipe_gutmann: Set patterns[%i] = book[%i].", i, j );
     }
 
-    /* Ensure that the array is terminated. */
-    patterns[35].length = 0;
-    patterns[35].s = NULL;
-
-    /* Run the Gutmann method. */
-    c->result = nwipe_runmethod( c, patterns );
-
-    /* Finished. Set the wipe_status flag so that the GUI knows */
-    c->wipe_status = 0;
-
-    /* get current time at the end of the wipe  */
-    time( &c->end_time );
+    return method->pass_count > 0;
 
-    return NULL;
-} /* nwipe_gutmann */
+} /* nwipe_method_is_zero */
 
-void* nwipe_ops2( void* ptr )
+nwipe_plan_t* nwipe_plan_create( nwipe_context_t* c, const nwipe_method_t* method )
 {
     /**
-     *  Royal Canadian Mounted Police
-     *  Technical Security Standard for Information Technology
-     *  Appendix OPS-II: Media Sanitization
+     * Compiles a method into the exact sequence of passes and verifications for a device.
      *
-     *  NOTE: The last pass of this method is specially handled by nwipe_runmethod.
+     * The random characters of each round and the pass order of shuffled methods are
+     * drawn here, and the options that change what runs (rounds, verify and noblank)
+     * are applied, so the plan holds everything that nwipe_runmethod() will do and the
+     * number of bytes that it will read and write.
      *
+     * @parameter c       The device context, used for its entropy source and size.
+     * @parameter method  The method to compile.
+     * @returns           The plan, or NULL on failure. Release it with nwipe_plan_free().
      */
 
-    nwipe_context_t* c;
-    c = (nwipe_context_t*) ptr;
+    /* The plan being built. */
+    nwipe_plan_t* plan;
 
-    /* get current time at the start of the wipe  */
-    time( &c->start_time );
+    /* The pass being compiled. */
+    const nwipe_method_pass_t* p;
 
-    /* set wipe in progress flag for GUI */
-    c->wipe_status = 1;
+    /* The pattern of the pass being compiled. */
+    nwipe_pattern_t pattern;
 
-    /* A generic array index. */
-    int i;
+    /* The patterns of the final passes. */
+    nwipe_pattern_t pattern_zero = {1, nwipe_zero_pattern};
+    nwipe_pattern_t pattern_random = {-1, ""};
 
-    /* A generic result buffer. */
-    int r;
+    /* The order that the passes run in. */
+    int* order;
 
-    /* A buffer for random characters. */
-    char* s;
+    /* Entropy for shuffling the passes. */
+    u16* s;
 
-    /* A buffer for the bitwise complements of 's'. */
-    char* t;
+    /* The number of random characters used in each round. */
+    int bytes = 0;
 
-    /* The element count of 's' and 't'. */
-    u32 u;
+    /* Whether the pass is verified. */
+    int verify;
 
-    /* The pattern array for this method is dynamically allocated. */
-    nwipe_pattern_t* patterns;
+    /* Whether the method is a zero fill. */
+    int zero = nwipe_method_is_zero( method );
 
-    /* The element count of 'patterns'. */
-    u32 q;
+    /* Whether the passes may skip blocks that already hold their pattern. */
+    int skip = nwipe_options.skipmatching && zero;
 
-    /* We need one random character per round. */
-    u = 1 * nwipe_options.rounds;
+    /* Whether blanks discard the device instead of writing it, and whether one did. */
+    int discard = nwipe_options.discard && c->device_zone_count == 0 && nwipe_discard_capable( c );
+    int discarded = 0;
 
-    /* Allocate the array of random characters. */
-    s = malloc( sizeof( char ) * u );
+    /* The last write of the last round. */
+    nwipe_plan_step_t* last = NULL;
 
-    if( s == NULL )
-    {
-        nwipe_perror( errno, __FUNCTION__, "malloc" );
-        nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate the random character array." );
-        c->result = -1;
-        return NULL;
-    }
+    int round;
+    int i;
+    int j;
+    int n;
 
-    /* Allocate the array of complement characters. */
-    t = malloc( sizeof( char ) * u );
+    plan = calloc( 1, sizeof( nwipe_plan_t ) );
 
-    if( t == NULL )
+    if( plan == NULL )
     {
-        nwipe_perror( errno, __FUNCTION__, "malloc" );
-        nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate the complement character array." );
-        c->result = -1;
-        free( s );
+        nwipe_perror( errno, __FUNCTION__, "calloc" );
+        nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the wipe plan." );
         return NULL;
     }
 
-    /* We need eight pattern elements per round, plus one for padding. */
-    q = 8 * u + 1;
+    plan->method = method;
+    plan->pass_count = method->pass_count;
+    plan->round_count = nwipe_options.rounds;
 
-    /* Allocate the pattern array. */
-    patterns = malloc( sizeof( nwipe_pattern_t ) * q );
+    /* Every pass is written and read back at most once, plus up to two final steps. */
+    plan->steps = calloc( 2 * plan->pass_count * plan->round_count + 2, sizeof( nwipe_plan_step_t ) );
+    order = malloc( ( plan->pass_count + 1 ) * sizeof( int ) );
 
-    if( patterns == NULL )
+    if( plan->steps == NULL || order == NULL )
     {
-        nwipe_perror( errno, __FUNCTION__, "malloc" );
-        nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate the pattern array." );
-        c->result = -1;
-        free( s );
-        free( t );
+        nwipe_perror( errno, __FUNCTION__, "calloc" );
+        nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the wipe plan." );
+        free( order );
+        nwipe_plan_free( plan );
         return NULL;
     }
 
-    /* Load the array of random characters. */
-    r = read( c->entropy_fd, s, u );
-
-    if( r != u )
+    for( i = 0; i < plan->pass_count; i++ )
     {
-        r = errno;
-        nwipe_perror( r, __FUNCTION__, "read" );
-        nwipe_log( NWIPE_LOG_FATAL, "Unable to seed the %s method.", nwipe_ops2_label );
+        order[i] = i;
 
-        if( r < 0 )
+        if( method->passes[i].kind == NWIPE_METHOD_PASS_BYTE
+            || method->passes[i].kind == NWIPE_METHOD_PASS_COMPLEMENT )
         {
-            c->result = r;
-            free( s );
-            free( t );
-            free( patterns );
-            return NULL;
+            if( method->passes[i].byte + 1 > bytes )
+            {
+                bytes = method->passes[i].byte + 1;
+            }
         }
-        else
+    }
+
+    if( method->shuffle && plan->pass_count > 1 )
+    {
+        s = malloc( plan->pass_count * sizeof( u16 ) );
+
+        if( s == NULL || nwipe_plan_seed( c, method, s, plan->pass_count * sizeof( u16 ) ) != 0 )
         {
-            c->result = -1;
             free( s );
-            free( t );
-            free( patterns );
+            free( order );
+            nwipe_plan_free( plan );
             return NULL;
         }
+
+        for( i = plan->pass_count - 1; i > 0; i-- )
+        {
+            /* Get a random integer that is not greater than the index 'i'. */
+            j = (int) ( (double) ( s[i] ) / (double) ( 0x0000FFFF + 1 ) * (double) ( i + 1 ) );
+
+            n = order[i];
+            order[i] = order[j];
+            order[j] = n;
+
+            nwipe_log( NWIPE_LOG_DEBUG, "%s: Set pass %i to pass %i of the method.", __FUNCTION__, i + 1, order[i] + 1 );
+        }
+
+        free( s );
     }
 
-    for( i = 0; i < u; i += 1 )
+    if( bytes > 0 )
     {
-        /* Populate the array of complements. */
-        t[i] = ~s[i];
+        /* Each round has its own random characters, with their complements alongside. */
+        plan->bytes = malloc( 2 * bytes * plan->round_count );
+
+        if( plan->bytes == NULL
+            || nwipe_plan_seed( c, method, plan->bytes, bytes * plan->round_count ) != 0 )
+        {
+            free( order );
+            nwipe_plan_free( plan );
+            return NULL;
+        }
+
+        for( i = bytes * plan->round_count - 1; i >= 0; i-- )
+        {
+            plan->bytes[2 * i] = plan->bytes[i];
+            plan->bytes[2 * i + 1] = ~plan->bytes[i];
+        }
     }
 
-    for( i = 0; i < u; i += 8 )
+    for( round = 1; round <= plan->round_count; round++ )
     {
-        /* Populate the array of patterns. */
-
-        /* Even elements point to the random characters. */
-        patterns[i * 4 + 0].length = 1;
-        patterns[i * 4 + 0].s = &s[i];
-        patterns[i * 4 + 2].length = 1;
-        patterns[i * 4 + 2].s = &s[i];
-        patterns[i * 4 + 4].length = 1;
-        patterns[i * 4 + 4].s = &s[i];
-        patterns[i * 4 + 6].length = 1;
-        patterns[i * 4 + 6].s = &s[i];
-
-        /* Odd elements point to the complement characters. */
-        patterns[i * 4 + 1].length = 1;
-        patterns[i * 4 + 1].s = &t[i];
-        patterns[i * 4 + 3].length = 1;
-        patterns[i * 4 + 3].s = &t[i];
-        patterns[i * 4 + 5].length = 1;
-        patterns[i * 4 + 5].s = &t[i];
-        patterns[i * 4 + 7].length = 1;
-        patterns[i * 4 + 7].s = &t[i];
+        for( i = 0; i < plan->pass_count; i++ )
+        {
+            p = &method->passes[order[i]];
+
+            switch( p->kind )
+            {
+                case NWIPE_METHOD_PASS_STATIC:
+                    pattern.length = p->length;
+                    pattern.s = (char*) p->s;
+                    break;
+
+                case NWIPE_METHOD_PASS_BYTE:
+                case NWIPE_METHOD_PASS_COMPLEMENT:
+                    pattern.length = 1;
+                    pattern.s = &plan->bytes[2 * ( ( round - 1 ) * bytes + p->byte )
+                                             + ( p->kind == NWIPE_METHOD_PASS_COMPLEMENT )];
+                    break;
+
+                default:
+                    pattern = pattern_random;
+                    break;
+            }
+
+            last = &plan->steps[plan->step_count];
+
+            if( discard && zero )
+            {
+                /* A zero fill is a blank, so it discards the device like the final blank would. */
+                nwipe_plan_discard( plan, pattern, NWIPE_PASS_WRITE, NWIPE_PASS_VERIFY, round, i + 1 );
+                discarded = 1;
+                continue;
+            }
+
+            nwipe_plan_add( plan, NWIPE_STEP_WRITE, pattern, NWIPE_PASS_WRITE, round, i + 1 );
+            last->skip = skip;
+
+            verify = ( nwipe_options.verify == NWIPE_VERIFY_ALL || p->verify );
+
+            /* Without a final blank, the last pass is the one that is left on the device. */
+            if( nwipe_options.verify == NWIPE_VERIFY_LAST && round == plan->round_count && i == plan->pass_count - 1
+                && ( method->final == NWIPE_METHOD_FINAL_NONE
+                     || ( method->final == NWIPE_METHOD_FINAL_BLANK && nwipe_options.noblank ) ) )
+            {
+                verify = 1;
+            }
+
+            if( verify )
+            {
+                nwipe_plan_add( plan, NWIPE_STEP_VERIFY, pattern, NWIPE_PASS_VERIFY, round, i + 1 );
+            }
+        }
     }
 
-    /* Ensure that the array is terminated. */
-    patterns[q - 1].length = 0;
-    patterns[q - 1].s = NULL;
+    free( order );
 
-    /* Run the TSSIT OPS-II method. */
-    c->result = nwipe_runmethod( c, patterns );
+    switch( method->final )
+    {
+        case NWIPE_METHOD_FINAL_BLANK:
 
-    /* Release the random character buffer. */
-    free( s );
+            if( nwipe_options.noblank )
+            {
+                break;
+            }
 
-    /* Release the complement character buffer */
-    free( t );
+            if( last != NULL && nwipe_plan_is_zero( &last->pattern ) )
+            {
+                /* The last pass already filled the device with zeros, so writing them again is pointless. */
+                nwipe_log( NWIPE_LOG_NOTICE,
+                           "Skipping the final blank of %s, the last pass already writes zeros.",
+                           c->device_name );
 
-    /* Release the pattern buffer. */
-    free( patterns );
+                if( nwipe_options.verify != NWIPE_VERIFY_NONE && last == &plan->steps[plan->step_count - 1] )
+                {
+                    nwipe_plan_add( plan, NWIPE_STEP_VERIFY, pattern_zero, NWIPE_PASS_FINAL_BLANK, 0, 0 );
+                }
+                break;
+            }
 
-    /* We're done. */
+            if( discard )
+            {
+                /* Discard, then always verify, writing whatever did not come back as zero. */
+                nwipe_plan_discard( plan, pattern_zero, NWIPE_PASS_FINAL_BLANK, NWIPE_PASS_FINAL_BLANK, 0, 0 );
+                discarded = 1;
+                break;
+            }
 
-    /* Finished. Set the wipe_status flag so that the GUI knows */
-    c->wipe_status = 0;
+            nwipe_plan_add( plan, NWIPE_STEP_WRITE, pattern_zero, NWIPE_PASS_FINAL_BLANK, 0, 0 );
+            plan->steps[plan->step_count - 1].skip = nwipe_options.skipmatching;
 
-    /* get current time at the end of the wipe  */
-    time( &c->end_time );
+            if( nwipe_options.verify != NWIPE_VERIFY_NONE )
+            {
+                nwipe_plan_add( plan, NWIPE_STEP_VERIFY, pattern_zero, NWIPE_PASS_FINAL_BLANK, 0, 0 );
+            }
+            break;
 
-    return NULL;
-} /* nwipe_ops2 */
+        case NWIPE_METHOD_FINAL_RANDOM:
 
-void* nwipe_is5enh( void* ptr )
-{
-    nwipe_context_t* c = (nwipe_context_t*) ptr;
+            /* NOTE: The OPS-II method specifically requires that a random pattern be left on the device. */
+            nwipe_plan_add( plan, NWIPE_STEP_WRITE, pattern_random, NWIPE_PASS_FINAL_OPS2, 0, 0 );
 
-    /* get current time at the start of the wipe  */
-    time( &c->start_time );
+            if( nwipe_options.verify != NWIPE_VERIFY_NONE )
+            {
+                nwipe_plan_add( plan, NWIPE_STEP_VERIFY, pattern_random, NWIPE_PASS_FINAL_OPS2, 0, 0 );
+            }
+            break;
 
-    c->wipe_status = 1;
+        case NWIPE_METHOD_FINAL_VERIFY:
 
-    char is5enh[3] = {'\x00', '\xFF', '\x00'};
-    nwipe_pattern_t patterns[] = {{1, &is5enh[0]},  // Pass 1: 0s
-                                  {1, &is5enh[1]},  // Pass 2: 1s
-                                  {-1, &is5enh[2]},  // Pass 3: random bytes with verification
-                                  {0, NULL}};
-    c->result = nwipe_runmethod( c, patterns );
+            nwipe_plan_add( plan, NWIPE_STEP_VERIFY, pattern_zero, NWIPE_PASS_VERIFY, 0, 0 );
+            break;
 
-    c->wipe_status = 0;
+        case NWIPE_METHOD_FINAL_NONE:
+            break;
+    }
 
-    /* get current time at the end of the wipe  */
-    time( &c->end_time );
+    if( discard && !discarded )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "Not discarding %s, its plan has no blank for a discard to replace.", c->device_name );
+    }
 
-    return NULL;
-} /* nwipe_is5enh */
+    plan->size = plan->step_count * c->wipe_size;
+
+    nwipe_log( NWIPE_LOG_INFO,
+               "Planned %i passes and %i verifications, %llu bytes, for %s.",
+               plan->step_count - plan->verify_count,
+               plan->verify_count,
+               plan->size,
+               c->device_name );
 
-void* nwipe_random( void* ptr )
+    return plan;
+
+} /* nwipe_plan_create */
+
+void nwipe_plan_free( nwipe_plan_t* plan )
+{
+    if( plan == NULL )
+    {
+        return;
+    }
+
+    free( plan->steps );
+    free( plan->bytes );
+    free( plan );
+
+} /* nwipe_plan_free */
+
+void* nwipe_wipe( void* ptr )
 {
     /**
-     * Fill the device with a stream from the PRNG.
+     * Runs the selected method on a device.
      *
      */
 
     nwipe_context_t* c;
     c = (nwipe_context_t*) ptr;
 
+    /* The compiled method. */
+    nwipe_plan_t* plan;
+
     /* get current time at the start of the wipe  */
     time( &c->start_time );
 
     /* set wipe in progress flag for GUI */
     c->wipe_status = 1;
 
-    /* Define the random method. */
-    nwipe_pattern_t patterns[] = {{-1, ""}, {0, NULL}};
+    nwipe_trace_name( "wipe %s", c->device_name );
+
+    /* Account the CPU time of this thread, also when it is cancelled. */
+    nwipe_cpu_start( &c->cpu_meter, c );
+    pthread_cleanup_push( nwipe_cpu_cleanup, &c->cpu_meter );
+
+    /* Take the i/o priority of the device, and let the status screen change it. */
+    nwipe_ioprio_join( c );
+    pthread_cleanup_push( nwipe_ioprio_leave, c );
+
+    /* Zoned devices have to be written zone by zone, and the passes may only cover some ranges. */
+    if( nwipe_zone_probe( c ) < 0 || nwipe_extents_create( c ) != 0 )
+    {
+        plan = NULL;
+    }
+    else
+    {
+        plan = nwipe_plan_create( c, nwipe_options.method );
+    }
+
+    if( plan == NULL )
+    {
+        c->result = -1;
+    }
+    else
+    {
+        /* Run the method. */
+        c->result = nwipe_runmethod( c, plan );
+        nwipe_plan_free( plan );
+    }
+
+    nwipe_extents_free( c );
+    nwipe_zone_free( c );
+    nwipe_digest_free( c );
 
-    /* Run the method. */
-    c->result = nwipe_runmethod( c, patterns );
+    pthread_cleanup_pop( 1 );
+    pthread_cleanup_pop( 1 );
 
     /* Finished. Set the wipe_status flag so that the GUI knows */
     c->wipe_status = 0;
@@ -680,12 +987,74 @@ void* nwipe_random( void* ptr )
     time( &c->end_time );
 
     return NULL;
-} /* nwipe_random */
 
-int nwipe_runmethod( nwipe_context_t* c, nwipe_pattern_t* patterns )
+} /* nwipe_wipe */
+
+static int nwipe_runstep( nwipe_context_t* c, nwipe_plan_step_t* step )
+{
+    /**
+     * Runs the pass or verification of a step. It is kept out of nwipe_runmethod() so that
+     * the cleanup handler does not clobber the locals of the loop.
+     */
+
+    /* The result holder. */
+    int r;
+
+    /* Hash the data of the step for the summary, a discard has none. */
+    if( step->op != NWIPE_STEP_DISCARD )
+    {
+        nwipe_merkle_begin( c );
+    }
+
+    /* Stop the hashing thread if this thread is cancelled during the step. */
+    pthread_cleanup_push( nwipe_merkle_abort, c );
+
+    if( step->op == NWIPE_STEP_DISCARD )
+    {
+        /* Discard the device. */
+        r = nwipe_discard_pass( c );
+    }
+    else if( step->op == NWIPE_STEP_WRITE && step->pattern.length > 0 && step->skip )
+    {
+        /* Write a static pass where the device does not already hold it. */
+        r = nwipe_static_rewrite( c, &step->pattern );
+    }
+    else if( step->op == NWIPE_STEP_WRITE && step->pattern.length > 0 )
+    {
+        /* Write a static pass. */
+        r = nwipe_static_pass( c, &step->pattern );
+    }
+    else if( step->op == NWIPE_STEP_WRITE )
+    {
+        /* Write the random pass, nwipe_runmethod() has seeded the PRNG. */
+        r = nwipe_random_pass( c );
+    }
+    else if( step->pattern.length > 0 && step->skip )
+    {
+        /* Verify a discard, writing the chunks that do not hold the pattern. */
+        r = nwipe_static_repair( c, &step->pattern );
+    }
+    else if( step->pattern.length > 0 )
+    {
+        /* Verify a static pass. */
+        r = nwipe_static_verify( c, &step->pattern );
+    }
+    else
+    {
+        /* Verify a random pass, the PRNG is still seeded from the write. */
+        r = nwipe_random_verify( c );
+    }
+
+    pthread_cleanup_pop( 0 );
+
+    return r;
+
+} /* nwipe_runstep */
+
+int nwipe_runmethod( nwipe_context_t* c, nwipe_plan_t* plan )
 {
     /**
-     * Writes patterns to the device.
+     * Runs the steps of a plan on the device.
      *
      */
 
@@ -693,15 +1062,31 @@ int nwipe_runmethod( nwipe_context_t* c, nwipe_pattern_t* patterns )
     int r;
 
     /* An index variable. */
-    int i = 0;
+    int i;
+
+    /* The current step and the one after it. */
+    nwipe_plan_step_t* step;
+    nwipe_plan_step_t* next;
+
+    /* The start and end time of a step. */
+    struct timespec step_start;
+    struct timespec step_end;
+
+    /* The duration of a step in seconds. */
+    double seconds;
+
+    /* The sync time and the errors of the device before a step. */
+    double sync_time;
+    u64 errors;
 
-    /* Variable to track if it is the last pass */
-    int lastpass = 0;
+    /* The record of a finished step. */
+    nwipe_pass_timing_t* timing;
 
-    i = 0;
+    /* A verification read rate in a readable format. */
+    char verify_rate[13];
 
-    /* The zero-fill pattern for the final pass of most methods. */
-    nwipe_pattern_t pattern_zero = {1, "\x00"};
+    /* The digest of a step. */
+    char root[NWIPE_MERKLE_HEX];
 
     /* Create the PRNG state buffer. */
     c->prng_seed.length = NWIPE_KNOB_PRNG_STATE_LENGTH;
@@ -715,360 +1100,302 @@ int nwipe_runmethod( nwipe_context_t* c, nwipe_pattern_t* patterns )
         return -1;
     }
 
-    /* Count the number of patterns in the array. */
-    while( patterns[i].length )
-    {
-        i += 1;
-    }
-
     /* Tell the parent the number of device passes that will be run in one round. */
-    c->pass_count = i;
+    c->pass_count = plan->pass_count;
 
-    /* Set the number of bytes that will be written across all passes in one round. */
-    c->pass_size = c->pass_count * c->device_size;
+    /* Set the number of bytes that will be read or written in one round. */
+    c->pass_size = 0;
 
-    if( nwipe_options.verify == NWIPE_VERIFY_ALL )
+    for( i = 0; i < plan->step_count && plan->steps[i].round == 1; i++ )
     {
-        /* We must read back all passes, so double the byte count. */
-        c->pass_size *= 2;
+        c->pass_size += c->wipe_size;
     }
 
     /* Tell the parent the number of rounds that will be run. */
-    c->round_count = nwipe_options.rounds;
-
-    /* Set the initial number of bytes that will be written across all rounds. */
-    c->round_size = c->pass_size;
-
-    /* For the selected method, calculate the correct round_size value (for correct percentage calculation) */
-    calculate_round_size( c );
-
-    c->result = c->round_size;
+    c->round_count = plan->round_count;
 
-    /* If only verifing then the round size is the device size */
-    if( nwipe_options.method == &nwipe_verify )
-    {
-        c->round_size = c->device_size;
-    }
+    /* The plan knows exactly how many bytes will be read and written, which drives the percentage and ETA. */
+    c->round_size = plan->size;
 
-    /* Initialize the working round counter. */
+    /* Initialize the working round and pass counters. */
     c->round_working = 0;
+    c->pass_working = 0;
+
+    /* Each step is timed for the summary, which simply leaves the table out without memory for it. */
+    c->timing_count = 0;
+    c->timings = calloc( plan->step_count, sizeof( nwipe_pass_timing_t ) );
 
-    nwipe_log(
-        NWIPE_LOG_NOTICE, "Invoking method '%s' on %s", nwipe_method_label( nwipe_options.method ), c->device_name );
+    nwipe_log( NWIPE_LOG_NOTICE, "Invoking method '%s' on %s", nwipe_method_label( plan->method ), c->device_name );
 
-    while( c->round_working < c->round_count )
+    for( i = 0; i < plan->step_count; i++ )
     {
-        /* Increment the round counter. */
-        c->round_working += 1;
+        step = &plan->steps[i];
+        next = ( i + 1 < plan->step_count ) ? &plan->steps[i + 1] : NULL;
 
-        nwipe_log(
-            NWIPE_LOG_NOTICE, "Starting round %i of %i on %s", c->round_working, c->round_count, c->device_name );
+        if( step->round > 0 && step->round != c->round_working )
+        {
+            c->round_working = step->round;
 
-        /* Initialize the working pass counter. */
-        c->pass_working = 0;
+            nwipe_log(
+                NWIPE_LOG_NOTICE, "Starting round %i of %i on %s", c->round_working, c->round_count, c->device_name );
+            NWIPE_PROBE3( round__start, c->device_name, c->round_working, c->round_count );
+        }
 
-        for( i = 0; i < c->pass_count; i++ )
+        if( step->round > 0 )
         {
-            /* Increment the working pass. */
-            c->pass_working += 1;
+            c->pass_working = step->pass;
 
-            /* Check if this is the last pass. */
-            if( nwipe_options.verify == NWIPE_VERIFY_LAST && nwipe_options.method != &nwipe_ops2 )
+            if( step->op == NWIPE_STEP_DISCARD )
             {
-                if( nwipe_options.noblank == 1 && c->round_working == c->round_count
-                    && c->pass_working == c->pass_count )
-                {
-                    lastpass = 1;
-                }
+                nwipe_log( NWIPE_LOG_NOTICE,
+                           "Discarding pass %i/%i, round %i/%i, on %s",
+                           c->pass_working,
+                           c->pass_count,
+                           c->round_working,
+                           c->round_count,
+                           c->device_name );
             }
-
-            nwipe_log( NWIPE_LOG_NOTICE,
-                       "Starting pass %i/%i, round %i/%i, on %s",
-                       c->pass_working,
-                       c->pass_count,
-                       c->round_working,
-                       c->round_count,
-                       c->device_name );
-
-            if( patterns[i].length == 0 )
+            else if( step->op == NWIPE_STEP_WRITE )
             {
-                /* Caught insanity. */
-                nwipe_log( NWIPE_LOG_SANITY, "nwipe_runmethod: A non-terminating pattern element has zero length." );
-                return -1;
+                nwipe_log( NWIPE_LOG_NOTICE,
+                           "Starting pass %i/%i, round %i/%i, on %s",
+                           c->pass_working,
+                           c->pass_count,
+                           c->round_working,
+                           c->round_count,
+                           c->device_name );
             }
-
-            if( patterns[i].length > 0 )
+            else
             {
-
-                /* Write a static pass. */
-                c->pass_type = NWIPE_PASS_WRITE;
-                r = nwipe_static_pass( c, &patterns[i] );
-                c->pass_type = NWIPE_PASS_NONE;
-
-                /* Log number of bytes written to disk */
-                nwipe_log( NWIPE_LOG_NOTICE, "%llu bytes written to %s", c->pass_done, c->device_name );
-
-                /* Check for a fatal error. */
-                if( r < 0 )
-                {
-                    return r;
-                }
-
-                if( nwipe_options.verify == NWIPE_VERIFY_ALL || lastpass == 1 )
-                {
-
-                    nwipe_log( NWIPE_LOG_NOTICE,
-                               "Verifying pass %i of %i, round %i of %i, on %s",
-                               c->pass_working,
-                               c->pass_count,
-                               c->round_working,
-                               c->round_count,
-                               c->device_name );
-
-                    /* Verify this pass. */
-                    c->pass_type = NWIPE_PASS_VERIFY;
-                    r = nwipe_static_verify( c, &patterns[i] );
-                    c->pass_type = NWIPE_PASS_NONE;
-
-                    /* Check for a fatal error. */
-                    if( r < 0 )
-                    {
-                        return r;
-                    }
-
-                    nwipe_log( NWIPE_LOG_NOTICE,
-                               "Verified pass %i of %i, round %i of %i, on '%s'.",
-                               c->pass_working,
-                               c->pass_count,
-                               c->round_working,
-                               c->round_count,
-                               c->device_name );
-                }
-
-            } /* static pass */
-
+                nwipe_log( NWIPE_LOG_NOTICE,
+                           "Verifying pass %i of %i, round %i of %i, on %s",
+                           c->pass_working,
+                           c->pass_count,
+                           c->round_working,
+                           c->round_count,
+                           c->device_name );
+            }
+        }
+        else if( step->pass_type == NWIPE_PASS_FINAL_BLANK )
+        {
+            if( step->op == NWIPE_STEP_DISCARD )
+            {
+                nwipe_log( NWIPE_LOG_NOTICE, "Discarding device %s", c->device_name );
+            }
+            else if( step->op == NWIPE_STEP_WRITE )
+            {
+                nwipe_log( NWIPE_LOG_NOTICE, "Blanking device %s", c->device_name );
+            }
             else
             {
-                c->pass_type = NWIPE_PASS_WRITE;
-
-                /* Seed the PRNG. */
-                r = read( c->entropy_fd, c->prng_seed.s, c->prng_seed.length );
-
-                /* Check the result. */
-                if( r < 0 )
-                {
-                    c->pass_type = NWIPE_PASS_NONE;
-                    nwipe_perror( errno, __FUNCTION__, "read" );
-                    nwipe_log( NWIPE_LOG_FATAL, "Unable to seed the PRNG." );
-                    return -1;
-                }
-
-                /* Check for a partial read. */
-                if( r != c->prng_seed.length )
-                {
-                    /* TODO: Handle partial reads. */
-                    nwipe_log( NWIPE_LOG_FATAL, "Insufficient entropy is available." );
-                    return -1;
-                }
-
-                /* Write the random pass. */
-                r = nwipe_random_pass( c );
-                c->pass_type = NWIPE_PASS_NONE;
+                nwipe_log( NWIPE_LOG_NOTICE, "Verifying that %s is empty.", c->device_name );
+            }
+        }
+        else if( step->pass_type == NWIPE_PASS_FINAL_OPS2 )
+        {
+            if( step->op == NWIPE_STEP_WRITE )
+            {
+                nwipe_log( NWIPE_LOG_NOTICE, "Writing final random pattern to '%s'.", c->device_name );
+            }
+            else
+            {
+                nwipe_log( NWIPE_LOG_NOTICE, "Verifying the final random pattern on %s.", c->device_name );
+            }
+        }
+        else
+        {
+            nwipe_log( NWIPE_LOG_NOTICE, "Verifying that %s is empty", c->device_name );
+        }
 
-                /* Log number of bytes written to disk */
-                nwipe_log( NWIPE_LOG_NOTICE, "%llu bytes written to %s", c->pass_done, c->device_name );
+        /* Tell the parent what kind of pass is running. */
+        c->pass_type = step->pass_type;
 
-                /* Check for a fatal error. */
-                if( r < 0 )
-                {
-                    return r;
-                }
+        /* Every step is timed, verifications also on their own, they measure the read rate of the media. */
+        sync_time = c->sync_time;
+        errors = ( step->op == NWIPE_STEP_VERIFY ) ? c->verify_errors : c->pass_errors;
+        clock_gettime( CLOCK_MONOTONIC, &step_start );
 
-                /* Make sure IS5 enhanced always verifies its PRNG pass regardless */
-                /* of the current combination of the --noblank (which influences   */
-                /* the lastpass variable) and --verify options.                    */
-                if( nwipe_options.verify == NWIPE_VERIFY_ALL || lastpass == 1 || nwipe_options.method == &nwipe_is5enh )
-                {
-                    nwipe_log( NWIPE_LOG_NOTICE,
-                               "Verifying pass %i of %i, round %i of %i, on %s",
-                               c->pass_working,
-                               c->pass_count,
-                               c->round_working,
-                               c->round_count,
-                               c->device_name );
+        NWIPE_TRACE_BEGIN( nwipe_step_names[step->op] );
+        NWIPE_PROBE3( pass__start, c->device_name, step->pass, (int) step->op );
 
-                    /* Verify this pass. */
-                    c->pass_type = NWIPE_PASS_VERIFY;
-                    r = nwipe_random_verify( c );
-                    c->pass_type = NWIPE_PASS_NONE;
+        if( step->op == NWIPE_STEP_WRITE && step->pattern.length <= 0 )
+        {
+            /* Seed the PRNG. */
+            r = read( c->entropy_fd, c->prng_seed.s, c->prng_seed.length );
 
-                    /* Check for a fatal error. */
-                    if( r < 0 )
-                    {
-                        return r;
-                    }
+            /* Check the result. */
+            if( r < 0 )
+            {
+                c->pass_type = NWIPE_PASS_NONE;
+                nwipe_perror( errno, __FUNCTION__, "read" );
+                nwipe_log( NWIPE_LOG_FATAL, "Unable to seed the PRNG." );
+                return -1;
+            }
 
-                    nwipe_log( NWIPE_LOG_NOTICE,
-                               "Verified pass %i of %i, round %i of %i, on '%s'.",
-                               c->pass_working,
-                               c->pass_count,
-                               c->round_working,
-                               c->round_count,
-                               c->device_name );
-                }
+            /* Check for a partial read. */
+            if( r != c->prng_seed.length )
+            {
+                /* TODO: Handle partial reads. */
+                c->pass_type = NWIPE_PASS_NONE;
+                nwipe_log( NWIPE_LOG_FATAL, "Insufficient entropy is available." );
+                return -1;
+            }
+        }
 
-            } /* random pass */
+        /* Run the step, hashing its data for the summary. */
+        r = nwipe_runstep( c, step );
 
-            nwipe_log( NWIPE_LOG_NOTICE,
-                       "Finished pass %i/%i, round %i/%i, on %s",
-                       c->pass_working,
-                       c->pass_count,
-                       c->round_working,
-                       c->round_count,
-                       c->device_name );
+        clock_gettime( CLOCK_MONOTONIC, &step_end );
+        seconds = ( step_end.tv_sec - step_start.tv_sec ) + ( step_end.tv_nsec - step_start.tv_nsec ) / 1e9;
 
-        } /* for passes */
+        nwipe_merkle_end( c, root );
 
-        if( c->round_working < c->round_count )
+        if( root[0] != 0 && r >= 0 )
         {
-            nwipe_log(
-                NWIPE_LOG_NOTICE, "Finished round %i of %i on %s", c->round_working, c->round_count, c->device_name );
+            nwipe_log( NWIPE_LOG_NOTICE, "Digest of the %s on %s: %s", nwipe_step_names[step->op], c->device_name, root );
         }
-        else
+
+        if( c->timings != NULL )
         {
-            nwipe_log( NWIPE_LOG_NOTICE,
-                       "Finished final round %i of %i on %s",
-                       c->round_working,
-                       c->round_count,
-                       c->device_name );
+            timing = &c->timings[c->timing_count++];
+            timing->op = step->op;
+            timing->pass_type = step->pass_type;
+            timing->round = step->round;
+            timing->pass = step->pass;
+            timing->bytes = c->pass_done;
+            timing->seconds = seconds;
+            timing->sync_seconds = c->sync_time - sync_time;
+            timing->errors = ( ( step->op == NWIPE_STEP_VERIFY ) ? c->verify_errors : c->pass_errors ) - errors;
+            timing->result = r;
+            strcpy( timing->root, root );
         }
 
-    } /* while rounds */
-
-    if( nwipe_options.method == &nwipe_ops2 )
-    {
-        /* NOTE: The OPS-II method specifically requires that a random pattern be left on the device. */
-
-        /* Tell the parent that we are running the final pass. */
-        c->pass_type = NWIPE_PASS_FINAL_OPS2;
-
-        /* Seed the PRNG. */
-        r = read( c->entropy_fd, c->prng_seed.s, c->prng_seed.length );
+        /* A pass that failed may have left its batch open. */
+        NWIPE_TRACE_BATCH_END();
+        NWIPE_TRACE_END( nwipe_step_names[step->op] );
+        NWIPE_PROBE4( pass__end, c->device_name, step->pass, (int) step->op, r );
 
-        /* Check the result. */
-        if( r < 0 )
+        /* Steps that follow the last round keep their type until the end. */
+        if( step->round > 0 )
         {
-            nwipe_perror( errno, __FUNCTION__, "read" );
-            nwipe_log( NWIPE_LOG_FATAL, "Unable to seed the PRNG." );
-            return -1;
+            c->pass_type = NWIPE_PASS_NONE;
         }
 
-        /* Check for a partial read. */
-        if( r != c->prng_seed.length )
+        if( step->op == NWIPE_STEP_WRITE && step->round > 0 )
         {
-            /* TODO: Handle partial reads. */
-            nwipe_log( NWIPE_LOG_FATAL, "Insufficient entropy is available." );
-            return -1;
+            /* Log number of bytes written to disk */
+            nwipe_log( NWIPE_LOG_NOTICE, "%llu bytes written to %s", c->pass_done, c->device_name );
         }
 
-        nwipe_log( NWIPE_LOG_NOTICE, "Writing final random pattern to '%s'.", c->device_name );
-
-        /* The final ops2 pass. */
-        r = nwipe_random_pass( c );
-
         /* Check for a fatal error. */
         if( r < 0 )
         {
             return r;
         }
 
-        if( nwipe_options.verify == NWIPE_VERIFY_LAST || nwipe_options.verify == NWIPE_VERIFY_ALL )
+        if( step->op == NWIPE_STEP_VERIFY )
         {
-            nwipe_log( NWIPE_LOG_NOTICE, "Verifying the final random pattern on %s is empty.", c->device_name );
+            c->verify_done += c->pass_done;
+            c->verify_time += seconds;
+            c->verify_throughput = ( c->verify_time > 0 ) ? c->verify_done / c->verify_time : 0;
 
-            /* Verify the final zero pass. */
-            r = nwipe_random_verify( c );
+            Determine_C_B_nomenclature(
+                ( seconds > 0 ) ? c->pass_done / seconds : 0, verify_rate, sizeof( verify_rate ) );
 
-            /* Check for a fatal error. */
-            if( r < 0 )
-            {
-                return r;
-            }
-
-            nwipe_log( NWIPE_LOG_NOTICE, "Verified the final random pattern on '%s' is empty.", c->device_name );
+            nwipe_log(
+                NWIPE_LOG_INFO, "Verification read %llu bytes of %s at %s/s.", c->pass_done, c->device_name, verify_rate );
         }
 
-        nwipe_log( NWIPE_LOG_NOTICE, "Wrote final random pattern to '%s'.", c->device_name );
-
-    } /* final ops2 */
+        if( step->round > 0 )
+        {
+            if( step->op == NWIPE_STEP_VERIFY )
+            {
+                nwipe_log( NWIPE_LOG_NOTICE,
+                           "Verified pass %i of %i, round %i of %i, on '%s'.",
+                           c->pass_working,
+                           c->pass_count,
+                           c->round_working,
+                           c->round_count,
+                           c->device_name );
+            }
 
-    else if( nwipe_options.method == &nwipe_verify )
-    {
-        nwipe_log( NWIPE_LOG_NOTICE, "Verifying that %s is empty", c->device_name );
+            if( next == NULL || next->round != step->round || next->pass != step->pass )
+            {
+                nwipe_log( NWIPE_LOG_NOTICE,
+                           "Finished pass %i/%i, round %i/%i, on %s",
+                           c->pass_working,
+                           c->pass_count,
+                           c->round_working,
+                           c->round_count,
+                           c->device_name );
+            }
 
-        /* Verify the final zero pass. */
-        c->pass_type = NWIPE_PASS_VERIFY;
-        r = nwipe_static_verify( c, &pattern_zero );
-        c->pass_type = NWIPE_PASS_NONE;
+            if( next == NULL || next->round != step->round )
+            {
+                NWIPE_PROBE3( round__end, c->device_name, c->round_working, c->round_count );
 
-        /* Check for a fatal error. */
-        if( r < 0 )
-        {
-            return r;
-        }
-        if( c->verify_errors == 0 )
-        {
-            nwipe_log( NWIPE_LOG_NOTICE, "[SUCCESS] Verified that %s is empty.", c->device_name );
+                if( c->round_working < c->round_count )
+                {
+                    nwipe_log( NWIPE_LOG_NOTICE,
+                               "Finished round %i of %i on %s",
+                               c->round_working,
+                               c->round_count,
+                               c->device_name );
+                }
+                else
+                {
+                    nwipe_log( NWIPE_LOG_NOTICE,
+                               "Finished final round %i of %i on %s",
+                               c->round_working,
+                               c->round_count,
+                               c->device_name );
+                }
+            }
         }
-        else
+        else if( step->pass_type == NWIPE_PASS_FINAL_BLANK )
         {
-            nwipe_log( NWIPE_LOG_ERROR, "[FAILURE] %s IS NOT empty.", c->device_name );
-        }
-
-    } /* verify */
-
-    else if( nwipe_options.noblank == 0 )
-    {
-        /* Tell the user that we are on the final pass. */
-        c->pass_type = NWIPE_PASS_FINAL_BLANK;
-
-        nwipe_log( NWIPE_LOG_NOTICE, "Blanking device %s", c->device_name );
-
-        /* The final zero pass. */
-        r = nwipe_static_pass( c, &pattern_zero );
+            if( step->op == NWIPE_STEP_VERIFY )
+            {
+                if( c->verify_errors == 0 )
+                {
+                    nwipe_log( NWIPE_LOG_NOTICE, "[SUCCESS] Verified that %s is empty.", c->device_name );
+                }
+                else
+                {
+                    nwipe_log( NWIPE_LOG_NOTICE, "[FAILURE] %s Verification errors, not empty", c->device_name );
+                }
+            }
 
-        /* Check for a fatal error. */
-        if( r < 0 )
-        {
-            return r;
+            if( next == NULL )
+            {
+                nwipe_log( NWIPE_LOG_NOTICE, "[SUCCESS] Blanked device %s", c->device_name );
+            }
         }
-
-        if( nwipe_options.verify == NWIPE_VERIFY_LAST || nwipe_options.verify == NWIPE_VERIFY_ALL )
+        else if( step->pass_type == NWIPE_PASS_FINAL_OPS2 )
         {
-            nwipe_log( NWIPE_LOG_NOTICE, "Verifying that %s is empty.", c->device_name );
-
-            /* Verify the final zero pass. */
-            r = nwipe_static_verify( c, &pattern_zero );
-
-            /* Check for a fatal error. */
-            if( r < 0 )
+            if( step->op == NWIPE_STEP_VERIFY )
             {
-                return r;
+                nwipe_log( NWIPE_LOG_NOTICE, "Verified the final random pattern on '%s'.", c->device_name );
             }
 
+            if( next == NULL )
+            {
+                nwipe_log( NWIPE_LOG_NOTICE, "Wrote final random pattern to '%s'.", c->device_name );
+            }
+        }
+        else
+        {
             if( c->verify_errors == 0 )
             {
                 nwipe_log( NWIPE_LOG_NOTICE, "[SUCCESS] Verified that %s is empty.", c->device_name );
             }
             else
             {
-                nwipe_log( NWIPE_LOG_NOTICE, "[FAILURE] %s Verification errors, not empty", c->device_name );
+                nwipe_log( NWIPE_LOG_ERROR, "[FAILURE] %s IS NOT empty.", c->device_name );
             }
         }
 
-        nwipe_log( NWIPE_LOG_NOTICE, "[SUCCESS] Blanked device %s", c->device_name );
-
-    } /* final blank */
+    } /* for steps */
 
     /* Release the state buffer. */
     c->prng_seed.length = 0;
@@ -1102,185 +1429,4 @@ int nwipe_runmethod( nwipe_context_t* c, nwipe_pattern_t* patterns )
 
 } /* nwipe_runmethod */
 
-void calculate_round_size( nwipe_context_t* c )
-{
-    /* This is where the round size is adjusted. round_size is used in the running percentage completion
-     * calculation. round size is calculated based on pass_size, pass_count, number of rounds, blanking
-     * on/off and verification on/off
-     *
-     * To hopefully make this adjustment more understandable, I have presented each calculation
-     * under each method. This should make it easier to add a new method here without breaking the
-     * calculations for other methods.
-     */
-
-    /* Don't change the order of these values as the case statements use their index in the array */
-    void* array_methods[] = {&nwipe_zero,
-                             &nwipe_ops2,
-                             &nwipe_dodshort,
-                             &nwipe_dod522022m,
-                             &nwipe_gutmann,
-                             &nwipe_random,
-                             &nwipe_is5enh,
-                             NULL};
-    int i;
-
-    /* This while loop allows us to effectively create a const so we can use a case statement rather than if statements.
-     * This is probably more readable as more methods may get added in the future. The code could be condensed as some
-     * methods have identical adjustments, however as there are only a few methods I felt it was easier to understand as
-     * it is, however this could be changed if necessary.
-     */
-
-    int selected_method;
-    i = 0;
-    while( array_methods[i] != NULL )
-    {
-        if( nwipe_options.method == array_methods[i] )
-        {
-            selected_method = i;
-        }
-        i++;
-    }
-
-    /* Multiple the round_size by the number of rounds (times) the user wants to wipe the drive with this method.
-     */
-    c->round_size *= c->round_count;
-
-    /* For each method create the correct round_size value */
-    switch( selected_method )
-    {
-        case 0:
-            /* NWIPE_ZERO
-             * ---------- */
-
-            if( nwipe_options.verify == NWIPE_VERIFY_ALL )
-            {
-                c->round_size += c->device_size;
-            }
-            if( nwipe_options.verify == NWIPE_VERIFY_LAST )
-            {
-                c->round_size += c->device_size;
-            }
-            if( nwipe_options.noblank == 0 )
-            {
-                c->round_size += c->device_size;
-            }
-            break;
-
-        case 1:
-            /* NWIPE_OPS2
-             * ---------- */
-
-            /* Required for the 9th and final random pass */
-            c->round_size += c->device_size;
-
-            if( nwipe_options.verify == NWIPE_VERIFY_LAST )
-            {
-                c->round_size += c->device_size;
-            }
-            if( nwipe_options.verify == NWIPE_VERIFY_ALL )
-            {
-                c->round_size += c->device_size;
-            }
-            break;
-
-        case 2:
-            /* DoD Short
-             * --------- */
-
-            if( nwipe_options.verify == NWIPE_VERIFY_LAST )
-            {
-                c->round_size += c->device_size;
-            }
-            if( nwipe_options.verify == NWIPE_VERIFY_ALL )
-            {
-                c->round_size += c->device_size;
-            }
-            if( nwipe_options.noblank == 0 )
-            {
-                c->round_size += c->device_size;
-            }
-            break;
-
-        case 3:
-            /* DOD 522022m
-             * ----------- */
-
-            if( nwipe_options.verify == NWIPE_VERIFY_LAST )
-            {
-                c->round_size += c->device_size;
-            }
-            if( nwipe_options.verify == NWIPE_VERIFY_ALL )
-            {
-                c->round_size += c->device_size;
-            }
-            if( nwipe_options.noblank == 0 )
-            {
-                c->round_size += c->device_size;
-            }
-            break;
-
-        case 4:
-            /* GutMann
-             * ------- */
-
-            if( nwipe_options.verify == NWIPE_VERIFY_LAST )
-            {
-                c->round_size += c->device_size;
-            }
-            if( nwipe_options.verify == NWIPE_VERIFY_ALL )
-            {
-                c->round_size += c->device_size;
-            }
-            if( nwipe_options.noblank == 0 )
-            {
-                c->round_size += c->device_size;
-            }
-            break;
-
-        case 5:
-            /* PRNG (random)
-             * ------------- */
-
-            if( nwipe_options.verify == NWIPE_VERIFY_LAST )
-            {
-                c->round_size += c->device_size;
-            }
-            if( nwipe_options.verify == NWIPE_VERIFY_ALL )
-            {
-                c->round_size += c->device_size;
-            }
-            if( nwipe_options.noblank == 0 )
-            {
-                c->round_size += c->device_size;
-            }
-            break;
-
-        case 6:
-            /* NWIPE_IS5ENH
-             * ------------ */
-
-            /* This method ALWAYS verifies the 3rd pass so increase by device size,
-             * and does not need to be increased by device size for VERIFY_ALL*/
-
-            if( nwipe_options.verify == NWIPE_VERIFY_LAST )
-            {
-                c->round_size += c->device_size;
-            }
-            if( nwipe_options.verify == NWIPE_VERIFY_ALL )
-            {
-                c->round_size += c->device_size;
-            }
-            else
-            {
-                /* Adjusts for verify on every third pass multiplied by number of rounds */
-                c->round_size += ( c->device_size * c->round_count );
-            }
-            if( nwipe_options.noblank == 0 )
-            {
-                c->round_size += c->device_size;
-            }
-            break;
-    }
-}
-
 /* eof */
@@ -32,27 +32,93 @@ typedef enum nwipe_verify_t_ {
     NWIPE_VERIFY_ALL,  // Check all passes.
 } nwipe_verify_t;
 
-/* The typedef of the function that will do the wipe. */
-typedef int ( *nwipe_method_t )( void* ptr );
-
 typedef struct
 {
     int length;  // Length of the pattern in bytes, -1 means random.
     char* s;  // The actual bytes of the pattern.
 } nwipe_pattern_t;
 
-const char* nwipe_method_label( void* method );
-int nwipe_runmethod( NWIPE_METHOD_SIGNATURE, nwipe_pattern_t* patterns );
+typedef enum nwipe_method_pass_kind_t_ {
+    NWIPE_METHOD_PASS_STATIC = 0,  // A fixed pattern.
+    NWIPE_METHOD_PASS_RANDOM,  // A stream from the PRNG.
+    NWIPE_METHOD_PASS_BYTE,  // A random character that is chosen afresh for each round.
+    NWIPE_METHOD_PASS_COMPLEMENT  // The bitwise complement of a random character.
+} nwipe_method_pass_kind_t;
+
+typedef enum nwipe_method_final_t_ {
+    NWIPE_METHOD_FINAL_BLANK = 0,  // Blank the device afterwards unless --noblank was given.
+    NWIPE_METHOD_FINAL_RANDOM,  // Leave a random stream on the device.
+    NWIPE_METHOD_FINAL_VERIFY,  // Only check that the device is blank.
+    NWIPE_METHOD_FINAL_NONE  // Leave the last pass on the device.
+} nwipe_method_final_t;
+
+/* One pass of a method description. */
+typedef struct
+{
+    nwipe_method_pass_kind_t kind;
+    int length;  // The length of a static pattern.
+    const char* s;  // The bytes of a static pattern.
+    int byte;  // The random character used by a byte or complement pass.
+    int verify;  // Always read this pass back, whatever the verify option says.
+} nwipe_method_pass_t;
+
+#define NWIPE_METHOD_NAMES 4  // The number of names that a method can be selected by.
+
+/* A wipe method description, either built in or loaded from a file. */
+typedef struct
+{
+    const char* names[NWIPE_METHOD_NAMES];  // The names accepted by --method.
+    const char* label;  // The name shown to the user.
+    const nwipe_method_pass_t* passes;  // The passes of one round.
+    int pass_count;  // The number of passes in one round.
+    int shuffle;  // Run the passes in a random order.
+    nwipe_method_final_t final;  // What happens after the last round.
+} nwipe_method_t;
+
+typedef enum nwipe_step_op_t_ {
+    NWIPE_STEP_WRITE = 0,  // Write the pattern to the device.
+    NWIPE_STEP_VERIFY,  // Read the pattern back from the device.
+    NWIPE_STEP_DISCARD  // Discard the whole device.
+} nwipe_step_op_t;
+
+/* One device sized operation of a compiled plan. */
+typedef struct
+{
+    nwipe_step_op_t op;
+    nwipe_pattern_t pattern;  // The pattern, a length of -1 means the PRNG stream.
+    nwipe_pass_t pass_type;  // What the step is shown as while it runs.
+    int round;  // The round of the step, zero for the steps that follow the last round.
+    int pass;  // The pass of the step within its round.
+    int skip;  // Only write the blocks that do not already hold the pattern, or for a verification, write them.
+} nwipe_plan_step_t;
+
+/* A method compiled for one device, with everything that will be written and read in order. */
+typedef struct
+{
+    const nwipe_method_t* method;  // The method that the plan was compiled from.
+    nwipe_plan_step_t* steps;  // The steps in the order that they run.
+    int step_count;  // The number of steps.
+    int pass_count;  // The number of passes in each round.
+    int round_count;  // The number of rounds.
+    int verify_count;  // The number of steps that read from the device.
+    u64 size;  // The number of bytes that all steps read or write.
+    char* bytes;  // Storage for the random characters of each round.
+} nwipe_plan_t;
+
+/* The built in methods, in the order that they are offered by the GUI. */
+extern const nwipe_method_t nwipe_methods[];
+extern const int nwipe_method_count;
+
+const char* nwipe_method_label( const nwipe_method_t* method );
+const nwipe_method_t* nwipe_method_lookup( const char* name );
+nwipe_method_t* nwipe_method_load( const char* path );
+
+nwipe_plan_t* nwipe_plan_create( NWIPE_METHOD_SIGNATURE, const nwipe_method_t* method );
+void nwipe_plan_free( nwipe_plan_t* plan );
 
-void* nwipe_dod522022m( void* ptr );
-void* nwipe_dodshort( void* ptr );
-void* nwipe_gutmann( void* ptr );
-void* nwipe_ops2( void* ptr );
-void* nwipe_is5enh( void* ptr );
-void* nwipe_random( void* ptr );
-void* nwipe_zero( void* ptr );
-void* nwipe_verify( void* ptr );
+int nwipe_runmethod( NWIPE_METHOD_SIGNATURE, nwipe_plan_t* plan );
 
-void calculate_round_size( nwipe_context_t* );
+/* The wipe thread, which runs nwipe_options.method on the device. */
+void* nwipe_wipe( void* ptr );
 
 #endif /* METHOD_H_ */
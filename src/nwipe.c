@@ -42,6 +42,12 @@
 #include "device.h"
 #include "logging.h"
 #include "gui.h"
+#include "iostat.h"
+#include "trace.h"
+#include "preflight.h"
+#include "arena.h"
+#include "merkle.h"
+#include "ioprio.h"
 
 #include <sys/ioctl.h> /* FIXME: Twice Included */
 #include <sys/shm.h>
@@ -151,6 +157,20 @@ int main( int argc, char** argv )
 
     nwipe_log( NWIPE_LOG_NOTICE, "Opened entropy source '%s'.", NWIPE_KNOB_ENTROPY );
 
+    /* Start recording the trace before any thread is created, so every thread is in it. */
+    if( nwipe_options.trace[0] != 0 && nwipe_trace_open( nwipe_options.trace ) != 0 )
+    {
+        cleanup();
+        free( c2 );
+        return -1;
+    }
+
+    /* Map the i/o buffers before any wipe thread asks for one. */
+    if( nwipe_options.buffers > 0 )
+    {
+        nwipe_arena_init( nwipe_options.buffers );
+    }
+
     /* Block relevant signals in main thread. Any other threads that are     */
     /*        created after this will also block those signals.              */
     sigset_t sigset;
@@ -171,6 +191,7 @@ int main( int argc, char** argv )
     nwipe_misc_thread_data_t nwipe_misc_thread_data;
     nwipe_thread_data_ptr_t nwipe_thread_data_ptr;
 
+    memset( &nwipe_misc_thread_data, 0, sizeof( nwipe_misc_thread_data ) );
     nwipe_thread_data_ptr.c = c2;
     nwipe_misc_thread_data.nwipe_enumerated = nwipe_enumerated;
     nwipe_misc_thread_data.nwipe_selected = 0;
@@ -230,6 +251,10 @@ int main( int argc, char** argv )
 
     if( nwipe_options.autonuke == 1 )
     {
+        /* Nobody confirms the forecast, it is logged and shown while the wipe runs. */
+        if( nwipe_options.preflight )
+            nwipe_preflight( c1, nwipe_enumerated );
+
         /* Print the options window. */
         if( !nwipe_options.nogui )
             nwipe_gui_options();
@@ -271,6 +296,16 @@ int main( int argc, char** argv )
         }
     }
 
+    /* The limits of --cgroup have to be in place before the first write, a wipe does not run without them. */
+    if( user_abort == 0 && nwipe_cgroup_create( c2, nwipe_selected ) != 0 )
+    {
+        nwipe_log( NWIPE_LOG_FATAL, "Unable to set up the cgroup of --cgroup, nothing is wiped." );
+        if( !nwipe_options.nogui )
+            nwipe_gui_free();
+        cleanup();
+        return -1;
+    }
+
     /* TODO: free c1 and c2 memory. */
     if( user_abort == 0 )
     {
@@ -420,8 +455,16 @@ int main( int argc, char** argv )
                            c2[i]->device_size );
             }
 
+            /* Open the block layer statistics for the status screen. */
+            nwipe_iostat_open( c2[i] );
+
+            /* The threads of the device start at the priority of --ioprio. */
+            c2[i]->io_priority = nwipe_options.ioprio;
+
             /* Fork a child process. */
-            errno = pthread_create( &c2[i]->thread, NULL, nwipe_options.method, (void*) c2[i] );
+            /* With --check the devices are hashed instead of wiped. */
+            errno = pthread_create(
+                &c2[i]->thread, NULL, nwipe_options.check[0] != 0 ? nwipe_merkle_check : nwipe_wipe, (void*) c2[i] );
             if( errno )
             {
                 nwipe_perror( errno, __FUNCTION__, "pthread_create" );
@@ -556,6 +599,7 @@ int main( int argc, char** argv )
 
             /* Close the device file descriptor. */
             close( c2[i]->device_fd );
+            nwipe_iostat_close( c2[i] );
         }
     }
 
@@ -594,6 +638,8 @@ int main( int argc, char** argv )
     /* Generate and send the drive status summary to the log */
     nwipe_log_summary( c2, nwipe_selected );
 
+    nwipe_trace_close();
+
     if( return_status == 0 )
     {
         nwipe_log( NWIPE_LOG_INFO, "Nwipe successfully exited." );
@@ -640,6 +686,8 @@ void* signal_hand( void* ptr )
     c = nwipe_thread_data_ptr->c;
     nwipe_misc_thread_data = nwipe_thread_data_ptr->nwipe_misc_thread_data;
 
+    nwipe_trace_name( "signals" );
+
     while( 1 )
     {
         /* wait for a signal to arrive */
@@ -698,6 +746,17 @@ void* signal_hand( void* ptr )
                                    minutes,
                                    seconds,
                                    status );
+
+                        if( c[i]->device_iostat.utilization >= 0 && c[i]->device_iostat.sampled > 0 )
+                        {
+                            nwipe_log( NWIPE_LOG_INFO,
+                                       "%s: util %.0f%%, queue %i, service %.2f ms, merged %.0f/s",
+                                       c[i]->device_name,
+                                       c[i]->device_iostat.utilization,
+                                       c[i]->device_iostat.inflight,
+                                       c[i]->device_iostat.service_time,
+                                       c[i]->device_iostat.merge_rate );
+                        }
                     }
                     else
                     {
@@ -718,6 +777,12 @@ void* signal_hand( void* ptr )
                     }
                 }
 
+                /* Write the trace so far, for a look at a wipe that seems stuck. */
+                if( nwipe_trace_enabled )
+                {
+                    nwipe_trace_write();
+                }
+
                 break;
 
             case SIGHUP:
@@ -747,6 +812,9 @@ int cleanup()
     extern int log_elements_allocated;
     extern char** log_lines;
 
+    /* Leave the cgroup of --cgroup while the log can still take the errors. */
+    nwipe_cgroup_remove();
+
     /* Print the logs held in memory. */
     for( i = log_elements_displayed; i < log_elements_allocated; i++ )
     {
@@ -105,10 +105,12 @@ typedef unsigned char u8;
 /* #include <linux/fs.h> */
 
 /* Define ioctls that cannot be included. */
+#define BLKFLSBUF _IO( 0x12, 97 )
 #define BLKSSZGET _IO( 0x12, 104 )
 #define BLKBSZGET _IOR( 0x12, 112, size_t )
 #define BLKBSZSET _IOW( 0x12, 113, size_t )
 #define BLKGETSIZE64 _IOR( 0x12, 114, sizeof( u64 ) )
+#define BLKDISCARD _IO( 0x12, 119 )
 
 /* This is required for ioctl FDFLUSH. */
 #include <linux/fd.h>
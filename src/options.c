@@ -20,17 +20,96 @@
  *
  */
 
+#include <limits.h>
 #include "nwipe.h"
 #include "context.h"
 #include "method.h"
 #include "prng.h"
 #include "options.h"
 #include "logging.h"
+#include "ioprio.h"
 #include "version.h"
 
 /* The global options struct. */
 nwipe_options_t nwipe_options;
 
+static int nwipe_options_size( const char* arg, char** end, long long* size )
+{
+    /**
+     * Parses a decimal byte count with an optional K, M, G or T binary suffix. A leading zero
+     * is not octal, so that --range=010G:1G starts at 10GiB.
+     *
+     * Returns zero on success.
+     */
+
+    /* The multiplier of the suffix. */
+    long long unit = 1;
+
+    errno = 0;
+    *size = strtoll( arg, end, 10 );
+
+    if( errno != 0 || *end == arg )
+    {
+        return -1;
+    }
+
+    switch( **end )
+    {
+        case 'T':
+        case 't':
+            unit *= 1024;
+            /* fall through */
+        case 'G':
+        case 'g':
+            unit *= 1024;
+            /* fall through */
+        case 'M':
+        case 'm':
+            unit *= 1024;
+            /* fall through */
+        case 'K':
+        case 'k':
+            unit *= 1024;
+            *end += 1;
+            break;
+    }
+
+    if( *size > LLONG_MAX / unit || *size < LLONG_MIN / unit )
+    {
+        return -1;
+    }
+
+    *size *= unit;
+
+    return 0;
+
+} /* nwipe_options_size */
+
+static int nwipe_options_range( const char* arg, nwipe_range_t* range )
+{
+    /**
+     * Parses a START:LENGTH byte range. A negative start counts back from the end of the device.
+     *
+     * Returns zero on success.
+     */
+
+    /* The end of the parsed text. */
+    char* end;
+
+    if( nwipe_options_size( arg, &end, &range->start ) != 0 || *end != ':' )
+    {
+        return -1;
+    }
+
+    if( nwipe_options_size( end + 1, &end, &range->length ) != 0 || *end != 0 || range->length <= 0 )
+    {
+        return -1;
+    }
+
+    return 0;
+
+} /* nwipe_options_range */
+
 int nwipe_options_parse( int argc, char** argv )
 {
     extern char* optarg;  // The working getopt option argument.
@@ -40,6 +119,8 @@ int nwipe_options_parse( int argc, char** argv )
 
     extern nwipe_prng_t nwipe_twister;
     extern nwipe_prng_t nwipe_isaac;
+    extern nwipe_prng_t nwipe_broadcast;
+    extern nwipe_prng_t nwipe_getrandom;
 
     /* The getopt() result holder. */
     int nwipe_opt;
@@ -52,6 +133,9 @@ int nwipe_options_parse( int argc, char** argv )
     /* Array index variable. */
     int i;
 
+    /* The end of a parsed size. */
+    char* end;
+
     /* The list of acceptable short options. */
     char nwipe_options_short[] = "Vvhl:m:p:r:e:";
 
@@ -84,6 +168,33 @@ int nwipe_options_parse( int argc, char** argv )
         /* Whether to blank the disk after wiping. */
         {"noblank", no_argument, 0, 0},
 
+        /* Whether to read before blanking and skip blocks that are already blank. */
+        {"skipmatching", no_argument, 0, 0},
+
+        /* Whether to blank with discards. */
+        {"discard", no_argument, 0, 0},
+
+        /* Whether to leave the writes in the page cache. */
+        {"cached", no_argument, 0, 0},
+
+        /* The size of the i/o buffer arena. */
+        {"buffers", required_argument, 0, 0},
+
+        /* The i/o priority of the threads of each device. */
+        {"ioprio", required_argument, 0, 0},
+
+        /* Run the wipe in a child of this cgroup v2 directory. */
+        {"cgroup", required_argument, 0, 0},
+
+        /* The rate limit of each device in the cgroup. */
+        {"iomax", required_argument, 0, 0},
+
+        /* The weight of each device in the cgroup. */
+        {"ioweight", required_argument, 0, 0},
+
+        /* Only wipe a byte range of each device, may be repeated. */
+        {"range", required_argument, 0, 0},
+
         /* Whether to ignore all USB devices. */
         {"nousb", no_argument, 0, 0},
 
@@ -93,6 +204,15 @@ int nwipe_options_parse( int argc, char** argv )
         /* Whether to allow signals to interrupt a wipe. */
         {"nosignals", no_argument, 0, 0},
 
+        /* Hash the data of each pass. */
+        {"digest", no_argument, 0, 0},
+
+        /* Check the digest of the devices instead of wiping them. */
+        {"check", required_argument, 0, 0},
+
+        /* Measure the devices and forecast the wipe time before starting. */
+        {"preflight", no_argument, 0, 0},
+
         /* Whether to exit after wiping or wait for a keypress. */
         {"nogui", no_argument, 0, 0},
 
@@ -102,6 +222,12 @@ int nwipe_options_parse( int argc, char** argv )
         /* Verify that wipe patterns are being written to the device. */
         {"verify", required_argument, 0, 0},
 
+        /* Record a trace of the wipe. */
+        {"trace", required_argument, 0, 0},
+
+        /* Write the duration of each pass to a CSV file. */
+        {"timings", required_argument, 0, 0},
+
         /* Display program version. */
         {"verbose", no_argument, 0, 'v'},
 
@@ -114,18 +240,32 @@ int nwipe_options_parse( int argc, char** argv )
     /* Set default options. */
     nwipe_options.autonuke = 0;
     nwipe_options.autopoweroff = 0;
-    nwipe_options.method = &nwipe_dodshort;
+    nwipe_options.buffers = 0;
+    nwipe_options.cached = 0;
+    nwipe_options.ioprio = 0;
+    nwipe_options.iomax = 0;
+    nwipe_options.ioweight = 0;
+    nwipe_options.method = nwipe_method_lookup( "dodshort" );
     nwipe_options.prng = &nwipe_twister;
     nwipe_options.rounds = 1;
     nwipe_options.noblank = 0;
+    nwipe_options.skipmatching = 0;
+    nwipe_options.discard = 0;
+    nwipe_options.range_count = 0;
     nwipe_options.nousb = 0;
     nwipe_options.nowait = 0;
     nwipe_options.nosignals = 0;
+    nwipe_options.preflight = 0;
+    nwipe_options.digest = 0;
     nwipe_options.nogui = 0;
     nwipe_options.sync = 100000;
     nwipe_options.verbose = 0;
     nwipe_options.verify = NWIPE_VERIFY_LAST;
     memset( nwipe_options.logfile, '\0', sizeof( nwipe_options.logfile ) );
+    memset( nwipe_options.trace, '\0', sizeof( nwipe_options.trace ) );
+    memset( nwipe_options.timings, '\0', sizeof( nwipe_options.timings ) );
+    memset( nwipe_options.check, '\0', sizeof( nwipe_options.check ) );
+    memset( nwipe_options.cgroup, '\0', sizeof( nwipe_options.cgroup ) );
 
     /* Initialise each of the strings in the excluded drives array */
     for( i = 0; i < MAX_NUMBER_EXCLUDED_DRIVES; i++ )
@@ -167,6 +307,97 @@ int nwipe_options_parse( int argc, char** argv )
                     break;
                 }
 
+                if( strcmp( nwipe_options_long[i].name, "skipmatching" ) == 0 )
+                {
+                    nwipe_options.skipmatching = 1;
+                    break;
+                }
+
+                if( strcmp( nwipe_options_long[i].name, "discard" ) == 0 )
+                {
+                    nwipe_options.discard = 1;
+                    break;
+                }
+
+                if( strcmp( nwipe_options_long[i].name, "cached" ) == 0 )
+                {
+                    nwipe_options.cached = 1;
+                    break;
+                }
+
+                if( strcmp( nwipe_options_long[i].name, "buffers" ) == 0 )
+                {
+                    if( nwipe_options_size( optarg, &end, &nwipe_options.buffers ) != 0 || *end != 0
+                        || nwipe_options.buffers <= 0 )
+                    {
+                        fprintf( stderr, "Error: Invalid buffer size '%s'.\n", optarg );
+                        exit( EINVAL );
+                    }
+                    break;
+                }
+
+                if( strcmp( nwipe_options_long[i].name, "ioprio" ) == 0 )
+                {
+                    if( nwipe_ioprio_parse( optarg, &nwipe_options.ioprio ) != 0 )
+                    {
+                        fprintf( stderr, "Error: Unknown i/o priority '%s', expected none, idle or be:0-7.\n", optarg );
+                        exit( EINVAL );
+                    }
+                    break;
+                }
+
+                if( strcmp( nwipe_options_long[i].name, "cgroup" ) == 0 )
+                {
+                    /* Leave room for the /nwipe-<pid> child. */
+                    if( strlen( optarg ) >= sizeof( nwipe_options.cgroup ) - 32 )
+                    {
+                        fprintf( stderr, "Error: The cgroup directory name is too long.\n" );
+                        exit( EINVAL );
+                    }
+                    strcpy( nwipe_options.cgroup, optarg );
+                    break;
+                }
+
+                if( strcmp( nwipe_options_long[i].name, "iomax" ) == 0 )
+                {
+                    if( nwipe_options_size( optarg, &end, &nwipe_options.iomax ) != 0 || *end != 0
+                        || nwipe_options.iomax <= 0 )
+                    {
+                        fprintf( stderr, "Error: Invalid i/o rate '%s'.\n", optarg );
+                        exit( EINVAL );
+                    }
+                    break;
+                }
+
+                if( strcmp( nwipe_options_long[i].name, "ioweight" ) == 0 )
+                {
+                    if( sscanf( optarg, " %i", &nwipe_options.ioweight ) != 1 || nwipe_options.ioweight < 1
+                        || nwipe_options.ioweight > 10000 )
+                    {
+                        fprintf( stderr, "Error: The ioweight argument must be from 1 to 10000.\n" );
+                        exit( EINVAL );
+                    }
+                    break;
+                }
+
+                if( strcmp( nwipe_options_long[i].name, "range" ) == 0 )
+                {
+                    if( nwipe_options.range_count >= MAX_NUMBER_RANGES )
+                    {
+                        fprintf( stderr, "Error: No more than %i ranges can be given.\n", MAX_NUMBER_RANGES );
+                        exit( EINVAL );
+                    }
+
+                    if( nwipe_options_range( optarg, &nwipe_options.range[nwipe_options.range_count] ) != 0 )
+                    {
+                        fprintf( stderr, "Error: Invalid range '%s', expected START:LENGTH.\n", optarg );
+                        exit( EINVAL );
+                    }
+
+                    nwipe_options.range_count += 1;
+                    break;
+                }
+
                 if( strcmp( nwipe_options_long[i].name, "nousb" ) == 0 )
                 {
                     nwipe_options.nousb = 1;
@@ -185,6 +416,31 @@ int nwipe_options_parse( int argc, char** argv )
                     break;
                 }
 
+                if( strcmp( nwipe_options_long[i].name, "preflight" ) == 0 )
+                {
+                    nwipe_options.preflight = 1;
+                    break;
+                }
+
+                if( strcmp( nwipe_options_long[i].name, "digest" ) == 0 )
+                {
+                    nwipe_options.digest = 1;
+                    break;
+                }
+
+                if( strcmp( nwipe_options_long[i].name, "check" ) == 0 )
+                {
+                    if( strlen( optarg ) != sizeof( nwipe_options.check ) - 1
+                        || strspn( optarg, "0123456789abcdefABCDEF" ) != strlen( optarg ) )
+                    {
+                        fprintf( stderr, "Error: The digest to check must be 64 hexadecimal digits.\n" );
+                        exit( EINVAL );
+                    }
+
+                    strcpy( nwipe_options.check, optarg );
+                    break;
+                }
+
                 if( strcmp( nwipe_options_long[i].name, "nogui" ) == 0 )
                 {
                     nwipe_options.nogui = 1;
@@ -234,57 +490,49 @@ int nwipe_options_parse( int argc, char** argv )
                     exit( EINVAL );
                 }
 
-                /* getopt_long should raise on invalid option, so we should never get here. */
-                exit( EINVAL );
-
-            case 'm': /* Method option. */
-
-                if( strcmp( optarg, "dod522022m" ) == 0 || strcmp( optarg, "dod" ) == 0 )
+                if( strcmp( nwipe_options_long[i].name, "trace" ) == 0 )
                 {
-                    nwipe_options.method = &nwipe_dod522022m;
+                    if( strlen( optarg ) >= sizeof( nwipe_options.trace ) )
+                    {
+                        fprintf( stderr, "Error: The trace file name is too long.\n" );
+                        exit( EINVAL );
+                    }
+                    strcpy( nwipe_options.trace, optarg );
                     break;
                 }
 
-                if( strcmp( optarg, "dodshort" ) == 0 || strcmp( optarg, "dod3pass" ) == 0 )
+                if( strcmp( nwipe_options_long[i].name, "timings" ) == 0 )
                 {
-                    nwipe_options.method = &nwipe_dodshort;
+                    if( strlen( optarg ) >= sizeof( nwipe_options.timings ) )
+                    {
+                        fprintf( stderr, "Error: The timings file name is too long.\n" );
+                        exit( EINVAL );
+                    }
+                    strcpy( nwipe_options.timings, optarg );
                     break;
                 }
 
-                if( strcmp( optarg, "gutmann" ) == 0 )
-                {
-                    nwipe_options.method = &nwipe_gutmann;
-                    break;
-                }
+                /* getopt_long should raise on invalid option, so we should never get here. */
+                exit( EINVAL );
 
-                if( strcmp( optarg, "ops2" ) == 0 )
-                {
-                    nwipe_options.method = &nwipe_ops2;
-                    break;
-                }
+            case 'm': /* Method option. */
 
-                if( strcmp( optarg, "random" ) == 0 || strcmp( optarg, "prng" ) == 0
-                    || strcmp( optarg, "stream" ) == 0 )
-                {
-                    nwipe_options.method = &nwipe_random;
-                    break;
-                }
+                nwipe_options.method = nwipe_method_lookup( optarg );
 
-                if( strcmp( optarg, "zero" ) == 0 || strcmp( optarg, "quick" ) == 0 )
+                if( nwipe_options.method != NULL )
                 {
-                    nwipe_options.method = &nwipe_zero;
                     break;
                 }
 
-                if( strcmp( optarg, "verify" ) == 0 )
+                /* A name that is not a built in method can be a method description file. */
+                if( access( optarg, F_OK ) == 0 )
                 {
-                    nwipe_options.method = &nwipe_verify;
-                    break;
-                }
+                    nwipe_options.method = nwipe_method_load( optarg );
 
-                if( strcmp( optarg, "is5enh" ) == 0 )
-                {
-                    nwipe_options.method = &nwipe_is5enh;
+                    if( nwipe_options.method == NULL )
+                    {
+                        exit( EINVAL );
+                    }
                     break;
                 }
 
@@ -359,6 +607,18 @@ int nwipe_options_parse( int argc, char** argv )
                     break;
                 }
 
+                if( strcmp( optarg, "broadcast" ) == 0 )
+                {
+                    nwipe_options.prng = &nwipe_broadcast;
+                    break;
+                }
+
+                if( strcmp( optarg, "getrandom" ) == 0 )
+                {
+                    nwipe_options.prng = &nwipe_getrandom;
+                    break;
+                }
+
                 /* Else we do not know this PRNG. */
                 fprintf( stderr, "Error: Unknown prng '%s'.\n", optarg );
                 exit( EINVAL );
@@ -393,6 +653,13 @@ int nwipe_options_parse( int argc, char** argv )
 
     } /* command line options */
 
+    /* The limits are lines of the cgroup of the wipe. */
+    if( ( nwipe_options.iomax > 0 || nwipe_options.ioweight > 0 ) && nwipe_options.cgroup[0] == 0 )
+    {
+        fprintf( stderr, "Error: --iomax and --ioweight need --cgroup.\n" );
+        exit( EINVAL );
+    }
+
     /* Return the number of options that were processed. */
     return optind;
 }
@@ -403,6 +670,12 @@ void nwipe_options_log( void )
      *  Prints a manifest of options to the log.
      */
 
+    /* An index variable. */
+    int i;
+
+    /* The text of the i/o priority. */
+    char name[8];
+
     nwipe_log( NWIPE_LOG_NOTICE, "Program options are set as follows..." );
 
     if( nwipe_options.autonuke )
@@ -428,6 +701,24 @@ void nwipe_options_log( void )
         nwipe_log( NWIPE_LOG_NOTICE, "  do not perform a final blank pass" );
     }
 
+    if( nwipe_options.skipmatching )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "  do not rewrite blocks that are already blank" );
+    }
+
+    if( nwipe_options.discard )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "  blank with discard where the device supports it" );
+    }
+
+    for( i = 0; i < nwipe_options.range_count; i++ )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE,
+                   "  range = %lld:%lld (only wipe this byte range)",
+                   nwipe_options.range[i].start,
+                   nwipe_options.range[i].length );
+    }
+
     if( nwipe_options.nowait )
     {
         nwipe_log( NWIPE_LOG_NOTICE, "  do not wait for a key before exiting" );
@@ -443,11 +734,66 @@ void nwipe_options_log( void )
         nwipe_log( NWIPE_LOG_NOTICE, "  do not show GUI interface" );
     }
 
+    if( nwipe_options.preflight )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "  measure the devices and forecast the wipe time before starting" );
+    }
+
+    if( nwipe_options.cached )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "  leave the writes in the page cache" );
+    }
+
+    if( nwipe_options.ioprio != 0 )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "  ioprio   = %s", nwipe_ioprio_name( nwipe_options.ioprio, name ) );
+    }
+
+    if( nwipe_options.cgroup[0] != 0 )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "  cgroup   = %s", nwipe_options.cgroup );
+    }
+
+    if( nwipe_options.iomax > 0 )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "  iomax    = %lld", nwipe_options.iomax );
+    }
+
+    if( nwipe_options.ioweight > 0 )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "  ioweight = %i", nwipe_options.ioweight );
+    }
+
+    if( nwipe_options.buffers > 0 )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "  buffers  = %lld", nwipe_options.buffers );
+    }
+
+    if( nwipe_options.digest )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "  hash the data of each pass" );
+    }
+
+    if( nwipe_options.check[0] != 0 )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "  check    = %s (check the digest instead of wiping)", nwipe_options.check );
+    }
+
     nwipe_log( NWIPE_LOG_NOTICE, "  banner   = %s", banner );
     nwipe_log( NWIPE_LOG_NOTICE, "  method   = %s", nwipe_method_label( nwipe_options.method ) );
     nwipe_log( NWIPE_LOG_NOTICE, "  rounds   = %i", nwipe_options.rounds );
     nwipe_log( NWIPE_LOG_NOTICE, "  sync     = %i", nwipe_options.sync );
 
+    if( nwipe_options.timings[0] != 0 )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "  timings  = %s", nwipe_options.timings );
+    }
+
+    if( nwipe_options.trace[0] != 0 )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "  trace    = %s", nwipe_options.trace );
+    }
+
     switch( nwipe_options.verify )
     {
         case NWIPE_VERIFY_NONE:
@@ -505,13 +851,55 @@ void display_help()
     puts( "                          ops2                   - RCMP TSSIT OPS-II" );
     puts( "                          random / prng / stream - PRNG Stream" );
     puts( "                          zero / quick           - Overwrite with zeros" );
-    puts( "                          verify                 - Verifies disk is zero filled\n" );
+    puts( "                          verify                 - Verifies disk is zero filled" );
+    puts( "                          is5enh                 - HMG IS5 enhanced" );
+    puts( "                          FILE                   - A method description file\n" );
     puts( "  -l, --logfile=FILE      Filename to log to. Default is STDOUT\n" );
-    puts( "  -p, --prng=METHOD       PRNG option (mersenne|twister|isaac)\n" );
+    puts( "      --timings=FILE      Write the duration, bytes and sync time of each pass" );
+    puts( "                          and verification of each device to FILE as CSV\n" );
+    puts( "      --trace=FILE        Record a trace of the passes, syncs, compares, log" );
+    puts( "                          calls and screen updates, written to FILE on exit" );
+    puts( "                          and on SIGUSR1 in the Chrome trace format\n" );
+    puts( "  -p, --prng=METHOD       PRNG option" );
+    puts( "                          (mersenne|twister|isaac|broadcast|getrandom)" );
+    puts( "                          broadcast shares one random pool between all drives" );
+    puts( "                          and whitens it per drive, which costs far less CPU" );
+    puts( "                          but is not cryptographically strong between drives." );
+    puts( "                          getrandom writes the ChaCha20 stream of the kernel," );
+    puts( "                          which does not replay, so verification checks the" );
+    puts( "                          digests the pass kept of what it wrote\n" );
     puts( "  -r, --rounds=NUM        Number of times to wipe the device using the selected" );
     puts( "                          method (default: 1)\n" );
     puts( "      --noblank           Do not blank disk after wipe" );
     puts( "                          (default is to complete a final blank pass)\n" );
+    puts( "      --skipmatching      Read before the final blank or a zero fill and only" );
+    puts( "                          write the blocks that are not already zero" );
+    puts( "                          (default is to write every block)\n" );
+    puts( "      --discard           Blank, or zero fill, by discarding the device, then" );
+    puts( "                          verify, writing what does not read back as zero" );
+    puts( "                          (default is to write the blank)\n" );
+    puts( "      --range=START:LENGTH" );
+    puts( "                          Only wipe LENGTH bytes from offset START, which" );
+    puts( "                          counts back from the end of the device when negative." );
+    puts( "                          Sizes take K, M, G or T suffixes and the option may" );
+    puts( "                          be repeated (default is to wipe the whole device)\n" );
+    puts( "      --cached            Leave the writes of the passes in the page cache" );
+    puts( "                          (default is to write them back and drop them every" );
+    puts( "                          8MiB, keeping about 40MiB per device cached)\n" );
+    puts( "      --ioprio=CLASS      The i/o priority of the threads of each device," );
+    puts( "                          none, idle, be or be:0-7, which I on the status" );
+    puts( "                          screen changes while the wipe runs (default: none)\n" );
+    puts( "      --cgroup=DIR        Run the wipe in a new child of the cgroup v2" );
+    puts( "                          directory DIR, which holds the --iomax and" );
+    puts( "                          --ioweight limits of each device\n" );
+    puts( "      --iomax=RATE        Limit the reads and writes of each device to RATE" );
+    puts( "                          bytes per second in the cgroup of --cgroup\n" );
+    puts( "      --ioweight=NUM      The io.weight of each device in the cgroup of" );
+    puts( "                          --cgroup, from 1 to 10000\n" );
+    puts( "      --buffers=SIZE      Take the i/o buffers from SIZE bytes of memory that" );
+    puts( "                          is mapped at startup, in huge pages when they are" );
+    puts( "                          reserved, and locked, which caps the buffer memory" );
+    puts( "                          (default is the heap)\n" );
     puts( "      --nowait            Do not wait for a key before exiting" );
     puts( "                          (default is to wait)\n" );
     puts( "      --nosignals         Do not allow signals to interrupt a wipe" );
@@ -519,6 +907,14 @@ void display_help()
     puts( "      --nogui             Do not show the GUI interface. Automatically invokes" );
     puts( "                          the nowait option. Must be used with the --autonuke" );
     puts( "                          option. Send SIGUSR1 to log current stats\n" );
+    puts( "      --preflight         Read a sample at several offsets of each selected" );
+    puts( "                          device, without writing, and forecast how long the" );
+    puts( "                          wipe of each device and of all of them will take" );
+    puts( "                          before it starts\n" );
+    puts( "      --digest            Hash the data that each pass writes and reads back" );
+    puts( "                          into a SHA-256 Merkle root, logged with the summary\n" );
+    puts( "      --check=ROOT        Do not wipe, hash the selected devices and compare" );
+    puts( "                          them with the Merkle root of their final pass\n" );
     puts( "      --nousb             Do show or wipe any USB devices whether in GUI" );
     puts( "                          mode, --nogui or --autonuke modes.\n" );
     puts( "  -e, --exclude=DEVICES   Up to ten comma separated devices to be excluded" );
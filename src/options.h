@@ -24,19 +24,50 @@
 #define OPTIONS_H_
 
 /* Program knobs. */
+#define NWIPE_KNOB_CPU_SAMPLE ( 256 * 1024 )  // Bytes per sample of the CPU time of each stage.
+#define NWIPE_KNOB_DISCARD_CHUNK ( 128 * 1024 * 1024 )  // Bytes discarded by each BLKDISCARD, for progress.
+#define NWIPE_KNOB_ARENA_SLOT ( 64 * 1024 )  // The granularity of the --buffers arena, a multiple of the i/o alignment.
+#define NWIPE_KNOB_BROADCAST_POOL ( 16 * 1024 * 1024 )  // Bytes of the random pool that the broadcast PRNG shares.
+#define NWIPE_KNOB_DIGEST_MEMORY ( 16 * 1024 * 1024 )  // Digests of a random pass beyond this size go to a temporary file.
 #define NWIPE_KNOB_ENTROPY "/dev/urandom"
+#define NWIPE_KNOB_GETRANDOM_BATCH ( 1024 * 1024 )  // Bytes that the getrandom PRNG asks the kernel for at once.
+#define NWIPE_KNOB_GUI_FRAME_TICKS 10  // Slowest status screen frame rate, in tenths of a second per frame.
+#define NWIPE_KNOB_GUI_LINE_SHARE 50  // Percent of the terminal line rate that status screen updates may use.
+#define NWIPE_KNOB_HUGEPAGE_SIZE ( 2 * 1024 * 1024 )  // Buffers at least this large try to use huge pages.
 #define NWIPE_KNOB_IDENTITY_SIZE 512
+#define NWIPE_KNOB_IOSTAT_INTERVAL 1  // Seconds between samples of the block layer statistics of a device.
+#define NWIPE_KNOB_IO_ALIGN 4096  // Alignment of i/o buffers, suitable for O_DIRECT.
 #define NWIPE_KNOB_LABEL_SIZE 128
 #define NWIPE_KNOB_LOADAVG "/proc/loadavg"
 #define NWIPE_KNOB_LOG_BUFFERSIZE 1024  // Maximum length of a log event.
+#define NWIPE_KNOB_MERKLE_REGIONS 8  // Regions of a device that --check hashes at once.
 #define NWIPE_KNOB_PARTITIONS "/proc/partitions"
+#define NWIPE_KNOB_PATTERN_CACHE_IDLE 32  // Unused pattern buffers that are kept for reuse, enough for Gutmann.
 #define NWIPE_KNOB_PARTITIONS_PREFIX "/dev/"
+#define NWIPE_KNOB_PREFLIGHT_SAMPLE ( 64 * 1024 * 1024 )  // Bytes that the pre-flight reads at each zone of a device.
+#define NWIPE_KNOB_PREFLIGHT_ZONES 5  // Offsets from the start to the end of a device that the pre-flight reads at.
 #define NWIPE_KNOB_PRNG_STATE_LENGTH 512  // 128 words
 #define NWIPE_KNOB_SCSI "/proc/scsi/scsi"
 #define NWIPE_KNOB_SLEEP 1
 #define NWIPE_KNOB_STAT "/proc/stat"
+#define NWIPE_KNOB_STATIC_TRANSFER ( 256 * 1024 )  // Bytes written by each vectored static pattern write.
+#define NWIPE_KNOB_TRACE_BATCH ( 16 * 1024 * 1024 )  // Bytes of a loop that one traced batch span covers.
+#define NWIPE_KNOB_TRACE_EVENTS 8192  // Events kept in the trace ring of each thread.
+#define NWIPE_KNOB_VERIFY_AHEAD 8  // Chunks that random verification generates ahead of the compare.
+#define NWIPE_KNOB_VERIFY_CHUNK ( 1024 * 1024 )  // Bytes read by each verification read.
+#define NWIPE_KNOB_WRITEBACK_WINDOW ( 8 * 1024 * 1024 )  // Bytes of buffered writes that are written back at once.
+#define NWIPE_KNOB_ZONE_REPORT 256  // Zones fetched by each BLKREPORTZONE.
+#define NWIPE_KNOB_ZONE_THREADS 4  // Zones of one device that a static pass writes at once.
 #define MAX_NUMBER_EXCLUDED_DRIVES 10
 #define MAX_DRIVE_PATH_LENGTH 200  // e.g. /dev/sda is only 8 characters long, so 200 should be plenty.
+#define MAX_NUMBER_RANGES 16
+
+/* A byte range given with --range. */
+typedef struct nwipe_range_t_
+{
+    long long start;  // The offset of the range, counted back from the end of the device when negative.
+    long long length;  // The length of the range.
+} nwipe_range_t;
 
 /* Function prototypes for loading options from the environment and command line. */
 int nwipe_options_parse( int argc, char** argv );
@@ -49,18 +80,33 @@ typedef struct
 {
     int autonuke;  // Do not prompt the user for confirmation when set.
     int autopoweroff;  // Power off on completion of wipe
+    int cached;  // Leave the writes of the passes in the page cache.
+    long long buffers;  // The bytes of the i/o buffer arena, zero to take buffers from the heap.
+    char cgroup[FILENAME_MAX];  // The cgroup v2 directory to run the wipe in a child of, none when empty.
+    char check[65];  // The Merkle root to check the devices against instead of wiping them, none when empty.
+    int digest;  // Compute the Merkle root of the data of each pass and verification.
+    long long iomax;  // The read and write limit of each device in bytes per second in the cgroup, zero for none.
+    int ioprio;  // The ioprio_set() priority of the threads of each device, zero to inherit it.
+    int ioweight;  // The io.weight of each device in the cgroup, zero to leave it.
     int noblank;  // Do not perform a final blanking pass.
+    int skipmatching;  // Do not rewrite blocks that already hold the pattern of a blank or zero fill.
+    int discard;  // Blank by discarding the device, then write the blocks that do not read back as zero.
     int nousb;  // Do not show or wipe any USB devices.
     int nowait;  // Do not wait for a final key before exiting.
     int nosignals;  // Do not allow signals to interrupt a wipe.
     int nogui;  // Do not show the GUI.
+    int preflight;  // Measure the read rate of the devices and forecast the wipe time before starting.
     char* banner;  // The product banner shown on the top line of the screen.
-    void* method;  // A function pointer to the wipe method that will be used.
+    const nwipe_method_t* method;  // The wipe method that will be used.
     char logfile[FILENAME_MAX];  // The filename to log the output to.
     char exclude[MAX_NUMBER_EXCLUDED_DRIVES][MAX_DRIVE_PATH_LENGTH];  // Drives excluded from the search.
+    nwipe_range_t range[MAX_NUMBER_RANGES];  // The byte ranges to wipe, the whole device when there are none.
+    int range_count;  // The number of byte ranges.
     nwipe_prng_t* prng;  // The pseudo random number generator implementation.
     int rounds;  // The number of times that the wipe method should be called.
     int sync;  // A flag to indicate whether and how often writes should be sync'd.
+    char timings[FILENAME_MAX];  // The CSV file to write the duration of each pass to, none when empty.
+    char trace[FILENAME_MAX];  // The file to write a trace of the wipe to, none when empty.
     int verbose;  // Make log more verbose
     nwipe_verify_t verify;  // A flag to indicate whether writes should be verified.
 } nwipe_options_t;
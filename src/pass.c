@@ -20,203 +20,923 @@
  *
  */
 
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #define _POSIX_C_SOURCE 200809L
 
+#include <limits.h>
 #include <stdint.h>
+#include <sys/sysmacros.h>
+#include <sys/uio.h>
 #include "nwipe.h"
 #include "context.h"
 #include "method.h"
 #include "prng.h"
 #include "options.h"
 #include "pass.h"
+#include "pattern.h"
+#include "zone.h"
 #include "logging.h"
 #include "gui.h"
-
-int nwipe_random_verify( nwipe_context_t* c )
+#include "cpu.h"
+#include "trace.h"
+#include "probe.h"
+#include "arena.h"
+#include "digest.h"
+#include "merkle.h"
+#include "writeback.h"
+
+int nwipe_extents_create( NWIPE_METHOD_SIGNATURE )
 {
     /**
-     * Verifies that a random pass was correctly written to the device.
+     * Builds the byte ranges that each pass covers from the --range options.
+     *
+     * Ranges are clipped to the device, widened to whole blocks, sorted and merged.
+     * Without any ranges the whole device is covered.
      *
+     * Returns zero on success.
      */
 
-    /* The result holder. */
-    int r;
+    /* The transfer size, which the ranges are widened to. */
+    long long blksize = ( c->device_stat.st_blksize > 0 ) ? c->device_stat.st_blksize : 512;
 
-    /* The IO size. */
-    size_t blocksize;
+    /* The byte range of an option. */
+    long long start;
+    long long end;
 
-    /* The result buffer for calls to lseek. */
-    off64_t offset;
+    /* A sorted extent that is being moved. */
+    nwipe_extent_t t;
 
-    /* The input buffer. */
-    char* b;
+    /* Index variables. */
+    int i;
+    int j;
 
-    /* The pattern buffer that is used to check the input buffer. */
-    char* d;
+    c->extent_count = 0;
+    c->wipe_size = 0;
+    c->extents = malloc( ( nwipe_options.range_count > 0 ? nwipe_options.range_count : 1 ) * sizeof( nwipe_extent_t ) );
 
-    /* The number of bytes remaining in the pass. */
-    u64 z = c->device_size;
-
-    if( c->prng_seed.s == NULL )
+    if( c->extents == NULL )
     {
-        nwipe_log( NWIPE_LOG_SANITY, "Null seed pointer." );
+        nwipe_perror( errno, __FUNCTION__, "malloc" );
+        nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the ranges of '%s'.", c->device_name );
         return -1;
     }
 
-    if( c->prng_seed.length <= 0 )
+    if( nwipe_options.range_count == 0 )
     {
-        nwipe_log( NWIPE_LOG_SANITY, "The entropy length member is %i.", c->prng_seed.length );
+        c->extents[0].start = 0;
+        c->extents[0].length = c->device_size;
+        c->extent_count = 1;
+        c->wipe_size = c->device_size;
+        return 0;
+    }
+
+    if( c->device_zone_count > 0 )
+    {
+        nwipe_log(
+            NWIPE_LOG_ERROR, "Zones of '%s' can only be reset whole, so ranges cannot be wiped.", c->device_name );
         return -1;
     }
 
-    /* Create the input buffer. */
-    b = malloc( c->device_stat.st_blksize );
+    for( i = 0; i < nwipe_options.range_count; i++ )
+    {
+        start = nwipe_options.range[i].start;
 
-    /* Check the memory allocation. */
-    if( !b )
+        if( start < 0 )
+        {
+            /* The range counts back from the end of the device. */
+            start = ( -start < c->device_size ) ? c->device_size + start : 0;
+        }
+
+        if( start >= c->device_size )
+        {
+            nwipe_log( NWIPE_LOG_WARNING,
+                       "Range %lld:%lld is beyond the end of '%s' and is ignored.",
+                       nwipe_options.range[i].start,
+                       nwipe_options.range[i].length,
+                       c->device_name );
+            continue;
+        }
+
+        end = ( nwipe_options.range[i].length < c->device_size - start ) ? start + nwipe_options.range[i].length
+                                                                         : c->device_size;
+
+        /* Widen the range to whole blocks. */
+        start = start / blksize * blksize;
+        end = ( end + blksize - 1 ) / blksize * blksize;
+
+        if( end > c->device_size )
+        {
+            end = c->device_size;
+        }
+
+        /* Insert the extent in order. */
+        for( j = c->extent_count; j > 0 && c->extents[j - 1].start > (u64) start; j-- )
+        {
+            c->extents[j] = c->extents[j - 1];
+        }
+
+        c->extents[j].start = start;
+        c->extents[j].length = end - start;
+        c->extent_count += 1;
+    }
+
+    if( c->extent_count == 0 )
     {
-        nwipe_perror( errno, __FUNCTION__, "malloc" );
-        nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the input buffer." );
+        nwipe_log( NWIPE_LOG_ERROR, "None of the ranges are on '%s'.", c->device_name );
         return -1;
     }
 
-    /* Create the pattern buffer */
-    d = malloc( c->device_stat.st_blksize );
+    /* Merge the extents that overlap or touch. */
+    for( i = 0, j = 1; j < c->extent_count; j++ )
+    {
+        t = c->extents[j];
 
-    /* Check the memory allocation. */
-    if( !d )
+        if( t.start <= c->extents[i].start + c->extents[i].length )
+        {
+            if( t.start + t.length > c->extents[i].start + c->extents[i].length )
+            {
+                c->extents[i].length = t.start + t.length - c->extents[i].start;
+            }
+        }
+        else
+        {
+            c->extents[++i] = t;
+        }
+    }
+
+    c->extent_count = i + 1;
+
+    for( i = 0; i < c->extent_count; i++ )
     {
-        nwipe_perror( errno, __FUNCTION__, "malloc" );
-        nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the pattern buffer." );
-        free( b );
-        return -1;
+        c->wipe_size += c->extents[i].length;
+
+        nwipe_log( NWIPE_LOG_NOTICE,
+                   "Range %i of %s covers %llu bytes from offset %llu.",
+                   i + 1,
+                   c->device_name,
+                   c->extents[i].length,
+                   c->extents[i].start );
     }
 
-    /* Reset the file pointer. */
-    offset = lseek( c->device_fd, 0, SEEK_SET );
+    nwipe_log( NWIPE_LOG_NOTICE,
+               "Wiping %llu of %lld bytes of %s in %i ranges.",
+               c->wipe_size,
+               c->device_size,
+               c->device_name,
+               c->extent_count );
 
-    /* Reset the pass byte counter. */
-    c->pass_done = 0;
+    return 0;
+
+} /* nwipe_extents_create */
+
+void nwipe_extents_free( NWIPE_METHOD_SIGNATURE )
+{
+    free( c->extents );
+    c->extents = NULL;
+    c->extent_count = 0;
+
+} /* nwipe_extents_free */
+
+static int nwipe_extent_seek( nwipe_context_t* c, int e )
+{
+    /**
+     * Moves the file offset to the start of extent 'e'.
+     *
+     * Returns zero on success.
+     */
+
+    /* The result buffer for calls to lseek. */
+    off64_t offset = lseek( c->device_fd, c->extents[e].start, SEEK_SET );
 
     if( offset == (off64_t) -1 )
     {
         nwipe_perror( errno, __FUNCTION__, "lseek" );
         nwipe_log( NWIPE_LOG_FATAL, "Unable to reset the '%s' file offset.", c->device_name );
-        free( b );
-        free( d );
         return -1;
     }
 
-    if( offset != 0 )
+    if( (u64) offset != c->extents[e].start )
     {
         /* This is system insanity. */
         nwipe_log( NWIPE_LOG_SANITY, "lseek() returned a bogus offset on '%s'.", c->device_name );
-        free( b );
-        free( d );
         return -1;
     }
 
+    return 0;
+
+} /* nwipe_extent_seek */
+
+int nwipe_sync( nwipe_context_t* c, int fd )
+{
+    /**
+     * Flushes the writes of a device, showing the sync to the GUI and adding its duration to
+     * the sync time of the device.
+     *
+     * Returns the result of fdatasync() with its errno.
+     */
+
+    /* The start and end time of the sync. */
+    struct timespec start;
+    struct timespec end;
+
+    int r;
+    int e;
+
     /* Tell our parent that we are syncing the device. */
     c->sync_status = 1;
 
-    /* Sync the device. */
-    r = fdatasync( c->device_fd );
+    NWIPE_TRACE_BEGIN( "sync" );
+    NWIPE_PROBE1( sync__begin, c->device_name );
+    clock_gettime( CLOCK_MONOTONIC, &start );
+    nwipe_cpu_span( &c->cpu_meter );
+    r = fdatasync( fd );
+    e = errno;
+    nwipe_cpu_mark( &c->cpu_meter, NWIPE_STAGE_SYNC );
+    clock_gettime( CLOCK_MONOTONIC, &end );
+    NWIPE_TRACE_END( "sync" );
+    NWIPE_PROBE2( sync__end, c->device_name, r );
+
+    c->sync_time += ( end.tv_sec - start.tv_sec ) + ( end.tv_nsec - start.tv_nsec ) / 1e9;
 
     /* Tell our parent that we have finished syncing the device. */
     c->sync_status = 0;
 
-    if( r != 0 )
+    errno = e;
+    return r;
+
+} /* nwipe_sync */
+
+static int nwipe_verify_open( nwipe_context_t* c )
+{
+    /**
+     * Opens the device for a verification that reads the media rather than the page cache.
+     *
+     * Returns an O_DIRECT descriptor, or the wipe descriptor when the device does not
+     * take direct i/o. The cached pages of the device are dropped in either case.
+     * Close the descriptor with nwipe_verify_close().
+     */
+
+    int fd;
+
+    if( posix_fadvise( c->device_fd, 0, 0, POSIX_FADV_DONTNEED ) != 0 && nwipe_options.verbose )
+    {
+        nwipe_log( NWIPE_LOG_DEBUG, "Unable to drop the cached pages of '%s'.", c->device_name );
+    }
+
+    /* This also drops the buffers that other descriptors of the device left behind. */
+    if( ioctl( c->device_fd, BLKFLSBUF, 0 ) != 0 && nwipe_options.verbose )
+    {
+        nwipe_log( NWIPE_LOG_DEBUG, "Unable to flush the buffers of '%s'.", c->device_name );
+    }
+
+    fd = open( c->device_name, O_RDONLY | O_DIRECT );
+
+    if( fd < 0 )
+    {
+        nwipe_perror( errno, __FUNCTION__, "open" );
+        nwipe_log( NWIPE_LOG_WARNING,
+                   "Unable to open '%s' for direct i/o, verifying through the page cache.",
+                   c->device_name );
+        return c->device_fd;
+    }
+
+    return fd;
+
+} /* nwipe_verify_open */
+
+static void nwipe_verify_close( nwipe_context_t* c, int fd )
+{
+    if( fd != c->device_fd )
+    {
+        close( fd );
+    }
+
+} /* nwipe_verify_close */
+
+/* The expected data of a random verification, generated ahead of the reads. */
+typedef struct nwipe_verify_ring_t_
+{
+    nwipe_context_t* c;  // The device.
+    char* buffer;  // NWIPE_KNOB_VERIFY_AHEAD chunks of expected data.
+    u64 produced;  // The number of chunks that have been generated.
+    u64 consumed;  // The number of chunks that have been compared.
+    int stop;  // Set to make the generator return early.
+    pthread_t thread;  // The generator thread.
+    pthread_mutex_t mutex;  // Serializes the counters.
+    pthread_cond_t cond;  // Signalled when a counter changes.
+} nwipe_verify_ring_t;
+
+static void* nwipe_verify_generate( void* ptr )
+{
+    /**
+     * Generates the PRNG stream chunk by chunk, in the same extents and chunk
+     * lengths that the verification reads, staying up to NWIPE_KNOB_VERIFY_AHEAD
+     * chunks ahead of the compare.
+     */
+
+    nwipe_verify_ring_t* ring = (nwipe_verify_ring_t*) ptr;
+
+    /* The device. */
+    nwipe_context_t* c = ring->c;
+
+    /* The CPU time of this thread is all random data generation. */
+    nwipe_cpu_meter_t meter;
+
+    /* The number of bytes remaining in the extent. */
+    u64 z;
+
+    /* The number of bytes in the current chunk. */
+    size_t length;
+
+    /* The current extent. */
+    int e;
+
+    nwipe_cpu_start( &meter, c );
+    nwipe_trace_name( "verify prng %s", c->device_name );
+
+    for( e = 0; e < c->extent_count; e++ )
+    {
+        for( z = c->extents[e].length; z > 0; z -= length )
+        {
+            length = ( NWIPE_KNOB_VERIFY_CHUNK <= z ) ? NWIPE_KNOB_VERIFY_CHUNK : z;
+
+            pthread_mutex_lock( &ring->mutex );
+
+            while( !ring->stop && ring->produced - ring->consumed >= NWIPE_KNOB_VERIFY_AHEAD )
+            {
+                pthread_cond_wait( &ring->cond, &ring->mutex );
+            }
+
+            pthread_mutex_unlock( &ring->mutex );
+
+            if( ring->stop )
+            {
+                nwipe_cpu_stop( &meter );
+                return NULL;
+            }
+
+            /* The slot is not touched by the compare until it is produced. */
+            nwipe_cpu_next( &meter, length );
+            NWIPE_TRACE_BATCH( "prng", length );
+            c->prng->read( &c->prng_state,
+                           &ring->buffer[( ring->produced % NWIPE_KNOB_VERIFY_AHEAD ) * NWIPE_KNOB_VERIFY_CHUNK],
+                           length );
+            nwipe_cpu_mark( &meter, NWIPE_STAGE_PRNG );
+
+            pthread_mutex_lock( &ring->mutex );
+            ring->produced += 1;
+            pthread_cond_broadcast( &ring->cond );
+            pthread_mutex_unlock( &ring->mutex );
+        }
+    }
+
+    nwipe_cpu_stop( &meter );
+
+    return NULL;
+
+} /* nwipe_verify_generate */
+
+static void nwipe_verify_stop( void* ptr )
+{
+    /**
+     * Stops the generator and waits for it, also when the wipe thread is cancelled,
+     * because the ring lives on the stack of the wipe thread.
+     */
+
+    nwipe_verify_ring_t* ring = (nwipe_verify_ring_t*) ptr;
+
+    pthread_mutex_lock( &ring->mutex );
+    ring->stop = 1;
+    pthread_cond_broadcast( &ring->cond );
+    pthread_mutex_unlock( &ring->mutex );
+
+    pthread_join( ring->thread, NULL );
+
+} /* nwipe_verify_stop */
+
+static void nwipe_verify_unlock( void* ptr )
+{
+    pthread_mutex_unlock( (pthread_mutex_t*) ptr );
+
+} /* nwipe_verify_unlock */
+
+static const char* nwipe_verify_next( nwipe_verify_ring_t* ring )
+{
+    /**
+     * Waits for the next chunk of expected data, which shows in the trace when the generator
+     * falls behind, and returns it.
+     */
+
+    NWIPE_TRACE_BEGIN( "wait prng" );
+    pthread_mutex_lock( &ring->mutex );
+    pthread_cleanup_push( nwipe_verify_unlock, &ring->mutex );
+
+    while( ring->produced <= ring->consumed )
+    {
+        pthread_cond_wait( &ring->cond, &ring->mutex );
+    }
+
+    pthread_cleanup_pop( 1 );
+    NWIPE_TRACE_END( "wait prng" );
+
+    return &ring->buffer[( ring->consumed % NWIPE_KNOB_VERIFY_AHEAD ) * NWIPE_KNOB_VERIFY_CHUNK];
+
+} /* nwipe_verify_next */
+
+static int nwipe_digest_verify( nwipe_context_t* c )
+{
+    /**
+     * Verifies a random pass against the digests that it kept, reading the chunks the same way
+     * as nwipe_random_verify() but without regenerating the PRNG stream. Only a chunk whose digest
+     * does not match is regenerated, to count its blocks that differ like nwipe_random_verify().
+     */
+
+    /* The result holder. */
+    ssize_t r = 0;
+
+    /* The input buffer. */
+    char* b;
+
+    /* The regenerated chunk, allocated at the first mismatch. */
+    char* p = NULL;
+
+    /* The offset of the current chunk in the stream, and how far the stream has been replayed. */
+    u64 position = 0;
+    u64 replayed = 0;
+
+    /* The chunks that did not match when the stream cannot be replayed. */
+    u64 chunks = 0;
+
+    /* The offset of the current block in the chunk, and its size. */
+    size_t k;
+    size_t blocksize;
+
+    /* The bytes of the stream that are skipped at once. */
+    size_t n;
+
+    /* The file descriptor that the verification reads. */
+    int fd;
+
+    /* The device offset of the current chunk. */
+    u64 offset;
+
+    /* The number of bytes in the current chunk. */
+    size_t length;
+
+    /* The number of bytes remaining in the extent. */
+    u64 z;
+
+    /* The digest of the current chunk. */
+    u64 d = 0;
+
+    /* The current extent. */
+    int e;
+
+    /* Create the input buffer. */
+    b = nwipe_arena_get( NWIPE_KNOB_VERIFY_CHUNK );
+
+    /* Check the memory allocation. */
+    if( !b )
+    {
+        nwipe_perror( errno, __FUNCTION__, "nwipe_arena_get" );
+        nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the input buffer." );
+        return -1;
+    }
+
+    /* Reset the pass byte counter. */
+    c->pass_done = 0;
+
+    /* Sync the device, the verification still reads back what reached it when this fails. */
+    if( nwipe_sync( c, c->device_fd ) != 0 )
     {
         /* FIXME: Is there a better way to handle this? */
         nwipe_perror( errno, __FUNCTION__, "fdatasync" );
         nwipe_log( NWIPE_LOG_WARNING, "Buffer flush failure on '%s'.", c->device_name );
     }
 
-    /* Reseed the PRNG. */
-    c->prng->init( &c->prng_state, &c->prng_seed );
+    /* Read from the media rather than from the pages that the pass left in the cache. */
+    fd = nwipe_verify_open( c );
 
-    while( z > 0 )
+    for( e = 0; e < c->extent_count && r >= 0; e++ )
     {
-        if( c->device_stat.st_blksize <= z )
+        offset = c->extents[e].start;
+        z = c->extents[e].length;
+
+        if( fd == c->device_fd )
         {
-            blocksize = c->device_stat.st_blksize;
+            /* Start reading the beginning of the extent. */
+            posix_fadvise( fd, offset, NWIPE_KNOB_VERIFY_AHEAD * NWIPE_KNOB_VERIFY_CHUNK, POSIX_FADV_WILLNEED );
         }
-        else
+
+        while( z > 0 )
         {
-            /* This is a seatbelt for buggy drivers and programming errors because */
-            /* the device size should always be an even multiple of its blocksize. */
-            blocksize = z;
-            nwipe_log( NWIPE_LOG_WARNING,
-                       "%s: The size of '%s' is not a multiple of its block size %i.",
-                       __FUNCTION__,
-                       c->device_name,
-                       c->device_stat.st_blksize );
-        }
+            length = ( NWIPE_KNOB_VERIFY_CHUNK <= z ) ? NWIPE_KNOB_VERIFY_CHUNK : z;
+
+            nwipe_cpu_next( &c->cpu_meter, length );
+            NWIPE_TRACE_BATCH( "read", length );
+
+            /* Keep the reads NWIPE_KNOB_VERIFY_AHEAD chunks ahead. */
+            if( fd == c->device_fd && z > NWIPE_KNOB_VERIFY_AHEAD * NWIPE_KNOB_VERIFY_CHUNK )
+            {
+                posix_fadvise( fd,
+                               offset + NWIPE_KNOB_VERIFY_AHEAD * NWIPE_KNOB_VERIFY_CHUNK,
+                               NWIPE_KNOB_VERIFY_CHUNK,
+                               POSIX_FADV_WILLNEED );
+            }
+
+            /* Read the chunk in from the device. */
+            r = pread( fd, b, length, offset );
+            nwipe_cpu_mark( &c->cpu_meter, NWIPE_STAGE_SUBMIT );
+
+            /* Check the result. */
+            if( r < 0 )
+            {
+                nwipe_perror( errno, __FUNCTION__, "pread" );
+                nwipe_log( NWIPE_LOG_ERROR, "Unable to read from '%s'.", c->device_name );
+                break;
+            }
+
+            if( r != (ssize_t) length )
+            {
+                nwipe_log( NWIPE_LOG_WARNING,
+                           "%s: Partial read from '%s', %zu bytes short.",
+                           __FUNCTION__,
+                           c->device_name,
+                           length - r );
+            }
+
+            /* A short read is a mismatch, the blocks that were not read count as errors. */
+            if( r != (ssize_t) length || nwipe_crc32c( 0, b, length ) != c->digests[d] )
+            {
+                nwipe_cpu_mark( &c->cpu_meter, NWIPE_STAGE_DIGEST );
+
+                if( p == NULL && !c->prng->unseeded )
+                {
+                    p = nwipe_arena_get( NWIPE_KNOB_VERIFY_CHUNK );
+
+                    if( p != NULL )
+                    {
+                        c->prng->init( &c->prng_state, &c->prng_seed );
+                    }
+                }
+
+                if( p == NULL )
+                {
+                    /* A digest cannot tell which block is wrong, so the chunk counts as one error. */
+                    chunks += 1;
+                    c->verify_errors += 1;
+                    NWIPE_PROBE3( verify__mismatch, c->device_name, offset, length );
+                }
+                else
+                {
+                    /* Bring the stream up to the chunk, mismatches come in stream order. */
+                    while( replayed < position )
+                    {
+                        n = ( position - replayed < NWIPE_KNOB_VERIFY_CHUNK ) ? position - replayed
+                                                                              : NWIPE_KNOB_VERIFY_CHUNK;
+                        c->prng->read( &c->prng_state, p, n );
+                        replayed += n;
+                    }
+
+                    c->prng->read( &c->prng_state, p, length );
+                    replayed += length;
+                    nwipe_cpu_mark( &c->cpu_meter, NWIPE_STAGE_PRNG );
+
+                    for( k = 0; k < length; k += blocksize )
+                    {
+                        blocksize = ( c->device_stat.st_blksize <= length - k ) ? c->device_stat.st_blksize : length - k;
+
+                        if( k + blocksize > (size_t) r || memcmp( &b[k], &p[k], blocksize ) != 0 )
+                        {
+                            c->verify_errors += 1;
+                            NWIPE_PROBE3( verify__mismatch, c->device_name, offset + k, blocksize );
+                        }
+                    }
+
+                    nwipe_cpu_mark( &c->cpu_meter, NWIPE_STAGE_COMPARE );
+                }
+            }
+
+            nwipe_cpu_mark( &c->cpu_meter, NWIPE_STAGE_DIGEST );
 
-        /* Fill the output buffer with the random pattern. */
-        c->prng->read( &c->prng_state, d, blocksize );
+            /* Hash what was read back. */
+            nwipe_merkle_update( c, b, r );
+            nwipe_cpu_mark( &c->cpu_meter, NWIPE_STAGE_DIGEST );
 
-        /* Read the buffer in from the device. */
-        r = read( c->device_fd, b, blocksize );
+            d += 1;
+            offset += length;
+            position += length;
 
-        /* Check the result. */
-        if( r < 0 )
+            /* Decrement the bytes remaining in this pass. */
+            z -= length;
+
+            /* Increment the total progress counters. */
+            c->pass_done += length;
+            c->round_done += length;
+
+            pthread_testcancel();
+
+        } /* while bytes remaining */
+
+        nwipe_merkle_extent_end( c );
+
+    } /* extents */
+
+    if( chunks > 0 )
+    {
+        nwipe_log( NWIPE_LOG_ERROR,
+                   "%llu chunks of %i bytes on '%s' do not match their digest, their blocks could not be "
+                   "counted because the %s stream was not regenerated.",
+                   chunks,
+                   NWIPE_KNOB_VERIFY_CHUNK,
+                   c->device_name,
+                   c->prng->label );
+    }
+
+    /* Release the buffers. */
+    nwipe_verify_close( c, fd );
+    nwipe_arena_put( p );
+    nwipe_arena_put( b );
+
+    /* We're done. */
+    return ( r < 0 ) ? -1 : 0;
+
+} /* nwipe_digest_verify */
+
+static ssize_t nwipe_verify_extents( nwipe_context_t* c, nwipe_verify_ring_t* ring, char* b, int fd )
+{
+    /**
+     * Reads the extents of the device into 'b' and compares them with the ring, returns -1 when
+     * a read fails. It is kept out of nwipe_random_verify() because the cleanup push there may
+     * longjmp, which would clobber the position held in these locals.
+     */
+
+    /* The result holder. */
+    ssize_t r = 0;
+
+    /* The IO size. */
+    size_t blocksize;
+
+    /* The expected data of the current chunk. */
+    const char* d;
+
+    /* The device offset of the current chunk. */
+    u64 offset;
+
+    /* The number of bytes in the current chunk. */
+    size_t length;
+
+    /* The offset of the current block in the chunk. */
+    size_t k;
+
+    /* The number of bytes remaining in the extent. */
+    u64 z;
+
+    /* The current extent. */
+    int e;
+
+    for( e = 0; e < c->extent_count && r >= 0; e++ )
+    {
+        offset = c->extents[e].start;
+        z = c->extents[e].length;
+
+        if( fd == c->device_fd )
         {
-            nwipe_perror( errno, __FUNCTION__, "read" );
-            nwipe_log( NWIPE_LOG_ERROR, "Unable to read from '%s'.", c->device_name );
-            return -1;
+            /* Start reading the beginning of the extent. */
+            posix_fadvise( fd, offset, NWIPE_KNOB_VERIFY_AHEAD * NWIPE_KNOB_VERIFY_CHUNK, POSIX_FADV_WILLNEED );
         }
 
-        /* Check for a partial read. */
-        if( r != blocksize )
+        while( z > 0 )
         {
-            /* TODO: Handle a partial read. */
+            length = ( NWIPE_KNOB_VERIFY_CHUNK <= z ) ? NWIPE_KNOB_VERIFY_CHUNK : z;
 
-            /* The number of bytes that were not read. */
-            int s = blocksize - r;
+            nwipe_cpu_next( &c->cpu_meter, length );
+            NWIPE_TRACE_BATCH( "read", length );
 
-            nwipe_log(
-                NWIPE_LOG_WARNING, "%s: Partial read from '%s', %i bytes short.", __FUNCTION__, c->device_name, s );
+            /* Keep the reads NWIPE_KNOB_VERIFY_AHEAD chunks ahead. */
+            if( fd == c->device_fd && z > NWIPE_KNOB_VERIFY_AHEAD * NWIPE_KNOB_VERIFY_CHUNK )
+            {
+                posix_fadvise( fd,
+                               offset + NWIPE_KNOB_VERIFY_AHEAD * NWIPE_KNOB_VERIFY_CHUNK,
+                               NWIPE_KNOB_VERIFY_CHUNK,
+                               POSIX_FADV_WILLNEED );
+            }
 
-            /* Increment the error count. */
-            c->verify_errors += 1;
+            /* Read the chunk in from the device. */
+            r = pread( fd, b, length, offset );
+            nwipe_cpu_mark( &c->cpu_meter, NWIPE_STAGE_SUBMIT );
 
-            /* Bump the file pointer to the next block. */
-            offset = lseek( c->device_fd, s, SEEK_CUR );
+            /* Check the result. */
+            if( r < 0 )
+            {
+                nwipe_perror( errno, __FUNCTION__, "pread" );
+                nwipe_log( NWIPE_LOG_ERROR, "Unable to read from '%s'.", c->device_name );
+                break;
+            }
 
-            if( offset == (off64_t) -1 )
+            if( r != (ssize_t) length )
             {
-                nwipe_perror( errno, __FUNCTION__, "lseek" );
-                nwipe_log(
-                    NWIPE_LOG_ERROR, "Unable to bump the '%s' file offset after a partial read.", c->device_name );
-                return -1;
+                /* TODO: Handle a partial read. */
+                nwipe_log( NWIPE_LOG_WARNING,
+                           "%s: Partial read from '%s', %zu bytes short.",
+                           __FUNCTION__,
+                           c->device_name,
+                           length - r );
             }
 
-        } /* partial read */
+            /* Wait for the expected data. */
+            d = nwipe_verify_next( ring );
 
-        /* Compare buffer contents. */
-        if( memcmp( b, d, blocksize ) != 0 )
-        {
-            c->verify_errors += 1;
-        }
+            /* Compare each block, counting the blocks that were not read as errors. */
+            NWIPE_TRACE_BEGIN( "compare" );
+            for( k = 0; k < length; k += blocksize )
+            {
+                blocksize = ( c->device_stat.st_blksize <= length - k ) ? c->device_stat.st_blksize : length - k;
+
+                if( k + blocksize > (size_t) r || memcmp( &b[k], &d[k], blocksize ) != 0 )
+                {
+                    c->verify_errors += 1;
+                    NWIPE_PROBE3( verify__mismatch, c->device_name, offset + k, blocksize );
+                }
+            }
+            NWIPE_TRACE_END( "compare" );
+
+            nwipe_cpu_mark( &c->cpu_meter, NWIPE_STAGE_COMPARE );
+
+            /* Hash what was read back. */
+            nwipe_merkle_update( c, b, r );
+            nwipe_cpu_mark( &c->cpu_meter, NWIPE_STAGE_DIGEST );
+
+            /* Hand the slot back to the generator. */
+            pthread_mutex_lock( &ring->mutex );
+            ring->consumed += 1;
+            pthread_cond_broadcast( &ring->cond );
+            pthread_mutex_unlock( &ring->mutex );
+
+            offset += length;
+
+            /* Decrement the bytes remaining in this pass. */
+            z -= length;
+
+            /* Increment the total progress counters. */
+            c->pass_done += length;
+            c->round_done += length;
+
+            pthread_testcancel();
+
+        } /* while bytes remaining */
+
+        nwipe_merkle_extent_end( c );
+
+    } /* extents */
+
+    return r;
+
+} /* nwipe_verify_extents */
+
+int nwipe_random_verify( nwipe_context_t* c )
+{
+    /**
+     * Verifies that a random pass was correctly written to the device.
+     *
+     * The verification is a pipeline. A generator thread regenerates the PRNG stream
+     * into a ring of NWIPE_KNOB_VERIFY_AHEAD chunks while this thread reads chunks from
+     * the media, bypassing the page cache, and compares them with the expected data.
+     * When the device cannot be read directly, the kernel reads ahead instead.
+     *
+     * When the pass kept the digests of its chunks, they are compared instead.
+     */
+
+    /* The result holder. */
+    ssize_t r;
+
+    /* The input buffer. */
+    char* b;
+
+    /* The generator state. */
+    nwipe_verify_ring_t ring;
+
+    /* The file descriptor that the verification reads. */
+    int fd;
+
+    if( c->prng_seed.s == NULL )
+    {
+        nwipe_log( NWIPE_LOG_SANITY, "Null seed pointer." );
+        return -1;
+    }
+
+    if( c->prng_seed.length <= 0 )
+    {
+        nwipe_log( NWIPE_LOG_SANITY, "The entropy length member is %i.", c->prng_seed.length );
+        return -1;
+    }
+
+    if( c->prng->unseeded
+        && ( c->device_zone_count > 0 || !c->digest_valid || c->digest_index != c->digest_count ) )
+    {
+        /* Regenerating the stream would report every block as a mismatch. */
+        nwipe_log( NWIPE_LOG_ERROR,
+                   "Unable to verify '%s', the %s stream does not replay and the pass kept no digests.",
+                   c->device_name,
+                   c->prng->label );
+        return -1;
+    }
+
+    if( c->device_zone_count > 0 )
+    {
+        /* Zoned devices are written zone by zone. */
+        return nwipe_zone_verify( c, NULL );
+    }
+
+    if( c->digest_valid && c->digest_index == c->digest_count )
+    {
+        /* The pass kept the digest of every chunk. */
+        return nwipe_digest_verify( c );
+    }
+
+    /* Create the input buffer. */
+    b = nwipe_arena_get( NWIPE_KNOB_VERIFY_CHUNK );
+
+    /* Check the memory allocation. */
+    if( !b )
+    {
+        nwipe_perror( errno, __FUNCTION__, "nwipe_arena_get" );
+        nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the input buffer." );
+        return -1;
+    }
+
+    /* Create the ring of expected data. */
+    memset( &ring, 0, sizeof( ring ) );
+    ring.c = c;
+    ring.buffer = nwipe_arena_get( NWIPE_KNOB_VERIFY_AHEAD * NWIPE_KNOB_VERIFY_CHUNK );
+
+    /* Check the memory allocation. */
+    if( !ring.buffer )
+    {
+        nwipe_perror( errno, __FUNCTION__, "nwipe_arena_get" );
+        nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the pattern buffer." );
+        nwipe_arena_put( b );
+        return -1;
+    }
+
+    /* Reset the pass byte counter. */
+    c->pass_done = 0;
+
+    /* Sync the device, the verification still reads back what reached it when this fails. */
+    if( nwipe_sync( c, c->device_fd ) != 0 )
+    {
+        /* FIXME: Is there a better way to handle this? */
+        nwipe_perror( errno, __FUNCTION__, "fdatasync" );
+        nwipe_log( NWIPE_LOG_WARNING, "Buffer flush failure on '%s'.", c->device_name );
+    }
 
-        /* Decrement the bytes remaining in this pass. */
-        z -= r;
+    /* Read from the media rather than from the pages that the pass left in the cache. */
+    fd = nwipe_verify_open( c );
 
-        /* Increment the total progress counters. */
-        c->pass_done += r;
-        c->round_done += r;
+    /* Reseed the PRNG. */
+    c->prng->init( &c->prng_state, &c->prng_seed );
 
-        pthread_testcancel();
+    pthread_mutex_init( &ring.mutex, NULL );
+    pthread_cond_init( &ring.cond, NULL );
 
-    } /* while bytes remaining */
+    r = pthread_create( &ring.thread, NULL, nwipe_verify_generate, &ring );
+
+    if( r != 0 )
+    {
+        nwipe_perror( r, __FUNCTION__, "pthread_create" );
+        nwipe_log( NWIPE_LOG_FATAL, "Unable to start the PRNG thread for '%s'.", c->device_name );
+        pthread_cond_destroy( &ring.cond );
+        pthread_mutex_destroy( &ring.mutex );
+        nwipe_verify_close( c, fd );
+        nwipe_arena_put( ring.buffer );
+        nwipe_arena_put( b );
+        return -1;
+    }
+
+    /* Stop the generator if this thread is cancelled. */
+    pthread_cleanup_push( nwipe_verify_stop, &ring );
+
+    r = nwipe_verify_extents( c, &ring, b, fd );
+
+    pthread_cleanup_pop( 1 );
+
+    pthread_cond_destroy( &ring.cond );
+    pthread_mutex_destroy( &ring.mutex );
 
     /* Release the buffers. */
-    free( b );
-    free( d );
+    nwipe_verify_close( c, fd );
+    nwipe_arena_put( ring.buffer );
+    nwipe_arena_put( b );
 
     /* We're done. */
-    return 0;
+    return ( r < 0 ) ? -1 : 0;
 
 } /* nwipe_random_verify */
 
@@ -240,7 +960,10 @@ int nwipe_random_pass( NWIPE_METHOD_SIGNATURE )
     char* b;
 
     /* The number of bytes remaining in the pass. */
-    u64 z = c->device_size;
+    u64 z;
+
+    /* The current extent. */
+    int e;
 
     /* Number of writes to do before a fdatasync. */
     int syncRate = nwipe_options.sync;
@@ -260,13 +983,20 @@ int nwipe_random_pass( NWIPE_METHOD_SIGNATURE )
         return -1;
     }
 
+    if( c->device_zone_count > 0 )
+    {
+        /* Zoned devices are written zone by zone. */
+        nwipe_digest_invalidate( c );
+        return nwipe_zone_pass( c, NULL );
+    }
+
     /* Create the output buffer. */
-    b = malloc( c->device_stat.st_blksize );
+    b = nwipe_arena_get( c->device_stat.st_blksize );
 
     /* Check the memory allocation. */
     if( !b )
     {
-        nwipe_perror( errno, __FUNCTION__, "malloc" );
+        nwipe_perror( errno, __FUNCTION__, "nwipe_arena_get" );
         nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the output buffer." );
         return -1;
     }
@@ -274,386 +1004,528 @@ int nwipe_random_pass( NWIPE_METHOD_SIGNATURE )
     /* Seed the PRNG. */
     c->prng->init( &c->prng_state, &c->prng_seed );
 
-    /* Reset the file pointer. */
-    offset = lseek( c->device_fd, 0, SEEK_SET );
+    /* Keep the digests of the chunks for the verification. */
+    nwipe_digest_start( c );
+
+    /* Keep the page cache footprint of the pass constant. */
+    nwipe_writeback_start( c );
 
     /* Reset the pass byte counter. */
     c->pass_done = 0;
 
-    if( offset == (off64_t) -1 )
-    {
-        nwipe_perror( errno, __FUNCTION__, "lseek" );
-        nwipe_log( NWIPE_LOG_FATAL, "Unable to reset the '%s' file offset.", c->device_name );
-        free( b );
-        return -1;
-    }
-
-    if( offset != 0 )
-    {
-        /* This is system insanity. */
-        nwipe_log( NWIPE_LOG_SANITY, "__FUNCTION__: lseek() returned a bogus offset on '%s'.", c->device_name );
-        free( b );
-        return -1;
-    }
-
-    while( z > 0 )
+    for( e = 0; e < c->extent_count; e++ )
     {
-        if( c->device_stat.st_blksize <= z )
+        if( nwipe_extent_seek( c, e ) != 0 )
         {
-            blocksize = c->device_stat.st_blksize;
-        }
-        else
-        {
-            /* This is a seatbelt for buggy drivers and programming errors because */
-            /* the device size should always be an even multiple of its blocksize. */
-            blocksize = z;
-            nwipe_log( NWIPE_LOG_WARNING,
-                       "%s: The size of '%s' is not a multiple of its block size %i.",
-                       __FUNCTION__,
-                       c->device_name,
-                       c->device_stat.st_blksize );
-        }
-
-        /* Fill the output buffer with the random pattern. */
-        c->prng->read( &c->prng_state, b, blocksize );
-
-        /* Write the next block out to the device. */
-        r = write( c->device_fd, b, blocksize );
-
-        /* Check the result for a fatal error. */
-        if( r < 0 )
-        {
-            nwipe_perror( errno, __FUNCTION__, "write" );
-            nwipe_log( NWIPE_LOG_FATAL, "Unable to read from '%s'.", c->device_name );
+            nwipe_arena_put( b );
             return -1;
         }
 
-        /* Check for a partial write. */
-        if( r != blocksize )
-        {
-            /* TODO: Handle a partial write. */
+        z = c->extents[e].length;
 
-            /* The number of bytes that were not written. */
-            int s = blocksize - r;
+        while( z > 0 )
+        {
+            if( c->device_stat.st_blksize <= z )
+            {
+                blocksize = c->device_stat.st_blksize;
+            }
+            else
+            {
+                /* This is a seatbelt for buggy drivers and programming errors because */
+                /* the device size should always be an even multiple of its blocksize. */
+                blocksize = z;
+                nwipe_log( NWIPE_LOG_WARNING,
+                           "%s: The size of '%s' is not a multiple of its block size %i.",
+                           __FUNCTION__,
+                           c->device_name,
+                           c->device_stat.st_blksize );
+            }
 
-            /* Increment the error count by the number of bytes that were not written. */
-            c->pass_errors += s;
+            nwipe_cpu_next( &c->cpu_meter, blocksize );
+            NWIPE_TRACE_BATCH( "write", blocksize );
 
-            nwipe_log( NWIPE_LOG_WARNING, "Partial write on '%s', %i bytes short.", c->device_name, s );
+            /* Fill the output buffer with the random pattern. */
+            c->prng->read( &c->prng_state, b, blocksize );
+            nwipe_cpu_mark( &c->cpu_meter, NWIPE_STAGE_PRNG );
 
-            /* Bump the file pointer to the next block. */
-            offset = lseek( c->device_fd, s, SEEK_CUR );
+            /* Write the next block out to the device. */
+            NWIPE_PROBE3( chunk__submit, c->device_name, c->extents[e].start + c->extents[e].length - z, blocksize );
+            r = write( c->device_fd, b, blocksize );
+            nwipe_cpu_mark( &c->cpu_meter, NWIPE_STAGE_SUBMIT );
+            NWIPE_PROBE4(
+                chunk__complete, c->device_name, c->extents[e].start + c->extents[e].length - z, blocksize, r );
 
-            if( offset == (off64_t) -1 )
+            /* Check the result for a fatal error. */
+            if( r < 0 )
             {
-                nwipe_perror( errno, __FUNCTION__, "lseek" );
-                nwipe_log(
-                    NWIPE_LOG_ERROR, "Unable to bump the '%s' file offset after a partial write.", c->device_name );
+                nwipe_perror( errno, __FUNCTION__, "write" );
+                nwipe_log( NWIPE_LOG_FATAL, "Unable to read from '%s'.", c->device_name );
                 return -1;
             }
 
-        } /* partial write */
-
-        /* Decrement the bytes remaining in this pass. */
-        z -= r;
+            /* Check for a partial write. */
+            if( r != blocksize )
+            {
+                /* TODO: Handle a partial write. */
 
-        /* Increment the total progress counters. */
-        c->pass_done += r;
-        c->round_done += r;
+                /* The number of bytes that were not written. */
+                int s = blocksize - r;
 
-        /* Perodic Sync */
-        if( syncRate > 0 )
-        {
-            i++;
+                /* The stream no longer lines up with the chunks. */
+                nwipe_digest_invalidate( c );
 
-            if( i >= syncRate )
-            {
-                /* Tell our parent that we are syncing the device. */
-                c->sync_status = 1;
+                /* Increment the error count by the number of bytes that were not written. */
+                c->pass_errors += s;
 
-                /* Sync the device. */
-                r = fdatasync( c->device_fd );
+                nwipe_log( NWIPE_LOG_WARNING, "Partial write on '%s', %i bytes short.", c->device_name, s );
 
-                /* Tell our parent that we have finished syncing the device. */
-                c->sync_status = 0;
+                /* Bump the file pointer to the next block. */
+                offset = lseek( c->device_fd, s, SEEK_CUR );
 
-                if( r != 0 )
+                if( offset == (off64_t) -1 )
                 {
-                    nwipe_perror( errno, __FUNCTION__, "fdatasync" );
-                    nwipe_log( NWIPE_LOG_WARNING, "Buffer flush failure on '%s'.", c->device_name );
-                    nwipe_log( NWIPE_LOG_WARNING, "Wrote %llu bytes on '%s'.", c->pass_done, c->device_name );
-                    free( b );
+                    nwipe_perror( errno, __FUNCTION__, "lseek" );
+                    nwipe_log(
+                        NWIPE_LOG_ERROR, "Unable to bump the '%s' file offset after a partial write.", c->device_name );
                     return -1;
                 }
 
-                i = 0;
+            } /* partial write */
+
+            nwipe_digest_update( c, b, r );
+            nwipe_merkle_update( c, b, r );
+            nwipe_cpu_mark( &c->cpu_meter, NWIPE_STAGE_DIGEST );
+
+            nwipe_writeback_add( c, c->extents[e].start + c->extents[e].length - z, r );
+            nwipe_cpu_mark( &c->cpu_meter, NWIPE_STAGE_SYNC );
+
+            /* Decrement the bytes remaining in this pass. */
+            z -= r;
+
+            /* Increment the total progress counters. */
+            c->pass_done += r;
+            c->round_done += r;
+
+            /* Perodic Sync */
+            if( syncRate > 0 )
+            {
+                i++;
+
+                if( i >= syncRate )
+                {
+                    /* Sync the device. */
+                    r = nwipe_sync( c, c->device_fd );
+
+                    if( r != 0 )
+                    {
+                        nwipe_perror( errno, __FUNCTION__, "fdatasync" );
+                        nwipe_log( NWIPE_LOG_WARNING, "Buffer flush failure on '%s'.", c->device_name );
+                        nwipe_log( NWIPE_LOG_WARNING, "Wrote %llu bytes on '%s'.", c->pass_done, c->device_name );
+                        nwipe_arena_put( b );
+                        return -1;
+                    }
+
+                    i = 0;
+                }
             }
-        }
 
-        pthread_testcancel();
+            pthread_testcancel();
 
-    } /* remaining bytes */
+        } /* remaining bytes */
 
-    /* Release the output buffer. */
-    free( b );
+        nwipe_digest_extent_end( c );
+        nwipe_merkle_extent_end( c );
 
-    /* Tell our parent that we are syncing the device. */
-    c->sync_status = 1;
+    } /* extents */
+
+    /* Release the output buffer. */
+    nwipe_arena_put( b );
 
     /* Sync the device. */
-    r = fdatasync( c->device_fd );
+    r = nwipe_sync( c, c->device_fd );
 
-    /* Tell our parent that we have finished syncing the device. */
-    c->sync_status = 0;
+    if( r != 0 )
+    {
+        /* FIXME: Is there a better way to handle this? */
+        nwipe_perror( errno, __FUNCTION__, "fdatasync" );
+        nwipe_log( NWIPE_LOG_WARNING, "Buffer flush failure on '%s'.", c->device_name );
+    }
+
+    /* Drop the last windows, which the sync has written. */
+    nwipe_writeback_finish( c );
+
+    /* We're done. */
+    return 0;
+
+} /* nwipe_random_pass */
+
+static u64 nwipe_static_compare( nwipe_context_t* c,
+                                 const char* b,
+                                 ssize_t r,
+                                 nwipe_pattern_buffer_t* pb,
+                                 nwipe_pattern_t* pattern,
+                                 u64 offset,
+                                 size_t length )
+{
+    /**
+     * Compares each block of a chunk of 'length' bytes at 'offset', of which 'r' were read
+     * into 'b', with the pattern. Returns the number of blocks that differ or were not read.
+     */
+
+    /* The IO size. */
+    size_t blocksize;
+
+    /* The offset of the current block in the chunk. */
+    size_t k;
+
+    u64 mismatches = 0;
+
+    NWIPE_TRACE_BEGIN( "compare" );
+    for( k = 0; k < length; k += blocksize )
+    {
+        blocksize = ( c->device_stat.st_blksize <= length - k ) ? c->device_stat.st_blksize : length - k;
+
+        if( k + blocksize > (size_t) r || !nwipe_pattern_match( &b[k], pb, offset + k, blocksize, pattern ) )
+        {
+            mismatches += 1;
+            NWIPE_PROBE3( verify__mismatch, c->device_name, offset + k, blocksize );
+        }
+    }
+    NWIPE_TRACE_END( "compare" );
+
+    return mismatches;
+
+} /* nwipe_static_compare */
+
+static ssize_t nwipe_static_mend( nwipe_context_t* c,
+                                  int fd,
+                                  char* b,
+                                  nwipe_pattern_buffer_t* pb,
+                                  u64 offset,
+                                  size_t length )
+{
+    /**
+     * Writes the pattern over a chunk that did not hold it, and reads the chunk back into 'b'
+     * through the verification descriptor 'fd'.
+     *
+     * Returns the result of the read, or -1 when the write fails.
+     */
+
+    /* The pattern buffer window offset. */
+    size_t w = offset % pb->size;
+
+    /* The number of bytes copied from the window. */
+    size_t n;
+
+    /* The offset in the chunk. */
+    size_t k;
+
+    ssize_t r;
+
+    for( k = 0; k < length; k += n )
+    {
+        n = ( pb->size - w <= length - k ) ? pb->size - w : length - k;
+        memcpy( &b[k], &pb->buffer[w], n );
+        w = 0;
+    }
+
+    r = pwrite( c->device_fd, b, length, offset );
+
+    if( r != (ssize_t) length )
+    {
+        nwipe_perror( errno, __FUNCTION__, "pwrite" );
+        nwipe_log( NWIPE_LOG_FATAL, "Unable to write %zu bytes at %llu of '%s'.", length, offset, c->device_name );
+        return -1;
+    }
 
-    if( r != 0 )
+    if( nwipe_sync( c, c->device_fd ) != 0 )
     {
-        /* FIXME: Is there a better way to handle this? */
         nwipe_perror( errno, __FUNCTION__, "fdatasync" );
         nwipe_log( NWIPE_LOG_WARNING, "Buffer flush failure on '%s'.", c->device_name );
     }
 
-    /* We're done. */
-    return 0;
+    /* Read the media again, not the pages that were just written. */
+    posix_fadvise( c->device_fd, offset, length, POSIX_FADV_DONTNEED );
 
-} /* nwipe_random_pass */
+    r = pread( fd, b, length, offset );
 
-int nwipe_static_verify( NWIPE_METHOD_SIGNATURE, nwipe_pattern_t* pattern )
+    if( r < 0 )
+    {
+        nwipe_perror( errno, __FUNCTION__, "pread" );
+        nwipe_log( NWIPE_LOG_ERROR, "Unable to read from '%s'.", c->device_name );
+    }
+
+    return r;
+
+} /* nwipe_static_mend */
+
+static int nwipe_static_check( nwipe_context_t* c, nwipe_pattern_t* pattern, int repair )
 {
     /**
      * Verifies that a static pass was correctly written to the device.
+     *
+     * The device is read in NWIPE_KNOB_VERIFY_CHUNK chunks from the media, bypassing
+     * the page cache, and each block is compared with the shared pattern buffer.
+     *
+     * When 'repair' is set, a chunk that does not hold the pattern is written with it and
+     * read back once more, so only the blocks that still differ count as errors.
      */
 
     /* The result holder. */
-    int r;
-
-    /* The IO size. */
-    size_t blocksize;
-
-    /* The result buffer for calls to lseek. */
-    off64_t offset;
+    ssize_t r = 0;
 
     /* The input buffer. */
     char* b;
 
-    /* The pattern buffer that is used to check the input buffer. */
-    char* d;
+    /* The shared pattern buffer that is used to check the input buffer. */
+    nwipe_pattern_buffer_t* pb;
 
-    /* A pointer into the pattern buffer. */
-    char* q;
+    /* The file descriptor that the verification reads. */
+    int fd;
 
-    /* The pattern buffer window offset. */
-    int w = 0;
+    /* The device offset of the current chunk. */
+    u64 offset;
 
-    /* The number of bytes remaining in the pass. */
-    u64 z = c->device_size;
+    /* The number of bytes in the current chunk. */
+    size_t length;
+
+    /* The number of blocks of the current chunk that do not hold the pattern. */
+    u64 mismatches;
+
+    /* The number of bytes that were written by the repair. */
+    u64 repaired = 0;
+
+    /* The number of bytes remaining in the extent. */
+    u64 z;
+
+    /* The current extent. */
+    int e;
 
     if( pattern == NULL )
     {
         /* Caught insanity. */
-        nwipe_log( NWIPE_LOG_SANITY, "nwipe_static_verify: Null entropy pointer." );
+        nwipe_log( NWIPE_LOG_SANITY, "%s: Null entropy pointer.", __FUNCTION__ );
         return -1;
     }
 
     if( pattern->length <= 0 )
     {
         /* Caught insanity. */
-        nwipe_log( NWIPE_LOG_SANITY, "nwipe_static_verify: The pattern length member is %i.", pattern->length );
+        nwipe_log( NWIPE_LOG_SANITY, "%s: The pattern length member is %i.", __FUNCTION__, pattern->length );
         return -1;
     }
 
+    if( c->device_zone_count > 0 )
+    {
+        /* Zoned devices are read zone by zone. */
+        return nwipe_zone_verify( c, pattern );
+    }
+
     /* Create the input buffer. */
-    b = malloc( c->device_stat.st_blksize );
+    b = nwipe_arena_get( NWIPE_KNOB_VERIFY_CHUNK );
 
     /* Check the memory allocation. */
     if( !b )
     {
-        nwipe_perror( errno, __FUNCTION__, "malloc" );
+        nwipe_perror( errno, __FUNCTION__, "nwipe_arena_get" );
         nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the input buffer." );
         return -1;
     }
 
-    /* Create the pattern buffer */
-    d = malloc( c->device_stat.st_blksize + pattern->length * 2 );
+    /* Get the pattern buffer. */
+    nwipe_cpu_span( &c->cpu_meter );
+    pb = nwipe_pattern_buffer_get( pattern, c->device_stat.st_blksize );
+    nwipe_cpu_mark( &c->cpu_meter, NWIPE_STAGE_PATTERN );
 
-    /* Check the memory allocation. */
-    if( !d )
+    if( !pb )
     {
-        nwipe_perror( errno, __FUNCTION__, "malloc" );
-        nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the pattern buffer." );
-        free( b );
+        nwipe_arena_put( b );
         return -1;
     }
 
-    for( q = d; q < d + c->device_stat.st_blksize + pattern->length; q += pattern->length )
-    {
-        /* Fill the pattern buffer with the pattern. */
-        memcpy( q, pattern->s, pattern->length );
-    }
-
-    /* Tell our parent that we are syncing the device. */
-    c->sync_status = 1;
-
-    /* Sync the device. */
-    r = fdatasync( c->device_fd );
-
-    /* Tell our parent that we have finished syncing the device. */
-    c->sync_status = 0;
-
-    if( r != 0 )
+    /* Sync the device, the verification still reads back what reached it when this fails. */
+    if( nwipe_sync( c, c->device_fd ) != 0 )
     {
         /* FIXME: Is there a better way to handle this? */
         nwipe_perror( errno, __FUNCTION__, "fdatasync" );
         nwipe_log( NWIPE_LOG_WARNING, "Buffer flush failure on '%s'.", c->device_name );
     }
 
-    /* Reset the file pointer. */
-    offset = lseek( c->device_fd, 0, SEEK_SET );
+    /* Read from the media rather than from the pages that the pass left in the cache. */
+    fd = nwipe_verify_open( c );
 
     /* Reset the pass byte counter. */
     c->pass_done = 0;
 
-    if( offset == (off64_t) -1 )
-    {
-        nwipe_perror( errno, __FUNCTION__, "lseek" );
-        nwipe_log( NWIPE_LOG_FATAL, "Unable to reset the '%s' file offset.", c->device_name );
-        free( b );
-        return -1;
-    }
-
-    if( offset != 0 )
+    for( e = 0; e < c->extent_count && r >= 0; e++ )
     {
-        /* This is system insanity. */
-        nwipe_log( NWIPE_LOG_SANITY, "nwipe_static_verify: lseek() returned a bogus offset on '%s'.", c->device_name );
-        free( b );
-        free( d );
-        return -1;
-    }
+        offset = c->extents[e].start;
+        z = c->extents[e].length;
 
-    while( z > 0 )
-    {
-        if( c->device_stat.st_blksize <= z )
-        {
-            blocksize = c->device_stat.st_blksize;
-        }
-        else
+        while( z > 0 )
         {
-            /* This is a seatbelt for buggy drivers and programming errors because */
-            /* the device size should always be an even multiple of its blocksize. */
-            blocksize = z;
-            nwipe_log( NWIPE_LOG_WARNING,
-                       "%s: The size of '%s' is not a multiple of its block size %i.",
-                       __FUNCTION__,
-                       c->device_name,
-                       c->device_stat.st_blksize );
-        }
+            length = ( NWIPE_KNOB_VERIFY_CHUNK <= z ) ? NWIPE_KNOB_VERIFY_CHUNK : z;
 
-        /* Fill the output buffer with the random pattern. */
-        /* Read the buffer in from the device. */
-        r = read( c->device_fd, b, blocksize );
+            nwipe_cpu_next( &c->cpu_meter, length );
+            NWIPE_TRACE_BATCH( "read", length );
 
-        /* Check the result. */
-        if( r < 0 )
-        {
-            nwipe_perror( errno, __FUNCTION__, "read" );
-            nwipe_log( NWIPE_LOG_ERROR, "Unable to read from '%s'.", c->device_name );
-            return -1;
-        }
+            /* Read the chunk in from the device. */
+            r = pread( fd, b, length, offset );
+            nwipe_cpu_mark( &c->cpu_meter, NWIPE_STAGE_SUBMIT );
 
-        /* Check for a partial read. */
-        if( r == blocksize )
-        {
-            /* Check every byte in the buffer. */
-            if( memcmp( b, &d[w], r ) != 0 )
+            /* Check the result. */
+            if( r < 0 )
             {
-                c->verify_errors += 1;
+                nwipe_perror( errno, __FUNCTION__, "pread" );
+                nwipe_log( NWIPE_LOG_ERROR, "Unable to read from '%s'.", c->device_name );
+                break;
             }
-        }
-        else
-        {
-            /* The number of bytes that were not read. */
-            int s = blocksize - r;
 
-            /* TODO: Handle a partial read. */
+            if( r != (ssize_t) length )
+            {
+                /* TODO: Handle a partial read. */
+                nwipe_log( NWIPE_LOG_WARNING, "Partial read on '%s', %zu bytes short.", c->device_name, length - r );
+            }
 
-            /* Increment the error count. */
-            c->verify_errors += 1;
+            mismatches = nwipe_static_compare( c, b, r, pb, pattern, offset, length );
+            nwipe_cpu_mark( &c->cpu_meter, NWIPE_STAGE_COMPARE );
 
-            nwipe_log( NWIPE_LOG_WARNING, "Partial read on '%s', %i bytes short.", c->device_name, s );
+            if( repair && mismatches > 0 )
+            {
+                /* Write the chunk, and compare what is read back instead. */
+                r = nwipe_static_mend( c, fd, b, pb, offset, length );
 
-            /* Bump the file pointer to the next block. */
-            offset = lseek( c->device_fd, s, SEEK_CUR );
+                if( r < 0 )
+                {
+                    break;
+                }
 
-            if( offset == (off64_t) -1 )
-            {
-                nwipe_perror( errno, __FUNCTION__, "lseek" );
-                nwipe_log(
-                    NWIPE_LOG_ERROR, "Unable to bump the '%s' file offset after a partial read.", c->device_name );
-                return -1;
+                repaired += length;
+                mismatches = nwipe_static_compare( c, b, r, pb, pattern, offset, length );
+                nwipe_cpu_mark( &c->cpu_meter, NWIPE_STAGE_COMPARE );
             }
 
-        } /* partial read */
+            c->verify_errors += mismatches;
 
-        /* Adjust the window. */
-        w = ( c->device_stat.st_blksize + w ) % pattern->length;
+            /* Hash what was read back. */
+            nwipe_merkle_update( c, b, r );
+            nwipe_cpu_mark( &c->cpu_meter, NWIPE_STAGE_DIGEST );
 
-        /* Intuition check:
-         *   If the pattern length evenly divides the block size
-         *   then ( w == 0 ) always.
-         */
+            offset += length;
 
-        /* Decrement the bytes remaining in this pass. */
-        z -= r;
+            /* Decrement the bytes remaining in this pass. */
+            z -= length;
 
-        /* Increment the total progress counters. */
-        c->pass_done += r;
-        c->round_done += r;
+            /* Increment the total progress counters. */
+            c->pass_done += length;
+            c->round_done += length;
 
-        pthread_testcancel();
+            pthread_testcancel();
 
-    } /* while bytes remaining */
+        } /* while bytes remaining */
+
+        nwipe_merkle_extent_end( c );
+
+    } /* extents */
+
+    if( repair )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE,
+                   "Wrote %llu of %llu bytes of %s that did not hold the pattern.",
+                   repaired,
+                   c->pass_done,
+                   c->device_name );
+    }
 
     /* Release the buffers. */
-    free( b );
-    free( d );
+    nwipe_verify_close( c, fd );
+    nwipe_arena_put( b );
+    nwipe_pattern_buffer_put( pb );
 
     /* We're done. */
-    return 0;
+    return ( r < 0 ) ? -1 : 0;
+
+} /* nwipe_static_check */
+
+int nwipe_static_verify( NWIPE_METHOD_SIGNATURE, nwipe_pattern_t* pattern )
+{
+    /**
+     * Verifies that a static pass was correctly written to the device.
+     */
+
+    return nwipe_static_check( c, pattern, 0 );
 
 } /* nwipe_static_verify */
 
-int nwipe_static_pass( NWIPE_METHOD_SIGNATURE, nwipe_pattern_t* pattern )
+int nwipe_static_repair( NWIPE_METHOD_SIGNATURE, nwipe_pattern_t* pattern )
+{
+    /**
+     * Verifies a static pattern and writes it where the device does not hold it, which
+     * completes a discard with a single read of the device.
+     */
+
+    return nwipe_static_check( c, pattern, 1 );
+
+} /* nwipe_static_repair */
+
+static int nwipe_static_write( nwipe_context_t* c, nwipe_pattern_t* pattern, int skip )
 {
     /**
      * Writes a static pattern to the device.
+     *
+     * The pattern buffer is shared and immutable, so rather than copying it into a
+     * transfer sized buffer each pwritev() call carries an iovec array that points at
+     * the same pattern buffer over and over again. One system call covers up to
+     * NWIPE_KNOB_STATIC_TRANSFER bytes without a buffer of that size.
+     *
+     * When 'skip' is set, each transfer is read first and only written if the device
+     * does not already hold the pattern there.
      */
 
     /* The result holder. */
-    int r;
+    ssize_t r;
 
-    /* The IO size. */
-    size_t blocksize;
+    /* The input buffer for skip mode. */
+    char* s = NULL;
 
-    /* The result buffer for calls to lseek. */
-    off64_t offset;
+    /* The number of bytes that already held the pattern. */
+    u64 skipped = 0;
 
-    /* The output buffer. */
-    char* b;
+    /* Set when the device already holds the pattern at the current transfer. */
+    int match;
 
-    /* A pointer into the output buffer. */
-    char* p;
+    /* The shared pattern buffer. */
+    nwipe_pattern_buffer_t* pb;
 
-    /* The output buffer window offset. */
-    int w = 0;
+    /* The transfer vector. */
+    struct iovec* iov;
 
-    /* The number of bytes remaining in the pass. */
-    u64 z = c->device_size;
+    /* The number of elements in the transfer vector. */
+    int iov_count;
 
-    /* Number of writes to do before a fdatasync. */
-    int syncRate = nwipe_options.sync;
+    /* The number of elements that are used by the current transfer. */
+    int n;
+
+    /* The number of bytes in a full transfer. */
+    size_t transfer;
+
+    /* The number of bytes in the current transfer. */
+    size_t length;
+
+    /* The device offset of the next transfer. */
+    off64_t offset;
+
+    /* The number of bytes remaining in the extent. */
+    u64 z;
+
+    /* The current extent. */
+    int e;
+
+    /* Number of blocks to write before a fdatasync. */
+    u64 syncRate = nwipe_options.sync;
 
     /* Counter to track when to do a fdatasync. */
-    int i = 0;
+    u64 i = 0;
 
     if( pattern == NULL )
     {
@@ -669,156 +1541,198 @@ int nwipe_static_pass( NWIPE_METHOD_SIGNATURE, nwipe_pattern_t* pattern )
         return -1;
     }
 
-    /* Create the output buffer. */
-    b = malloc( c->device_stat.st_blksize + pattern->length * 2 );
+    if( c->device_zone_count > 0 )
+    {
+        /* Zoned devices are reset and written zone by zone, so there is nothing to skip. */
+        return nwipe_zone_pass( c, pattern );
+    }
 
-    /* Check the memory allocation. */
-    if( !b )
+    /* Get the output buffer. */
+    nwipe_cpu_span( &c->cpu_meter );
+    pb = nwipe_pattern_buffer_get( pattern, c->device_stat.st_blksize );
+    nwipe_cpu_mark( &c->cpu_meter, NWIPE_STAGE_PATTERN );
+
+    if( !pb )
+    {
+        return -1;
+    }
+
+    /* Size the transfer. */
+    transfer = nwipe_pattern_transfer( pb, &iov_count );
+
+    /* Create the transfer vector. */
+    iov = malloc( iov_count * sizeof( struct iovec ) );
+
+    if( !iov )
     {
         nwipe_perror( errno, __FUNCTION__, "malloc" );
-        nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the pattern buffer." );
+        nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the transfer vector." );
+        nwipe_pattern_buffer_put( pb );
         return -1;
     }
 
-    for( p = b; p < b + c->device_stat.st_blksize + pattern->length; p += pattern->length )
+    if( skip )
     {
-        /* Fill the output buffer with the pattern. */
-        memcpy( p, pattern->s, pattern->length );
+        /* Create the input buffer. */
+        s = nwipe_arena_get( transfer );
+
+        if( !s )
+        {
+            nwipe_perror( errno, __FUNCTION__, "nwipe_arena_get" );
+            nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the input buffer." );
+            free( iov );
+            nwipe_pattern_buffer_put( pb );
+            return -1;
+        }
     }
-    ///
-    /* Reset the file pointer. */
-    offset = lseek( c->device_fd, 0, SEEK_SET );
 
     /* Reset the pass byte counter. */
     c->pass_done = 0;
 
-    if( offset == (off64_t) -1 )
-    {
-        nwipe_perror( errno, __FUNCTION__, "lseek" );
-        nwipe_log( NWIPE_LOG_FATAL, "Unable to reset the '%s' file offset.", c->device_name );
-        return -1;
-    }
+    /* Keep the page cache footprint of the pass constant. */
+    nwipe_writeback_start( c );
 
-    if( offset != 0 )
+    if( c->device_size % c->device_stat.st_blksize != 0 )
     {
-        /* This is system insanity. */
-        nwipe_log( NWIPE_LOG_SANITY, "__FUNCTION__: lseek() returned a bogus offset on '%s'.", c->device_name );
-        return -1;
+        /* This is a seatbelt for buggy drivers and programming errors because */
+        /* the device size should always be an even multiple of its blocksize. */
+        nwipe_log( NWIPE_LOG_WARNING,
+                   "%s: The size of '%s' is not a multiple of its block size %i.",
+                   __FUNCTION__,
+                   c->device_name,
+                   c->device_stat.st_blksize );
     }
 
-    while( z > 0 )
+    for( e = 0; e < c->extent_count; e++ )
     {
-        if( c->device_stat.st_blksize <= z )
-        {
-            blocksize = c->device_stat.st_blksize;
-        }
-        else
+        offset = c->extents[e].start;
+        z = c->extents[e].length;
+
+        while( z > 0 )
         {
-            /* This is a seatbelt for buggy drivers and programming errors because */
-            /* the device size should always be an even multiple of its blocksize. */
-            blocksize = z;
-            nwipe_log( NWIPE_LOG_WARNING,
-                       "%s: The size of '%s' is not a multiple of its block size %i.",
-                       __FUNCTION__,
-                       c->device_name,
-                       c->device_stat.st_blksize );
-        }
+            length = ( transfer <= z ) ? transfer : z;
 
-        /* Fill the output buffer with the random pattern. */
-        /* Write the next block out to the device. */
-        r = write( c->device_fd, &b[w], blocksize );
+            nwipe_cpu_next( &c->cpu_meter, length );
+            NWIPE_TRACE_BATCH( "write", length );
 
-        /* Check the result for a fatal error. */
-        if( r < 0 )
-        {
-            nwipe_perror( errno, __FUNCTION__, "write" );
-            nwipe_log( NWIPE_LOG_FATAL, "Unable to write to '%s'.", c->device_name );
-            return -1;
-        }
+            if( skip )
+            {
+                /* A chunk that cannot be read is simply written. */
+                r = pread( c->device_fd, s, length, offset );
+                nwipe_cpu_mark( &c->cpu_meter, NWIPE_STAGE_SUBMIT );
 
-        /* Check for a partial write. */
-        if( r != blocksize )
-        {
-            /* TODO: Handle a partial write. */
+                match = ( r == (ssize_t) length && nwipe_pattern_match( s, pb, offset, length, pattern ) );
+                nwipe_cpu_mark( &c->cpu_meter, NWIPE_STAGE_COMPARE );
 
-            /* The number of bytes that were not written. */
-            int s = blocksize - r;
+                if( match )
+                {
+                    /* The device already holds the pattern here, so leave it alone. */
+                    nwipe_merkle_update( c, s, length );
+                    nwipe_cpu_mark( &c->cpu_meter, NWIPE_STAGE_DIGEST );
+
+                    /* The pages that were read are clean, so they can go at once. */
+                    if( !nwipe_options.cached )
+                    {
+                        posix_fadvise( c->device_fd, offset, length, POSIX_FADV_DONTNEED );
+                    }
+
+                    skipped += length;
+                    offset += length;
+                    z -= length;
+                    c->pass_done += length;
+                    c->round_done += length;
+
+                    pthread_testcancel();
+                    continue;
+                }
+            }
 
-            /* Increment the error count. */
-            c->pass_errors += s;
+            /* Point the transfer vector at the pattern buffer, starting at the slice for this offset. */
+            n = nwipe_pattern_iov( iov, pb, offset, length );
+            nwipe_cpu_mark( &c->cpu_meter, NWIPE_STAGE_PATTERN );
 
-            nwipe_log( NWIPE_LOG_WARNING, "Partial write on '%s', %i bytes short.", c->device_name, s );
+            /* Write the next transfer out to the device. */
+            NWIPE_PROBE3( chunk__submit, c->device_name, offset, length );
+            r = pwritev( c->device_fd, iov, n, offset );
+            nwipe_cpu_mark( &c->cpu_meter, NWIPE_STAGE_SUBMIT );
+            NWIPE_PROBE4( chunk__complete, c->device_name, offset, length, r );
 
-            /* Bump the file pointer to the next block. */
-            offset = lseek( c->device_fd, s, SEEK_CUR );
+            /* Check the result for a fatal error. */
+            if( r < 0 )
+            {
+                nwipe_perror( errno, __FUNCTION__, "pwritev" );
+                nwipe_log( NWIPE_LOG_FATAL, "Unable to write to '%s'.", c->device_name );
+                nwipe_arena_put( s );
+                free( iov );
+                nwipe_pattern_buffer_put( pb );
+                return -1;
+            }
 
-            if( offset == (off64_t) -1 )
+            if( r == 0 )
             {
-                nwipe_perror( errno, __FUNCTION__, "lseek" );
-                nwipe_log(
-                    NWIPE_LOG_ERROR, "Unable to bump the '%s' file offset after a partial write.", c->device_name );
+                /* The device stopped accepting data before its reported size. */
+                c->pass_errors += z;
+                nwipe_log( NWIPE_LOG_FATAL, "Unable to write to '%s', %llu bytes short.", c->device_name, z );
+                nwipe_arena_put( s );
+                free( iov );
+                nwipe_pattern_buffer_put( pb );
                 return -1;
             }
 
-        } /* partial write */
+            /* A short write is not an error by itself, the next transfer resumes where it stopped. */
 
-        /* Adjust the window. */
-        w = ( c->device_stat.st_blksize + w ) % pattern->length;
+            /* Hash what was written. */
+            nwipe_merkle_updatev( c, iov, n, r );
+            nwipe_cpu_mark( &c->cpu_meter, NWIPE_STAGE_DIGEST );
 
-        /* Intuition check:
-         *
-         *   If the pattern length evenly divides the block size
-         *   then ( w == 0 ) always.
-         */
+            nwipe_writeback_add( c, offset, r );
+            nwipe_cpu_mark( &c->cpu_meter, NWIPE_STAGE_SYNC );
 
-        /* Decrement the bytes remaining in this pass. */
-        z -= r;
+            /* Advance the device offset. */
+            offset += r;
 
-        /* Increment the total progress counterr. */
-        c->pass_done += r;
-        c->round_done += r;
+            /* Decrement the bytes remaining in this pass. */
+            z -= r;
 
-        /* Perodic Sync */
-        if( syncRate > 0 )
-        {
-            i++;
+            /* Increment the total progress counterr. */
+            c->pass_done += r;
+            c->round_done += r;
 
-            if( i >= syncRate )
+            /* Perodic Sync */
+            if( syncRate > 0 )
             {
-                /* Tell our parent that we are syncing the device. */
-                c->sync_status = 1;
+                i += r;
 
-                /* Sync the device. */
-                r = fdatasync( c->device_fd );
-
-                /* Tell our parent that we have finished syncing the device. */
-                c->sync_status = 0;
-
-                if( r != 0 )
+                if( i >= syncRate * c->device_stat.st_blksize )
                 {
-                    nwipe_perror( errno, __FUNCTION__, "fdatasync" );
-                    nwipe_log( NWIPE_LOG_WARNING, "Buffer flush failure on '%s'.", c->device_name );
-                    nwipe_log( NWIPE_LOG_WARNING, "Wrote %llu bytes on '%s'.", c->pass_done, c->device_name );
-                    free( b );
-                    return -1;
+                    /* Sync the device. */
+                    r = nwipe_sync( c, c->device_fd );
+
+                    if( r != 0 )
+                    {
+                        nwipe_perror( errno, __FUNCTION__, "fdatasync" );
+                        nwipe_log( NWIPE_LOG_WARNING, "Buffer flush failure on '%s'.", c->device_name );
+                        nwipe_log( NWIPE_LOG_WARNING, "Wrote %llu bytes on '%s'.", c->pass_done, c->device_name );
+                        nwipe_arena_put( s );
+                        free( iov );
+                        nwipe_pattern_buffer_put( pb );
+                        return -1;
+                    }
+
+                    i = 0;
                 }
-
-                i = 0;
             }
-        }
 
-        pthread_testcancel();
+            pthread_testcancel();
 
-    } /* remaining bytes */
+        } /* remaining bytes */
 
-    /* Tell our parent that we are syncing the device. */
-    c->sync_status = 1;
+        nwipe_merkle_extent_end( c );
 
-    /* Sync the device. */
-    r = fdatasync( c->device_fd );
+    } /* extents */
 
-    /* Tell our parent that we have finished syncing the device. */
-    c->sync_status = 0;
+    /* Sync the device. */
+    r = nwipe_sync( c, c->device_fd );
 
     if( r != 0 )
     {
@@ -827,10 +1741,197 @@ int nwipe_static_pass( NWIPE_METHOD_SIGNATURE, nwipe_pattern_t* pattern )
         nwipe_log( NWIPE_LOG_WARNING, "Buffer flush failure on '%s'.", c->device_name );
     }
 
-    /* Release the output buffer. */
-    free( b );
+    /* Drop the last windows, which the sync has written. */
+    nwipe_writeback_finish( c );
+
+    if( skip )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE,
+                   "Skipped %llu of %llu bytes (%.1f%%) that already held the pattern, wrote %llu bytes to %s.",
+                   skipped,
+                   c->pass_done,
+                   c->pass_done ? 100.0 * skipped / c->pass_done : 0.0,
+                   c->pass_done - skipped,
+                   c->device_name );
+    }
+
+    /* Release the buffers. */
+    nwipe_arena_put( s );
+    free( iov );
+    nwipe_pattern_buffer_put( pb );
 
     /* We're done. */
     return 0;
 
+} /* nwipe_static_write */
+
+int nwipe_static_pass( NWIPE_METHOD_SIGNATURE, nwipe_pattern_t* pattern )
+{
+    /**
+     * Writes a static pattern to the device.
+     */
+
+    return nwipe_static_write( c, pattern, 0 );
+
 } /* nwipe_static_pass */
+
+int nwipe_static_rewrite( NWIPE_METHOD_SIGNATURE, nwipe_pattern_t* pattern )
+{
+    /**
+     * Writes a static pattern to the device, skipping the chunks that already hold it.
+     *
+     * This saves writes, and flash endurance, when blanking a device that is mostly
+     * blank already. It must not be used where every block has to be overwritten.
+     */
+
+    return nwipe_static_write( c, pattern, 1 );
+
+} /* nwipe_static_rewrite */
+
+int nwipe_discard_capable( NWIPE_METHOD_SIGNATURE )
+{
+    /**
+     * Checks whether the device accepts discards, and logs whether it promises zeros afterwards.
+     *
+     * Returns non-zero when the device accepts discards.
+     */
+
+    /* The sysfs attribute, for a whole device or the device that holds a partition. */
+    char path[PATH_MAX];
+
+    /* A file handle for the attribute. */
+    FILE* fp;
+
+    /* The largest discard that the device accepts, zero when it accepts none. */
+    unsigned long long discard_max = 0;
+
+    /* The identify words that describe TRIM, for ATA devices. */
+    u16 trim_support = c->identity.words161_175[8];
+    u16 trim_zeros = c->identity.words69_70[0];
+
+    snprintf( path,
+              sizeof( path ),
+              "/sys/dev/block/%u:%u/queue/discard_max_bytes",
+              major( c->device_stat.st_rdev ),
+              minor( c->device_stat.st_rdev ) );
+
+    fp = fopen( path, "r" );
+
+    if( fp == NULL )
+    {
+        snprintf( path,
+                  sizeof( path ),
+                  "/sys/dev/block/%u:%u/../queue/discard_max_bytes",
+                  major( c->device_stat.st_rdev ),
+                  minor( c->device_stat.st_rdev ) );
+
+        fp = fopen( path, "r" );
+    }
+
+    if( fp != NULL )
+    {
+        if( fscanf( fp, "%llu", &discard_max ) != 1 )
+        {
+            discard_max = 0;
+        }
+
+        fclose( fp );
+    }
+
+    if( discard_max == 0 )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "%s does not support discard, the blank will be written.", c->device_name );
+        return 0;
+    }
+
+    /* Word 169 bit 0 is TRIM support, word 69 bit 14 is DRAT and bit 5 is RZAT. */
+    if( ( trim_support & 0x0001 ) && ( trim_zeros & 0x4000 ) && ( trim_zeros & 0x0020 ) )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE, "%s reads zeros after discard, blanking with discard.", c->device_name );
+    }
+    else
+    {
+        nwipe_log( NWIPE_LOG_NOTICE,
+                   "%s does not promise zeros after discard, blocks that are not zero will be written.",
+                   c->device_name );
+    }
+
+    return 1;
+
+} /* nwipe_discard_capable */
+
+int nwipe_discard_pass( NWIPE_METHOD_SIGNATURE )
+{
+    /**
+     * Discards the extents of the device in chunks.
+     *
+     * A failed discard is not fatal, because the pass that follows writes every
+     * block that does not read back as zero.
+     */
+
+    /* The result holder. */
+    int r;
+
+    /* The byte range of a discard. */
+    u64 range[2];
+
+    /* The device offset of the next discard. */
+    u64 offset;
+
+    /* The number of bytes in the current discard. */
+    u64 length;
+
+    /* The number of bytes remaining in the extent. */
+    u64 z;
+
+    /* The current extent. */
+    int e;
+
+    /* Reset the pass byte counter. */
+    c->pass_done = 0;
+
+    for( e = 0; e < c->extent_count; e++ )
+    {
+        offset = c->extents[e].start;
+        z = c->extents[e].length;
+
+        while( z > 0 )
+        {
+            length = ( NWIPE_KNOB_DISCARD_CHUNK <= z ) ? NWIPE_KNOB_DISCARD_CHUNK : z;
+
+            range[0] = offset;
+            range[1] = length;
+
+            NWIPE_TRACE_BEGIN( "BLKDISCARD" );
+            r = ioctl( c->device_fd, BLKDISCARD, &range );
+            NWIPE_TRACE_END( "BLKDISCARD" );
+
+            if( r != 0 )
+            {
+                nwipe_perror( errno, __FUNCTION__, "ioctl" );
+                nwipe_log( NWIPE_LOG_WARNING,
+                           "Unable to discard '%s' at offset %llu, the rest of the blank will be written.",
+                           c->device_name,
+                           offset );
+
+                /* Account for the rest of the pass, which the next pass writes. */
+                c->round_done += c->wipe_size - c->pass_done;
+                c->pass_done = c->wipe_size;
+                return 0;
+            }
+
+            offset += length;
+            z -= length;
+
+            /* Increment the total progress counters. */
+            c->pass_done += length;
+            c->round_done += length;
+
+            pthread_testcancel();
+        }
+
+    } /* extents */
+
+    return 0;
+
+} /* nwipe_discard_pass */
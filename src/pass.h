@@ -26,7 +26,14 @@
 int nwipe_random_pass( nwipe_context_t* c );
 int nwipe_random_verify( nwipe_context_t* c );
 int nwipe_static_pass( nwipe_context_t* c, nwipe_pattern_t* pattern );
+int nwipe_static_rewrite( nwipe_context_t* c, nwipe_pattern_t* pattern );
 int nwipe_static_verify( nwipe_context_t* c, nwipe_pattern_t* pattern );
+int nwipe_static_repair( nwipe_context_t* c, nwipe_pattern_t* pattern );
+int nwipe_discard_capable( nwipe_context_t* c );
+int nwipe_discard_pass( nwipe_context_t* c );
+int nwipe_extents_create( nwipe_context_t* c );
+int nwipe_sync( nwipe_context_t* c, int fd );
+void nwipe_extents_free( nwipe_context_t* c );
 
 void test_functionn( int count, nwipe_context_t** c );
 
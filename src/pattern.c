@@ -0,0 +1,460 @@
+/*
+ *  pattern.c: Shared pattern buffers for nwipe.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/* RATIONALE:
+ *
+ *   Every static pass of every device writes and compares the same few
+ *   patterns. Rather than each wipe thread building a private copy of the
+ *   pattern for each pass, the buffers live in one process-wide cache and
+ *   are shared read-only by all threads, so the memory used by static
+ *   passes does not grow with the number of devices being wiped.
+ *
+ */
+
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
+/* For IOV_MAX in <limits.h>. */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <limits.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+
+#include "nwipe.h"
+#include "context.h"
+#include "method.h"
+#include "options.h"
+#include "pattern.h"
+#include "logging.h"
+
+/* The largest pattern period that nwipe_pattern_compare() handles with a specialized loop. */
+#define NWIPE_PATTERN_WORDS 3
+
+/* The cached buffers, most recently created first. */
+static nwipe_pattern_buffer_t* nwipe_pattern_cache = NULL;
+
+/* Serializes access to the cache. */
+static pthread_mutex_t nwipe_pattern_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+size_t nwipe_gcd( size_t a, size_t b )
+{
+    /* Euclid's algorithm. */
+    size_t t;
+
+    while( b != 0 )
+    {
+        t = a % b;
+        a = b;
+        b = t;
+    }
+
+    return a;
+
+} /* nwipe_gcd */
+
+size_t nwipe_lcm( size_t a, size_t b )
+{
+    return a / nwipe_gcd( a, b ) * b;
+
+} /* nwipe_lcm */
+
+static inline __attribute__( ( always_inline ) ) void
+    nwipe_pattern_fill_n( char* b, size_t size, const char* s, const size_t n )
+{
+    /**
+     * Repeats the n byte pattern 's' across 'size' bytes of 'b'.
+     *
+     * This is always inlined so that calls with a constant 'n' compile to
+     * plain fixed size stores instead of a memcpy() call per repetition.
+     */
+
+    char* p;
+
+    for( p = b; p + n <= b + size; p += n )
+    {
+        memcpy( p, s, n );
+    }
+
+} /* nwipe_pattern_fill_n */
+
+void nwipe_pattern_fill( char* b, size_t size, nwipe_pattern_t* pattern )
+{
+    /**
+     * Fills a pattern buffer, using fast paths for the common 1 and 3 byte patterns.
+     */
+
+    switch( pattern->length )
+    {
+        case 1:
+            memset( b, pattern->s[0], size );
+            break;
+
+        case 3:
+            nwipe_pattern_fill_n( b, size, pattern->s, 3 );
+            break;
+
+        default:
+            nwipe_pattern_fill_n( b, size, pattern->s, pattern->length );
+            break;
+    }
+
+} /* nwipe_pattern_fill */
+
+static inline __attribute__( ( always_inline ) ) int
+    nwipe_pattern_compare_n( const char* b, const char* d, size_t size, const size_t n )
+{
+    /**
+     * Compares 'size' bytes of 'b' against the pattern slice 'd' whose period is 'n' bytes.
+     *
+     * Eight bytes of any pattern with an 'n' byte period repeat every 'n' words, so the
+     * input buffer is checked against 'n' words loaded from the start of the slice. The
+     * differences are accumulated without branching so that the loop can be vectorized.
+     *
+     * Returns zero when the buffer matches.
+     */
+
+    u64 e[NWIPE_PATTERN_WORDS];
+    u64 q;
+    u64 x = 0;
+    size_t i;
+    size_t j;
+    size_t words = size / ( sizeof( u64 ) * n ) * n;
+
+    if( words == 0 )
+    {
+        /* The slice may be too short to load a whole period of words from. */
+        return memcmp( b, d, size ) != 0;
+    }
+
+    for( j = 0; j < n; j++ )
+    {
+        memcpy( &e[j], d + j * sizeof( u64 ), sizeof( u64 ) );
+    }
+
+    for( i = 0; i < words; i += n )
+    {
+        for( j = 0; j < n; j++ )
+        {
+            memcpy( &q, b + ( i + j ) * sizeof( u64 ), sizeof( u64 ) );
+            x |= q ^ e[j];
+        }
+    }
+
+    if( x != 0 )
+    {
+        return 1;
+    }
+
+    /* Check the tail that does not fill a whole period of words. */
+    i *= sizeof( u64 );
+    return memcmp( b + i, d + i, size - i ) != 0;
+
+} /* nwipe_pattern_compare_n */
+
+int nwipe_pattern_compare( const char* b, const char* d, size_t size, nwipe_pattern_t* pattern )
+{
+    /**
+     * Compares an input buffer against a pre-rotated pattern slice.
+     *
+     * Returns zero when the buffer matches.
+     */
+
+    switch( pattern->length )
+    {
+        case 1:
+            return nwipe_pattern_compare_n( b, d, size, 1 );
+
+        case 3:
+            return nwipe_pattern_compare_n( b, d, size, 3 );
+
+        default:
+            return memcmp( b, d, size ) != 0;
+    }
+
+} /* nwipe_pattern_compare */
+
+int nwipe_pattern_match( const char* s,
+                         const nwipe_pattern_buffer_t* pb,
+                         u64 offset,
+                         size_t length,
+                         nwipe_pattern_t* pattern )
+{
+    /**
+     * Checks whether 'length' bytes that were read from device 'offset' hold the pattern.
+     *
+     * Returns non-zero when they do.
+     */
+
+    /* The pattern buffer window offset. */
+    size_t w = offset % pb->size;
+
+    /* The number of bytes to compare against the window. */
+    size_t n;
+
+    while( length > 0 )
+    {
+        n = ( pb->size - w <= length ) ? pb->size - w : length;
+
+        if( nwipe_pattern_compare( s, &pb->buffer[w], n, pattern ) != 0 )
+        {
+            return 0;
+        }
+
+        s += n;
+        length -= n;
+        w = 0;
+    }
+
+    return 1;
+
+} /* nwipe_pattern_match */
+
+size_t nwipe_pattern_transfer( const nwipe_pattern_buffer_t* pb, int* iov_count )
+{
+    /**
+     * Sizes a vectored transfer from the pattern buffer.
+     *
+     * The transfer is about NWIPE_KNOB_STATIC_TRANSFER bytes and a whole number of buffers,
+     * and 'iov_count' is set to the number of iovec elements that it needs, leaving one
+     * element for a leading partial buffer.
+     */
+
+    size_t transfer = NWIPE_KNOB_STATIC_TRANSFER / pb->size * pb->size;
+
+    if( transfer == 0 )
+    {
+        transfer = pb->size;
+    }
+
+    if( transfer / pb->size + 1 > IOV_MAX )
+    {
+        transfer = ( IOV_MAX - 1 ) * pb->size;
+    }
+
+    *iov_count = transfer / pb->size + 1;
+
+    return transfer;
+
+} /* nwipe_pattern_transfer */
+
+int nwipe_pattern_iov( struct iovec* iov, const nwipe_pattern_buffer_t* pb, u64 offset, size_t length )
+{
+    /**
+     * Points a transfer vector at the pattern buffer for 'length' bytes written at device 'offset'.
+     *
+     * Returns the number of elements used.
+     */
+
+    /* The pattern buffer window offset. */
+    size_t w = offset % pb->size;
+
+    /* The element counter. */
+    int n;
+
+    for( n = 0; length > 0; n++ )
+    {
+        iov[n].iov_base = (void*) &pb->buffer[w];
+        iov[n].iov_len = ( pb->size - w <= length ) ? pb->size - w : length;
+        length -= iov[n].iov_len;
+        w = 0;
+    }
+
+    return n;
+
+} /* nwipe_pattern_iov */
+
+static void nwipe_pattern_buffer_free( nwipe_pattern_buffer_t* pb )
+{
+    munmap( pb->buffer, pb->mapped );
+    free( pb->key );
+    free( pb );
+
+} /* nwipe_pattern_buffer_free */
+
+static nwipe_pattern_buffer_t* nwipe_pattern_buffer_create( nwipe_pattern_t* pattern, size_t blksize )
+{
+    /**
+     * Creates a read-only pattern buffer.
+     *
+     * The buffer length is the least common multiple of the pattern length, the i/o
+     * alignment and the transfer size, so the slice for the block at any device offset
+     * starts at ( offset % size ), is aligned, and already has the correct pattern phase.
+     *
+     * Large buffers are placed in huge pages when the system has them available.
+     */
+
+    nwipe_pattern_buffer_t* pb;
+
+    pb = calloc( 1, sizeof( nwipe_pattern_buffer_t ) );
+
+    if( pb == NULL )
+    {
+        nwipe_perror( errno, __FUNCTION__, "calloc" );
+        return NULL;
+    }
+
+    pb->key = malloc( pattern->length );
+
+    if( pb->key == NULL )
+    {
+        nwipe_perror( errno, __FUNCTION__, "malloc" );
+        free( pb );
+        return NULL;
+    }
+
+    memcpy( pb->key, pattern->s, pattern->length );
+    pb->length = pattern->length;
+    pb->blksize = blksize;
+    pb->size = nwipe_lcm( nwipe_lcm( pattern->length, NWIPE_KNOB_IO_ALIGN ), blksize );
+    pb->buffer = MAP_FAILED;
+
+    if( pb->size >= NWIPE_KNOB_HUGEPAGE_SIZE )
+    {
+        pb->mapped = ( pb->size + NWIPE_KNOB_HUGEPAGE_SIZE - 1 ) / NWIPE_KNOB_HUGEPAGE_SIZE * NWIPE_KNOB_HUGEPAGE_SIZE;
+        pb->buffer = mmap( NULL, pb->mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0 );
+        pb->hugepage = ( pb->buffer != MAP_FAILED );
+    }
+
+    if( pb->buffer == MAP_FAILED )
+    {
+        /* Fall back to normal pages. The size is always a multiple of the page aligned i/o alignment. */
+        pb->mapped = pb->size;
+        pb->buffer = mmap( NULL, pb->mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+    }
+
+    if( pb->buffer == MAP_FAILED )
+    {
+        nwipe_perror( errno, __FUNCTION__, "mmap" );
+        free( pb->key );
+        free( pb );
+        return NULL;
+    }
+
+    nwipe_pattern_fill( pb->buffer, pb->size, pattern );
+
+    /* The buffer is shared between threads, so make sure that nobody can scribble on it. */
+    if( mprotect( pb->buffer, pb->mapped, PROT_READ ) != 0 )
+    {
+        nwipe_perror( errno, __FUNCTION__, "mprotect" );
+    }
+
+    if( nwipe_options.verbose )
+    {
+        nwipe_log( NWIPE_LOG_DEBUG,
+                   "Created %zu byte pattern buffer for a %i byte pattern%s.",
+                   pb->size,
+                   pb->length,
+                   pb->hugepage ? " in huge pages" : "" );
+    }
+
+    return pb;
+
+} /* nwipe_pattern_buffer_create */
+
+nwipe_pattern_buffer_t* nwipe_pattern_buffer_get( nwipe_pattern_t* pattern, size_t blksize )
+{
+    /**
+     * Returns a shared read-only buffer for the pattern and transfer size.
+     *
+     * @parameter pattern  The static pattern.
+     * @parameter blksize  The transfer size of the device.
+     * @returns            The buffer, or NULL on failure. Release it with nwipe_pattern_buffer_put().
+     */
+
+    nwipe_pattern_buffer_t* pb;
+
+    pthread_mutex_lock( &nwipe_pattern_cache_mutex );
+
+    for( pb = nwipe_pattern_cache; pb != NULL; pb = pb->next )
+    {
+        if( pb->length == pattern->length && pb->blksize == blksize && memcmp( pb->key, pattern->s, pb->length ) == 0 )
+        {
+            break;
+        }
+    }
+
+    if( pb == NULL )
+    {
+        pb = nwipe_pattern_buffer_create( pattern, blksize );
+
+        if( pb == NULL )
+        {
+            pthread_mutex_unlock( &nwipe_pattern_cache_mutex );
+            nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the pattern buffer." );
+            return NULL;
+        }
+
+        pb->next = nwipe_pattern_cache;
+        nwipe_pattern_cache = pb;
+    }
+
+    pb->refs += 1;
+
+    pthread_mutex_unlock( &nwipe_pattern_cache_mutex );
+
+    return pb;
+
+} /* nwipe_pattern_buffer_get */
+
+void nwipe_pattern_buffer_put( nwipe_pattern_buffer_t* pb )
+{
+    /**
+     * Releases a pattern buffer.
+     *
+     * Unused buffers stay in the cache so that devices running a little behind
+     * the others can pick them up again, but only the most recent few are kept.
+     */
+
+    nwipe_pattern_buffer_t** pp;
+    nwipe_pattern_buffer_t* q;
+    int idle = 0;
+
+    if( pb == NULL )
+    {
+        return;
+    }
+
+    pthread_mutex_lock( &nwipe_pattern_cache_mutex );
+
+    pb->refs -= 1;
+
+    pp = &nwipe_pattern_cache;
+
+    while( *pp != NULL )
+    {
+        q = *pp;
+
+        if( q->refs == 0 && ++idle > NWIPE_KNOB_PATTERN_CACHE_IDLE )
+        {
+            /* Evict the oldest unused buffers. */
+            *pp = q->next;
+            nwipe_pattern_buffer_free( q );
+            continue;
+        }
+
+        pp = &q->next;
+    }
+
+    pthread_mutex_unlock( &nwipe_pattern_cache_mutex );
+
+} /* nwipe_pattern_buffer_put */
@@ -0,0 +1,66 @@
+/*
+ *  pattern.h: Shared pattern buffers for nwipe.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef PATTERN_H_
+#define PATTERN_H_
+
+struct iovec;
+
+/* An immutable buffer filled with a static pattern, shared by all wipe threads. */
+typedef struct nwipe_pattern_buffer_t_
+{
+    struct nwipe_pattern_buffer_t_* next;  // The next buffer in the cache.
+    char* key;  // A copy of the pattern bytes.
+    int length;  // The length of the pattern in bytes.
+    size_t blksize;  // The transfer size that the buffer was built for.
+    char* buffer;  // The read-only pattern data.
+    size_t size;  // The length of the buffer, a whole number of pattern periods and transfers.
+    size_t mapped;  // The length of the mapping that holds the buffer.
+    int refs;  // The number of threads using the buffer.
+    int hugepage;  // Set when the buffer is backed by huge pages.
+} nwipe_pattern_buffer_t;
+
+/* Returns a shared buffer for the pattern and transfer size, creating it if necessary. */
+nwipe_pattern_buffer_t* nwipe_pattern_buffer_get( nwipe_pattern_t* pattern, size_t blksize );
+
+/* Releases a buffer that was returned by nwipe_pattern_buffer_get(). */
+void nwipe_pattern_buffer_put( nwipe_pattern_buffer_t* pb );
+
+/* Fills 'size' bytes of 'b' with the pattern. */
+void nwipe_pattern_fill( char* b, size_t size, nwipe_pattern_t* pattern );
+
+/* Compares 'size' bytes of 'b' with the pattern slice 'd', returning zero when they match. */
+int nwipe_pattern_compare( const char* b, const char* d, size_t size, nwipe_pattern_t* pattern );
+
+/* Returns non-zero when 'length' bytes 's' that were read from device 'offset' hold the pattern. */
+int nwipe_pattern_match( const char* s,
+                         const nwipe_pattern_buffer_t* pb,
+                         u64 offset,
+                         size_t length,
+                         nwipe_pattern_t* pattern );
+
+/* Returns the size of a vectored pattern transfer, and the number of iovec elements that it needs. */
+size_t nwipe_pattern_transfer( const nwipe_pattern_buffer_t* pb, int* iov_count );
+
+/* Fills 'iov' for a transfer of 'length' bytes at device 'offset', returning the number of elements used. */
+int nwipe_pattern_iov( struct iovec* iov, const nwipe_pattern_buffer_t* pb, u64 offset, size_t length );
+
+size_t nwipe_gcd( size_t a, size_t b );
+size_t nwipe_lcm( size_t a, size_t b );
+
+#endif /* PATTERN_H_ */
@@ -0,0 +1,307 @@
+/*
+ *  preflight.c: A read-only throughput probe of the devices and a forecast of the wipe time.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "nwipe.h"
+#include "context.h"
+#include "method.h"
+#include "prng.h"
+#include "options.h"
+#include "pass.h"
+#include "logging.h"
+#include "preflight.h"
+
+/* The alignment of the probe buffer and offsets, which O_DIRECT needs. */
+#define NWIPE_PREFLIGHT_ALIGN 4096
+
+double nwipe_preflight_batch = 0;
+
+nwipe_context_t* nwipe_preflight_slowest = NULL;
+
+static void* nwipe_preflight_measure( void* ptr )
+{
+    /**
+     * Reads NWIPE_KNOB_PREFLIGHT_SAMPLE bytes at each of NWIPE_KNOB_PREFLIGHT_ZONES offsets spread
+     * from the start to the end of the device, bypassing the page cache, and sets the read rate
+     * of the device. The outer tracks of a disk are faster than the inner ones and a pass spends
+     * as many bytes in each zone, so the rate is the harmonic mean of the zones.
+     */
+
+    nwipe_context_t* c = (nwipe_context_t*) ptr;
+
+    /* The rates of the zones, for the log. */
+    char rates[128];
+    char rate[13];
+    size_t length = 0;
+
+    /* The start and end time of a zone. */
+    struct timespec start;
+    struct timespec end;
+
+    /* The seconds that each byte took, summed over the zones. */
+    double cost = 0;
+    double seconds;
+
+    /* The bytes read at each zone, and the offset of the zone. */
+    u64 sample;
+    u64 offset;
+    u64 done;
+
+    char* b;
+    ssize_t r;
+    int fd;
+    int z;
+
+    sample = (u64) c->device_size / NWIPE_KNOB_PREFLIGHT_ZONES;
+    if( sample > NWIPE_KNOB_PREFLIGHT_SAMPLE )
+    {
+        sample = NWIPE_KNOB_PREFLIGHT_SAMPLE;
+    }
+    sample -= sample % NWIPE_PREFLIGHT_ALIGN;
+
+    if( sample == 0 )
+    {
+        return NULL;
+    }
+
+    fd = open( c->device_name, O_RDONLY | O_DIRECT );
+
+    if( fd < 0 )
+    {
+        /* The cached pages are dropped before each zone instead. */
+        fd = open( c->device_name, O_RDONLY );
+    }
+
+    if( fd < 0 )
+    {
+        nwipe_perror( errno, __FUNCTION__, "open" );
+        nwipe_log( NWIPE_LOG_WARNING, "Unable to open '%s' for the pre-flight.", c->device_name );
+        return NULL;
+    }
+
+    if( posix_memalign( (void**) &b, NWIPE_PREFLIGHT_ALIGN, NWIPE_KNOB_VERIFY_CHUNK ) != 0 )
+    {
+        nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the pre-flight of '%s'.", c->device_name );
+        close( fd );
+        return NULL;
+    }
+
+    for( z = 0; z < NWIPE_KNOB_PREFLIGHT_ZONES; z++ )
+    {
+        offset = ( (u64) c->device_size - sample ) / ( NWIPE_KNOB_PREFLIGHT_ZONES - 1 ) * z;
+        offset -= offset % NWIPE_PREFLIGHT_ALIGN;
+
+        posix_fadvise( fd, offset, sample, POSIX_FADV_DONTNEED );
+
+        clock_gettime( CLOCK_MONOTONIC, &start );
+
+        for( done = 0; done < sample; done += r )
+        {
+            r = pread( fd,
+                       b,
+                       ( sample - done < NWIPE_KNOB_VERIFY_CHUNK ) ? sample - done : NWIPE_KNOB_VERIFY_CHUNK,
+                       offset + done );
+
+            if( r <= 0 )
+            {
+                nwipe_perror( errno, __FUNCTION__, "pread" );
+                nwipe_log( NWIPE_LOG_WARNING,
+                           "Unable to read '%s' at %llu for the pre-flight, it has no forecast.",
+                           c->device_name,
+                           offset + done );
+                free( b );
+                close( fd );
+                return NULL;
+            }
+        }
+
+        clock_gettime( CLOCK_MONOTONIC, &end );
+
+        seconds = ( end.tv_sec - start.tv_sec ) + ( end.tv_nsec - start.tv_nsec ) / 1e9;
+        cost += seconds / sample;
+
+        Determine_C_B_nomenclature( ( seconds > 0 ) ? (u64) ( sample / seconds ) : 0, rate, 13 );
+
+        if( length < sizeof( rates ) )
+        {
+            length += snprintf( &rates[length],
+                                sizeof( rates ) - length,
+                                "%s%s/s at %i%%",
+                                length > 0 ? ", " : "",
+                                rate,
+                                100 * z / ( NWIPE_KNOB_PREFLIGHT_ZONES - 1 ) );
+        }
+    }
+
+    free( b );
+    close( fd );
+
+    c->preflight_rate = ( cost > 0 ) ? NWIPE_KNOB_PREFLIGHT_ZONES / cost : 0;
+
+    nwipe_log( NWIPE_LOG_INFO, "Pre-flight of %s: %s", c->device_name, rates );
+
+    return NULL;
+
+} /* nwipe_preflight_measure */
+
+static double nwipe_preflight_forecast( nwipe_context_t* c )
+{
+    /**
+     * Returns the seconds that the selected method would take on the device at its read rate,
+     * from the bytes of the compiled plan, or zero when there is no forecast. Writes are taken
+     * to run at the read rate, and discards to take as long as a write.
+     */
+
+    /* The plan that the wipe would run. */
+    nwipe_plan_t* plan;
+
+    /* The bytes that the plan reads and writes. */
+    u64 size;
+
+    if( c->preflight_rate <= 0 || nwipe_extents_create( c ) != 0 )
+    {
+        nwipe_extents_free( c );
+        return 0;
+    }
+
+    plan = nwipe_plan_create( c, nwipe_options.method );
+    size = ( plan != NULL ) ? plan->size : 0;
+
+    nwipe_plan_free( plan );
+    nwipe_extents_free( c );
+
+    return size / c->preflight_rate;
+
+} /* nwipe_preflight_forecast */
+
+int nwipe_preflight( nwipe_context_t** c, int count )
+{
+    /* The probe thread of each device. */
+    pthread_t* threads;
+
+    /* Set for the devices that are being probed. */
+    char* probed;
+
+    /* The forecast of the device, and in a readable format. */
+    double seconds;
+    char rate[13];
+    int hours;
+    int minutes;
+    int secs;
+
+    /* The end of the batch, if it started now. */
+    time_t t;
+    struct tm* p;
+
+    int forecasts = 0;
+    int i;
+
+    threads = calloc( count, sizeof( pthread_t ) );
+    probed = calloc( count, sizeof( char ) );
+
+    if( threads == NULL || probed == NULL )
+    {
+        nwipe_perror( errno, __FUNCTION__, "calloc" );
+        free( threads );
+        free( probed );
+        return 0;
+    }
+
+    /* The devices are probed at once, as they will be wiped. */
+    for( i = 0; i < count; i++ )
+    {
+        if( c[i]->select == NWIPE_SELECT_TRUE && c[i]->preflight_rate <= 0 )
+        {
+            probed[i] = ( pthread_create( &threads[i], NULL, nwipe_preflight_measure, c[i] ) == 0 );
+        }
+    }
+
+    for( i = 0; i < count; i++ )
+    {
+        if( probed[i] )
+        {
+            pthread_join( threads[i], NULL );
+        }
+    }
+
+    free( threads );
+    free( probed );
+
+    nwipe_preflight_batch = 0;
+    nwipe_preflight_slowest = NULL;
+
+    for( i = 0; i < count; i++ )
+    {
+        if( c[i]->select != NWIPE_SELECT_TRUE )
+        {
+            continue;
+        }
+
+        seconds = nwipe_preflight_forecast( c[i] );
+
+        if( seconds <= 0 )
+        {
+            continue;
+        }
+
+        forecasts += 1;
+
+        Determine_C_B_nomenclature( (u64) c[i]->preflight_rate, rate, 13 );
+        convert_seconds_to_hours_minutes_seconds( (u64) seconds, &hours, &minutes, &secs );
+        nwipe_log( NWIPE_LOG_NOTICE,
+                   "Forecast for %s: %02i:%02i:%02i at %s/s",
+                   c[i]->device_name,
+                   hours,
+                   minutes,
+                   secs,
+                   rate );
+
+        /* The devices are wiped at once, so the batch takes as long as its slowest device. */
+        if( seconds > nwipe_preflight_batch )
+        {
+            nwipe_preflight_batch = seconds;
+            nwipe_preflight_slowest = c[i];
+        }
+    }
+
+    if( nwipe_preflight_slowest != NULL )
+    {
+        t = time( NULL ) + (time_t) nwipe_preflight_batch;
+        p = localtime( &t );
+
+        convert_seconds_to_hours_minutes_seconds( (u64) nwipe_preflight_batch, &hours, &minutes, &secs );
+        nwipe_log( NWIPE_LOG_NOTICE,
+                   "Forecast for the batch: %02i:%02i:%02i, until %i/%02i/%02i %02i:%02i if started now, waiting "
+                   "on %s",
+                   hours,
+                   minutes,
+                   secs,
+                   1900 + p->tm_year,
+                   1 + p->tm_mon,
+                   p->tm_mday,
+                   p->tm_hour,
+                   p->tm_min,
+                   nwipe_preflight_slowest->device_name );
+    }
+
+    return forecasts;
+
+} /* nwipe_preflight */
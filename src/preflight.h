@@ -0,0 +1,35 @@
+/*
+ *  preflight.h: A read-only throughput probe of the devices and a forecast of the wipe time.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef PREFLIGHT_H_
+#define PREFLIGHT_H_
+
+/* The forecast of the whole batch in seconds, zero until nwipe_preflight() has forecast one. */
+extern double nwipe_preflight_batch;
+
+/* The device that the batch waits for, or NULL. */
+extern nwipe_context_t* nwipe_preflight_slowest;
+
+/*
+ * Measures the sequential read rate of each selected device that has not been measured yet, all
+ * at once, and forecasts how long the selected method takes on each of them and on the batch.
+ * Nothing is written. Returns the number of selected devices with a forecast.
+ */
+int nwipe_preflight( nwipe_context_t** c, int count );
+
+#endif /* PREFLIGHT_H_ */
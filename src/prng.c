@@ -17,17 +17,25 @@
  *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <sys/syscall.h>
+
 #include "nwipe.h"
 #include "prng.h"
 #include "context.h"
 #include "logging.h"
+#include "method.h"
+#include "options.h"
 
 #include "mt19937ar-cok/mt19937ar-cok.h"
 #include "isaac_rand/isaac_rand.h"
 
-nwipe_prng_t nwipe_twister = {"Mersenne Twister (mt19937ar-cok)", nwipe_twister_init, nwipe_twister_read};
+nwipe_prng_t nwipe_twister = {"Mersenne Twister (mt19937ar-cok)", nwipe_twister_init, nwipe_twister_read, 0};
+
+nwipe_prng_t nwipe_isaac = {"ISAAC (rand.c 20010626)", nwipe_isaac_init, nwipe_isaac_read, 0};
+
+nwipe_prng_t nwipe_broadcast = {"Broadcast (shared pool, whitened)", nwipe_broadcast_init, nwipe_broadcast_read, 0};
 
-nwipe_prng_t nwipe_isaac = {"ISAAC (rand.c 20010626)", nwipe_isaac_init, nwipe_isaac_read};
+nwipe_prng_t nwipe_getrandom = {"Kernel getrandom (ChaCha20)", nwipe_getrandom_init, nwipe_getrandom_read, 1};
 
 int nwipe_u32tobuffer( u8* buffer, u32 rand, int len )
 {
@@ -151,3 +159,302 @@ int nwipe_isaac_read( NWIPE_PRNG_READ_SIGNATURE )
 
     return 0;
 }
+
+/*
+ * The broadcast PRNG generates one pool of NWIPE_KNOB_BROADCAST_POOL bytes with the Mersenne Twister
+ * the first time that any device is seeded, and shares it between all devices for the rest of the
+ * run. Each device reads the pool from its own rotation and XORs it with a keyed splitmix64 counter
+ * stream, so the bytes differ between devices and repeat neither within a device nor between
+ * rounds, while a device only costs one multiply-xorshift per eight bytes instead of a twister.
+ * The key and the rotation come from the seed of the device, so reseeding replays the stream for
+ * the verification.
+ *
+ * The security trade-off: the pool is the same on every device, so XORing the contents of two
+ * drives wiped in the same run leaves two splitmix64 streams, which are not cryptographically
+ * strong. This does not matter for destroying the old data, but the random pass of one drive
+ * is less hard to tell from that of another than with the twister or ISAAC.
+ */
+
+typedef struct
+{
+    u64 key;  // Keys the whitening stream.
+    u64 rotation;  // The pool offset of the first byte, a multiple of eight.
+    u64 position;  // The number of bytes read since the seed.
+} nwipe_broadcast_state_t;
+
+/* The shared pool, or NULL when it could not be allocated. */
+static u8* nwipe_broadcast_pool = NULL;
+static pthread_mutex_t nwipe_broadcast_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static u64 nwipe_splitmix64( u64 x )
+{
+    x += 0x9E3779B97F4A7C15ULL;
+    x = ( x ^ ( x >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+    x = ( x ^ ( x >> 27 ) ) * 0x94D049BB133111EBULL;
+    return x ^ ( x >> 31 );
+}
+
+int nwipe_broadcast_init( NWIPE_PRNG_INIT_SIGNATURE )
+{
+    nwipe_broadcast_state_t* broadcast_state;
+
+    /* The state of the twister that fills the pool. */
+    void* twister = NULL;
+
+    /* The seed folded into one word. */
+    u64 h = 0;
+    u64 w;
+
+    size_t i;
+
+    if( *state == NULL )
+    {
+        /* This is the first time that we have been called. */
+        *state = malloc( sizeof( nwipe_broadcast_state_t ) );
+
+        /* Check the memory allocation. */
+        if( *state == NULL )
+        {
+            nwipe_perror( errno, __FUNCTION__, "malloc" );
+            nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the broadcast state." );
+            return -1;
+        }
+    }
+
+    broadcast_state = *state;
+
+    pthread_mutex_lock( &nwipe_broadcast_mutex );
+
+    if( nwipe_broadcast_pool == NULL )
+    {
+        nwipe_broadcast_pool = malloc( NWIPE_KNOB_BROADCAST_POOL );
+
+        if( nwipe_broadcast_pool == NULL )
+        {
+            nwipe_perror( errno, __FUNCTION__, "malloc" );
+            nwipe_log( NWIPE_LOG_WARNING, "Unable to allocate the broadcast pool, whitening only." );
+        }
+        else
+        {
+            nwipe_twister_init( &twister, seed );
+            nwipe_twister_read( &twister, nwipe_broadcast_pool, NWIPE_KNOB_BROADCAST_POOL );
+            free( twister );
+        }
+    }
+
+    pthread_mutex_unlock( &nwipe_broadcast_mutex );
+
+    for( i = 0; i + sizeof( u64 ) <= seed->length; i += sizeof( u64 ) )
+    {
+        memcpy( &w, &seed->s[i], sizeof( u64 ) );
+        h = nwipe_splitmix64( h ^ w );
+    }
+
+    broadcast_state->key = nwipe_splitmix64( h );
+    broadcast_state->rotation = nwipe_splitmix64( h ^ broadcast_state->key ) % NWIPE_KNOB_BROADCAST_POOL & ~7ULL;
+    broadcast_state->position = 0;
+
+    return 0;
+}
+
+int nwipe_broadcast_read( NWIPE_PRNG_READ_SIGNATURE )
+{
+    nwipe_broadcast_state_t* broadcast_state = *state;
+
+    u8* b = buffer;
+
+    /* The pool word and the whitened word. */
+    u64 p = 0;
+    u64 v;
+
+    /* The pool offset of the word. */
+    u64 o;
+
+    /* The byte of the word that the position is at, and the bytes taken from the word. */
+    size_t skip;
+    size_t n;
+
+    while( count > 0 )
+    {
+        skip = broadcast_state->position % sizeof( u64 );
+        n = ( sizeof( u64 ) - skip <= count ) ? sizeof( u64 ) - skip : count;
+
+        /* The rotation is a multiple of eight, so a word never wraps around the end of the pool. */
+        o = ( broadcast_state->position - skip + broadcast_state->rotation ) % NWIPE_KNOB_BROADCAST_POOL;
+
+        if( nwipe_broadcast_pool != NULL )
+        {
+            memcpy( &p, &nwipe_broadcast_pool[o], sizeof( u64 ) );
+        }
+
+        v = p ^ nwipe_splitmix64( broadcast_state->key + broadcast_state->position / sizeof( u64 ) );
+        memcpy( b, (u8*) &v + skip, n );
+
+        b += n;
+        count -= n;
+        broadcast_state->position += n;
+    }
+
+    return 0;
+}
+
+/*
+ * The getrandom PRNG takes the stream from the ChaCha20 generator of the kernel, which is reseeded
+ * from the entropy pool by the kernel and not by nwipe, so the seed of the device is not used and
+ * a reseed does not replay the stream. The random pass keeps the CRC32C of every chunk that it
+ * writes, and the verification compares the digests of what it reads back; when the digests could
+ * not be kept the verification fails instead of regenerating a stream that differs.
+ *
+ * Block sized reads are served from a batch of NWIPE_KNOB_GETRANDOM_BATCH bytes, so the cost of the
+ * system call is spread over the batch, and reads of a batch or more go straight to the buffer.
+ * Kernels older than 3.17 have no getrandom(), they are read from NWIPE_KNOB_ENTROPY instead.
+ */
+
+typedef struct
+{
+    u8* batch;  // The bytes taken from the kernel ahead of the reads.
+    size_t fill;  // The number of bytes in the batch.
+    size_t used;  // The number of bytes of the batch that have been read.
+    int fd;  // The entropy source when there is no getrandom(), else -1.
+} nwipe_getrandom_state_t;
+
+static int nwipe_getrandom_fill( nwipe_getrandom_state_t* getrandom_state, u8* buffer, size_t count )
+{
+    ssize_t r;
+
+    while( count > 0 )
+    {
+        if( getrandom_state->fd >= 0 )
+        {
+            r = read( getrandom_state->fd, buffer, count );
+        }
+        else
+        {
+            /* Reads of more than 256 bytes can return short when a signal arrives. */
+            r = syscall( SYS_getrandom, buffer, count, 0 );
+        }
+
+        if( r < 0 && errno == EINTR )
+        {
+            continue;
+        }
+
+        if( r <= 0 )
+        {
+            nwipe_perror( errno, __FUNCTION__, getrandom_state->fd >= 0 ? "read" : "getrandom" );
+            nwipe_log( NWIPE_LOG_FATAL, "Unable to read from the kernel random number generator." );
+            return -1;
+        }
+
+        buffer += r;
+        count -= r;
+    }
+
+    return 0;
+}
+
+int nwipe_getrandom_init( NWIPE_PRNG_INIT_SIGNATURE )
+{
+    nwipe_getrandom_state_t* getrandom_state;
+
+    u8 probe;
+
+    (void) seed;
+
+    if( *state == NULL )
+    {
+        /* This is the first time that we have been called. */
+        *state = malloc( sizeof( nwipe_getrandom_state_t ) );
+
+        /* Check the memory allocation. */
+        if( *state == NULL )
+        {
+            nwipe_perror( errno, __FUNCTION__, "malloc" );
+            nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the getrandom state." );
+            return -1;
+        }
+
+        getrandom_state = *state;
+        getrandom_state->batch = malloc( NWIPE_KNOB_GETRANDOM_BATCH );
+        getrandom_state->fd = -1;
+
+        if( getrandom_state->batch == NULL )
+        {
+            nwipe_perror( errno, __FUNCTION__, "malloc" );
+            nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the getrandom batch." );
+            free( *state );
+            *state = NULL;
+            return -1;
+        }
+
+        if( syscall( SYS_getrandom, &probe, sizeof( probe ), 0 ) < 0 && errno == ENOSYS )
+        {
+            getrandom_state->fd = open( NWIPE_KNOB_ENTROPY, O_RDONLY );
+
+            if( getrandom_state->fd < 0 )
+            {
+                nwipe_perror( errno, __FUNCTION__, "open" );
+                nwipe_log( NWIPE_LOG_FATAL, "Unable to open entropy source %s.", NWIPE_KNOB_ENTROPY );
+                return -1;
+            }
+
+            nwipe_log( NWIPE_LOG_WARNING, "The kernel has no getrandom(), reading '%s'.", NWIPE_KNOB_ENTROPY );
+        }
+    }
+
+    getrandom_state = *state;
+
+    /* Drop the rest of the batch, a new pass starts on fresh bytes. */
+    getrandom_state->fill = 0;
+    getrandom_state->used = 0;
+
+    return 0;
+}
+
+int nwipe_getrandom_read( NWIPE_PRNG_READ_SIGNATURE )
+{
+    nwipe_getrandom_state_t* getrandom_state = *state;
+
+    u8* b = buffer;
+
+    size_t n;
+
+    while( count > 0 )
+    {
+        if( getrandom_state->used < getrandom_state->fill )
+        {
+            n = ( getrandom_state->fill - getrandom_state->used <= count )
+                ? getrandom_state->fill - getrandom_state->used
+                : count;
+
+            memcpy( b, getrandom_state->batch + getrandom_state->used, n );
+            getrandom_state->used += n;
+        }
+        else if( count >= NWIPE_KNOB_GETRANDOM_BATCH )
+        {
+            /* Large reads skip the copy. */
+            n = count - count % NWIPE_KNOB_GETRANDOM_BATCH;
+
+            if( nwipe_getrandom_fill( getrandom_state, b, n ) != 0 )
+            {
+                return -1;
+            }
+        }
+        else
+        {
+            if( nwipe_getrandom_fill( getrandom_state, getrandom_state->batch, NWIPE_KNOB_GETRANDOM_BATCH ) != 0 )
+            {
+                return -1;
+            }
+
+            getrandom_state->fill = NWIPE_KNOB_GETRANDOM_BATCH;
+            getrandom_state->used = 0;
+            continue;
+        }
+
+        b += n;
+        count -= n;
+    }
+
+    return 0;
+}
@@ -41,6 +41,7 @@ typedef struct
     const char* label;  // The name of the pseudo random number generator.
     nwipe_prng_init_t init;  // Inialize the prng state with the seed.
     nwipe_prng_read_t read;  // Read data from the prng.
+    int unseeded;  // Set when reseeding does not replay the stream, so only digests can verify it.
 } nwipe_prng_t;
 
 /* Mersenne Twister prototypes. */
@@ -51,6 +52,14 @@ int nwipe_twister_read( NWIPE_PRNG_READ_SIGNATURE );
 int nwipe_isaac_init( NWIPE_PRNG_INIT_SIGNATURE );
 int nwipe_isaac_read( NWIPE_PRNG_READ_SIGNATURE );
 
+/* Broadcast prototypes. */
+int nwipe_broadcast_init( NWIPE_PRNG_INIT_SIGNATURE );
+int nwipe_broadcast_read( NWIPE_PRNG_READ_SIGNATURE );
+
+/* Kernel random prototypes. */
+int nwipe_getrandom_init( NWIPE_PRNG_INIT_SIGNATURE );
+int nwipe_getrandom_read( NWIPE_PRNG_READ_SIGNATURE );
+
 /* Size of the twister is not derived from the architecture, but it is strictly 4 bytes */
 #define SIZE_OF_TWISTER 4
 
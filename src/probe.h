@@ -0,0 +1,78 @@
+/*
+ *  probe.h: Static probes of the nwipe provider for bpftrace, perf and SystemTap.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef PROBE_H_
+#define PROBE_H_
+
+/*
+ * When <sys/sdt.h> of SystemTap is found at build time, each probe is a nop instruction with a
+ * note in the .note.stapsdt section that names it and where its arguments are, so a tracer can
+ * attach with usdt:/usr/bin/nwipe:nwipe:<probe>. The header is all there is to it, nwipe does
+ * not link against anything more. Without the header the probes compile to nothing.
+ *
+ * The probes and their arguments, where device is the device name and offset and length are bytes:
+ *
+ *   round__start( device, round, rounds )          round__end( device, round, rounds )
+ *   pass__start( device, pass, op )                pass__end( device, pass, op, result )
+ *   chunk__submit( device, offset, length )        chunk__complete( device, offset, length, result )
+ *   sync__begin( device )                          sync__end( device, result )
+ *   verify__mismatch( device, offset, length )
+ *
+ * The op of a pass is the nwipe_step_op_t of the step, 0 for a write, 1 for a verification and 2
+ * for a discard, and the pass is 0 for the steps that follow the last round. A chunk is a write
+ * to the device, its latency is the time between submit and complete on the same thread.
+ *
+ * See the scripts in bpftrace/ for examples.
+ */
+
+#if defined( __has_include )
+#if __has_include( <sys/sdt.h> )
+#include <sys/sdt.h>
+#define NWIPE_PROBES 1
+#endif
+#endif
+
+#ifdef NWIPE_PROBES
+
+#define NWIPE_PROBE1( name, a1 ) DTRACE_PROBE1( nwipe, name, a1 )
+#define NWIPE_PROBE2( name, a1, a2 ) DTRACE_PROBE2( nwipe, name, a1, a2 )
+#define NWIPE_PROBE3( name, a1, a2, a3 ) DTRACE_PROBE3( nwipe, name, a1, a2, a3 )
+#define NWIPE_PROBE4( name, a1, a2, a3, a4 ) DTRACE_PROBE4( nwipe, name, a1, a2, a3, a4 )
+
+#else
+
+#define NWIPE_PROBE1( name, a1 ) \
+    do                           \
+    {                            \
+    } while( 0 )
+#define NWIPE_PROBE2( name, a1, a2 ) \
+    do                               \
+    {                                \
+    } while( 0 )
+#define NWIPE_PROBE3( name, a1, a2, a3 ) \
+    do                                   \
+    {                                    \
+    } while( 0 )
+#define NWIPE_PROBE4( name, a1, a2, a3, a4 ) \
+    do                                       \
+    {                                        \
+    } while( 0 )
+
+#endif
+
+#endif /* PROBE_H_ */
@@ -0,0 +1,427 @@
+/*
+ *  trace.c: A recorder of timed events, written out in the Chrome trace format.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <stdarg.h>
+#include <sys/syscall.h>
+
+#include "nwipe.h"
+#include "context.h"
+#include "method.h"
+#include "prng.h"
+#include "options.h"
+#include "logging.h"
+#include "trace.h"
+
+/* An event in a ring. */
+typedef struct nwipe_trace_event_t_
+{
+    u64 time;  // CLOCK_MONOTONIC in nanoseconds.
+    const char* name;  // The name of the span, a string literal.
+    pid_t tid;  // The thread that recorded the event, rings are reused by later threads.
+    char phase;  // 'B' for begin or 'E' for end.
+} nwipe_trace_event_t;
+
+/* The ring of events of a thread. */
+typedef struct nwipe_trace_ring_t_
+{
+    nwipe_trace_event_t* events;  // NWIPE_KNOB_TRACE_EVENTS events.
+    u64 head;  // The number of events that were ever recorded, the next one goes to head % NWIPE_KNOB_TRACE_EVENTS.
+    pid_t tid;  // The thread that owns the ring.
+    int idle;  // Set when the owning thread has exited and the ring can be taken by a new thread.
+    const char* batch;  // The name of the open batch span, or NULL.
+    u64 batch_bytes;  // The bytes counted into the open batch span.
+    struct nwipe_trace_ring_t_* next;  // The next ring in the list of all rings.
+} nwipe_trace_ring_t;
+
+/* The name of a thread. */
+typedef struct nwipe_trace_thread_t_
+{
+    pid_t tid;
+    char name[64];
+} nwipe_trace_thread_t;
+
+int nwipe_trace_enabled = 0;
+
+/* The trace file. */
+static char nwipe_trace_path[FILENAME_MAX];
+
+/* Serializes the list of rings, the thread names and the writing of the file, but not recording. */
+static pthread_mutex_t nwipe_trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* All rings that were created. */
+static nwipe_trace_ring_t* nwipe_trace_rings = NULL;
+
+/* The names of the threads. */
+static nwipe_trace_thread_t* nwipe_trace_threads = NULL;
+static int nwipe_trace_thread_count = 0;
+
+/* Releases the ring of a thread when the thread exits. */
+static pthread_key_t nwipe_trace_key;
+
+/* The ring of the calling thread. */
+static __thread nwipe_trace_ring_t* nwipe_trace_self = NULL;
+
+static u64 nwipe_trace_now( void )
+{
+    struct timespec t;
+
+    clock_gettime( CLOCK_MONOTONIC, &t );
+
+    return (u64) t.tv_sec * 1000000000ULL + (u64) t.tv_nsec;
+
+} /* nwipe_trace_now */
+
+static void nwipe_trace_release( void* ptr )
+{
+    /**
+     * Closes the open batch of an exiting thread and hands its ring to the next new thread,
+     * so that the short lived threads of each verification do not each keep a ring.
+     */
+
+    nwipe_trace_ring_t* ring = (nwipe_trace_ring_t*) ptr;
+
+    nwipe_trace_batch( NULL, 0 );
+
+    pthread_mutex_lock( &nwipe_trace_mutex );
+    ring->idle = 1;
+    pthread_mutex_unlock( &nwipe_trace_mutex );
+
+    nwipe_trace_self = NULL;
+
+} /* nwipe_trace_release */
+
+static nwipe_trace_ring_t* nwipe_trace_ring( void )
+{
+    /**
+     * Returns the ring of the calling thread, taking an idle ring or creating one on first use.
+     */
+
+    nwipe_trace_ring_t* ring;
+
+    if( nwipe_trace_self != NULL )
+    {
+        return nwipe_trace_self;
+    }
+
+    pthread_mutex_lock( &nwipe_trace_mutex );
+
+    for( ring = nwipe_trace_rings; ring != NULL && !ring->idle; ring = ring->next )
+        ;
+
+    if( ring == NULL )
+    {
+        ring = calloc( 1, sizeof( nwipe_trace_ring_t ) );
+
+        if( ring != NULL )
+        {
+            ring->events = calloc( NWIPE_KNOB_TRACE_EVENTS, sizeof( nwipe_trace_event_t ) );
+
+            if( ring->events == NULL )
+            {
+                free( ring );
+                ring = NULL;
+            }
+            else
+            {
+                ring->next = nwipe_trace_rings;
+                nwipe_trace_rings = ring;
+            }
+        }
+    }
+
+    if( ring != NULL )
+    {
+        ring->idle = 0;
+        ring->tid = (pid_t) syscall( SYS_gettid );
+        ring->batch = NULL;
+        ring->batch_bytes = 0;
+        nwipe_trace_self = ring;
+        pthread_setspecific( nwipe_trace_key, ring );
+    }
+
+    pthread_mutex_unlock( &nwipe_trace_mutex );
+
+    return ring;
+
+} /* nwipe_trace_ring */
+
+int nwipe_trace_open( const char* path )
+{
+    /**
+     * Starts recording. The file is created straight away, so that a path that cannot be
+     * written is reported before the wipe rather than after it.
+     */
+
+    FILE* fp;
+
+    fp = fopen( path, "w" );
+
+    if( fp == NULL )
+    {
+        nwipe_perror( errno, __FUNCTION__, "fopen" );
+        nwipe_log( NWIPE_LOG_ERROR, "Unable to create the trace file '%s'.", path );
+        return -1;
+    }
+
+    fclose( fp );
+
+    if( pthread_key_create( &nwipe_trace_key, nwipe_trace_release ) != 0 )
+    {
+        return -1;
+    }
+
+    strncpy( nwipe_trace_path, path, sizeof( nwipe_trace_path ) - 1 );
+    nwipe_trace_enabled = 1;
+
+    nwipe_trace_name( "main" );
+
+    return 0;
+
+} /* nwipe_trace_open */
+
+void nwipe_trace_name( const char* format, ... )
+{
+    /* The arguments of the name. */
+    va_list ap;
+
+    /* The name of the calling thread. */
+    char name[sizeof( nwipe_trace_threads->name )];
+
+    /* The thread. */
+    pid_t tid;
+
+    /* The grown array of names. */
+    nwipe_trace_thread_t* threads;
+
+    char* p;
+    int i;
+
+    if( !nwipe_trace_enabled )
+    {
+        return;
+    }
+
+    va_start( ap, format );
+    vsnprintf( name, sizeof( name ), format, ap );
+    va_end( ap );
+
+    /* The name is written into the JSON as is. */
+    for( p = name; *p != 0; p++ )
+    {
+        if( *p == '"' || *p == '\\' || (unsigned char) *p < ' ' )
+        {
+            *p = '_';
+        }
+    }
+
+    tid = (pid_t) syscall( SYS_gettid );
+
+    pthread_mutex_lock( &nwipe_trace_mutex );
+
+    /* Thread ids are reused, the latest thread with an id names it. */
+    for( i = 0; i < nwipe_trace_thread_count && nwipe_trace_threads[i].tid != tid; i++ )
+        ;
+
+    if( i == nwipe_trace_thread_count )
+    {
+        threads = realloc( nwipe_trace_threads, ( i + 1 ) * sizeof( nwipe_trace_thread_t ) );
+
+        if( threads != NULL )
+        {
+            nwipe_trace_threads = threads;
+            nwipe_trace_thread_count += 1;
+        }
+    }
+
+    if( i < nwipe_trace_thread_count )
+    {
+        nwipe_trace_threads[i].tid = tid;
+        strcpy( nwipe_trace_threads[i].name, name );
+    }
+
+    pthread_mutex_unlock( &nwipe_trace_mutex );
+
+} /* nwipe_trace_name */
+
+void nwipe_trace_event( const char* name, char phase )
+{
+    /**
+     * Only the owning thread writes to a ring. The head is published after the event, so a
+     * concurrent nwipe_trace_write() sees whole events, although the oldest events of a full
+     * ring may be overwritten while it writes them out.
+     */
+
+    nwipe_trace_ring_t* ring = nwipe_trace_ring();
+
+    nwipe_trace_event_t* event;
+
+    if( ring == NULL )
+    {
+        return;
+    }
+
+    event = &ring->events[ring->head % NWIPE_KNOB_TRACE_EVENTS];
+    event->time = nwipe_trace_now();
+    event->name = name;
+    event->tid = ring->tid;
+    event->phase = phase;
+
+    __atomic_store_n( &ring->head, ring->head + 1, __ATOMIC_RELEASE );
+
+} /* nwipe_trace_event */
+
+void nwipe_trace_batch( const char* name, size_t length )
+{
+    nwipe_trace_ring_t* ring = nwipe_trace_self;
+
+    if( ring != NULL && ring->batch != NULL && ( name == NULL || ring->batch_bytes >= NWIPE_KNOB_TRACE_BATCH ) )
+    {
+        nwipe_trace_event( ring->batch, 'E' );
+        ring->batch = NULL;
+    }
+
+    if( name == NULL )
+    {
+        return;
+    }
+
+    ring = nwipe_trace_ring();
+
+    if( ring == NULL )
+    {
+        return;
+    }
+
+    if( ring->batch == NULL )
+    {
+        nwipe_trace_event( name, 'B' );
+        ring->batch = name;
+        ring->batch_bytes = 0;
+    }
+
+    ring->batch_bytes += length;
+
+} /* nwipe_trace_batch */
+
+void nwipe_trace_write( void )
+{
+    /**
+     * Writes the rings to a temporary file that replaces the trace file, so the trace file is
+     * always complete. Events are in the JSON object format of the Trace Event Format.
+     */
+
+    /* The temporary file. */
+    char path[FILENAME_MAX + 8];
+
+    /* The process id of every event. */
+    pid_t pid = getpid();
+
+    /* Separates the events. */
+    const char* comma = "";
+
+    nwipe_trace_ring_t* ring;
+    nwipe_trace_event_t* event;
+    FILE* fp;
+    u64 head;
+    u64 i;
+    int t;
+
+    if( nwipe_trace_path[0] == 0 )
+    {
+        return;
+    }
+
+    snprintf( path, sizeof( path ), "%s.tmp", nwipe_trace_path );
+
+    pthread_mutex_lock( &nwipe_trace_mutex );
+
+    fp = fopen( path, "w" );
+
+    if( fp == NULL )
+    {
+        pthread_mutex_unlock( &nwipe_trace_mutex );
+        nwipe_perror( errno, __FUNCTION__, "fopen" );
+        nwipe_log( NWIPE_LOG_ERROR, "Unable to write the trace file '%s'.", path );
+        return;
+    }
+
+    fprintf( fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" );
+
+    for( t = 0; t < nwipe_trace_thread_count; t++ )
+    {
+        fprintf( fp,
+                 "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                 comma,
+                 (int) pid,
+                 (int) nwipe_trace_threads[t].tid,
+                 nwipe_trace_threads[t].name );
+        comma = ",";
+    }
+
+    for( ring = nwipe_trace_rings; ring != NULL; ring = ring->next )
+    {
+        head = __atomic_load_n( &ring->head, __ATOMIC_ACQUIRE );
+
+        for( i = ( head > NWIPE_KNOB_TRACE_EVENTS ) ? head - NWIPE_KNOB_TRACE_EVENTS : 0; i < head; i++ )
+        {
+            event = &ring->events[i % NWIPE_KNOB_TRACE_EVENTS];
+            fprintf( fp,
+                     "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%llu.%03llu,\"pid\":%d,\"tid\":%d}",
+                     comma,
+                     event->name,
+                     event->phase,
+                     event->time / 1000,
+                     event->time % 1000,
+                     (int) pid,
+                     (int) event->tid );
+            comma = ",";
+        }
+    }
+
+    fprintf( fp, "\n]}\n" );
+
+    if( fclose( fp ) != 0 || rename( path, nwipe_trace_path ) != 0 )
+    {
+        pthread_mutex_unlock( &nwipe_trace_mutex );
+        nwipe_perror( errno, __FUNCTION__, "rename" );
+        nwipe_log( NWIPE_LOG_ERROR, "Unable to write the trace file '%s'.", nwipe_trace_path );
+        return;
+    }
+
+    pthread_mutex_unlock( &nwipe_trace_mutex );
+
+} /* nwipe_trace_write */
+
+void nwipe_trace_close( void )
+{
+    /**
+     * The rings are left to the exit of the process, as the signal thread may still be
+     * recording an event.
+     */
+
+    if( !nwipe_trace_enabled )
+    {
+        return;
+    }
+
+    nwipe_trace_enabled = 0;
+    nwipe_trace_write();
+
+    nwipe_log( NWIPE_LOG_NOTICE, "Wrote the trace to '%s'.", nwipe_trace_path );
+
+} /* nwipe_trace_close */
@@ -0,0 +1,94 @@
+/*
+ *  trace.h: A recorder of timed events, written out in the Chrome trace format.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+/*
+ * Each thread records begin and end events into a ring of its own, so recording takes no lock.
+ * The rings are written to the --trace file as JSON that chrome://tracing and Perfetto open,
+ * when nwipe exits and on SIGUSR1. Event names must be string literals, the rings keep pointers.
+ *
+ * Without --trace each event site costs a single branch that is predicted not taken.
+ */
+
+/* Set while events are recorded. */
+extern int nwipe_trace_enabled;
+
+/* Starts a span of the calling thread. */
+#define NWIPE_TRACE_BEGIN( name )                        \
+    do                                                   \
+    {                                                    \
+        if( __builtin_expect( nwipe_trace_enabled, 0 ) ) \
+        {                                                \
+            nwipe_trace_event( name, 'B' );              \
+        }                                                \
+    } while( 0 )
+
+/* Ends the innermost span of the calling thread, which must have the same name. */
+#define NWIPE_TRACE_END( name )                          \
+    do                                                   \
+    {                                                    \
+        if( __builtin_expect( nwipe_trace_enabled, 0 ) ) \
+        {                                                \
+            nwipe_trace_event( name, 'E' );              \
+        }                                                \
+    } while( 0 )
+
+/*
+ * Counts 'length' bytes of a loop into a batch span, which ends and starts again once it covers
+ * NWIPE_KNOB_TRACE_BATCH bytes, so that loops over small blocks do not flood the ring.
+ */
+#define NWIPE_TRACE_BATCH( name, length )                \
+    do                                                   \
+    {                                                    \
+        if( __builtin_expect( nwipe_trace_enabled, 0 ) ) \
+        {                                                \
+            nwipe_trace_batch( name, length );           \
+        }                                                \
+    } while( 0 )
+
+/* Ends the open batch span of the calling thread, if there is one. */
+#define NWIPE_TRACE_BATCH_END()                          \
+    do                                                   \
+    {                                                    \
+        if( __builtin_expect( nwipe_trace_enabled, 0 ) ) \
+        {                                                \
+            nwipe_trace_batch( NULL, 0 );                \
+        }                                                \
+    } while( 0 )
+
+/* Starts recording events, which are written to 'path'. */
+int nwipe_trace_open( const char* path );
+
+/* Names the calling thread in the trace. */
+void nwipe_trace_name( const char* format, ... );
+
+/* Records an event of the calling thread, use the macros above instead. */
+void nwipe_trace_event( const char* name, char phase );
+
+/* Counts bytes into a batch span, or ends it when 'name' is NULL, use the macros above instead. */
+void nwipe_trace_batch( const char* name, size_t length );
+
+/* Writes the recorded events to the trace file. */
+void nwipe_trace_write( void );
+
+/* Writes the trace file a last time and stops recording. */
+void nwipe_trace_close( void );
+
+#endif /* TRACE_H_ */
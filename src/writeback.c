@@ -0,0 +1,161 @@
+/*
+ *  writeback.c: Keeps the buffered writes of a pass out of the page cache.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "nwipe.h"
+#include "context.h"
+#include "method.h"
+#include "prng.h"
+#include "options.h"
+#include "logging.h"
+#include "trace.h"
+#include "writeback.h"
+
+static int nwipe_writeback_range( nwipe_context_t* c, u64 offset, u64 length, unsigned int flags, int drop )
+{
+    /**
+     * Writes back a range, waiting for it when 'flags' say so, and drops it from the page cache
+     * when 'drop' is set. Returns zero on success, the writeback stops otherwise.
+     */
+
+    int r;
+
+    r = sync_file_range( c->device_fd, offset, length, flags );
+
+    if( r == 0 && drop )
+    {
+        r = posix_fadvise( c->device_fd, offset, length, POSIX_FADV_DONTNEED );
+
+        /* posix_fadvise() returns the error rather than setting errno. */
+        if( r != 0 )
+        {
+            errno = r;
+        }
+    }
+
+    if( r != 0 )
+    {
+        nwipe_perror( errno, __FUNCTION__, drop ? "sync_file_range/posix_fadvise" : "sync_file_range" );
+        nwipe_log( NWIPE_LOG_WARNING,
+                   "Unable to write back '%s', the rest of the pass goes through the page cache.",
+                   c->device_name );
+        c->writeback.failed = 1;
+    }
+
+    return r;
+
+} /* nwipe_writeback_range */
+
+static void nwipe_writeback_drop( nwipe_context_t* c )
+{
+    /**
+     * Waits for the oldest window and drops it.
+     */
+
+    nwipe_extent_t* w = &c->writeback.window[0];
+
+    NWIPE_TRACE_BEGIN( "wait writeback" );
+    nwipe_writeback_range(
+        c, w->start, w->length, SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER, 1 );
+    NWIPE_TRACE_END( "wait writeback" );
+
+    c->writeback.count -= 1;
+    memmove( &c->writeback.window[0], &c->writeback.window[1], c->writeback.count * sizeof( nwipe_extent_t ) );
+
+} /* nwipe_writeback_drop */
+
+static void nwipe_writeback_submit( nwipe_context_t* c )
+{
+    /**
+     * Starts the writeback of what was written since the last window, making room for it first.
+     */
+
+    nwipe_writeback_t* wb = &c->writeback;
+
+    if( wb->end == wb->start )
+    {
+        return;
+    }
+
+    if( wb->count == NWIPE_WRITEBACK_WINDOWS )
+    {
+        nwipe_writeback_drop( c );
+    }
+
+    if( !wb->failed && nwipe_writeback_range( c, wb->start, wb->end - wb->start, SYNC_FILE_RANGE_WRITE, 0 ) == 0 )
+    {
+        wb->window[wb->count].start = wb->start;
+        wb->window[wb->count].length = wb->end - wb->start;
+        wb->count += 1;
+    }
+
+    wb->start = wb->end;
+
+} /* nwipe_writeback_submit */
+
+void nwipe_writeback_start( nwipe_context_t* c )
+{
+    memset( &c->writeback, 0, sizeof( c->writeback ) );
+
+} /* nwipe_writeback_start */
+
+void nwipe_writeback_add( nwipe_context_t* c, u64 offset, size_t length )
+{
+    nwipe_writeback_t* wb = &c->writeback;
+
+    if( nwipe_options.cached || wb->failed )
+    {
+        return;
+    }
+
+    if( offset != wb->end )
+    {
+        /* The pass moved on to another extent, or skipped a range. */
+        nwipe_writeback_submit( c );
+        wb->start = offset;
+    }
+
+    wb->end = offset + length;
+
+    if( wb->end - wb->start >= NWIPE_KNOB_WRITEBACK_WINDOW )
+    {
+        nwipe_writeback_submit( c );
+    }
+
+} /* nwipe_writeback_add */
+
+void nwipe_writeback_finish( nwipe_context_t* c )
+{
+    if( nwipe_options.cached )
+    {
+        return;
+    }
+
+    nwipe_writeback_submit( c );
+
+    while( c->writeback.count > 0 && !c->writeback.failed )
+    {
+        nwipe_writeback_drop( c );
+    }
+
+    c->writeback.count = 0;
+
+} /* nwipe_writeback_finish */
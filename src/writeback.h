@@ -0,0 +1,39 @@
+/*
+ *  writeback.h: Keeps the buffered writes of a pass out of the page cache.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef WRITEBACK_H_
+#define WRITEBACK_H_
+
+/*
+ * The passes write through the page cache, which would otherwise fill with the pattern and flush
+ * it all at each fdatasync(). Every NWIPE_KNOB_WRITEBACK_WINDOW bytes that a pass has written are
+ * handed to the kernel with sync_file_range( SYNC_FILE_RANGE_WRITE ), and the window that is
+ * NWIPE_WRITEBACK_WINDOWS windows older is waited for and dropped with POSIX_FADV_DONTNEED, so a
+ * pass keeps about five windows in the cache whatever the size of the device. --cached turns it off.
+ */
+
+/* Starts the writeback of a pass. */
+void nwipe_writeback_start( nwipe_context_t* c );
+
+/* Notes that 'length' bytes were written at 'offset'. */
+void nwipe_writeback_add( nwipe_context_t* c, u64 offset, size_t length );
+
+/* Writes back and drops what the pass left in the page cache. */
+void nwipe_writeback_finish( nwipe_context_t* c );
+
+#endif /* WRITEBACK_H_ */
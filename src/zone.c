@@ -0,0 +1,831 @@
+/*
+ *  zone.c: Zoned block device support for nwipe.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+/* RATIONALE:
+ *
+ *   Host-managed SMR drives and zoned NVMe namespaces only accept writes at
+ *   the write pointer of each sequential zone, so the usual pass that
+ *   rewrites the device from offset zero fails as soon as it reaches a zone
+ *   that already holds data. On these devices every pass resets a zone and
+ *   then appends to it from start to capacity. Zones are independent, so
+ *   static passes write several of them at once, up to the number of zones
+ *   that the device can keep open. Random passes and verification walk the
+ *   zones in device order so that the PRNG stream lines up between them.
+ *
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <limits.h>
+#include <linux/blkzoned.h>
+#include <sys/sysmacros.h>
+#include <sys/uio.h>
+
+#include "nwipe.h"
+#include "context.h"
+#include "method.h"
+#include "prng.h"
+#include "options.h"
+#include "pattern.h"
+#include "pass.h"
+#include "zone.h"
+#include "logging.h"
+#include "cpu.h"
+#include "trace.h"
+#include "probe.h"
+#include "arena.h"
+#include "ioprio.h"
+
+/* The state that is shared by the threads writing the zones of one device. */
+typedef struct nwipe_zone_job_t_
+{
+    nwipe_context_t* c;  // The device.
+    int fd;  // The O_DIRECT file descriptor that the zones are written through.
+    nwipe_pattern_t* pattern;  // The static pattern, or NULL for the PRNG stream.
+    nwipe_pattern_buffer_t* pb;  // The shared pattern buffer for a static pattern.
+    char* b;  // The output buffer for the PRNG stream.
+    char* s;  // The input buffer for verification.
+    size_t transfer;  // The number of bytes in a full transfer.
+    int iov_count;  // The number of iovec elements that a transfer needs.
+    int next;  // The index of the next zone to write, claimed atomically.
+    int failed;  // Set when a thread could not write its zone.
+    pthread_t* threads;  // The worker threads.
+    int thread_count;  // The number of worker threads that were started.
+} nwipe_zone_job_t;
+
+static int nwipe_zone_attribute( nwipe_context_t* c, const char* name, char* value, size_t size )
+{
+    /**
+     * Reads a queue attribute of the device from sysfs.
+     *
+     * Returns zero on success.
+     */
+
+    /* The sysfs attribute, for a whole device or the device that holds a partition. */
+    char path[PATH_MAX];
+
+    /* A file handle for the attribute. */
+    FILE* fp;
+
+    snprintf( path,
+              sizeof( path ),
+              "/sys/dev/block/%u:%u/queue/%s",
+              major( c->device_stat.st_rdev ),
+              minor( c->device_stat.st_rdev ),
+              name );
+
+    fp = fopen( path, "r" );
+
+    if( fp == NULL )
+    {
+        snprintf( path,
+                  sizeof( path ),
+                  "/sys/dev/block/%u:%u/../queue/%s",
+                  major( c->device_stat.st_rdev ),
+                  minor( c->device_stat.st_rdev ),
+                  name );
+
+        fp = fopen( path, "r" );
+    }
+
+    if( fp == NULL )
+    {
+        return -1;
+    }
+
+    if( fgets( value, size, fp ) == NULL )
+    {
+        fclose( fp );
+        return -1;
+    }
+
+    fclose( fp );
+
+    /* Strip the trailing newline. */
+    value[strcspn( value, "\n" )] = 0;
+
+    return 0;
+
+} /* nwipe_zone_attribute */
+
+int nwipe_zone_probe( nwipe_context_t* c )
+{
+    /**
+     * Reads the zone layout of the device with BLKREPORTZONE.
+     *
+     * Devices that are not zoned are left alone and zero is returned.
+     *
+     * @parameter c  The device.
+     * @returns      The number of zones, or -1 on failure.
+     */
+
+    /* A sysfs attribute value. */
+    char value[64];
+
+    /* The zone report buffer. */
+    struct blk_zone_report* report;
+
+    /* A zone descriptor in the report. */
+    struct blk_zone* z;
+
+    /* The grown zone array. */
+    nwipe_zone_t* zones;
+
+    /* The next sector to report on. */
+    u64 sector = 0;
+
+    /* The number of zones that the zone array has room for. */
+    int allocated = 0;
+
+    /* The number of zones that can be written at once. */
+    int open_max = 0;
+    int active_max = 0;
+
+    /* An index variable. */
+    unsigned int i;
+
+    c->device_zone_count = 0;
+    c->device_zones = NULL;
+    c->device_zone_open = 0;
+
+    if( nwipe_zone_attribute( c, "zoned", value, sizeof( value ) ) != 0 || strcmp( value, "none" ) == 0 )
+    {
+        /* This is not a zoned device. */
+        return 0;
+    }
+
+    report = malloc( sizeof( struct blk_zone_report ) + NWIPE_KNOB_ZONE_REPORT * sizeof( struct blk_zone ) );
+
+    if( report == NULL )
+    {
+        nwipe_perror( errno, __FUNCTION__, "malloc" );
+        nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the zone report." );
+        return -1;
+    }
+
+    while( sector < (u64) c->device_size / 512 )
+    {
+        memset( report, 0, sizeof( struct blk_zone_report ) + NWIPE_KNOB_ZONE_REPORT * sizeof( struct blk_zone ) );
+        report->sector = sector;
+        report->nr_zones = NWIPE_KNOB_ZONE_REPORT;
+
+        if( ioctl( c->device_fd, BLKREPORTZONE, report ) != 0 )
+        {
+            nwipe_perror( errno, __FUNCTION__, "ioctl" );
+            nwipe_log( NWIPE_LOG_FATAL, "Unable to report the zones of '%s'.", c->device_name );
+            free( report );
+            nwipe_zone_free( c );
+            return -1;
+        }
+
+        if( report->nr_zones == 0 )
+        {
+            break;
+        }
+
+        if( c->device_zone_count + (int) report->nr_zones > allocated )
+        {
+            allocated = c->device_zone_count + report->nr_zones + allocated;
+            zones = realloc( c->device_zones, allocated * sizeof( nwipe_zone_t ) );
+
+            if( zones == NULL )
+            {
+                nwipe_perror( errno, __FUNCTION__, "realloc" );
+                nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the zones of '%s'.", c->device_name );
+                free( report );
+                nwipe_zone_free( c );
+                return -1;
+            }
+
+            c->device_zones = zones;
+        }
+
+        for( i = 0; i < report->nr_zones; i++ )
+        {
+            z = &report->zones[i];
+
+            c->device_zones[c->device_zone_count].start = z->start * 512;
+            c->device_zones[c->device_zone_count].length = z->len * 512;
+            c->device_zones[c->device_zone_count].capacity =
+                ( ( report->flags & BLK_ZONE_REP_CAPACITY ) ? z->capacity : z->len ) * 512;
+            c->device_zones[c->device_zone_count].conventional = ( z->type == BLK_ZONE_TYPE_CONVENTIONAL );
+
+            if( z->cond == BLK_ZONE_COND_READONLY || z->cond == BLK_ZONE_COND_OFFLINE )
+            {
+                /* Nothing can be written here, so the zone is only counted towards the progress. */
+                c->device_zones[c->device_zone_count].capacity = 0;
+                c->pass_errors += z->len * 512;
+                nwipe_log( NWIPE_LOG_WARNING,
+                           "Zone at %llu of '%s' is %s and will not be wiped.",
+                           z->start * 512,
+                           c->device_name,
+                           z->cond == BLK_ZONE_COND_READONLY ? "read-only" : "offline" );
+            }
+
+            c->device_zone_count += 1;
+            sector = z->start + z->len;
+        }
+    }
+
+    free( report );
+
+    if( nwipe_zone_attribute( c, "max_open_zones", value, sizeof( value ) ) == 0 )
+    {
+        open_max = atoi( value );
+    }
+
+    if( nwipe_zone_attribute( c, "max_active_zones", value, sizeof( value ) ) == 0 )
+    {
+        active_max = atoi( value );
+    }
+
+    /* Zero means that the device does not limit the number of zones. */
+    if( active_max > 0 && ( open_max == 0 || active_max < open_max ) )
+    {
+        open_max = active_max;
+    }
+
+    c->device_zone_open = open_max;
+
+    nwipe_log( NWIPE_LOG_NOTICE,
+               "%s is a zoned device with %i zones, %i can be open at once.",
+               c->device_name,
+               c->device_zone_count,
+               c->device_zone_open );
+
+    if( nwipe_options.discard || nwipe_options.skipmatching )
+    {
+        nwipe_log( NWIPE_LOG_NOTICE,
+                   "Zones are reset before they are written, so --discard and --skipmatching do not apply to %s.",
+                   c->device_name );
+    }
+
+    return c->device_zone_count;
+
+} /* nwipe_zone_probe */
+
+void nwipe_zone_free( nwipe_context_t* c )
+{
+    free( c->device_zones );
+    c->device_zones = NULL;
+    c->device_zone_count = 0;
+
+} /* nwipe_zone_free */
+
+static int nwipe_zone_open( nwipe_context_t* c )
+{
+    /**
+     * Opens the device for direct i/o, which sequential zones need so that the
+     * page cache cannot reorder the writes behind the write pointer.
+     */
+
+    int fd = open( c->device_name, O_RDWR | O_DIRECT );
+
+    if( fd < 0 )
+    {
+        nwipe_perror( errno, __FUNCTION__, "open" );
+        nwipe_log( NWIPE_LOG_FATAL, "Unable to open '%s' for direct i/o.", c->device_name );
+    }
+
+    return fd;
+
+} /* nwipe_zone_open */
+
+static void nwipe_zone_progress( nwipe_context_t* c, u64 bytes )
+{
+    /* Several threads may be writing zones of the same device. */
+    __sync_fetch_and_add( &c->pass_done, bytes );
+    __sync_fetch_and_add( &c->round_done, bytes );
+
+} /* nwipe_zone_progress */
+
+static int nwipe_zone_write( nwipe_zone_job_t* job, nwipe_zone_t* zone, struct iovec* iov, nwipe_cpu_meter_t* meter )
+{
+    /**
+     * Resets a zone and appends the pattern to it from the start to its capacity.
+     */
+
+    /* The device. */
+    nwipe_context_t* c = job->c;
+
+    /* The zone range for BLKRESETZONE. */
+    struct blk_zone_range range;
+
+    /* The result holder. */
+    ssize_t r;
+
+    /* The number of elements used by the current transfer. */
+    int n;
+
+    /* The number of bytes in the current transfer. */
+    size_t length;
+
+    /* The device offset of the next transfer. */
+    u64 offset = zone->start;
+
+    if( !zone->conventional && zone->capacity > 0 )
+    {
+        range.sector = zone->start / 512;
+        range.nr_sectors = zone->length / 512;
+
+        if( ioctl( job->fd, BLKRESETZONE, &range ) != 0 )
+        {
+            nwipe_perror( errno, __FUNCTION__, "ioctl" );
+            nwipe_log( NWIPE_LOG_FATAL, "Unable to reset the zone at %llu of '%s'.", zone->start, c->device_name );
+            return -1;
+        }
+    }
+
+    while( offset < zone->start + zone->capacity )
+    {
+        length = ( job->transfer <= zone->start + zone->capacity - offset ) ? job->transfer
+                                                                            : zone->start + zone->capacity - offset;
+
+        nwipe_cpu_next( meter, length );
+
+        if( job->pattern != NULL )
+        {
+            n = nwipe_pattern_iov( iov, job->pb, offset, length );
+            nwipe_cpu_mark( meter, NWIPE_STAGE_PATTERN );
+        }
+        else
+        {
+            /* Fill the output buffer with the random pattern. */
+            c->prng->read( &c->prng_state, job->b, length );
+            iov[0].iov_base = job->b;
+            iov[0].iov_len = length;
+            n = 1;
+            nwipe_cpu_mark( meter, NWIPE_STAGE_PRNG );
+        }
+
+        NWIPE_PROBE3( chunk__submit, c->device_name, offset, length );
+        r = pwritev( job->fd, iov, n, offset );
+        nwipe_cpu_mark( meter, NWIPE_STAGE_SUBMIT );
+        NWIPE_PROBE4( chunk__complete, c->device_name, offset, length, r );
+
+        if( r < 0 )
+        {
+            nwipe_perror( errno, __FUNCTION__, "pwritev" );
+            nwipe_log( NWIPE_LOG_FATAL, "Unable to write to the zone at %llu of '%s'.", zone->start, c->device_name );
+            return -1;
+        }
+
+        if( r != (ssize_t) length )
+        {
+            /* Anything else would leave a gap behind the write pointer. */
+            __sync_fetch_and_add( &c->pass_errors, zone->start + zone->capacity - offset - r );
+            nwipe_log( NWIPE_LOG_FATAL,
+                       "Partial write to the zone at %llu of '%s', %zu bytes short.",
+                       zone->start,
+                       c->device_name,
+                       length - r );
+            return -1;
+        }
+
+        offset += r;
+        nwipe_zone_progress( c, r );
+
+        pthread_testcancel();
+    }
+
+    /* The bytes beyond the zone capacity cannot be written or read. */
+    nwipe_zone_progress( c, zone->length - zone->capacity );
+
+    return 0;
+
+} /* nwipe_zone_write */
+
+static void nwipe_zone_work( nwipe_zone_job_t* job, nwipe_cpu_meter_t* meter )
+{
+    /**
+     * Writes zones until none are left.
+     */
+
+    /* The transfer vector. */
+    struct iovec* iov;
+
+    /* The claimed zone. */
+    int i;
+
+    iov = malloc( job->iov_count * sizeof( struct iovec ) );
+
+    if( iov == NULL )
+    {
+        nwipe_perror( errno, __FUNCTION__, "malloc" );
+        nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the transfer vector." );
+        job->failed = 1;
+        return;
+    }
+
+    pthread_cleanup_push( free, iov );
+
+    while( !job->failed )
+    {
+        i = __sync_fetch_and_add( &job->next, 1 );
+
+        if( i >= job->c->device_zone_count )
+        {
+            break;
+        }
+
+        NWIPE_TRACE_BEGIN( "zone" );
+
+        if( nwipe_zone_write( job, &job->c->device_zones[i], iov, meter ) != 0 )
+        {
+            job->failed = 1;
+        }
+
+        NWIPE_TRACE_END( "zone" );
+    }
+
+    pthread_cleanup_pop( 1 );
+
+} /* nwipe_zone_work */
+
+static void* nwipe_zone_worker( void* ptr )
+{
+    /**
+     * Writes zones on a thread of its own, which has its own CPU meter.
+     */
+
+    nwipe_zone_job_t* job = (nwipe_zone_job_t*) ptr;
+
+    /* The CPU meter of this thread. */
+    nwipe_cpu_meter_t meter;
+
+    nwipe_cpu_start( &meter, job->c );
+    nwipe_trace_name( "zone writer %s", job->c->device_name );
+
+    pthread_cleanup_push( nwipe_cpu_cleanup, &meter );
+
+    nwipe_ioprio_join( job->c );
+    pthread_cleanup_push( nwipe_ioprio_leave, job->c );
+
+    nwipe_zone_work( job, &meter );
+
+    pthread_cleanup_pop( 1 );
+    pthread_cleanup_pop( 1 );
+
+    return NULL;
+
+} /* nwipe_zone_worker */
+
+static void nwipe_zone_cleanup( void* ptr )
+{
+    /**
+     * Stops the workers and releases the job, also when the wipe thread is cancelled.
+     */
+
+    nwipe_zone_job_t* job = (nwipe_zone_job_t*) ptr;
+
+    /* An index variable. */
+    int i;
+
+    for( i = 0; i < job->thread_count; i++ )
+    {
+        pthread_cancel( job->threads[i] );
+    }
+
+    for( i = 0; i < job->thread_count; i++ )
+    {
+        pthread_join( job->threads[i], NULL );
+    }
+
+    free( job->threads );
+    nwipe_arena_put( job->b );
+    nwipe_arena_put( job->s );
+    nwipe_pattern_buffer_put( job->pb );
+
+    if( job->fd >= 0 )
+    {
+        close( job->fd );
+    }
+
+} /* nwipe_zone_cleanup */
+
+int nwipe_zone_pass( nwipe_context_t* c, nwipe_pattern_t* pattern )
+{
+    /**
+     * Writes a pass to a zoned device.
+     *
+     * Static passes write up to NWIPE_KNOB_ZONE_THREADS zones at once, but never more
+     * than the device can keep open. The PRNG stream must be written in device order
+     * for the verification to regenerate it, so random passes use one thread.
+     *
+     * @parameter c        The device.
+     * @parameter pattern  The static pattern, or NULL for the PRNG stream.
+     * @returns            Zero on success, -1 on failure.
+     */
+
+    /* The shared job state. */
+    nwipe_zone_job_t job;
+
+    /* The result holder. */
+    int r;
+
+    /* The number of worker threads to start. */
+    int threads = 1;
+
+    /* An index variable. */
+    int i;
+
+    memset( &job, 0, sizeof( job ) );
+    job.c = c;
+    job.pattern = pattern;
+    job.fd = nwipe_zone_open( c );
+
+    if( job.fd < 0 )
+    {
+        return -1;
+    }
+
+    pthread_cleanup_push( nwipe_zone_cleanup, &job );
+
+    if( pattern != NULL )
+    {
+        job.pb = nwipe_pattern_buffer_get( pattern, c->device_stat.st_blksize );
+
+        if( job.pb == NULL )
+        {
+            job.failed = 1;
+        }
+        else
+        {
+            job.transfer = nwipe_pattern_transfer( job.pb, &job.iov_count );
+
+            threads = NWIPE_KNOB_ZONE_THREADS;
+
+            if( c->device_zone_open > 0 && c->device_zone_open < threads )
+            {
+                threads = c->device_zone_open;
+            }
+
+            if( threads > c->device_zone_count )
+            {
+                threads = c->device_zone_count;
+            }
+        }
+    }
+    else
+    {
+        /* The transfer is a multiple of every block size, so zone boundaries never split a block. */
+        job.transfer = NWIPE_KNOB_STATIC_TRANSFER;
+        job.iov_count = 1;
+
+        job.b = nwipe_arena_get( job.transfer );
+
+        if( !job.b )
+        {
+            nwipe_perror( errno, __FUNCTION__, "nwipe_arena_get" );
+            nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the output buffer." );
+            job.failed = 1;
+        }
+        else
+        {
+            /* Seed the PRNG. */
+            c->prng->init( &c->prng_state, &c->prng_seed );
+        }
+    }
+
+    /* Reset the pass byte counter. */
+    c->pass_done = 0;
+
+    if( !job.failed && threads > 1 )
+    {
+        job.threads = malloc( threads * sizeof( pthread_t ) );
+
+        if( job.threads == NULL )
+        {
+            nwipe_perror( errno, __FUNCTION__, "malloc" );
+        }
+
+        for( i = 0; job.threads != NULL && i < threads; i++ )
+        {
+            r = pthread_create( &job.threads[i], NULL, nwipe_zone_worker, &job );
+
+            if( r != 0 )
+            {
+                nwipe_perror( r, __FUNCTION__, "pthread_create" );
+                break;
+            }
+
+            job.thread_count += 1;
+        }
+
+        if( nwipe_options.verbose )
+        {
+            nwipe_log( NWIPE_LOG_DEBUG, "Writing %i zones of %s at once.", job.thread_count, c->device_name );
+        }
+    }
+
+    if( !job.failed && job.thread_count == 0 )
+    {
+        /* Write the zones on this thread, also when no worker could be started. */
+        nwipe_zone_work( &job, &c->cpu_meter );
+    }
+
+    while( job.thread_count > 0 )
+    {
+        pthread_join( job.threads[job.thread_count - 1], NULL );
+        job.thread_count -= 1;
+    }
+
+    if( !job.failed )
+    {
+        /* Flush the volatile cache of the device. */
+        r = nwipe_sync( c, job.fd );
+
+        if( r != 0 )
+        {
+            nwipe_perror( errno, __FUNCTION__, "fdatasync" );
+            nwipe_log( NWIPE_LOG_WARNING, "Buffer flush failure on '%s'.", c->device_name );
+        }
+    }
+
+    r = job.failed ? -1 : 0;
+
+    pthread_cleanup_pop( 1 );
+
+    return r;
+
+} /* nwipe_zone_pass */
+
+int nwipe_zone_verify( nwipe_context_t* c, nwipe_pattern_t* pattern )
+{
+    /**
+     * Verifies a pass on a zoned device, zone by zone in device order.
+     *
+     * Only the capacity of each zone was written, so the rest is not read.
+     *
+     * @parameter c        The device.
+     * @parameter pattern  The static pattern, or NULL for the PRNG stream.
+     * @returns            Zero on success, -1 on failure.
+     */
+
+    /* The shared job state, which holds the buffers and the file descriptor. */
+    nwipe_zone_job_t job;
+
+    /* The result holder. */
+    ssize_t r;
+
+    /* The current zone. */
+    nwipe_zone_t* zone;
+
+    /* The device offset of the next transfer. */
+    u64 offset;
+
+    /* The number of bytes in the current transfer. */
+    size_t length;
+
+    /* The offset of the current block in the transfer. */
+    size_t k;
+
+    /* The number of bytes in the current block. */
+    size_t n;
+
+    /* An index variable. */
+    int i;
+
+    memset( &job, 0, sizeof( job ) );
+    job.c = c;
+    job.pattern = pattern;
+    job.fd = nwipe_zone_open( c );
+
+    if( job.fd < 0 )
+    {
+        return -1;
+    }
+
+    pthread_cleanup_push( nwipe_zone_cleanup, &job );
+
+    if( pattern != NULL )
+    {
+        job.pb = nwipe_pattern_buffer_get( pattern, c->device_stat.st_blksize );
+        job.failed = ( job.pb == NULL );
+        job.transfer = job.failed ? 0 : nwipe_pattern_transfer( job.pb, &job.iov_count );
+    }
+    else
+    {
+        job.transfer = NWIPE_KNOB_STATIC_TRANSFER;
+        job.b = nwipe_arena_get( job.transfer );
+
+        if( !job.b )
+        {
+            nwipe_perror( errno, __FUNCTION__, "nwipe_arena_get" );
+            nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the pattern buffer." );
+            job.failed = 1;
+        }
+        else
+        {
+            /* Seed the PRNG. */
+            c->prng->init( &c->prng_state, &c->prng_seed );
+        }
+    }
+
+    if( !job.failed )
+    {
+        job.s = nwipe_arena_get( job.transfer );
+
+        if( !job.s )
+        {
+            nwipe_perror( errno, __FUNCTION__, "nwipe_arena_get" );
+            nwipe_log( NWIPE_LOG_FATAL, "Unable to allocate memory for the input buffer." );
+            job.failed = 1;
+        }
+    }
+
+    /* Reset the pass byte counter. */
+    c->pass_done = 0;
+
+    for( i = 0; !job.failed && i < c->device_zone_count; i++ )
+    {
+        zone = &c->device_zones[i];
+
+        for( offset = zone->start; offset < zone->start + zone->capacity; offset += length )
+        {
+            length = ( job.transfer <= zone->start + zone->capacity - offset ) ? job.transfer
+                                                                               : zone->start + zone->capacity - offset;
+
+            nwipe_cpu_next( &c->cpu_meter, length );
+            NWIPE_TRACE_BATCH( "read", length );
+
+            if( pattern == NULL )
+            {
+                /* Regenerate the stream whether or not the read succeeds, to stay in step with the pass. */
+                c->prng->read( &c->prng_state, job.b, length );
+                nwipe_cpu_mark( &c->cpu_meter, NWIPE_STAGE_PRNG );
+            }
+
+            r = pread( job.fd, job.s, length, offset );
+            nwipe_cpu_mark( &c->cpu_meter, NWIPE_STAGE_SUBMIT );
+
+            if( r < 0 )
+            {
+                nwipe_perror( errno, __FUNCTION__, "pread" );
+                nwipe_log( NWIPE_LOG_ERROR, "Unable to read from '%s'.", c->device_name );
+                job.failed = 1;
+                break;
+            }
+
+            NWIPE_TRACE_BEGIN( "compare" );
+            for( k = 0; k < length; k += n )
+            {
+                n = ( c->device_stat.st_blksize <= length - k ) ? c->device_stat.st_blksize : length - k;
+
+                if( k + n > (size_t) r )
+                {
+                    /* The block was not read. */
+                    c->verify_errors += 1;
+                    NWIPE_PROBE3( verify__mismatch, c->device_name, offset + k, n );
+                }
+                else if( pattern != NULL ? !nwipe_pattern_match( &job.s[k], job.pb, offset + k, n, pattern )
+                                         : memcmp( &job.s[k], &job.b[k], n ) != 0 )
+                {
+                    c->verify_errors += 1;
+                    NWIPE_PROBE3( verify__mismatch, c->device_name, offset + k, n );
+                }
+            }
+
+            NWIPE_TRACE_END( "compare" );
+            nwipe_cpu_mark( &c->cpu_meter, NWIPE_STAGE_COMPARE );
+
+            if( r != (ssize_t) length )
+            {
+                nwipe_log( NWIPE_LOG_WARNING, "Partial read on '%s', %zu bytes short.", c->device_name, length - r );
+            }
+
+            nwipe_zone_progress( c, length );
+
+            pthread_testcancel();
+        }
+
+        if( !job.failed )
+        {
+            nwipe_zone_progress( c, zone->length - zone->capacity );
+        }
+    }
+
+    r = job.failed ? -1 : 0;
+
+    pthread_cleanup_pop( 1 );
+
+    return r;
+
+} /* nwipe_zone_verify */
@@ -0,0 +1,43 @@
+/*
+ *  zone.h: Zoned block device support for nwipe.
+ *
+ *  This program is free software; you can redistribute it and/or modify it under
+ *  the terms of the GNU General Public License as published by the Free Software
+ *  Foundation, version 2.
+ *
+ *  This program is distributed in the hope that it will be useful, but WITHOUT
+ *  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ *  FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ *  details.
+ *
+ *  You should have received a copy of the GNU General Public License along with
+ *  this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef ZONE_H_
+#define ZONE_H_
+
+/* A zone of a zoned block device, in bytes. */
+typedef struct nwipe_zone_t_
+{
+    u64 start;  // The device offset of the zone.
+    u64 length;  // The length of the zone.
+    u64 capacity;  // The number of bytes at the start of the zone that can be written.
+    int conventional;  // Set when the zone has no write pointer and can be written anywhere.
+} nwipe_zone_t;
+
+/* Reads the zone layout of a zoned device into the context, returning the number of zones or -1. */
+int nwipe_zone_probe( nwipe_context_t* c );
+
+/* Releases the zone layout. */
+void nwipe_zone_free( nwipe_context_t* c );
+
+/* Resets and writes every zone, with the static pattern or with the PRNG stream when 'pattern' is NULL. */
+int nwipe_zone_pass( nwipe_context_t* c, nwipe_pattern_t* pattern );
+
+/* Verifies every zone against the static pattern, or against the PRNG stream when 'pattern' is NULL. */
+int nwipe_zone_verify( nwipe_context_t* c, nwipe_pattern_t* pattern );
+
+#endif /* ZONE_H_ */